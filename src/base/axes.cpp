@@ -23,6 +23,7 @@
 #include "base/viewpane.h"
 #include "session/session.h"
 #include "render/fontinstance.h"
+#include <QElapsedTimer>
 
 // Static Members
 template<class Axes> RefList<Axes,int> ObjectStore<Axes>::objects_;
@@ -97,6 +98,7 @@ Axes::Axes(ViewPane& parent) : parent_(parent), ObjectStore<Axes>(this, ObjectTy
 	// Versions
 	axesVersion_ = 0;
 	displayVersion_ = 0;
+	styleVersion_ = 0;
 
 	// GL
 	for (int n=0; n<3; ++n)
@@ -117,6 +119,8 @@ Axes::Axes(ViewPane& parent) : parent_(parent), ObjectStore<Axes>(this, ObjectTy
 	gridLineMajorStyle_[2] = gridLineMajorStyle_[0];
 	gridLineMinorStyle_[2] = gridLineMinorStyle_[0];
 	primitiveVersion_ = -1;
+	gridLinesFlags_ = -1;
+	for (int n=0; n<3; ++n) regenerationTime_[n] = 0.0;
 }
 
 // Destructor
@@ -127,6 +131,7 @@ Axes::~Axes()
 // Copy constructor
 Axes::Axes(const Axes& source) : parent_(parent_), ObjectStore<Axes>(NULL, ObjectTypes::AxesObject)
 {
+	styleVersion_ = 0;
 	(*this) = source;
 }
 
@@ -197,12 +202,19 @@ void Axes::operator=(const Axes& source)
 	// Versions
 	axesVersion_ = 0;
 	displayVersion_ = 0;
+	++styleVersion_;
 
 	// GL
 	clipPlaneYMin_ = 0.0;
 	clipPlaneYMax_ = 0.0;
 	parent_.paneChanged();
 	primitiveVersion_ = -1;
+	gridLinesFlags_ = -1;
+	for (int n=0; n<3; ++n)
+	{
+		axisPrimitiveKey_[n].clear();
+		regenerationTime_[n] = 0.0;
+	}
 }
 
 /*
@@ -444,6 +456,7 @@ void Axes::setInverted(int axis, bool b)
 	inverted_[axis] = b;
 
 	++axesVersion_;
+	++styleVersion_;
 	++displayVersion_;
 }
 
@@ -467,6 +480,7 @@ void Axes::setLogarithmic(int axis, bool b)
 	clamp(axis);
 
 	++axesVersion_;
+	++styleVersion_;
 	++displayVersion_;
 
 	parent_.recalculateView();
@@ -517,6 +531,7 @@ void Axes::setPositionIsFractional(int axis, bool b)
 	positionIsFractional_[axis] = b;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -535,6 +550,7 @@ void Axes::setPositionReal(int axis, int dir, double value)
 	positionReal_[axis].set(dir, value);
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -564,6 +580,7 @@ void Axes::setPositionFractional(int axis, int dir, double value)
 	positionFractional_[axis].set(dir, value);
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -709,6 +726,7 @@ void Axes::setTickDirection(int axis, int dir, double value)
 	tickDirection_[axis].set(dir, value);
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -740,6 +758,7 @@ void Axes::setTickSize(int axis, double size)
 	tickSize_[axis] = size;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -758,6 +777,7 @@ void Axes::setFirstTick(int axis, double value)
 	tickFirst_[axis] = value;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 
@@ -777,6 +797,7 @@ void Axes::setTickDelta(int axis, double value)
 	tickDelta_[axis] = value;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -795,6 +816,7 @@ void Axes::setAutoTicks(int axis, bool b)
 	autoTicks_[axis] = b;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -813,6 +835,7 @@ void Axes::setMinorTicks(int axis, int value)
 	minorTicks_[axis] = value;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -841,6 +864,7 @@ void Axes::setLabelOrientation(int axis, int component, double value)
 	labelOrientation_[axis].set(component, value);
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -872,6 +896,7 @@ void Axes::setLabelAnchor(int axis, TextPrimitive::TextAnchor anchor)
 	labelAnchor_[axis] = anchor;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -903,6 +928,7 @@ void Axes::setTitle(int axis, QString title)
 	title_[axis] = title;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -921,6 +947,7 @@ void Axes::setTitleOrientation(int axis, int component, double value)
 	titleOrientation_[axis].set(component, value);
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -952,6 +979,7 @@ void Axes::setTitleAnchor(int axis, TextPrimitive::TextAnchor anchor)
 	titleAnchor_[axis] = anchor;
 
 	++axesVersion_;
+	++styleVersion_;
 
 	parent_.paneChanged();
 }
@@ -985,6 +1013,7 @@ void Axes::setUseBestFlatView(bool b)
 	useBestFlatView_ = b;
 
 	++axesVersion_;
+	++styleVersion_;
 }
 
 // Return whether to use best tick/label orientation for flat views
@@ -999,6 +1028,7 @@ void Axes::setAutoPositionTitles(bool b)
 	autoPositionTitles_ = b;
 
 	++axesVersion_;
+	++styleVersion_;
 }
 
 // Return whether to automatically place titles at a sensible position after label text
@@ -1076,30 +1106,255 @@ int Axes::axesVersion()
 	return axesVersion_;
 }
 
+// Return version of axis style, i.e. all properties except limits and stretch factors
+int Axes::styleVersion() const
+{
+	return styleVersion_;
+}
+
 // Return version of axis properties affecting data display
 int Axes::displayVersion() const
 {
 	return displayVersion_;
 }
 
+// Return signature of the transforms applied to displayed data (limits, inversion, log scaling, and stretch factors)
+QString Axes::transformSignature() const
+{
+	// These are exactly the properties whose setters increment displayVersion_, but unlike the version the signature may be compared between different axes
+	QString signature;
+	for (int axis=0; axis<3; ++axis) signature += QString("%1 %2 %3 %4 %5 ").arg(min_.get(axis), 0, 'g', 17).arg(max_.get(axis), 0, 'g', 17).arg(inverted_.get(axis)).arg(logarithmic_.get(axis)).arg(stretch_.get(axis), 0, 'g', 17);
+	return signature;
+}
+
 /*
  * GL
  */
 
+// Return key describing all inputs to the primitives for the specified axis
+QString Axes::axisPrimitiveKey(int axis, Matrix& viewRotationInverse)
+{
+	QString key = QString("%1 %2 %3 %4 %5 %6").arg(styleVersion_).arg(FontInstance::fontVersion()).arg(parent_.viewType()).arg(parent_.labelPointSize(), 0, 'g', 17).arg(parent_.titlePointSize(), 0, 'g', 17).arg(parent_.flatLabels());
+	key += QString(" %1 %2 %3").arg(min_[axis], 0, 'g', 17).arg(max_[axis], 0, 'g', 17).arg(stretch_[axis], 0, 'g', 17);
+	for (int n=0; n<3; ++n) key += QString(" %1 %2").arg(coordMin_[axis][n], 0, 'g', 17).arg(coordMax_[axis][n], 0, 'g', 17);
+
+	// Automatically-positioned titles also depend on the text scaling and the view rotation
+	if ((useBestFlatView_ && parent_.isFlatView()) || autoPositionTitles_)
+	{
+		key += QString(" %1").arg(parent_.textZScale(), 0, 'g', 17);
+		for (int n=0; n<16; ++n) key += QString(" %1").arg(viewRotationInverse[n], 0, 'g', 17);
+	}
+
+	return key;
+}
+
+// Return (cached) label text for value on specified axis
+QString Axes::labelText(int axis, double value)
+{
+	// Discard cached text if the number format has changed since it was generated, or if we have accumulated too many values
+	if ((labelTextFormat_[axis] != numberFormat_[axis]) || (labelText_[axis].count() > 4096))
+	{
+		labelText_[axis].clear();
+		labelTextFormat_[axis] = numberFormat_[axis];
+	}
+
+	QHash<double,QString>::const_iterator it = labelText_[axis].constFind(value);
+	if (it != labelText_[axis].constEnd()) return it.value();
+
+	QString s = numberFormat_[axis].format(value);
+	labelText_[axis].insert(value, s);
+	return s;
+}
+
+// Generate primitives for specified axis
+void Axes::generateAxisPrimitives(int axis, const Matrix& viewRotationInverse, int inPlaneAxis)
+{
+	QString s;
+	double delta, value;
+	Vec3<double> u, tickDir, adjustment;
+	Matrix labelTransform, titleTransform;
+
+	// Clear old axis primitives, keeping existing text primitives for reuse
+	axisPrimitives_[axis].forgetAll();
+	labelPrimitives_[axis].recycleAll();
+	titlePrimitives_[axis].recycleAll();
+	tickPositions_[axis].clear();
+	tickIsMajor_[axis].clear();
+
+	// Normalise tickDirection
+	tickDir = tickDirection(axis);
+	tickDir.normalise();
+
+	// Create tick label transformation matrix
+	labelTransform.setIdentity();
+	// -- 1) Apply axial rotation along label left-to-right direction
+	if (parent_.viewType() == ViewPane::FlatZYView) labelTransform.applyRotationY(labelOrientation(axis).x);
+	else labelTransform.applyRotationX(labelOrientation(axis).x);
+	// -- 2) Perform in-plane rotation
+	if (inPlaneAxis == 0) labelTransform.applyRotationX(labelOrientation(axis).y);
+	else if (inPlaneAxis == 1) labelTransform.applyRotationY(labelOrientation(axis).y);
+	else labelTransform.applyRotationZ(labelOrientation(axis).y);
+
+	// Create axis title transformation matrix
+	titleTransform.setIdentity();
+	// -- 1) Apply axial rotation along label left-to-right direction
+	if (parent_.viewType() == ViewPane::FlatZYView) titleTransform.applyRotationY(titleOrientation(axis).x);
+	else titleTransform.applyRotationX(titleOrientation(axis).x);
+	// -- 2) Perform in-plane rotation
+	if (inPlaneAxis == 0) titleTransform.applyRotationX(titleOrientation(axis).y);
+	else if (inPlaneAxis == 1) titleTransform.applyRotationY(titleOrientation(axis).y);
+	else titleTransform.applyRotationZ(titleOrientation(axis).y);
+
+	// Add axis labels
+	if (logarithmic_[axis])
+	{
+		// For the log axis, the associated surface data coordinate will already be in log form
+		if (max_[axis] < 0.0)
+		{
+			msg.print("Axis range is inappropriate for a log scale (%f < x < %f). Axis will not be drawn.\n", min_[axis], max_[axis]);
+			return;
+		}
+
+		// Draw a line from min to max range, passing through the defined position
+		axisPrimitives_[axis].line(coordMin_[axis], coordMax_[axis]);
+
+		// Grab logged min/max values for convenience, enforcing sensible minimum
+		double min = log10(min_[axis] <= 0.0 ? 1.0e-10 : min_[axis]);
+
+		// Plot tickmarks - Start at floored (ceiling'd) integer of logAxisMin (logAxisMax), and go from there.
+		int nMinorTicks = minorTicks_[axis] > 8 ? 8 : minorTicks_[axis];
+		int count = 0;
+		double power = floor(min);
+		double value = pow(10,power);
+		Vec3<double> u = coordMin_[axis];
+		while (value <= max_[axis])
+		{
+			// Check break condition
+// 				if (value > max_[axis]) break;
+
+			// If the current value is in range, plot a tick
+			u[axis] = (inverted_[axis] ? log10(max_[axis]/value) : log10(value)) * stretch_[axis];
+			if (log10(value) >= min)
+			{
+				// Tick mark
+				axisPrimitives_[axis].line(u, u+tickDir*tickSize_[axis]*(count == 0 ? 1.0 : 0.5));
+				tickPositions_[axis].add(u[axis]);
+				tickIsMajor_[axis].add(count == 0);
+
+				// Tick label
+				if (count == 0)
+				{
+					// Get formatted value text
+					s = labelText(axis, value);
+
+					labelPrimitives_[axis].add(s, u+tickDir*tickSize_[axis], labelAnchor(axis), tickDir * labelOrientation(axis).z, labelTransform, parent_.labelPointSize(), parent_.flatLabels());
+				}
+			}
+
+			// Increase tick counter, value, and power if necessary
+			++count;
+			if (count > nMinorTicks)
+			{
+				count = 0;
+				power = power + 1.0;
+				value = pow(10,power);
+			}
+			else value += pow(10,power);
+		}
+	}
+	else
+	{
+		// Calculate autoticks if necessary
+		if (autoTicks_[axis]) calculateTickDeltas(axis);
+
+		// Draw a line from min to max limits, passing through the defined position
+		axisPrimitives_[axis].line(coordMin_[axis], coordMax_[axis]);
+
+		// Check tickDelta
+		if (((max_[axis]-min_[axis]) / tickDelta_[axis]) > 1e6) return;
+
+		// Plot tickmarks
+		int count = 0;
+		delta = tickDelta_[axis] / (minorTicks_[axis]+1);
+		value = tickFirst_[axis];
+		u = coordMin_[axis];
+		u.set(axis, (inverted_[axis] ? (max_[axis] - tickFirst_[axis]) + min_[axis]: tickFirst_[axis]) * stretch_[axis]);
+		while (value <= max_[axis])
+		{
+			// Draw tick here, only if value >= min_
+			if (value >= min_[axis])
+			{
+				tickPositions_[axis].add(u[axis]);
+
+				if (count %(minorTicks_[axis]+1) == 0)
+				{
+					axisPrimitives_[axis].line(u, u + tickDir*tickSize_[axis]);
+
+					// Get formatted label text
+					s = labelText(axis, value);
+
+					labelPrimitives_[axis].add(s, u+tickDir*tickSize_[axis], labelAnchor(axis), tickDir * labelOrientation(axis).z, labelTransform, parent_.labelPointSize(), parent_.flatLabels());
+
+					tickIsMajor_[axis].add(true);
+
+					count = 0;
+				}
+				else
+				{
+					axisPrimitives_[axis].line(u, u + tickDir*tickSize_[axis]*0.5);
+					tickIsMajor_[axis].add(false);
+				}
+			}
+			u.add(axis, delta * (inverted_[axis] ? -stretch_[axis] : stretch_[axis]));
+			value += delta;
+			++count;
+		}
+	}
+
+	// Add axis title
+	// -- Set basic position (corresponding to offset position of tick labels combined with title label axis position to start with...)
+	u = coordMin_[axis];
+	if (logarithmic_[axis])
+	{
+		value = log10(min_[axis]) + log10(max_[axis]/min_[axis]) * titleOrientation_[axis].w;
+		u.set(axis, (inverted_[axis] ? log10(max_[axis])-value : value) * stretch_[axis]);
+	}
+	else
+	{
+		value = min_[axis] + (max_[axis] - min_[axis]) * titleOrientation(axis).w;
+		u.set(axis, (inverted_[axis] ? (max_[axis] - value) + min_[axis]: value) * stretch_[axis]);
+	}
+	// -- Next step depends on whether we are automatically adjusting label positions
+	if ((useBestFlatView_ && parent_.isFlatView()) || autoPositionTitles_)
+	{
+		Cuboid cuboid = labelPrimitives_[axis].boundingCuboid(viewRotationInverse, parent_.textZScale());
+		// Project tick direction onto cuboid width/height
+		// TODO This does not account for the fact that the bounding cuboid may only partly extend over the end of ths axis tick mark (e.g. as with in-plane rotations/TopMiddle anchors)...
+		Vec3<double> extent = cuboid.maxima() - cuboid.minima();
+		extent.multiply(tickDir);
+		// -- Add on extra distance from tick mark
+		u += tickDir * (tickSize_[axis]);
+		// -- Create adjustment vector. Start by adding space between tickmark, label text, and title text
+		adjustment = tickDir * (labelOrientation(axis).z + 0.2);
+		// -- Add on label extent in the tickmark direction - we must undo the scaling on the bounding box arising from display scales etc.
+		adjustment += (tickDir * extent.magnitude()) / (FontInstance::fontBaseHeight() * parent_.labelPointSize() / parent_.textZScale());
+		// -- Scaling will be done by the title point size in TextPrimitive, but all our adjustments were done with label point size, so scale it...
+		adjustment *= parent_.labelPointSize() / parent_.titlePointSize();
+	}
+	else adjustment = tickDir * titleOrientation(axis).z;
+
+	// -- Add primitive
+	titlePrimitives_[axis].add(title_[axis], u, titleAnchor(axis), adjustment, titleTransform, parent_.titlePointSize(), parent_.flatLabels());
+}
+
 // Update axes primitives
 void Axes::updateAxisPrimitives()
 {
 	// Check whether we need to regenerate the axes primitives / data
 	if (axesVersion_ == primitiveVersion_) return;
 
-	QString s;
-	FTBBox boundingBox;
-	Vec3<double> centre;
-	double delta, value, clipPlaneDelta = 0.0001;
-	Vec3<double> u, v1, v2, tickDir, adjustment;
-	Matrix labelTransform, titleTransform;
-	Array<double> tickPositions[3];
-	Array<bool> tickIsMajor[3];
+	double clipPlaneDelta = 0.0001;
+	Vec3<double> v1, v2;
 
 	// Make sure coordinates are up-to-date
 	updateCoordinates();
@@ -1124,179 +1379,32 @@ void Axes::updateAxisPrimitives()
 		clipPlaneYMax_ = (max_.y * stretch_.y) + clipPlaneDelta;
 	}
 
-	// Construct axes
+	// Construct axes, but only those whose inputs have changed since they were last generated (e.g. panning along X leaves the Y axis untouched)
+	bool axisChanged = false;
+	QString key;
+	QElapsedTimer timer;
 	for (int axis = 0; axis < 3; ++axis)
 	{
-		// Clear old axis primitives
-		axisPrimitives_[axis].forgetAll();
-		labelPrimitives_[axis].clear();
-		titlePrimitives_[axis].clear();
-
-		// Normalise tickDirection
-		tickDir = tickDirection(axis);
-		tickDir.normalise();
-
-		// Create tick label transformation matrix
-		labelTransform.setIdentity();
-		// -- 1) Apply axial rotation along label left-to-right direction
-		if (parent_.viewType() == ViewPane::FlatZYView) labelTransform.applyRotationY(labelOrientation(axis).x);
-		else labelTransform.applyRotationX(labelOrientation(axis).x);
-		// -- 2) Perform in-plane rotation
-		if (inPlaneAxis == 0) labelTransform.applyRotationX(labelOrientation(axis).y);
-		else if (inPlaneAxis == 1) labelTransform.applyRotationY(labelOrientation(axis).y);
-		else labelTransform.applyRotationZ(labelOrientation(axis).y);
-
-		// Create axis title transformation matrix
-		titleTransform.setIdentity();
-		// -- 1) Apply axial rotation along label left-to-right direction
-		if (parent_.viewType() == ViewPane::FlatZYView) titleTransform.applyRotationY(titleOrientation(axis).x);
-		else titleTransform.applyRotationX(titleOrientation(axis).x);
-		// -- 2) Perform in-plane rotation
-		if (inPlaneAxis == 0) titleTransform.applyRotationX(titleOrientation(axis).y);
-		else if (inPlaneAxis == 1) titleTransform.applyRotationY(titleOrientation(axis).y);
-		else titleTransform.applyRotationZ(titleOrientation(axis).y);
-
-		// Add axis labels
-		if (logarithmic_[axis])
-		{
-			// For the log axis, the associated surface data coordinate will already be in log form
-			if (max_[axis] < 0.0)
-			{
-				msg.print("Axis range is inappropriate for a log scale (%f < x < %f). Axis will not be drawn.\n", min_[axis], max_[axis]);
-				return;
-			}
+		key = axisPrimitiveKey(axis, viewRotationInverse);
+		if (key == axisPrimitiveKey_[axis]) continue;
 
-			// Draw a line from min to max range, passing through the defined position
-			axisPrimitives_[axis].line(coordMin_[axis], coordMax_[axis]);
+		timer.start();
+		generateAxisPrimitives(axis, viewRotationInverse, inPlaneAxis);
+		regenerationTime_[axis] += timer.nsecsElapsed() * 1.0e-6;
 
-			// Grab logged min/max values for convenience, enforcing sensible minimum
-			double min = log10(min_[axis] <= 0.0 ? 1.0e-10 : min_[axis]);
-
-			// Plot tickmarks - Start at floored (ceiling'd) integer of logAxisMin (logAxisMax), and go from there.
-			int nMinorTicks = minorTicks_[axis] > 8 ? 8 : minorTicks_[axis];
-			int count = 0;
-			double power = floor(min);
-			double value = pow(10,power);
-			Vec3<double> u = coordMin_[axis];
-			while (value <= max_[axis])
-			{
-				// Check break condition
-// 				if (value > max_[axis]) break;
-
-				// If the current value is in range, plot a tick
-				u[axis] = (inverted_[axis] ? log10(max_[axis]/value) : log10(value)) * stretch_[axis];
-				if (log10(value) >= min)
-				{
-					// Tick mark
-					axisPrimitives_[axis].line(u, u+tickDir*tickSize_[axis]*(count == 0 ? 1.0 : 0.5));
-					tickPositions[axis].add(u[axis]);
-					tickIsMajor[axis].add(count == 0);
-
-					// Tick label
-					if (count == 0)
-					{
-						// Get formatted value text
-						s = numberFormat_[axis].format(value);
-
-						labelPrimitives_[axis].add(s, u+tickDir*tickSize_[axis], labelAnchor(axis), tickDir * labelOrientation(axis).z, labelTransform, parent_.labelPointSize(), parent_.flatLabels());
-					}
-				}
-
-				// Increase tick counter, value, and power if necessary
-				++count;
-				if (count > nMinorTicks)
-				{
-					count = 0;
-					power = power + 1.0;
-					value = pow(10,power);
-				}
-				else value += pow(10,power);
-			}
-		}
-		else
-		{
-			// Calculate autoticks if necessary
-			if (autoTicks_[axis]) calculateTickDeltas(axis);
-
-			// Draw a line from min to max limits, passing through the defined position
-			axisPrimitives_[axis].line(coordMin_[axis], coordMax_[axis]);
-
-			// Check tickDelta
-			if (((max_[axis]-min_[axis]) / tickDelta_[axis]) > 1e6) return;
-
-			// Plot tickmarks
-			int count = 0;
-			delta = tickDelta_[axis] / (minorTicks_[axis]+1);
-			value = tickFirst_[axis];
-			u = coordMin_[axis];
-			u.set(axis, (inverted_[axis] ? (max_[axis] - tickFirst_[axis]) + min_[axis]: tickFirst_[axis]) * stretch_[axis]);
-			while (value <= max_[axis])
-			{
-				// Draw tick here, only if value >= min_
-				if (value >= min_[axis])
-				{
-					tickPositions[axis].add(u[axis]);
-
-					if (count %(minorTicks_[axis]+1) == 0)
-					{
-						axisPrimitives_[axis].line(u, u + tickDir*tickSize_[axis]);
-
-						// Get formatted label text
-						s = numberFormat_[axis].format(value);
-
-						labelPrimitives_[axis].add(s, u+tickDir*tickSize_[axis], labelAnchor(axis), tickDir * labelOrientation(axis).z, labelTransform, parent_.labelPointSize(), parent_.flatLabels());
-
-						tickIsMajor[axis].add(true);
-
-						count = 0;
-					}
-					else
-					{
-						axisPrimitives_[axis].line(u, u + tickDir*tickSize_[axis]*0.5);
-						tickIsMajor[axis].add(false);
-					}
-				}
-				u.add(axis, delta * (inverted_[axis] ? -stretch_[axis] : stretch_[axis]));
-				value += delta;
-				++count;
-			}
-		}
-
-		// Add axis title
-		// -- Set basic position (corresponding to offset position of tick labels combined with title label axis position to start with...)
-		u = coordMin_[axis];
-		if (logarithmic_[axis])
-		{
-			value = log10(min_[axis]) + log10(max_[axis]/min_[axis]) * titleOrientation_[axis].w;
-			u.set(axis, (inverted_[axis] ? log10(max_[axis])-value : value) * stretch_[axis]);
-		}
-		else
-		{
-			value = min_[axis] + (max_[axis] - min_[axis]) * titleOrientation(axis).w;
-			u.set(axis, (inverted_[axis] ? (max_[axis] - value) + min_[axis]: value) * stretch_[axis]);
-		}
-		// -- Next step depends on whether we are automatically adjusting label positions
-		if ((useBestFlatView_ && parent_.isFlatView()) || autoPositionTitles_)
-		{
-			Cuboid cuboid = labelPrimitives_[axis].boundingCuboid(viewRotationInverse, parent_.textZScale());
-			// Project tick direction onto cuboid width/height
-			// TODO This does not account for the fact that the bounding cuboid may only partly extend over the end of ths axis tick mark (e.g. as with in-plane rotations/TopMiddle anchors)...
-			Vec3<double> extent = cuboid.maxima() - cuboid.minima();
-			extent.multiply(tickDir);
-			// -- Add on extra distance from tick mark
-			u += tickDir * (tickSize_[axis]);
-			// -- Create adjustment vector. Start by adding space between tickmark, label text, and title text
-			adjustment = tickDir * (labelOrientation(axis).z + 0.2);
-			// -- Add on label extent in the tickmark direction - we must undo the scaling on the bounding box arising from display scales etc.
-			adjustment += (tickDir * extent.magnitude()) / (FontInstance::fontBaseHeight() * parent_.labelPointSize() / parent_.textZScale());
-			// -- Scaling will be done by the title point size in TextPrimitive, but all our adjustments were done with label point size, so scale it...
-			adjustment *= parent_.labelPointSize() / parent_.titlePointSize();
-		}
-		else adjustment = tickDir * titleOrientation(axis).z;
+		axisPrimitiveKey_[axis] = key;
+		axisChanged = true;
+	}
 
-		// -- Add primitive
-		titlePrimitives_[axis].add(title_[axis], u, titleAnchor(axis), adjustment, titleTransform, parent_.titlePointSize(), parent_.flatLabels());
+	// GridLines depend on the ticks of all axes, so are regenerated if any axis has changed, or if the lines shown have changed
+	int gridLinesFlags = 0;
+	for (int axis = 0; axis < 3; ++axis) gridLinesFlags |= ((gridLinesMajor_[axis] ? 1 : 0) | (gridLinesMinor_[axis] ? 2 : 0) | (gridLinesFull_[axis] ? 4 : 0)) << (axis*3);
+	if ((!axisChanged) && (gridLinesFlags == gridLinesFlags_))
+	{
+		primitiveVersion_ = axesVersion_;
+		return;
 	}
+	gridLinesFlags_ = gridLinesFlags;
 
 	// GridLines
 	gridLineMinorPrimitives_[0].initialise(GL_LINES, false);
@@ -1317,20 +1425,20 @@ void Axes::updateAxisPrimitives()
 		int ortho2 = (axis+2)%3;
 
 		// Double loop now, over the two sets of tickmarks that are orthogonal to 'axis'
-		for (int i1 = 0; i1<tickPositions[ortho1].nItems(); ++i1)
+		for (int i1 = 0; i1<tickPositions_[ortho1].nItems(); ++i1)
 		{
-			for (int i2 = 0; i2<tickPositions[ortho2].nItems(); ++i2)
+			for (int i2 = 0; i2<tickPositions_[ortho2].nItems(); ++i2)
 			{
 				// Set basic vector info
 				// The 'axis' will define its own component, with the other two coming from the tickmark positions of the other axes
 				v1[axis] = coordMin_[axis][axis];
-				v1[ortho1] = tickPositions[ortho1][i1];
-				v1[ortho2] = tickPositions[ortho2][i2];
+				v1[ortho1] = tickPositions_[ortho1][i1];
+				v1[ortho2] = tickPositions_[ortho2][i2];
 				v2[axis] = coordMax_[axis][axis];
-				v2[ortho1] = tickPositions[ortho1][i1];
-				v2[ortho2] = tickPositions[ortho2][i2];
-// 				v1.set(coordMin_[0][0], tickPositions[1][j], tickPositions[2][k]);
-// 				v2.set(coordMax_[0][0], tickPositions[1][j], tickPositions[2][k]);
+				v2[ortho1] = tickPositions_[ortho1][i1];
+				v2[ortho2] = tickPositions_[ortho2][i2];
+// 				v1.set(coordMin_[0][0], tickPositions_[1][j], tickPositions_[2][k]);
+// 				v2.set(coordMax_[0][0], tickPositions_[1][j], tickPositions_[2][k]);
 
 				// If we are only drawing lines in the planes orthogonal to the axis, break if we have moved away from it...
 				// Otherwise, we change either the i1 or i2 components of v1 and v2 to position the gridline with the axis line itself
@@ -1353,7 +1461,7 @@ void Axes::updateAxisPrimitives()
 				}
 
 				// Add line to the relevant primitive
-				if (tickIsMajor[ortho1][i1] && tickIsMajor[ortho2][i2])
+				if (tickIsMajor_[ortho1][i1] && tickIsMajor_[ortho2][i2])
 				{
 					if (gridLinesMajor_[axis]) gridLineMajorPrimitives_[axis].line(v1, v2);
 				}
@@ -1377,10 +1485,23 @@ GLdouble Axes::clipPlaneYMax()
 	return clipPlaneYMax_;
 }
 
+// Return time (in ms) spent regenerating primitives for the specified axis since the last reset
+double Axes::regenerationTime(int axis) const
+{
+	return regenerationTime_[axis];
+}
+
+// Reset accumulated primitive regeneration times
+void Axes::resetRegenerationTimes()
+{
+	for (int n=0; n<3; ++n) regenerationTime_[n] = 0.0;
+}
+
 // Flag primitives as invalid
 void Axes::setPrimitivesInvalid()
 {
 	primitiveVersion_ = -1;
+	++styleVersion_;
 	parent_.paneChanged();
 }
 
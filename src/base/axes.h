@@ -32,6 +32,7 @@
 #include "templates/vector4.h"
 #include "templates/array.h"
 #include <QString>
+#include <QHash>
 
 // Forward Declarations
 class ViewPane;
@@ -331,12 +332,18 @@ class Axes : public ObjectStore<Axes>
 	int axesVersion_;
 	// Version of axis properties affecting data display
 	int displayVersion_;
+	// Version of axis style (all properties except limits and stretch factors)
+	int styleVersion_;
 
 	public:
 	// Return version of axis definitions
 	int axesVersion();
 	// Return version of axis properties affecting data display
 	int displayVersion() const;
+	// Return signature of the transforms applied to displayed data (limits, inversion, log scaling, and stretch factors)
+	QString transformSignature() const;
+	// Return version of axis style (all properties except limits and stretch factors)
+	int styleVersion() const;
 
 
 	/*
@@ -357,16 +364,39 @@ class Axes : public ObjectStore<Axes>
 	LineStyle gridLineMajorStyle_[3], gridLineMinorStyle_[3];
 	// Versions at which primitives were last generated
 	int primitiveVersion_;
+	// Keys describing the inputs from which the primitives for each axis were last generated
+	QString axisPrimitiveKey_[3];
+	// Tick positions for each axis, and whether they are major ticks
+	Array<double> tickPositions_[3];
+	Array<bool> tickIsMajor_[3];
+	// GridLine flags (for all axes) with which gridline primitives were last generated
+	int gridLinesFlags_;
+	// Cached label text for tick values on each axis
+	QHash<double,QString> labelText_[3];
+	// Number formats used to generate cached label text
+	NumberFormat labelTextFormat_[3];
+	// Time (in ms) spent regenerating primitives for each axis since last reset
+	double regenerationTime_[3];
 
 	private:
-	// Update primitives for axis
-	void updateAxisPrimitives();
+	// Return key describing all inputs to the primitives for the specified axis
+	QString axisPrimitiveKey(int axis, Matrix& viewRotationInverse);
+	// Return (cached) label text for value on specified axis
+	QString labelText(int axis, double value);
+	// Generate primitives for specified axis
+	void generateAxisPrimitives(int axis, const Matrix& viewRotationInverse, int inPlaneAxis);
 
 	public:
+	// Update primitives for axes
+	void updateAxisPrimitives();
 	// Return clip plane lower Y value
 	GLdouble clipPlaneYMin();
 	// Return clip plane upper Y value
 	GLdouble clipPlaneYMax();
+	// Return time (in ms) spent regenerating primitives for the specified axis since the last reset
+	double regenerationTime(int axis) const;
+	// Reset accumulated primitive regeneration times
+	void resetRegenerationTimes();
 	// Flag primitives as invalid
 	void setPrimitivesInvalid();
 	// Return axis primitive for axis specified
@@ -0,0 +1,334 @@
+/*
+	*** Binary Data File
+	*** src/base/binarydata.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/binarydata.h"
+#include "base/data2d.h"
+#include "base/messenger.h"
+#include <QFileInfo>
+#include <QtEndian>
+#include <string.h>
+
+// Magic string identifying file
+const char binaryDataMagic[8] = { 'U', 'C', 'H', 'R', 'O', 'M', 'A', 'B' };
+// Current file version
+const quint32 binaryDataVersion = 1;
+// Size of file header
+const qint64 binaryDataHeaderSize = 24;
+// Size of chunk header
+const qint64 binaryDataChunkHeaderSize = 16;
+
+// Constructor
+BinaryDataFile::BinaryDataFile()
+{
+	mappedData_ = NULL;
+	mappedSize_ = 0;
+	writing_ = false;
+	nChunksWritten_ = 0;
+	writeOffset_ = 0;
+}
+
+// Destructor
+BinaryDataFile::~BinaryDataFile()
+{
+	// Discard any partially-written file
+	if (writing_)
+	{
+		writeFile_.cancelWriting();
+		writeFile_.commit();
+		writing_ = false;
+	}
+	close();
+}
+
+/*
+ * File
+ */
+
+// Calculate Adler-32 checksum of supplied data
+quint32 BinaryDataFile::checksum(const uchar* data, qint64 length)
+{
+	// Process in blocks small enough that the sums cannot overflow before the modulus is taken
+	const quint32 modAdler = 65521;
+	quint32 a = 1, b = 0;
+	while (length > 0)
+	{
+		qint64 blockLength = (length < 5552 ? length : 5552);
+		length -= blockLength;
+		for (qint64 n=0; n<blockLength; ++n)
+		{
+			a += data[n];
+			b += a;
+		}
+		data += blockLength;
+		a %= modAdler;
+		b %= modAdler;
+	}
+
+	return (b << 16) | a;
+}
+
+// Return sidecar filename to use for specified session file
+QString BinaryDataFile::sidecarFileName(QString sessionFileName)
+{
+	QFileInfo info(sessionFileName);
+	return info.absoluteDir().absoluteFilePath(info.completeBaseName() + ".ucb");
+}
+
+// Open specified file for reading
+bool BinaryDataFile::openForReading(QString fileName)
+{
+	close();
+
+	readFile_.setFileName(fileName);
+	if (!readFile_.open(QIODevice::ReadOnly))
+	{
+		msg.print("Error: Couldn't open binary data file '%s' for reading.\n", qPrintable(fileName));
+		return false;
+	}
+
+	// Map the whole file into memory
+	mappedSize_ = readFile_.size();
+	mappedData_ = (mappedSize_ > 0 ? readFile_.map(0, mappedSize_) : NULL);
+	if (!mappedData_)
+	{
+		msg.print("Error: Couldn't map binary data file '%s' into memory.\n", qPrintable(fileName));
+		close();
+		return false;
+	}
+
+	// Check header
+	if ((mappedSize_ < binaryDataHeaderSize) || (memcmp(mappedData_, binaryDataMagic, 8) != 0))
+	{
+		msg.print("Error: File '%s' is not a uChroma binary data file.\n", qPrintable(fileName));
+		close();
+		return false;
+	}
+	quint32 version = qFromLittleEndian<quint32>(mappedData_+8);
+	if (version > binaryDataVersion)
+	{
+		msg.print("Error: Binary data file '%s' has version %u, but only versions up to %u are supported.\n", qPrintable(fileName), version, binaryDataVersion);
+		close();
+		return false;
+	}
+
+	msg.print(Messenger::Verbose, "Opened binary data file '%s' (%lli bytes, %llu chunks).\n", qPrintable(fileName), mappedSize_, qFromLittleEndian<quint64>(mappedData_+16));
+
+	return true;
+}
+
+// Open specified file for writing
+bool BinaryDataFile::openForWriting(QString fileName)
+{
+	close();
+
+	writeFile_.setFileName(fileName);
+	if (!writeFile_.open(QIODevice::WriteOnly))
+	{
+		msg.print("Error: Couldn't open binary data file '%s' for writing.\n", qPrintable(fileName));
+		return false;
+	}
+
+	// Write header - the number of chunks is updated when the file is closed
+	uchar header[binaryDataHeaderSize];
+	memcpy(header, binaryDataMagic, 8);
+	qToLittleEndian<quint32>(binaryDataVersion, header+8);
+	qToLittleEndian<quint32>(0, header+12);
+	qToLittleEndian<quint64>(0, header+16);
+	if (writeFile_.write((const char*) header, binaryDataHeaderSize) != binaryDataHeaderSize)
+	{
+		writeFile_.cancelWriting();
+		writeFile_.commit();
+		return false;
+	}
+
+	writing_ = true;
+	nChunksWritten_ = 0;
+	writeOffset_ = binaryDataHeaderSize;
+
+	return true;
+}
+
+// Return whether the file is open for reading
+bool BinaryDataFile::isReadable() const
+{
+	return (mappedData_ != NULL);
+}
+
+// Return whether the file is open for writing
+bool BinaryDataFile::isWritable() const
+{
+	return writing_;
+}
+
+// Return name of open file
+QString BinaryDataFile::fileName() const
+{
+	return (writing_ ? writeFile_.fileName() : readFile_.fileName());
+}
+
+// Close file, committing any written data, and returning whether this was successful
+bool BinaryDataFile::close()
+{
+	bool result = true;
+
+	// Reading?
+	if (mappedData_)
+	{
+		readFile_.unmap((uchar*) mappedData_);
+		mappedData_ = NULL;
+	}
+	mappedSize_ = 0;
+	if (readFile_.isOpen()) readFile_.close();
+
+	// Writing?
+	if (writing_)
+	{
+		// Update chunk count in header
+		uchar nChunks[8];
+		qToLittleEndian<quint64>(nChunksWritten_, nChunks);
+		if ((!writeFile_.seek(16)) || (writeFile_.write((const char*) nChunks, 8) != 8)) writeFile_.cancelWriting();
+		result = writeFile_.commit();
+		if (!result) msg.print("Error: Failed to write binary data file '%s'.\n", qPrintable(writeFile_.fileName()));
+		writing_ = false;
+	}
+
+	return result;
+}
+
+/*
+ * Data
+ */
+
+// Write Data2D chunk, returning its offset in the file (or -1 for failure)
+qint64 BinaryDataFile::writeData(const Data2D& data)
+{
+	if (!writing_) return -1;
+
+	// Assemble payload - point count followed by x and y columns
+	const quint64 nPoints = data.nPoints();
+	const qint64 columnSize = nPoints * sizeof(double);
+	QByteArray payload(8 + 2*columnSize, Qt::Uninitialized);
+	uchar* dest = (uchar*) payload.data();
+	qToLittleEndian<quint64>(nPoints, dest);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+	if (nPoints > 0)
+	{
+		memcpy(dest+8, data.constArrayX().array(), columnSize);
+		memcpy(dest+8+columnSize, data.constArrayY().array(), columnSize);
+	}
+#else
+	quint64 bits;
+	for (quint64 n=0; n<nPoints; ++n)
+	{
+		double value = data.x(n);
+		memcpy(&bits, &value, 8);
+		qToLittleEndian<quint64>(bits, dest+8+n*8);
+		value = data.y(n);
+		memcpy(&bits, &value, 8);
+		qToLittleEndian<quint64>(bits, dest+8+columnSize+n*8);
+	}
+#endif
+
+	// Write chunk header and payload
+	uchar header[binaryDataChunkHeaderSize];
+	qToLittleEndian<quint32>(BinaryDataFile::Data2DChunk, header);
+	qToLittleEndian<quint32>(checksum(dest, payload.size()), header+4);
+	qToLittleEndian<quint64>(payload.size(), header+8);
+	if ((writeFile_.write((const char*) header, binaryDataChunkHeaderSize) != binaryDataChunkHeaderSize) || (writeFile_.write(payload) != payload.size()))
+	{
+		msg.print("Error: Failed to write data chunk to binary data file '%s'.\n", qPrintable(writeFile_.fileName()));
+		writeFile_.cancelWriting();
+		return -1;
+	}
+
+	qint64 offset = writeOffset_;
+	writeOffset_ += binaryDataChunkHeaderSize + payload.size();
+	++nChunksWritten_;
+
+	return offset;
+}
+
+// Read Data2D chunk at specified offset
+bool BinaryDataFile::readData(qint64 offset, Data2D& data)
+{
+	if (!mappedData_) return false;
+
+	// Check chunk header
+	if ((offset < binaryDataHeaderSize) || ((offset + binaryDataChunkHeaderSize) > mappedSize_))
+	{
+		msg.print("Error: Binary data chunk offset %lli is out of range.\n", offset);
+		return false;
+	}
+	const uchar* chunk = mappedData_ + offset;
+	if (qFromLittleEndian<quint32>(chunk) != BinaryDataFile::Data2DChunk)
+	{
+		msg.print("Error: Binary data chunk at offset %lli does not contain Data2D values.\n", offset);
+		return false;
+	}
+	quint32 expectedChecksum = qFromLittleEndian<quint32>(chunk+4);
+	quint64 payloadSize = qFromLittleEndian<quint64>(chunk+8);
+	if ((payloadSize < 8) || (payloadSize > quint64(mappedSize_ - offset - binaryDataChunkHeaderSize)))
+	{
+		msg.print("Error: Binary data chunk at offset %lli is truncated.\n", offset);
+		return false;
+	}
+
+	// Verify payload
+	const uchar* payload = chunk + binaryDataChunkHeaderSize;
+	if (checksum(payload, payloadSize) != expectedChecksum)
+	{
+		msg.print("Error: Checksum mismatch for binary data chunk at offset %lli.\n", offset);
+		return false;
+	}
+	quint64 nPoints = qFromLittleEndian<quint64>(payload);
+	if ((payloadSize != 8 + nPoints*16) || (nPoints > 0x7fffffff))
+	{
+		msg.print("Error: Binary data chunk at offset %lli has an inconsistent size.\n", offset);
+		return false;
+	}
+
+	// Copy columns into data
+	const qint64 columnSize = nPoints * sizeof(double);
+	double z = data.z();
+	data.initialise(nPoints);
+	data.setZ(z);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+	if (nPoints > 0)
+	{
+		memcpy(data.arrayX().array(), payload+8, columnSize);
+		memcpy(data.arrayY().array(), payload+8+columnSize, columnSize);
+	}
+#else
+	quint64 bits;
+	double value;
+	for (quint64 n=0; n<nPoints; ++n)
+	{
+		bits = qFromLittleEndian<quint64>(payload+8+n*8);
+		memcpy(&value, &bits, 8);
+		data.setX(n, value);
+		bits = qFromLittleEndian<quint64>(payload+8+columnSize+n*8);
+		memcpy(&value, &bits, 8);
+		data.setY(n, value);
+	}
+#endif
+
+	return true;
+}
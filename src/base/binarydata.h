@@ -0,0 +1,101 @@
+/*
+	*** Binary Data File
+	*** src/base/binarydata.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_BINARYDATA_H
+#define UCHROMA_BINARYDATA_H
+
+#include <QString>
+#include <QFile>
+#include <QSaveFile>
+
+// Forward Declarations
+class Data2D;
+
+/*
+ * Binary sidecar file holding dataset values for a session.
+ * The file consists of a header followed by a sequence of chunks, each of which is located by its byte offset from the start of the file.
+ * All values are stored little-endian.
+ *
+ * Header : char[8] magic, quint32 version, quint32 flags, quint64 nChunks
+ * Chunk  : quint32 type, quint32 checksum (Adler-32 of payload), quint64 payloadSize, payload
+ * Data2D chunk payload : quint64 nPoints, double x[nPoints], double y[nPoints]
+ */
+class BinaryDataFile
+{
+	public:
+	// Constructor / Destructor
+	BinaryDataFile();
+	~BinaryDataFile();
+	// Chunk Types
+	enum ChunkType { Data2DChunk = 0x44324453 };
+
+
+	/*
+	 * File
+	 */
+	private:
+	// File being read (mapped)
+	QFile readFile_;
+	// Mapped file contents
+	const uchar* mappedData_;
+	// Size of mapped file
+	qint64 mappedSize_;
+	// File being written
+	QSaveFile writeFile_;
+	// Whether we are currently writing
+	bool writing_;
+	// Number of chunks written
+	quint64 nChunksWritten_;
+	// Current write offset
+	qint64 writeOffset_;
+
+	private:
+	// Calculate Adler-32 checksum of supplied data
+	static quint32 checksum(const uchar* data, qint64 length);
+
+	public:
+	// Return sidecar filename to use for specified session file
+	static QString sidecarFileName(QString sessionFileName);
+	// Open specified file for reading
+	bool openForReading(QString fileName);
+	// Open specified file for writing
+	bool openForWriting(QString fileName);
+	// Return whether the file is open for reading
+	bool isReadable() const;
+	// Return whether the file is open for writing
+	bool isWritable() const;
+	// Return name of open file
+	QString fileName() const;
+	// Close file, committing any written data, and returning whether this was successful
+	bool close();
+
+
+	/*
+	 * Data
+	 */
+	public:
+	// Write Data2D chunk, returning its offset in the file (or -1 for failure)
+	qint64 writeData(const Data2D& data);
+	// Read Data2D chunk at specified offset
+	bool readData(qint64 offset, Data2D& data);
+};
+
+#endif
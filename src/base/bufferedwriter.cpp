@@ -0,0 +1,267 @@
+/*
+	*** Buffered Writer
+	*** src/base/bufferedwriter.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/bufferedwriter.h"
+#include "base/data2d.h"
+#include "base/jobscheduler.h"
+#include <QRunnable>
+#include <zlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+// Constructor
+BufferedWriter::BufferedWriter(QString fileName, int bufferSize)
+{
+	fileName_ = fileName;
+	gzFile_ = NULL;
+	failed_ = false;
+	bufferSize_ = bufferSize;
+	buffer_.reserve(bufferSize_ + 1024);
+
+	// Compress output on the fly if the filename ends in '.gz'
+	if (fileName_.endsWith(".gz", Qt::CaseInsensitive))
+	{
+		gzFile_ = gzopen(qPrintable(fileName_), "wb6");
+		if (!gzFile_) failed_ = true;
+		else gzbuffer(gzFile_, 262144);
+	}
+	else
+	{
+		file_.setFileName(fileName_);
+		if (!file_.open(QFile::WriteOnly)) failed_ = true;
+	}
+}
+
+// Destructor
+BufferedWriter::~BufferedWriter()
+{
+	close();
+}
+
+/*
+ * Target
+ */
+
+// Return whether the file is open and no errors have occurred
+bool BufferedWriter::ready() const
+{
+	if (failed_) return false;
+	return (gzFile_ ? true : file_.isOpen());
+}
+
+// Return whether output is being compressed
+bool BufferedWriter::compressed() const
+{
+	return fileName_.endsWith(".gz", Qt::CaseInsensitive);
+}
+
+// Flush buffer and close file, returning whether all data was written successfully
+bool BufferedWriter::close()
+{
+	flush();
+
+	if (gzFile_)
+	{
+		if (gzclose(gzFile_) != Z_OK) failed_ = true;
+		gzFile_ = NULL;
+	}
+	else if (file_.isOpen()) file_.close();
+
+	return (!failed_);
+}
+
+/*
+ * Buffer
+ */
+
+// Write contents of buffer to file
+bool BufferedWriter::flush()
+{
+	if (buffer_.isEmpty()) return (!failed_);
+
+	if (!failed_)
+	{
+		if (gzFile_)
+		{
+			if (gzwrite(gzFile_, buffer_.constData(), buffer_.size()) != buffer_.size()) failed_ = true;
+		}
+		else if (!file_.isOpen() || (file_.write(buffer_) != buffer_.size())) failed_ = true;
+	}
+	buffer_.resize(0);
+
+	return (!failed_);
+}
+
+// Write raw data
+void BufferedWriter::write(const char* data, int length)
+{
+	// Large blocks are written straight through, rather than being copied into the buffer
+	if (length >= bufferSize_)
+	{
+		flush();
+		if (failed_) return;
+		if (gzFile_)
+		{
+			if (gzwrite(gzFile_, data, length) != length) failed_ = true;
+		}
+		else if (!file_.isOpen() || (file_.write(data, length) != length)) failed_ = true;
+		return;
+	}
+
+	buffer_.append(data, length);
+	if (buffer_.size() >= bufferSize_) flush();
+}
+
+// Write string
+void BufferedWriter::write(const char* s)
+{
+	write(s, strlen(s));
+}
+
+// Write byte array
+void BufferedWriter::write(const QByteArray& data)
+{
+	write(data.constData(), data.size());
+}
+
+// Write value
+void BufferedWriter::write(double value)
+{
+	char s[32];
+	write(s, formatValue(value, s));
+}
+
+/*
+ * Formatting
+ */
+
+// Format value into buffer (which must hold at least 32 characters) using the shortest representation that reads back exactly, returning its length
+int BufferedWriter::formatValue(double value, char* buffer)
+{
+	// Integral values (common for abscissae) can be written directly
+	if ((fabs(value) < 1.0e15) && (value == floor(value)) && ((value != 0.0) || (!signbit(value))))
+	{
+		long long i = (long long) value;
+		char digits[24];
+		int nDigits = 0, length = 0;
+		unsigned long long u = (i < 0 ? -i : i);
+		do
+		{
+			digits[nDigits++] = '0' + (u % 10);
+			u /= 10;
+		} while (u > 0);
+		if (i < 0) buffer[length++] = '-';
+		while (nDigits > 0) buffer[length++] = digits[--nDigits];
+		buffer[length] = '\0';
+		return length;
+	}
+
+	// Otherwise, find the smallest precision which reproduces the value exactly (at most 17 significant figures are ever required)
+	int length = 0;
+	for (int precision = 15; precision <= 17; ++precision)
+	{
+		length = snprintf(buffer, 32, "%.*g", precision, value);
+		if (strtod(buffer, NULL) == value) break;
+	}
+
+	return length;
+}
+
+// Append formatted value to byte array
+void BufferedWriter::appendValue(QByteArray& target, double value)
+{
+	char s[32];
+	target.append(s, formatValue(value, s));
+}
+
+// Append x and y values of data to byte array, one pair per line with optional prefix
+void BufferedWriter::appendData(QByteArray& target, const Data2D& data, const char* prefix)
+{
+	const Array<double>& x = data.constArrayX();
+	const Array<double>& y = data.constArrayY();
+	int prefixLength = (prefix ? strlen(prefix) : 0);
+
+	// Reserve enough space for the largest possible lines
+	target.reserve(target.size() + data.nPoints() * (prefixLength + 2*24 + 3));
+
+	char s[32];
+	for (int n=0; n<data.nPoints(); ++n)
+	{
+		if (prefixLength) target.append(prefix, prefixLength);
+		target.append(s, formatValue(x.value(n), s));
+		target.append("  ", 2);
+		target.append(s, formatValue(y.value(n), s));
+		target.append('\n');
+	}
+}
+
+// Data Formatting Task
+class DataFormatTask : public QRunnable
+{
+	public:
+	// Constructor
+	DataFormatTask(const QVector<const Data2D*>& data, QVector<QByteArray>& results, const char* prefix, int firstIndex, int stride) : QRunnable(), data_(data), results_(results)
+	{
+		prefix_ = prefix;
+		firstIndex_ = firstIndex;
+		stride_ = stride;
+	}
+
+	private:
+	// Source data
+	const QVector<const Data2D*>& data_;
+	// Destination arrays
+	QVector<QByteArray>& results_;
+	// Line prefix
+	const char* prefix_;
+	// Index of first data to format, and stride between data
+	int firstIndex_, stride_;
+
+	public:
+	// Format our share of the data
+	void run()
+	{
+		for (int n=firstIndex_; n<data_.count(); n += stride_) BufferedWriter::appendData(results_[n], *data_.at(n), prefix_);
+	}
+};
+
+// Format values of all supplied data into separate byte arrays, in parallel
+QVector<QByteArray> BufferedWriter::formatData(const QVector<const Data2D*>& data, const char* prefix)
+{
+	QVector<QByteArray> results(data.count());
+
+	// Split the data between threads, unless there is too little to make this worthwhile
+	int nThreads = std::min(TaskGroup::maxThreadCount(), data.count());
+	if (nThreads < 2)
+	{
+		for (int n=0; n<data.count(); ++n) appendData(results[n], *data.at(n), prefix);
+		return results;
+	}
+
+	TaskGroup tasks;
+	for (int n=0; n<nThreads; ++n) tasks.start(new DataFormatTask(data, results, prefix, n, nThreads));
+	tasks.waitForDone();
+
+	return results;
+}
@@ -0,0 +1,101 @@
+/*
+	*** Buffered Writer
+	*** src/base/bufferedwriter.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_BUFFEREDWRITER_H
+#define UCHROMA_BUFFEREDWRITER_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+
+// Forward Declarations
+class Data2D;
+struct gzFile_s;
+
+// Buffered Writer
+class BufferedWriter
+{
+	public:
+	// Constructor / Destructor
+	BufferedWriter(QString fileName, int bufferSize = 4194304);
+	~BufferedWriter();
+
+
+	/*
+	 * Target
+	 */
+	private:
+	// Target filename
+	QString fileName_;
+	// File object (when not compressing)
+	QFile file_;
+	// Compressed file handle (when compressing)
+	gzFile_s* gzFile_;
+	// Whether an error has occurred while writing
+	bool failed_;
+
+	public:
+	// Return whether the file is open and no errors have occurred
+	bool ready() const;
+	// Return whether output is being compressed
+	bool compressed() const;
+	// Flush buffer and close file, returning whether all data was written successfully
+	bool close();
+
+
+	/*
+	 * Buffer
+	 */
+	private:
+	// Output buffer
+	QByteArray buffer_;
+	// Size at which buffer is flushed to file
+	int bufferSize_;
+
+	public:
+	// Write contents of buffer to file
+	bool flush();
+	// Write raw data
+	void write(const char* data, int length);
+	// Write string
+	void write(const char* s);
+	// Write byte array
+	void write(const QByteArray& data);
+	// Write value
+	void write(double value);
+
+
+	/*
+	 * Formatting
+	 */
+	public:
+	// Format value into buffer (which must hold at least 32 characters) using the shortest representation that reads back exactly, returning its length
+	static int formatValue(double value, char* buffer);
+	// Append formatted value to byte array
+	static void appendValue(QByteArray& target, double value);
+	// Append x and y values of data to byte array, one pair per line with optional prefix
+	static void appendData(QByteArray& target, const Data2D& data, const char* prefix = NULL);
+	// Format values of all supplied data into separate byte arrays, in parallel
+	static QVector<QByteArray> formatData(const QVector<const Data2D*>& data, const char* prefix = NULL);
+};
+
+#endif
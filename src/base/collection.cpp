@@ -22,9 +22,14 @@
 #include "base/collection.h"
 #include "base/viewpane.h"
 #include "base/lineparser.h"
+#include "base/bufferedwriter.h"
+#include "base/datacache.h"
+#include "base/collectionupdatejob.h"
+#include "base/statistics.h"
 #include "session/session.h"
 #include "kernels/fit.h"
 #include <limits>
+#include <algorithm>
 
 // Static Members
 template<class Collection> RefList<Collection,int> ObjectStore<Collection>::objects_;
@@ -41,6 +46,12 @@ Collection::Collection() : ListItem<Collection>(), ObjectStore<Collection>(this,
 	dataMax_.set(10.0, 10.0, 10.0);
 	dataVersion_ = 0;
 
+	// Deferred Data
+	lastDataAccess_ = 0;
+
+	// Memory
+	derivedDataReleased_ = false;
+
 	// Transform
 	transformMin_.zero();
 	transformMax_.set(10.0, 10.0, 10.0);
@@ -74,15 +85,33 @@ Collection::Collection() : ListItem<Collection>(), ObjectStore<Collection>(this,
 	parent_ = NULL;
 	type_ = Collection::MasterCollection;
 	currentSlice_ = NULL;
+	currentSliceAxis_ = -1;
+	currentSliceBin_ = -1;
+	currentSliceVersion_ = -1;
+	sliceIndexZOrder_ = 0;
+	sliceIndexZVersion_ = -1;
+	sliceIndexYVersion_ = -1;
+	contourGridVersion_ = -1;
+	currentSliceLevel_ = 0.0;
 	fitKernel_ = NULL;
 
 	// Update
 	limitsAndTransformsVersion_ = -1;
+	limitsAndTransformsNDataSets_ = 0;
+	appendBaseVersion_ = -1;
+	appendedAtVersion_ = -1;
+
+	// Background Update
+	backgroundUpdateVersion_ = -1;
+	backgroundUpdateCancelledAt_ = -1;
+	updateJob_ = NULL;
 
 	// Display
 	visible_ = true;
 	displayData_.clear();
 	displayDataGeneratedAt_ = -1;
+	displayDataResetAt_ = -1;
+	displayDataNDataSets_ = 0;
 	displayStyle_ = Collection::LineXYStyle;
 	displaySurfaceShininess_ = 128.0;
 	displayStyleVersion_ = 0;
@@ -96,6 +125,10 @@ Collection::~Collection()
 	while (slices_.last()) removeSlice(slices_.last());
 
 	if (fitKernel_) delete fitKernel_;
+
+	DataCache::removeCollection(this);
+	StatisticsEngine::removeCollection(this);
+	JobScheduler::cancel(this);
 }
 
 // Copy constructor
@@ -114,6 +147,8 @@ void Collection::operator=(const Collection& source)
 	dataMin_ = source.dataMin_;
 	dataMax_ = source.dataMax_;
 	dataVersion_ = 0;
+	lastDataAccess_ = 0;
+	derivedDataReleased_ = false;
 
 	// Transforms
 	transformMin_ = source.transformMin_;
@@ -159,6 +194,11 @@ void Collection::operator=(const Collection& source)
 	}
 	if (currentSlice_) delete currentSlice_;
 	currentSlice_ = NULL;
+	currentSliceAxis_ = -1;
+	currentSliceBin_ = -1;
+	currentSliceVersion_ = -1;
+	currentContourLines_.clear();
+	releaseSliceIndex();
 	if (source.fitKernel_)
 	{
 		if (!fitKernel_) fitKernel_ = new FitKernel;
@@ -172,11 +212,21 @@ void Collection::operator=(const Collection& source)
 
 	// Update
 	limitsAndTransformsVersion_ = -1;
+	limitsAndTransformsNDataSets_ = 0;
+	appendBaseVersion_ = -1;
+	appendedAtVersion_ = -1;
+
+	// Background Update
+	backgroundUpdateVersion_ = -1;
+	backgroundUpdateCancelledAt_ = -1;
+	updateJob_ = NULL;
 
 	// Display
 	visible_ = source.visible_;
 	displayData_.clear();
 	displayDataGeneratedAt_ = -1;
+	displayDataResetAt_ = -1;
+	displayDataNDataSets_ = 0;
 	displayStyle_ = source.displayStyle_;
 	displaySurfaceShininess_ = source.displaySurfaceShininess_;
 	displayLineStyle_ = source.displayLineStyle_;
@@ -351,6 +401,30 @@ void Collection::setDataSetZ(DataSet* target, double z)
 	UChromaSession::setAsModified();
 }
 
+// Return whether first dataset has a lower z value than the second (for sorting)
+bool Collection::dataSetZLessThan(const DataSet* a, const DataSet* b)
+{
+	return (a->z() < b->z());
+}
+
+// Sort datasets into ascending z order
+void Collection::sortDataSets()
+{
+	// Sort pointers to the datasets, and then rebuild the list in that order
+	Array<DataSet*> sorted;
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) sorted.add(dataSet);
+	std::stable_sort(sorted.array(), sorted.array() + sorted.nItems(), Collection::dataSetZLessThan);
+	for (int n=0; n<sorted.nItems(); ++n)
+	{
+		dataSets_.disown(sorted[n]);
+		dataSets_.own(sorted[n]);
+	}
+
+	++dataVersion_;
+
+	UChromaSession::setAsModified();
+}
+
 // Set data for specified dataste (from source DataSet)
 void Collection::setDataSetData(DataSet* target, DataSet& source)
 {
@@ -420,7 +494,7 @@ QString Collection::uniqueDataSetName(QString baseName)
 int Collection::nEmptyDataSets()
 {
 	int count = 0;
-	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) if (dataSet->data().nPoints() < 2) ++count;
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) if (dataSet->nPoints() < 2) ++count;
 	return count;
 }
 
@@ -439,7 +513,7 @@ void Collection::clearDataSets()
 int Collection::nDataPoints()
 {
 	int nPoints = 0;
-	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) nPoints += dataSet->data().nPoints();
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) nPoints += dataSet->nPoints();
 	return nPoints;
 }
 
@@ -474,6 +548,40 @@ bool Collection::appendDataSet(QString fileName)
 	return loadDataSet(dataSet);
 }
 
+// Append datasets to collection, taking ownership of them, and returning the number appended
+int Collection::appendDataSets(List<DataSet>& newDataSets)
+{
+	int nAppended = newDataSets.nItems();
+	if (nAppended == 0) return 0;
+
+	// If something else has changed the data since the last append, this starts a new run of appends
+	if (appendedAtVersion_ != dataVersion_) appendBaseVersion_ = dataVersion_;
+
+	// Move datasets over to our list, repositioning any which are out of order in z (which forces full updates of derived data)
+	bool inOrder = true;
+	DataSet* dataSet;
+	while ((dataSet = newDataSets.first()) != NULL)
+	{
+		double z = dataSet->data().z();
+		bool atEnd = ((dataSets_.last() == NULL) || (dataSets_.last()->data().z() <= z));
+		newDataSets.disown(dataSet);
+		dataSets_.own(dataSet);
+		dataSet->setParent(this);
+		if (!atEnd)
+		{
+			setDataSetZ(dataSet, z);
+			inOrder = false;
+		}
+	}
+
+	++dataVersion_;
+	if (inOrder) appendedAtVersion_ = dataVersion_;
+
+	UChromaSession::setAsModified();
+
+	return nAppended;
+}
+
 // Load data for specified dataset index
 bool Collection::loadDataSet(DataSet* dataSet)
 {
@@ -498,7 +606,7 @@ int Collection::loadAllDataSets()
 // Return data minima, calculating if necessary
 Vec3<double> Collection::dataMin()
 {
-	// Make sure limits and transform are up to date
+	// Make sure limits and transform are up to date (computing them here even if they're being regenerated in the background)
 	updateLimitsAndTransforms();
 
 	return dataMin_;
@@ -507,7 +615,7 @@ Vec3<double> Collection::dataMin()
 // Return data maxima, calculating if necessary
 Vec3<double> Collection::dataMax()
 {
-	// Make sure limits and transform are up to date
+	// Make sure limits and transform are up to date (computing them here even if they're being regenerated in the background)
 	updateLimitsAndTransforms();
 
 	return dataMax_;
@@ -525,59 +633,155 @@ int Collection::dataVersion()
 	return dataVersion_;
 }
 
+/*
+ * Deferred Data
+ */
+
+// Note that deferred data in this collection has been used
+void Collection::touchDeferredData()
+{
+	lastDataAccess_ = DataCache::nextAccess();
+}
+
+// Return access stamp at which deferred data was last used
+unsigned long int Collection::lastDataAccess() const
+{
+	return lastDataAccess_;
+}
+
+// Release resident deferred data in this collection, returning number of bytes freed
+long int Collection::evictDeferredData()
+{
+	long int bytes = 0;
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) bytes += dataSet->evictData();
+
+	// Transformed data has been released, so must be regenerated when next required
+	if (bytes > 0) limitsAndTransformsVersion_ = -1;
+
+	return bytes;
+}
+
+// Make all deferred data resident and stop deferring it (including in fits and slices)
+void Collection::detachDeferredData()
+{
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) dataSet->detachDeferredData();
+	for (Collection* fit = fits_.first(); fit != NULL; fit = fit->next) fit->detachDeferredData();
+	for (Collection* slice = slices_.first(); slice != NULL; slice = slice->next) slice->detachDeferredData();
+}
+
+/*
+ * Memory
+ */
+
+// Return whether collection is cold (i.e. not visible), and so a candidate for releasing memory
+bool Collection::isCold()
+{
+	return (!visible_);
+}
+
+// Release derived data, returning number of bytes freed
+long int Collection::releaseDerivedData()
+{
+	// Don't release anything while derived data is being generated in the background, since it will be replaced shortly anyway
+	if (backgroundUpdateVersion_ != -1) return 0;
+
+	long int bytes = derivedDataSize();
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) dataSet->releaseTransformedData();
+	displayData_.clear();
+	displayAbscissa_.releaseStorage();
+	releaseSliceIndex();
+
+	// Limits remain valid, so versions are left as they are - transformed and display data are regenerated when display data is next requested
+	derivedDataReleased_ = true;
+
+	return bytes;
+}
+
+// Compress data values held in memory, returning number of bytes freed
+long int Collection::compressData()
+{
+	long int bytes = 0;
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) bytes += dataSet->compressData();
+	return bytes;
+}
+
+// Return number of bytes used by data values (compressed or not)
+long int Collection::valuesSize()
+{
+	long int bytes = 0;
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) bytes += dataSet->valuesSize();
+	return bytes;
+}
+
+// Return number of bytes used by derived (transformed and display) data
+long int Collection::derivedDataSize()
+{
+	long int bytes = (displayAbscissa_.size() + sliceIndexZ_.size() + sliceIndexY_.size()) * sizeof(double) + contourGenerator_.memoryUsage();
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) bytes += dataSet->transformedDataSize();
+	for (DisplayDataSet* displayDataSet = displayData_.first(); displayDataSet != NULL; displayDataSet = displayDataSet->next) bytes += displayDataSet->y().size() * (sizeof(double) + sizeof(DisplayDataSet::DataPointType));
+	return bytes;
+}
+
+// Return number of datasets whose values are currently compressed
+int Collection::nCompressedDataSets()
+{
+	int count = 0;
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) if (dataSet->isCompressed()) ++count;
+	return count;
+}
+
 /*
  * Transforms
  */
 
-// Return transformed data minima, calculating if necessary
-Vec3<double> Collection::transformMin()
+// Return transformed data minima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+Vec3<double> Collection::transformMin(bool allowStale)
 {
-	// Make sure limits and transform are up to date
-	updateLimitsAndTransforms();
+	// Make sure limits and transform are up to date (unless stale values are allowed and they're being regenerated in the background, in which case the previous values are returned)
+	if ((!allowStale) || (!requestBackgroundUpdate())) updateLimitsAndTransforms();
 
 	return transformMin_;
 }
 
-// Return transformed data maxima, calculating if necessary
-Vec3<double> Collection::transformMax()
+// Return transformed data maxima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+Vec3<double> Collection::transformMax(bool allowStale)
 {
-	// Make sure limits and transform are up to date
-	updateLimitsAndTransforms();
+	// Make sure limits and transform are up to date (unless stale values are allowed and they're being regenerated in the background, in which case the previous values are returned)
+	if ((!allowStale) || (!requestBackgroundUpdate())) updateLimitsAndTransforms();
 
 	return transformMax_;
 }
 
-// Return transformed positive data minima, calculating if necessary
-Vec3<double> Collection::transformMinPositive()
+// Return transformed positive data minima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+Vec3<double> Collection::transformMinPositive(bool allowStale)
 {
-	// Make sure limits and transform are up to date
-	updateLimitsAndTransforms();
+	// Make sure limits and transform are up to date (unless stale values are allowed and they're being regenerated in the background, in which case the previous values are returned)
+	if ((!allowStale) || (!requestBackgroundUpdate())) updateLimitsAndTransforms();
 
 	return transformMinPositive_;
 }
 
-// Return transformed positive data maxima, calculating if necessary
-Vec3<double> Collection::transformMaxPositive()
+// Return transformed positive data maxima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+Vec3<double> Collection::transformMaxPositive(bool allowStale)
 {
-	// Make sure limits and transform are up to date
-	updateLimitsAndTransforms();
+	// Make sure limits and transform are up to date (unless stale values are allowed and they're being regenerated in the background, in which case the previous values are returned)
+	if ((!allowStale) || (!requestBackgroundUpdate())) updateLimitsAndTransforms();
 
-	return transformMaxPositive_;
+	// If there are no positive values along an axis, return a sensible default instead
+	return Vec3<double>(transformMaxPositive_.x < 0.0 ? 1.0 : transformMaxPositive_.x, transformMaxPositive_.y < 0.0 ? 1.0 : transformMaxPositive_.y, transformMaxPositive_.z < 0.0 ? 1.0 : transformMaxPositive_.z);
 }
 
-// Set transform equation for data
-void Collection::setTransformEquation(int axis, QString transformEquation)
+// Set transform equation for data, returning whether it is valid
+bool Collection::setTransformEquation(int axis, QString transformEquation)
 {
-	transforms_[axis].setEquation(transformEquation);
+	bool result = transforms_[axis].setEquation(transformEquation);
 
-	// Make sure limits and transform are up to date
-	if (transforms_[axis].enabled())
-	{
-		++dataVersion_;
-		updateLimitsAndTransforms();
-	}
+	// Limits and transformed data will be regenerated (possibly in the background) when next required
+	if (transforms_[axis].enabled()) ++dataVersion_;
 
 	UChromaSession::setAsModified();
+
+	return result;
 }
 
 // Return transform equation for data
@@ -597,11 +801,9 @@ void Collection::setTransformEnabled(int axis, bool enabled)
 {
 	transforms_[axis].setEnabled(enabled);
 
+	// Limits and transformed data will be regenerated (possibly in the background) when next required
 	++dataVersion_;
 
-	// Make sure limits and transform are up to date
-	updateLimitsAndTransforms();
-
 	UChromaSession::setAsModified();
 }
 
@@ -698,60 +900,245 @@ int Collection::closestBin(int axis, double value)
 	}
 	else if (axis == 1)
 	{
-		// ???
+		// Slices at fixed Y are contours through the whole surface (see getContour()), and do not correspond to a bin
 	}
 	else if (axis == 2)
 	{
-		// Check z-values
-		int closest = 0, n = 0;
-		double delta, closestDelta = fabs(displayData_.first()->z() - value);
-		for (DisplayDataSet* displayDataSet = displayData_.first()->next; displayDataSet != NULL; displayDataSet = displayDataSet->next)
+		// Check z-values - a binary search is possible if they are ordered, which they will be for most collections
+		updateSliceIndex(false);
+		const double* z = sliceIndexZ_.constArray();
+		int nZ = sliceIndexZ_.nItems();
+		if (nZ == 0) return -1;
+		if (sliceIndexZOrder_ == 0)
 		{
-			delta = fabs(displayDataSet->z() - value);
-			++n;
-			if (delta < closestDelta)
+			int closest = 0;
+			double delta, closestDelta = fabs(z[0] - value);
+			for (int n=1; n<nZ; ++n)
 			{
-				closest = n;
-				closestDelta = delta;
+				delta = fabs(z[n] - value);
+				if (delta < closestDelta)
+				{
+					closest = n;
+					closestDelta = delta;
+				}
 			}
+			return closest;
 		}
-		return closest;
+
+		// Binary chop, on values in ascending order or, if descending, on their negatives
+		double order = sliceIndexZOrder_, target = value * order;
+		int midIndex, loIndex = 0, hiIndex = nZ - 1;
+		if (target <= z[0] * order) return 0;
+		if (target >= z[hiIndex] * order) return hiIndex;
+		while ((hiIndex - loIndex) > 1)
+		{
+			midIndex = (hiIndex + loIndex) / 2;
+			if (z[midIndex] * order <= target) loIndex = midIndex;
+			else hiIndex = midIndex;
+		}
+		if (fabs(z[loIndex] - value) <= fabs(z[hiIndex] - value)) return loIndex;
+		else return hiIndex;
 	}
 
 	return -1;
 }
 
-// Get slice at specified axis and bin
-void Collection::getSlice(int axis, int bin)
+// Update side index of display data used for slice extraction, including y values if requested
+void Collection::updateSliceIndex(bool includeValues)
+{
+	int nX = displayAbscissa_.nItems(), nZ = displayData_.nItems(), n;
+
+	// Z values (and their ordering)
+	if ((sliceIndexZVersion_ != displayDataGeneratedAt_) || (sliceIndexZ_.nItems() != nZ))
+	{
+		sliceIndexZ_.createEmpty(nZ);
+		double* z = sliceIndexZ_.array();
+		n = 0;
+		for (DisplayDataSet* displayDataSet = displayData_.first(); displayDataSet != NULL; displayDataSet = displayDataSet->next) z[n++] = displayDataSet->z();
+
+		bool ascending = true, descending = true;
+		for (n=1; n<nZ; ++n)
+		{
+			if (z[n] < z[n-1]) ascending = false;
+			if (z[n] > z[n-1]) descending = false;
+		}
+		sliceIndexZOrder_ = (ascending ? 1 : (descending ? -1 : 0));
+		sliceIndexZVersion_ = displayDataGeneratedAt_;
+	}
+
+	// Y values, transposed so that each x forms a contiguous column
+	if (includeValues && ((sliceIndexYVersion_ != displayDataGeneratedAt_) || (sliceIndexY_.nItems() != nX*nZ)))
+	{
+		sliceIndexY_.createEmpty(nX*nZ);
+		double* columns = sliceIndexY_.array();
+		int z = 0;
+		for (DisplayDataSet* displayDataSet = displayData_.first(); displayDataSet != NULL; displayDataSet = displayDataSet->next, ++z)
+		{
+			const double* y = displayDataSet->y().constArray();
+			int nY = std::min(nX, displayDataSet->y().nItems());
+			for (n=0; n<nY; ++n) columns[n*nZ+z] = y[n];
+		}
+		sliceIndexYVersion_ = displayDataGeneratedAt_;
+	}
+}
+
+// Release side index of display data, returning number of bytes freed
+long int Collection::releaseSliceIndex()
+{
+	long int bytes = (sliceIndexZ_.size() + sliceIndexY_.size()) * sizeof(double) + contourGenerator_.memoryUsage();
+	sliceIndexZ_.releaseStorage();
+	sliceIndexY_.releaseStorage();
+	sliceIndexZVersion_ = -1;
+	sliceIndexYVersion_ = -1;
+	contourGenerator_.clear();
+	contourGridVersion_ = -1;
+	return bytes;
+}
+
+// Get slice at specified axis and bin, returning false if the current slice was already up to date
+bool Collection::getSlice(int axis, int bin)
 {
 	// Call currentSlice() so we generate a collection if one does not yet exist
 	currentSlice();
-	currentSlice_->clearDataSets();
+
+	// If we already hold the requested slice of the current display data, there is nothing to do
+	if ((axis == currentSliceAxis_) && (bin == currentSliceBin_) && (displayDataGeneratedAt_ == currentSliceVersion_)) return false;
+	currentSliceAxis_ = axis;
+	currentSliceBin_ = bin;
+	currentSliceVersion_ = displayDataGeneratedAt_;
+	currentContourLines_.clear();
 
 	// Are supplied bin and axis valid?
-	if ((bin == -1) || (axis == -1)) return;
-	else if (axis == 0)
+	bool valid = (bin != -1);
+	if (axis == 0) valid = valid && (bin < displayAbscissa_.nItems());
+	else if (axis == 2) valid = valid && (bin < displayData_.nItems());
+	else valid = false;
+	if (!valid)
 	{
-		DataSet* newDataSet = currentSlice_->addDataSet();
+		currentSlice_->clearDataSets();
+		return true;
+	}
 
-		// Slice at fixed X - the bin will be an index from the displayAbscissa_ / displayData_ data.
-		for (DisplayDataSet* displayDataSet = displayData_.first(); displayDataSet != NULL; displayDataSet = displayDataSet->next) newDataSet->addPoint(displayDataSet->z(), displayDataSet->y().value(bin));
-		currentSlice_->setName("X = " + QString::number(displayAbscissa_.value(bin)));
+	// Reuse the existing dataset (and its arrays) in the current slice, removing any others
+	DataSet* sliceDataSet = currentSlice_->dataSets_.first();
+	if (sliceDataSet == NULL)
+	{
+		sliceDataSet = currentSlice_->dataSets_.add();
+		sliceDataSet->setParent(currentSlice_);
 	}
-	else if (axis == 1)
+	while (sliceDataSet->next) currentSlice_->dataSets_.remove(sliceDataSet->next);
+	Data2D& sliceData = sliceDataSet->editableData();
+
+	if (axis == 0)
 	{
-		// TODO - Generate contour map?
+		// Slice at fixed X - the bin will be an index from the displayAbscissa_ / displayData_ data, and the values form a contiguous column in the slice index
+		updateSliceIndex(true);
+		int nZ = sliceIndexZ_.nItems();
+		sliceData.initialise(nZ);
+		double* x = sliceData.arrayX().array();
+		double* y = sliceData.arrayY().array();
+		const double* z = sliceIndexZ_.constArray();
+		const double* column = sliceIndexY_.constArray() + bin*nZ;
+		for (int n=0; n<nZ; ++n)
+		{
+			x[n] = z[n];
+			y[n] = column[n];
+		}
+		currentSlice_->name_ = "X = " + QString::number(displayAbscissa_.value(bin));
 	}
 	else if (axis == 2)
 	{
-		// Slice through Z
+		// Slice through Z - copy display data, pruning empty points
 		DisplayDataSet* displayDataSet = displayData_[bin];
-		if (displayDataSet)
+		const double* abscissa = displayAbscissa_.constArray();
+		const double* yValues = displayDataSet->y().constArray();
+		const DisplayDataSet::DataPointType* yType = displayDataSet->yType().constArray();
+		int nPoints = std::min(displayAbscissa_.nItems(), displayDataSet->y().nItems()), nSlicePoints = 0, n;
+		for (n=0; n<nPoints; ++n) if (yType[n] != DisplayDataSet::NoPoint) ++nSlicePoints;
+		sliceData.initialise(nSlicePoints);
+		double* x = sliceData.arrayX().array();
+		double* y = sliceData.arrayY().array();
+		nSlicePoints = 0;
+		for (n=0; n<nPoints; ++n)
+		{
+			if (yType[n] == DisplayDataSet::NoPoint) continue;
+			x[nSlicePoints] = abscissa[n];
+			y[nSlicePoints] = yValues[n];
+			++nSlicePoints;
+		}
+		currentSlice_->name_ = "Z = " + QString::number(displayDataSet->z());
+	}
+
+	// The current slice is transient, so its name is set directly (without recording an edit state) and the session is not marked as modified
+	currentSlice_->notifyDataChanged();
+
+	return true;
+}
+
+// Get contour at specified Y value, returning false if the current slice was already up to date
+bool Collection::getContour(double level)
+{
+	// Call currentSlice() so we generate a collection if one does not yet exist
+	currentSlice();
+
+	// Make sure that display data is up-to-date
+	updateDisplayData();
+
+	// If we already hold the requested contour of the current display data, there is nothing to do
+	if ((currentSliceAxis_ == 1) && (level == currentSliceLevel_) && (displayDataGeneratedAt_ == currentSliceVersion_)) return false;
+	currentSliceAxis_ = 1;
+	currentSliceBin_ = -1;
+	currentSliceLevel_ = level;
+	currentSliceVersion_ = displayDataGeneratedAt_;
+
+	// Set up contour grid (with its cell value ranges) if the display data has changed since it was last set
+	if (contourGridVersion_ != displayDataGeneratedAt_)
+	{
+		contourGenerator_.setGrid(displayAbscissa_, displayData_);
+		contourGridVersion_ = displayDataGeneratedAt_;
+	}
+
+	// Extract contour lines, and split them into pieces with increasing x which can be stored as datasets
+	// The complete lines are retained for display, since the pieces omit any vertical steps
+	List<Data2D> pieces;
+	contourGenerator_.extract(level, currentContourLines_);
+	ContourGenerator::splitMonotonic(currentContourLines_, pieces);
+
+	// Store pieces in the current slice, reusing its existing datasets (and their arrays) where possible
+	DataSet* sliceDataSet = currentSlice_->dataSets_.first();
+	for (Data2D* piece = pieces.first(); piece != NULL; piece = piece->next)
+	{
+		if (sliceDataSet == NULL)
 		{
-			currentSlice_->addDataSet(displayAbscissa_, displayDataSet);
-			currentSlice_->setName("Z = " + QString::number(displayDataSet->z()));
+			sliceDataSet = currentSlice_->dataSets_.add();
+			sliceDataSet->setParent(currentSlice_);
 		}
+		Data2D& sliceData = sliceDataSet->editableData();
+		int nPoints = piece->nPoints();
+		sliceData.initialise(nPoints);
+		double* x = sliceData.arrayX().array();
+		double* y = sliceData.arrayY().array();
+		const double* pieceX = piece->constArrayX().constArray();
+		const double* pieceY = piece->constArrayY().constArray();
+		for (int n=0; n<nPoints; ++n)
+		{
+			x[n] = pieceX[n];
+			y[n] = pieceY[n];
+		}
+		sliceData.setZ(level);
+		sliceDataSet = sliceDataSet->next;
+	}
+	while (sliceDataSet)
+	{
+		DataSet* nextDataSet = sliceDataSet->next;
+		currentSlice_->dataSets_.remove(sliceDataSet);
+		sliceDataSet = nextDataSet;
 	}
+	currentSlice_->name_ = "Y = " + QString::number(level);
+
+	currentSlice_->notifyDataChanged();
+
+	return true;
 }
 
 // Locate collection using parts specified
@@ -1015,15 +1402,16 @@ Collection* Collection::slice(QString name)
 // Update current slice based on specified axis and value
 void Collection::updateCurrentSlice(int axis, double axisValue)
 {
-	getSlice(axis, closestBin(axis, axisValue));
-
-	UChromaSignal::send(UChromaSignal::CollectionSliceChangedSignal, this);
+	// Only signal a change if the slice has actually changed - slices at fixed Y are contours, rather than taken from a single bin
+	bool changed = (axis == 1 ? getContour(axisValue) : getSlice(axis, closestBin(axis, axisValue)));
+	if (changed) UChromaSignal::send(UChromaSignal::CollectionSliceChangedSignal, this);
 }
 
 // Extract current slice based on specified axis and value
 void Collection::extractCurrentSlice(int axis, double axisValue)
 {
-	getSlice(axis, closestBin(axis, axisValue));
+	if (axis == 1) getContour(axisValue);
+	else getSlice(axis, closestBin(axis, axisValue));
 
 	Collection* newSlice = addSlice(currentSlice_->name());
 	newSlice->addDataSet(currentSlice_->dataSets());
@@ -1045,6 +1433,12 @@ Collection* Collection::currentSlice()
 	return currentSlice_;
 }
 
+// Return contour lines from which current slice was generated (if it is a contour)
+Data2D* Collection::currentContourLines()
+{
+	return currentContourLines_.first();
+}
+
 // Add FitKernel, if one does not exist
 void Collection::addFitKernel()
 {
@@ -1071,46 +1465,62 @@ void Collection::updateLimitsAndTransforms()
 {
 	if (dataVersion_ == limitsAndTransformsVersion_) return;
 
-	dataMin_ = 0.0;
-	dataMax_ = 0.0;
-	if (dataSets_.nItems() > 0)
+	// If datasets have only been appended since the last update, we need only transform the new ones and extend the existing limits
+	DataSet* firstNew = NULL;
+	if ((limitsAndTransformsNDataSets_ > 0) && (limitsAndTransformsNDataSets_ < dataSets_.nItems()) && appendedOnlySince(limitsAndTransformsVersion_)) firstNew = dataSets_[limitsAndTransformsNDataSets_];
+	limitsAndTransformsNDataSets_ = dataSets_.nItems();
+
+	DataSet* dataSet;
+	double mmin, mmax;
+	if (firstNew == NULL)
 	{
-		// Grab first dataset and set initial values
-		DataSet* dataSet = dataSets_.first();
-		dataMin_.set(dataSet->data().xMin(), dataSet->data().yMin(), dataSet->data().z());
-		dataMax_.set(dataSet->data().xMax(), dataSet->data().yMax(), dataSet->data().z());
-		double mmin, mmax;
-		for (dataSet = dataSet->next; dataSet != NULL; dataSet = dataSet->next)
+		dataMin_ = 0.0;
+		dataMax_ = 0.0;
+		if (dataSets_.nItems() > 0)
 		{
-// 			printf("Z = %f\n", dataSet->data().z());
-			mmin = dataSet->data().xMin();
-			mmax = dataSet->data().xMax();
-			if (mmin < dataMin_.x) dataMin_.x = mmin;
-			if (mmax > dataMax_.x) dataMax_.x = mmax;
-			mmin = dataSet->data().yMin();
-			mmax = dataSet->data().yMax();
-			if (mmin < dataMin_.y) dataMin_.y = mmin;
-			if (mmax > dataMax_.y) dataMax_.y = mmax;
-			if (dataSet->data().z() < dataMin_.z) dataMin_.z = dataSet->data().z();
-			else if (dataSet->data().z() > dataMax_.z) dataMax_.z = dataSet->data().z();
+			// Grab first dataset and set initial values
+			dataSet = dataSets_.first();
+			dataMin_.set(dataSet->xMin(), dataSet->yMin(), dataSet->z());
+			dataMax_.set(dataSet->xMax(), dataSet->yMax(), dataSet->z());
 		}
 	}
+	for (dataSet = (firstNew ? firstNew : dataSets_.first()); dataSet != NULL; dataSet = dataSet->next)
+	{
+// 		printf("Z = %f\n", dataSet->z());
+		mmin = dataSet->xMin();
+		mmax = dataSet->xMax();
+		if (mmin < dataMin_.x) dataMin_.x = mmin;
+		if (mmax > dataMax_.x) dataMax_.x = mmax;
+		mmin = dataSet->yMin();
+		mmax = dataSet->yMax();
+		if (mmin < dataMin_.y) dataMin_.y = mmin;
+		if (mmax > dataMax_.y) dataMax_.y = mmax;
+		if (dataSet->z() < dataMin_.z) dataMin_.z = dataSet->z();
+		else if (dataSet->z() > dataMax_.z) dataMax_.z = dataSet->z();
+	}
 
-	// Loop over dataSets_ list, updating transforms as we go
-	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) dataSet->transform(transforms_[0], transforms_[1], transforms_[2]);
+	// Loop over dataSets_ list, updating transforms as we go (reporting progress, and stopping if cancelled, if we're working in the background)
+	int nTransformed = 0;
+	for (dataSet = (firstNew ? firstNew : dataSets_.first()); dataSet != NULL; dataSet = dataSet->next)
+	{
+		dataSet->transform(transforms_[0], transforms_[1], transforms_[2]);
+		if (updateJob_ && (!updateJob_->advance(++nTransformed, dataSets_.nItems()))) return;
+	}
 
-	transformMin_ = 0.0;
-	transformMax_ = 0.0;
-	transformMinPositive_ = 0.1;
-	transformMaxPositive_ = -1.0;
-	if (dataSets_.nItems() == 0) return;
-	
-	// Grab first dataset and set initial values
-	DataSet* dataSet = dataSets_.first();
-	transformMin_.set(dataSet->transformedData().xMin(), dataSet->transformedData().yMin(), dataSet->transformedData().z());
-	transformMax_.set(dataSet->transformedData().xMax(), dataSet->transformedData().yMax(), dataSet->transformedData().z());
-	double mmin, mmax;
-	for (dataSet = dataSet->next; dataSet != NULL; dataSet = dataSet->next)
+	if (firstNew == NULL)
+	{
+		transformMin_ = 0.0;
+		transformMax_ = 0.0;
+		transformMinPositive_ = 0.1;
+		transformMaxPositive_ = -1.0;
+		if (dataSets_.nItems() == 0) return;
+
+		// Grab first dataset and set initial values
+		dataSet = dataSets_.first();
+		transformMin_.set(dataSet->transformedData().xMin(), dataSet->transformedData().yMin(), dataSet->transformedData().z());
+		transformMax_.set(dataSet->transformedData().xMax(), dataSet->transformedData().yMax(), dataSet->transformedData().z());
+	}
+	for (dataSet = (firstNew ? firstNew : dataSets_.first()); dataSet != NULL; dataSet = dataSet->next)
 	{
 		mmin = dataSet->transformedData().xMin();
 		mmax = dataSet->transformedData().xMax();
@@ -1125,7 +1535,8 @@ void Collection::updateLimitsAndTransforms()
 	}
 
 	// Now determine minimum positive limits
-	for (dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next)
+	// Maxima are left negative where there are no positive values, and a default is substituted in transformMaxPositive()
+	for (dataSet = (firstNew ? firstNew : dataSets_.first()); dataSet != NULL; dataSet = dataSet->next)
 	{
 		// Loop over XY points in data, searching for first positive, non-zero value
 		Data2D& data = dataSet->transformedData();
@@ -1153,15 +1564,110 @@ void Collection::updateLimitsAndTransforms()
 		}
 	}
 
-	// Check maximum positive values (since all datapoints might have been negative
-	if (transformMaxPositive_.x < 0.0) transformMaxPositive_.x = 1.0;
-	if (transformMaxPositive_.y < 0.0) transformMaxPositive_.y = 1.0;
-	if (transformMaxPositive_.z < 0.0) transformMaxPositive_.z = 1.0;
-
 	// Update version
 	limitsAndTransformsVersion_ = dataVersion_;
 }
 
+// Return whether datasets have only been appended (in order) since the specified data version
+bool Collection::appendedOnlySince(int version)
+{
+	return ((version != -1) && (appendedAtVersion_ == dataVersion_) && (version >= appendBaseVersion_));
+}
+
+/*
+ * Background Update
+ */
+
+// Request that derived data is regenerated in the background, returning true if the caller should wait for it
+bool Collection::requestBackgroundUpdate()
+{
+	// Nothing to do if jobs are not being run in the background, or if display data is already up to date
+	if ((!JobScheduler::enabled()) || (displayDataGeneratedAt_ == dataVersion_)) return false;
+
+	// If datasets have only been appended, the incremental update is quick enough to do immediately
+	if (appendedOnlySince(displayDataGeneratedAt_)) return false;
+
+	// Already being generated for this version, or cancelled by the user?
+	if ((backgroundUpdateVersion_ == dataVersion_) || (backgroundUpdateCancelledAt_ == dataVersion_)) return true;
+
+	// Any job started for an older version of the data is no longer needed
+	JobScheduler::cancel(this);
+
+	backgroundUpdateVersion_ = dataVersion_;
+	JobScheduler::submit(new CollectionUpdateJob(this));
+
+	return true;
+}
+
+// Copy data and transform settings from specified source, ready to generate derived data in the background
+void Collection::copyForBackgroundUpdate(const Collection& source)
+{
+	name_ = source.name_;
+	dataVersion_ = source.dataVersion_;
+	transforms_[0] = source.transforms_[0];
+	transforms_[1] = source.transforms_[1];
+	transforms_[2] = source.transforms_[2];
+	interpolate_ = source.interpolate_;
+	interpolateConstrained_ = source.interpolateConstrained_;
+	interpolationStep_ = source.interpolationStep_;
+
+	// Deferred data is not made resident here (in the GUI thread) - it is loaded by the job, and not counted against the data cache budget
+	dataSets_.clear();
+	for (DataSet* dataSet = source.dataSets_.first(); dataSet != NULL; dataSet = dataSet->next) dataSets_.add()->copyDeferred(*dataSet);
+}
+
+// Generate derived data (limits, transformed data, and display data) on behalf of the specified job
+void Collection::updateDerivedData(Job* job)
+{
+	updateJob_ = job;
+	updateDisplayData();
+	updateJob_ = NULL;
+}
+
+// Take derived data generated in the background by the specified collection, if it is still current
+bool Collection::takeDerivedData(Collection& source, int version, bool cancelled)
+{
+	if (backgroundUpdateVersion_ == version)
+	{
+		backgroundUpdateVersion_ = -1;
+
+		// If the user cancelled the update, keep the existing display until the data next changes
+		if (cancelled && (version == dataVersion_)) backgroundUpdateCancelledAt_ = version;
+	}
+	if (cancelled) return false;
+
+	// Drop the results if the data has changed since the job was created, or if derived data has been generated here in the meantime
+	if ((version != dataVersion_) || (displayDataGeneratedAt_ == dataVersion_) || (source.dataSets_.nItems() != dataSets_.nItems())) return false;
+
+	// Transformed data and limits
+	DataSet* sourceDataSet = source.dataSets_.first();
+	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next, sourceDataSet = sourceDataSet->next) dataSet->transformedData() = sourceDataSet->transformedData();
+	dataMin_ = source.dataMin_;
+	dataMax_ = source.dataMax_;
+	transformMin_ = source.transformMin_;
+	transformMax_ = source.transformMax_;
+	transformMinPositive_ = source.transformMinPositive_;
+	transformMaxPositive_ = source.transformMaxPositive_;
+	limitsAndTransformsVersion_ = dataVersion_;
+	limitsAndTransformsNDataSets_ = dataSets_.nItems();
+
+	// Display data
+	displayData_.clear();
+	DisplayDataSet* displayDataSet;
+	while ((displayDataSet = source.displayData_.first()) != NULL)
+	{
+		source.displayData_.disown(displayDataSet);
+		displayData_.own(displayDataSet);
+	}
+	displayAbscissa_ = source.displayAbscissa_;
+	displayDataGeneratedAt_ = dataVersion_;
+	derivedDataReleased_ = false;
+	displayDataResetAt_ = dataVersion_;
+	displayDataNDataSets_ = dataSets_.nItems();
+
+	return true;
+}
+
 /*
  * Colours
  */
@@ -1397,7 +1903,7 @@ int Collection::colourVersion()
  */
 
 // Suface Style Keywords
-const char* SurfaceStyleKeywords[] = { "LineXY", "LineZY", "Grid", "Surface", "UnlitSurface" };
+const char* SurfaceStyleKeywords[] = { "LineXY", "LineZY", "Grid", "Surface", "UnlitSurface", "Image" };
 
 // Convert text string to DisplayStyle
 Collection::DisplayStyle Collection::displayStyle(QString s)
@@ -1412,13 +1918,88 @@ const char* Collection::displayStyle(Collection::DisplayStyle kwd)
 	return SurfaceStyleKeywords[kwd];
 }
 
+// Get (interpolated) display arrays for specified dataset
+void Collection::displayArrays(DataSet* dataSet, Array<double>& x, Array<double>& y)
+{
+	x.clear();
+	y.clear();
+	if (interpolate_.x)
+	{
+		dataSet->transformedData().interpolate(interpolateConstrained_.x);
+		double xValue = dataSet->transformedData().arrayX().first();
+		while (xValue <= dataSet->transformedData().arrayX().last())
+		{
+			x.add(xValue);
+			y.add(dataSet->transformedData().interpolated(xValue));
+			xValue += interpolationStep_.x;
+		}
+	}
+	else
+	{
+		x = dataSet->transformedData().arrayX();
+		y = dataSet->transformedData().arrayY();
+	}
+}
+
+// Add display data for datasets from the index specified, returning false if all display data must be regenerated instead
+bool Collection::appendDisplayData(int firstIndex)
+{
+	// Existing display data can only be left untouched if the new datasets share its abscissa exactly
+	if ((displayAbscissa_.nItems() == 0) || (firstIndex >= dataSets_.nItems())) return false;
+
+	List<DisplayDataSet> newDisplayData;
+	Array<double> x, y;
+	for (DataSet* dataSet = dataSets_[firstIndex]; dataSet != NULL; dataSet = dataSet->next)
+	{
+		// Check for slice with no points...
+		if (dataSet->data().nPoints() == 0) continue;
+
+		displayArrays(dataSet, x, y);
+		if (x.nItems() != displayAbscissa_.nItems()) return false;
+		for (int n=0; n<x.nItems(); ++n) if (x.value(n) != displayAbscissa_.value(n)) return false;
+
+		DisplayDataSet* displayDataSet = newDisplayData.add();
+		displayDataSet->setZ(dataSet->transformedData().z());
+		for (int n=0; n<y.nItems(); ++n) displayDataSet->add(y.value(n), DisplayDataSet::RealPoint);
+	}
+
+	// Move new display data to the end of the existing list
+	DisplayDataSet* displayDataSet;
+	while ((displayDataSet = newDisplayData.first()) != NULL)
+	{
+		newDisplayData.disown(displayDataSet);
+		displayData_.own(displayDataSet);
+	}
+
+	return true;
+}
+
 // Generate display data
 void Collection::updateDisplayData()
 {
+	// If derived data was released while the collection was cold, regenerate everything from scratch
+	if (derivedDataReleased_)
+	{
+		limitsAndTransformsVersion_ = -1;
+		limitsAndTransformsNDataSets_ = 0;
+		displayDataGeneratedAt_ = -1;
+		displayDataNDataSets_ = 0;
+		derivedDataReleased_ = false;
+	}
+
 	if (dataVersion_ == displayDataGeneratedAt_) return;
 
 	// Make sure transforms are up to date
 	updateLimitsAndTransforms();
+	if (updateJob_ && updateJob_->cancelled()) return;
+
+	// If datasets have only been appended since we last generated display data, try to add display data for the new ones only
+	if (appendedOnlySince(displayDataGeneratedAt_) && appendDisplayData(displayDataNDataSets_))
+	{
+		displayDataNDataSets_ = dataSets_.nItems();
+		displayDataGeneratedAt_ = dataVersion_;
+		return;
+	}
 
 	// Clear old displayData_ and create temporary Data2D list for display data construction
 	List<Data2D> transformedData;
@@ -1440,22 +2021,7 @@ void Collection::updateDisplayData()
 
 		// Copy / interpolate raw data arrays
 		Array<double> array[2];
-		if (interpolate_.x)
-		{
-			dataSet->transformedData().interpolate(interpolateConstrained_.x);
-			double x = dataSet->transformedData().arrayX().first();
-			while (x <= dataSet->transformedData().arrayX().last())
-			{
-				array[0].add(x);
-				array[1].add(dataSet->transformedData().interpolated(x));
-				x += interpolationStep_.x;
-			}
-		}
-		else
-		{
-			array[0] = dataSet->transformedData().arrayX();
-			array[1] = dataSet->transformedData().arrayY();
-		}
+		displayArrays(dataSet, array[0], array[1]);
 
 		// Now add data to surfaceDataSet
 		for (int n=0; n<array[0].nItems(); ++n) surfaceDataSet->addPoint(array[0].value(n), array[1].value(n));
@@ -1549,6 +2115,8 @@ void Collection::updateDisplayData()
 	
 	// Store new version 
 	displayDataGeneratedAt_ = dataVersion_;
+	displayDataResetAt_ = dataVersion_;
+	displayDataNDataSets_ = dataSets_.nItems();
 }
 
 // Set whether data is visible
@@ -1579,6 +2147,16 @@ List<DisplayDataSet>& Collection::displayData()
 	return displayData_;
 }
 
+// Return whether existing display data is unchanged (but may have been added to) since the specified data version
+bool Collection::displayDataAppendedSince(int version)
+{
+	updateDisplayData();
+
+	if (version == dataVersion_) return true;
+
+	return (appendedOnlySince(version) && (displayDataResetAt_ <= version));
+}
+
 // Set display style of data
 void Collection::setDisplayStyle(DisplayStyle style)
 {
@@ -1624,25 +2202,40 @@ int Collection::displayStyleVersion()
 // Export data to plain text file
 bool Collection::exportData(QString fileName)
 {
-	LineParser parser(fileName, true);
-
-	if (!parser.ready()) return false;
+	// Output is compressed on the fly if the filename ends in '.gz'
+	BufferedWriter writer(fileName);
+	if (!writer.ready()) return false;
 
-	parser.writeLineF("# Exported data: '%s'\n", qPrintable(name_));
+	writer.write("# Exported data: '");
+	writer.write(qPrintable(name_));
+	writer.write("'\n");
 
-	for (DataSet* dataSet = dataSets_.first(); dataSet != NULL; dataSet = dataSet->next)
+	// Datasets are formatted in parallel, in blocks so that the formatted text for the whole collection is never held in memory at once
+	// Values are made resident here (which may load deferred data) rather than in the formatting threads
+	const int blockSize = 64;
+	DataSet* dataSet = dataSets_.first();
+	while (dataSet)
 	{
-		parser.writeLineF("# Z = %e\n", dataSet->z());
-		for (int n=0; n<dataSet->data().nPoints(); ++n)
+		QVector<const Data2D*> blockData;
+		QVector<double> blockZ;
+		for (DataSet* ds = dataSet; (ds != NULL) && (blockData.count() < blockSize); ds = ds->next)
 		{
-			const Array<double>& x = dataSet->data().constArrayX();
-			const Array<double>& y = dataSet->data().constArrayY();
-			parser.writeLineF("%e  %e\n", x.value(n), y.value(n));
+			blockData << &ds->data();
+			blockZ << ds->z();
 		}
-		parser.writeLineF("\n");
-	}
 
-	parser.closeFiles();
+		QVector<QByteArray> blockText = BufferedWriter::formatData(blockData);
+		for (int n=0; n<blockText.count(); ++n)
+		{
+			writer.write("# Z = ");
+			writer.write(blockZ.at(n));
+			writer.write("\n");
+			writer.write(blockText.at(n));
+			writer.write("\n");
+
+			dataSet = dataSet->next;
+		}
+	}
 
-	return true;
+	return writer.close();
 }
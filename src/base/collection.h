@@ -26,12 +26,14 @@
 #include "base/displaydataset.h"
 #include "base/transformer.h"
 #include "base/colourscale.h"
+#include "base/contourgenerator.h"
 #include "render/linestyle.h"
 #include "render/primitivelist.h"
 #include "templates/objectstore.h"
 
 // Forward Declarations
 class FitKernel;
+class Job;
 
 class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 {
@@ -61,6 +63,10 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	// Version counter for changes to data
 	int dataVersion_;
 
+	private:
+	// Return whether first dataset has a lower z value than the second (for sorting)
+	static bool dataSetZLessThan(const DataSet* a, const DataSet* b);
+
 	public:
 	// Set name of collection
 	void setName(QString title);
@@ -84,6 +90,8 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	void removeDataSet(DataSet* dataSet);
 	// Set z value of specified dataset
 	void setDataSetZ(DataSet* target, double z);
+	// Sort datasets into ascending z order
+	void sortDataSets();
 	// Set data for specified dataste (from source DataSet)
 	void setDataSetData(DataSet* target, DataSet& source);
 	// Return first dataset in list
@@ -110,6 +118,8 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	QDir dataFileDirectory();
 	// Append dataset to collection
 	bool appendDataSet(QString fileName);
+	// Append datasets to collection, taking ownership of them, and returning the number appended
+	int appendDataSets(List<DataSet>& newDataSets);
 	// Load specified dataset
 	bool loadDataSet(DataSet* dataSet);
 	// Reload data for all dataset
@@ -124,6 +134,46 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	int dataVersion();
 
 
+	/*
+	 * Deferred Data
+	 */
+	private:
+	// Access stamp at which deferred data was last used
+	unsigned long int lastDataAccess_;
+
+	public:
+	// Note that deferred data in this collection has been used
+	void touchDeferredData();
+	// Return access stamp at which deferred data was last used
+	unsigned long int lastDataAccess() const;
+	// Release resident deferred data in this collection, returning number of bytes freed
+	long int evictDeferredData();
+	// Make all deferred data resident and stop deferring it (including in fits and slices)
+	void detachDeferredData();
+
+
+	/*
+	 * Memory
+	 */
+	private:
+	// Whether derived (transformed and display) data has been released, and must be regenerated when next required
+	bool derivedDataReleased_;
+
+	public:
+	// Return whether collection is cold (i.e. not visible), and so a candidate for releasing memory
+	bool isCold();
+	// Release derived data, returning number of bytes freed
+	long int releaseDerivedData();
+	// Compress data values held in memory, returning number of bytes freed
+	long int compressData();
+	// Return number of bytes used by data values (compressed or not)
+	long int valuesSize();
+	// Return number of bytes used by derived (transformed and display) data
+	long int derivedDataSize();
+	// Return number of datasets whose values are currently compressed
+	int nCompressedDataSets();
+
+
 	/*
 	 * Transform
 	 */
@@ -140,16 +190,16 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	Vec3<double> interpolationStep_;
 
 	public:
-	// Return transformed data minima, calculating if necessary
-	Vec3<double> transformMin();
-	// Return transformed data maxima, calculating if necessary
-	Vec3<double> transformMax();
-	// Return transformed positive data minima
-	Vec3<double> transformMinPositive();
-	// Return transformed positive data maxima
-	Vec3<double> transformMaxPositive();
-	// Set transform equation for data
-	void setTransformEquation(int axis, QString transformEquation);
+	// Return transformed data minima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+	Vec3<double> transformMin(bool allowStale = false);
+	// Return transformed data maxima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+	Vec3<double> transformMax(bool allowStale = false);
+	// Return transformed positive data minima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+	Vec3<double> transformMinPositive(bool allowStale = false);
+	// Return transformed positive data maxima, calculating if necessary (or returning previous values, if allowed, while they are regenerated in the background)
+	Vec3<double> transformMaxPositive(bool allowStale = false);
+	// Set transform equation for data, returning whether it is valid
+	bool setTransformEquation(int axis, QString transformEquation);
 	// Return transform equation for data
 	QString transformEquation(int axis);
 	// Return whether specified transform equation is valid
@@ -204,14 +254,42 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	List<Collection> slices_;
 	// Current slice data
 	Collection* currentSlice_;
+	// Axis and bin from which current slice data was taken
+	int currentSliceAxis_, currentSliceBin_;
+	// Display data version from which current slice data was taken
+	int currentSliceVersion_;
+	// Z values of display data, used to locate slices at fixed Z
+	Array<double> sliceIndexZ_;
+	// Ordering of z values in sliceIndexZ_ (1 = ascending, -1 = descending, 0 = unordered)
+	int sliceIndexZOrder_;
+	// Display data version at which sliceIndexZ_ was generated
+	int sliceIndexZVersion_;
+	// Display data y values in column-major order (all z for each x), used to extract slices at fixed X
+	Array<double> sliceIndexY_;
+	// Display data version at which sliceIndexY_ was generated
+	int sliceIndexYVersion_;
+	// Contour generator, used to extract slices at fixed Y
+	ContourGenerator contourGenerator_;
+	// Display data version at which contour generator grid was set
+	int contourGridVersion_;
+	// Y value at which current slice (contour) was taken
+	double currentSliceLevel_;
+	// Contour lines (before splitting into pieces with increasing x) from which current slice was generated
+	List<Data2D> currentContourLines_;
 	// FitKernel (if a FitCollection)
 	FitKernel* fitKernel_;
 
 	private:
+	// Update side index of display data used for slice extraction, including y values if requested
+	void updateSliceIndex(bool includeValues);
+	// Release side index of display data, returning number of bytes freed
+	long int releaseSliceIndex();
 	// Return axis bin value of closest point to supplied value
 	int closestBin(int axis, double value);
-	// Get slice at specified axis and bin
-	void getSlice(int axis, int bin);
+	// Get slice at specified axis and bin, returning false if the current slice was already up to date
+	bool getSlice(int axis, int bin);
+	// Get contour at specified Y value, returning false if the current slice was already up to date
+	bool getContour(double level);
 
 	public:
 	// Locate collection using parts specified
@@ -254,6 +332,8 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	void extractCurrentSlice(int axis, double axisValue);
 	// Return current slice
 	Collection* currentSlice();
+	// Return contour lines from which current slice was generated (if it is a contour)
+	Data2D* currentContourLines();
 	// Add FitKernel, if one does not exist
 	void addFitKernel();
 	// Return FitKernel
@@ -266,10 +346,40 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	private:
 	// Data version at which limits and transforms were last updated
 	int limitsAndTransformsVersion_;
+	// Number of datasets present when limits and transforms were last updated
+	int limitsAndTransformsNDataSets_;
+	// Data version at which the current run of appends (with no other changes in between) started
+	int appendBaseVersion_;
+	// Data version following the most recent append
+	int appendedAtVersion_;
 
 	private:
 	// Update data limits and transform data
 	void updateLimitsAndTransforms();
+	// Return whether datasets have only been appended (in order) since the specified data version
+	bool appendedOnlySince(int version);
+
+
+	/*
+	 * Background Update
+	 */
+	private:
+	// Data version for which derived data is being generated in the background (-1 if none)
+	int backgroundUpdateVersion_;
+	// Data version for which a background update was cancelled (-1 if none)
+	int backgroundUpdateCancelledAt_;
+	// Job on whose behalf derived data is being generated (if this is a working copy)
+	Job* updateJob_;
+
+	public:
+	// Request that derived data is regenerated in the background, returning true if the caller should wait for it
+	bool requestBackgroundUpdate();
+	// Copy data and transform settings from specified source, ready to generate derived data in the background
+	void copyForBackgroundUpdate(const Collection& source);
+	// Generate derived data (limits, transformed data, and display data) on behalf of the specified job
+	void updateDerivedData(Job* job);
+	// Take derived data generated in the background by the specified collection, if it is still current
+	bool takeDerivedData(Collection& source, int version, bool cancelled);
 
 
 	/*
@@ -355,7 +465,7 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	 */
 	public:
 	// Display types enum
-	enum DisplayStyle { LineXYStyle, LineZYStyle, GridStyle, SurfaceStyle, UnlitSurfaceStyle, nDisplayStyles };
+	enum DisplayStyle { LineXYStyle, LineZYStyle, GridStyle, SurfaceStyle, UnlitSurfaceStyle, ImageStyle, nDisplayStyles };
 	// Convert text string to DisplayStyle
 	static DisplayStyle displayStyle(QString s);
 	// Convert DisplayStyle to text string
@@ -368,6 +478,10 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	List<DisplayDataSet> displayData_;
 	// Data version at which displayData_ was last generated
 	int displayDataGeneratedAt_;
+	// Data version at which displayData_ was last generated from scratch
+	int displayDataResetAt_;
+	// Number of datasets present when displayData_ was last generated
+	int displayDataNDataSets_;
 	// Abscissa values for display data
 	Array<double> displayAbscissa_;
 	// Display style of data
@@ -380,6 +494,10 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	int displayStyleVersion_;
 
 	private:
+	// Get (interpolated) display arrays for specified dataset
+	void displayArrays(DataSet* dataSet, Array<double>& x, Array<double>& y);
+	// Add display data for datasets from the index specified, returning false if all display data must be regenerated instead
+	bool appendDisplayData(int firstIndex);
 	// Generate display data
 	void updateDisplayData();
 
@@ -392,6 +510,8 @@ class Collection : public ListItem<Collection>, public ObjectStore<Collection>
 	const Array<double>& displayAbscissa();
 	// Return transformed data to display
 	List<DisplayDataSet>& displayData();
+	// Return whether existing display data is unchanged (but may have been added to) since the specified data version
+	bool displayDataAppendedSince(int version);
 	// Set display style of data
 	void setDisplayStyle(DisplayStyle style);
 	// Return display style of data
@@ -0,0 +1,285 @@
+/*
+	*** Collection Operations
+	*** src/base/collectionoperations.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/collectionoperations.h"
+#include "base/collection.h"
+#include "base/jobscheduler.h"
+#include "session/session.h"
+#include <QRunnable>
+#include <algorithm>
+
+// Pass Task
+class CollectionOperationTask : public QRunnable
+{
+	public:
+	// Constructor
+	CollectionOperationTask(CollectionOperations& operations, int firstIndex, int stride, int nDataSets) : QRunnable(), operations_(operations)
+	{
+		firstIndex_ = firstIndex;
+		stride_ = stride;
+		nDataSets_ = nDataSets;
+	}
+
+	private:
+	// Parent operations
+	CollectionOperations& operations_;
+	// Index of first dataset to process, and stride between datasets
+	int firstIndex_, stride_;
+	// Total number of datasets
+	int nDataSets_;
+
+	public:
+	// Apply current pass to our share of the datasets
+	void run()
+	{
+		for (int n=firstIndex_; n<nDataSets_; n += stride_) operations_.applyPass(n);
+	}
+};
+
+// Constructor
+CollectionOperations::CollectionOperations(Collection* target)
+{
+	target_ = target;
+	targetValuesReady_ = false;
+	valuesChanged_ = false;
+	zChanged_ = false;
+	success_ = true;
+	passType_ = CollectionOperations::OffsetYPass;
+	passValueA_ = 0.0;
+	passValueB_ = 0.0;
+
+	// Grab data for all datasets in the target (values are made available for modification only when needed by a pass)
+	for (DataSet* dataSet = target_->dataSets(); dataSet != NULL; dataSet = dataSet->next) targetData_.add(&dataSet->editableData(false));
+}
+
+// Destructor
+CollectionOperations::~CollectionOperations()
+{
+	finish();
+}
+
+/*
+ * Passes
+ */
+
+// Set per-dataset source data for current pass from specified collection
+bool CollectionOperations::setPassSource(Collection& source)
+{
+	// Source must contain either one dataset (applied to all) or the same number of datasets as the target
+	int nSource = source.nDataSets();
+	if ((nSource != 1) && (nSource != targetData_.nItems()))
+	{
+		msg.print("Error: Source collection '%s' contains %i datasets, but must contain either one or %i.\n", qPrintable(source.name()), nSource, targetData_.nItems());
+		success_ = false;
+		return false;
+	}
+
+	// Take a copy of each source dataset (which shares its values) and interpolate it here, so that the pass tasks share a single interpolation of each
+	passSourceData_.clear();
+	for (DataSet* dataSet = source.dataSets(); dataSet != NULL; dataSet = dataSet->next)
+	{
+		Data2D* data = passSourceData_.add();
+		(*data) = dataSet->data();
+		data->interpolate();
+	}
+
+	passSource_.clear();
+	Data2D* sourceData = passSourceData_.first();
+	for (int n=0; n<targetData_.nItems(); ++n)
+	{
+		passSource_.add(sourceData);
+		if (nSource > 1) sourceData = sourceData->next;
+	}
+
+	return true;
+}
+
+// Run pass of specified type over all datasets
+void CollectionOperations::runPass(PassType type, bool valuesRequired)
+{
+	// Data values must be made resident (and detached from any binary file) before modifying them
+	// This may load deferred data, and so must be done here rather than in the pass tasks
+	if (valuesRequired && (!targetValuesReady_))
+	{
+		for (DataSet* dataSet = target_->dataSets(); dataSet != NULL; dataSet = dataSet->next) dataSet->editableData(true);
+		targetValuesReady_ = true;
+	}
+
+	passType_ = type;
+
+	// Split the datasets between threads, unless there are too few to make this worthwhile
+	int nDataSets = targetData_.nItems();
+	int nThreads = std::min(TaskGroup::maxThreadCount(), nDataSets);
+	if (nThreads < 2) for (int n=0; n<nDataSets; ++n) applyPass(n);
+	else
+	{
+		TaskGroup tasks;
+		for (int n=0; n<nThreads; ++n) tasks.start(new CollectionOperationTask(*this, n, nThreads, nDataSets));
+		tasks.waitForDone();
+	}
+
+	if (valuesRequired) valuesChanged_ = true;
+	else zChanged_ = true;
+}
+
+// Apply current pass to dataset with specified index (called by pass tasks)
+void CollectionOperations::applyPass(int index)
+{
+	Data2D* data = targetData_.value(index);
+
+	switch (passType_)
+	{
+		case (CollectionOperations::OffsetYPass):
+			data->arrayY() += passValueA_;
+			break;
+		case (CollectionOperations::ScaleYPass):
+			data->arrayY() *= passValueA_;
+			break;
+		case (CollectionOperations::SubtractAverageYPass):
+			passValues_[index] = data->averageY(passValueA_, passValueB_);
+			data->arrayY() -= passValues_.value(index);
+			break;
+		case (CollectionOperations::OffsetZPass):
+			data->setZ(data->z() + passValueA_);
+			break;
+		case (CollectionOperations::SetZPass):
+			data->setZ(passValues_.value(index));
+			break;
+		case (CollectionOperations::DivideInterpolatedPass):
+		case (CollectionOperations::SubtractInterpolatedPass):
+		{
+			// The source was interpolated in setPassSource(), so it is only read here (each task keeps its own interval)
+			const Data2D& source = *passSource_.value(index);
+			const Array<double>& x = data->constArrayX();
+			Array<double>& y = data->arrayY();
+			double value;
+			int interval = -1;
+			for (int n=0; n<x.nItems(); ++n)
+			{
+				value = source.interpolated(x.value(n), interval);
+				if (passType_ == CollectionOperations::SubtractInterpolatedPass) y[n] -= value;
+				else y[n] = (value == 0.0 ? 0.0 : y[n] / value);
+			}
+			break;
+		}
+	}
+}
+
+/*
+ * Operations
+ */
+
+// Add constant value to y values of all datasets
+CollectionOperations& CollectionOperations::offsetY(double delta)
+{
+	passValueA_ = delta;
+	runPass(CollectionOperations::OffsetYPass, true);
+
+	return *this;
+}
+
+// Multiply y values of all datasets by constant factor
+CollectionOperations& CollectionOperations::scaleY(double factor)
+{
+	passValueA_ = factor;
+	runPass(CollectionOperations::ScaleYPass, true);
+
+	return *this;
+}
+
+// Subtract average y value (over specified x range) from each dataset
+CollectionOperations& CollectionOperations::subtractAverageOverX(double xMin, double xMax)
+{
+	passValueA_ = xMin;
+	passValueB_ = xMax;
+	passValues_.createEmpty(targetData_.nItems(), 0.0);
+	runPass(CollectionOperations::SubtractAverageYPass, true);
+
+	return *this;
+}
+
+// Add constant value to z values of all datasets
+CollectionOperations& CollectionOperations::offsetZ(double delta)
+{
+	passValueA_ = delta;
+	runPass(CollectionOperations::OffsetZPass, false);
+
+	return *this;
+}
+
+// Set z values of all datasets (one value per dataset)
+CollectionOperations& CollectionOperations::setZ(const Array<double>& zValues)
+{
+	if (zValues.nItems() != targetData_.nItems())
+	{
+		msg.print("Error: Number of z values supplied (%i) does not match the number of datasets (%i).\n", zValues.nItems(), targetData_.nItems());
+		success_ = false;
+		return *this;
+	}
+
+	passValues_ = zValues;
+	runPass(CollectionOperations::SetZPass, false);
+
+	return *this;
+}
+
+// Divide datasets by (interpolated) datasets in specified collection
+CollectionOperations& CollectionOperations::divideBy(Collection& source)
+{
+	if (setPassSource(source)) runPass(CollectionOperations::DivideInterpolatedPass, true);
+
+	return *this;
+}
+
+// Subtract (interpolated) datasets in specified collection from datasets
+CollectionOperations& CollectionOperations::subtractInterpolated(Collection& source)
+{
+	if (setPassSource(source)) runPass(CollectionOperations::SubtractInterpolatedPass, true);
+
+	return *this;
+}
+
+// Return per-dataset values calculated by the last operation (e.g. averages subtracted)
+const Array<double>& CollectionOperations::lastValues()
+{
+	return passValues_;
+}
+
+// Return whether all operations have succeeded
+bool CollectionOperations::success()
+{
+	return success_;
+}
+
+// Notify target collection of all changes made
+void CollectionOperations::finish()
+{
+	if ((!valuesChanged_) && (!zChanged_)) return;
+
+	// If z values have changed the datasets may need to be reordered, which will also notify the change
+	if (zChanged_) target_->sortDataSets();
+	else target_->notifyDataChanged();
+
+	UChromaSession::setAsModified();
+
+	valuesChanged_ = false;
+	zChanged_ = false;
+}
@@ -0,0 +1,115 @@
+/*
+	*** Collection Operations
+	*** src/base/collectionoperations.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_COLLECTIONOPERATIONS_H
+#define UCHROMA_COLLECTIONOPERATIONS_H
+
+#include "base/data2d.h"
+#include "templates/array.h"
+#include "templates/list.h"
+
+// Forward Declarations
+class Collection;
+
+// Collection Operations
+class CollectionOperations
+{
+	public:
+	// Constructor / Destructor
+	CollectionOperations(Collection* target);
+	~CollectionOperations();
+
+
+	/*
+	 * Target
+	 */
+	private:
+	// Target collection
+	Collection* target_;
+	// Data of target datasets
+	Array<Data2D*> targetData_;
+	// Whether target data values are ready for modification (i.e. resident and no longer deferred)
+	bool targetValuesReady_;
+	// Whether data values have been modified
+	bool valuesChanged_;
+	// Whether z values have been modified
+	bool zChanged_;
+	// Whether all operations have succeeded
+	bool success_;
+
+
+	/*
+	 * Passes
+	 */
+	public:
+	// Pass types
+	enum PassType { OffsetYPass, ScaleYPass, SubtractAverageYPass, OffsetZPass, SetZPass, DivideInterpolatedPass, SubtractInterpolatedPass };
+
+	private:
+	// Type of current pass
+	PassType passType_;
+	// Values for current pass
+	double passValueA_, passValueB_;
+	// Per-dataset values for current pass
+	Array<double> passValues_;
+	// Distinct source data for current pass (interpolated once, before the pass is run)
+	List<Data2D> passSourceData_;
+	// Per-dataset source data for current pass
+	Array<const Data2D*> passSource_;
+
+	private:
+	// Set per-dataset source data for current pass from specified collection
+	bool setPassSource(Collection& source);
+	// Run pass of specified type over all datasets
+	void runPass(PassType type, bool valuesRequired);
+
+	public:
+	// Apply current pass to dataset with specified index (called by pass tasks)
+	void applyPass(int index);
+
+
+	/*
+	 * Operations
+	 */
+	public:
+	// Add constant value to y values of all datasets
+	CollectionOperations& offsetY(double delta);
+	// Multiply y values of all datasets by constant factor
+	CollectionOperations& scaleY(double factor);
+	// Subtract average y value (over specified x range) from each dataset
+	CollectionOperations& subtractAverageOverX(double xMin, double xMax);
+	// Add constant value to z values of all datasets
+	CollectionOperations& offsetZ(double delta);
+	// Set z values of all datasets (one value per dataset)
+	CollectionOperations& setZ(const Array<double>& zValues);
+	// Divide datasets by (interpolated) datasets in specified collection
+	CollectionOperations& divideBy(Collection& source);
+	// Subtract (interpolated) datasets in specified collection from datasets
+	CollectionOperations& subtractInterpolated(Collection& source);
+	// Return per-dataset values calculated by the last operation (e.g. averages subtracted)
+	const Array<double>& lastValues();
+	// Return whether all operations have succeeded
+	bool success();
+	// Notify target collection of all changes made
+	void finish();
+};
+
+#endif
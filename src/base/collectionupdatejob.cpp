@@ -0,0 +1,51 @@
+/*
+	*** Collection Update Job
+	*** src/base/collectionupdatejob.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/collectionupdatejob.h"
+
+// Constructor (called in the GUI thread)
+CollectionUpdateJob::CollectionUpdateJob(Collection* target) : Job(QString("Updating '%1'").arg(target->name()), target)
+{
+	target_ = target;
+	dataVersion_ = target->dataVersion();
+
+	// Take a copy of the data and transform settings, so the worker never touches the target
+	workCollection_.copyForBackgroundUpdate(*target);
+}
+
+/*
+ * Execution
+ */
+
+// Perform the job (called in a worker thread)
+void CollectionUpdateJob::execute()
+{
+	workCollection_.updateDerivedData(this);
+}
+
+// Deliver results of the job (called in the GUI thread, even if the job was cancelled)
+void CollectionUpdateJob::deliver()
+{
+	// The target may have been deleted while we were working
+	if (!Collection::objectValid(target_)) return;
+
+	target_->takeDerivedData(workCollection_, dataVersion_, cancelled());
+}
@@ -0,0 +1,60 @@
+/*
+	*** Collection Update Job
+	*** src/base/collectionupdatejob.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_COLLECTIONUPDATEJOB_H
+#define UCHROMA_COLLECTIONUPDATEJOB_H
+
+#include "base/jobscheduler.h"
+#include "base/collection.h"
+
+// Collection Update Job
+class CollectionUpdateJob : public Job
+{
+	public:
+	// Constructor (called in the GUI thread)
+	CollectionUpdateJob(Collection* target);
+
+
+	/*
+	 * Data
+	 */
+	private:
+	// Collection whose derived data is to be regenerated
+	Collection* target_;
+	// Data version of target collection when the job was created
+	int dataVersion_;
+	// Working copy of target collection's data, in which derived data is generated
+	Collection workCollection_;
+
+
+	/*
+	 * Execution
+	 */
+	protected:
+	// Perform the job (called in a worker thread)
+	void execute();
+
+	public:
+	// Deliver results of the job (called in the GUI thread, even if the job was cancelled)
+	void deliver();
+};
+
+#endif
@@ -0,0 +1,411 @@
+/*
+	*** Contour Generator
+	*** src/base/contourgenerator.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/contourgenerator.h"
+#include "base/jobscheduler.h"
+#include <QRunnable>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+// Number of cells along each side of a cell block
+#define CONTOURBLOCKSIZE 16
+// Minimum number of cells in grid before extraction is split between threads
+#define CONTOURPARALLELCELLS 65536
+
+// Constructor
+ContourGenerator::ContourGenerator()
+{
+	nX_ = 0;
+	nZ_ = 0;
+	nBlocksX_ = 0;
+	nBlocksZ_ = 0;
+}
+
+// Destructor
+ContourGenerator::~ContourGenerator()
+{
+}
+
+/*
+ * Grid
+ */
+
+// Set grid from supplied display data, which must remain unchanged while the grid is in use
+void ContourGenerator::setGrid(const Array<double>& abscissa, List<DisplayDataSet>& displayData)
+{
+	clear();
+
+	// Grab row data, checking that each row is complete
+	nX_ = abscissa.nItems();
+	nZ_ = displayData.nItems();
+	if ((nX_ < 2) || (nZ_ < 2))
+	{
+		clear();
+		return;
+	}
+	x_ = abscissa;
+	z_.reserve(nZ_);
+	rows_.reserve(nZ_);
+	rowTypes_.reserve(nZ_);
+	for (DisplayDataSet* displayDataSet = displayData.first(); displayDataSet != NULL; displayDataSet = displayDataSet->next)
+	{
+		if ((displayDataSet->y().nItems() != nX_) || (displayDataSet->yType().nItems() != nX_))
+		{
+			clear();
+			return;
+		}
+		z_.add(displayDataSet->z());
+		rows_.add(displayDataSet->y().array());
+		rowTypes_.add(displayDataSet->yType().array());
+	}
+
+	// Calculate value range of each cell - cells containing a missing point will never contain a contour
+	// Values are rounded outwards so that single-precision storage never excludes a contour that should be found
+	const int nCellsX = nX_-1, nCellsZ = nZ_-1;
+	cellMin_.createEmpty(nCellsX*nCellsZ, std::numeric_limits<float>::max());
+	cellMax_.createEmpty(nCellsX*nCellsZ, -std::numeric_limits<float>::max());
+	float* cellMin = cellMin_.array();
+	float* cellMax = cellMax_.array();
+	for (int j=0; j<nCellsZ; ++j)
+	{
+		const double* y0 = rows_.value(j), *y1 = rows_.value(j+1);
+		const DisplayDataSet::DataPointType* type0 = rowTypes_.value(j), *type1 = rowTypes_.value(j+1);
+		for (int i=0; i<nCellsX; ++i)
+		{
+			if ((type0[i] == DisplayDataSet::NoPoint) || (type0[i+1] == DisplayDataSet::NoPoint) || (type1[i] == DisplayDataSet::NoPoint) || (type1[i+1] == DisplayDataSet::NoPoint)) continue;
+			double minValue = std::min(std::min(y0[i], y0[i+1]), std::min(y1[i], y1[i+1]));
+			double maxValue = std::max(std::max(y0[i], y0[i+1]), std::max(y1[i], y1[i+1]));
+			cellMin[j*nCellsX+i] = nextafterf(float(minValue), -std::numeric_limits<float>::max());
+			cellMax[j*nCellsX+i] = nextafterf(float(maxValue), std::numeric_limits<float>::max());
+		}
+	}
+
+	// Calculate value range of each block of cells
+	nBlocksX_ = (nCellsX + CONTOURBLOCKSIZE - 1) / CONTOURBLOCKSIZE;
+	nBlocksZ_ = (nCellsZ + CONTOURBLOCKSIZE - 1) / CONTOURBLOCKSIZE;
+	blockMin_.createEmpty(nBlocksX_*nBlocksZ_, std::numeric_limits<float>::max());
+	blockMax_.createEmpty(nBlocksX_*nBlocksZ_, -std::numeric_limits<float>::max());
+	float* blockMin = blockMin_.array();
+	float* blockMax = blockMax_.array();
+	for (int j=0; j<nCellsZ; ++j)
+	{
+		for (int i=0; i<nCellsX; ++i)
+		{
+			int block = (j/CONTOURBLOCKSIZE)*nBlocksX_ + i/CONTOURBLOCKSIZE;
+			if (cellMin[j*nCellsX+i] < blockMin[block]) blockMin[block] = cellMin[j*nCellsX+i];
+			if (cellMax[j*nCellsX+i] > blockMax[block]) blockMax[block] = cellMax[j*nCellsX+i];
+		}
+	}
+}
+
+// Clear grid
+void ContourGenerator::clear()
+{
+	nX_ = 0;
+	nZ_ = 0;
+	nBlocksX_ = 0;
+	nBlocksZ_ = 0;
+	x_.releaseStorage();
+	z_.releaseStorage();
+	rows_.releaseStorage();
+	rowTypes_.releaseStorage();
+	cellMin_.releaseStorage();
+	cellMax_.releaseStorage();
+	blockMin_.releaseStorage();
+	blockMax_.releaseStorage();
+}
+
+// Return whether a grid is set
+bool ContourGenerator::hasGrid() const
+{
+	return ((nX_ > 1) && (nZ_ > 1));
+}
+
+// Return number of bytes used by grid
+long int ContourGenerator::memoryUsage() const
+{
+	long int bytes = (x_.size() + z_.size()) * sizeof(double);
+	bytes += (rows_.size() + rowTypes_.size()) * sizeof(void*);
+	bytes += (cellMin_.size() + cellMax_.size() + blockMin_.size() + blockMax_.size()) * sizeof(float);
+	return bytes;
+}
+
+/*
+ * Extraction
+ */
+
+// Contour Segment Task
+class ContourSegmentTask : public QRunnable
+{
+	public:
+	// Constructor
+	ContourSegmentTask(const ContourGenerator& generator, double level, int firstBlockRow, int stride, Array<int>& segments) : QRunnable(), generator_(generator), segments_(segments)
+	{
+		level_ = level;
+		firstBlockRow_ = firstBlockRow;
+		stride_ = stride;
+	}
+
+	private:
+	// Source generator
+	const ContourGenerator& generator_;
+	// Contour level
+	double level_;
+	// First block row to process, and stride between block rows
+	int firstBlockRow_, stride_;
+	// Destination array
+	Array<int>& segments_;
+
+	public:
+	// Find segments in our share of the grid
+	void run()
+	{
+		generator_.findSegments(level_, firstBlockRow_, stride_, segments_);
+	}
+};
+
+// Return coordinates of the contour crossing on the specified grid edge
+void ContourGenerator::edgePoint(int edge, double level, double& x, double& z) const
+{
+	// Edges are numbered with all those along x (between (i,j) and (i+1,j)) first, followed by those along z (between (i,j) and (i,j+1))
+	const int nEdgesX = (nX_-1)*nZ_;
+	int i, j;
+	if (edge < nEdgesX)
+	{
+		i = edge % (nX_-1);
+		j = edge / (nX_-1);
+		double y0 = rows_.value(j)[i], y1 = rows_.value(j)[i+1];
+		double t = (level - y0) / (y1 - y0);
+		x = x_.value(i) + t * (x_.value(i+1) - x_.value(i));
+		z = z_.value(j);
+	}
+	else
+	{
+		edge -= nEdgesX;
+		i = edge % nX_;
+		j = edge / nX_;
+		double y0 = rows_.value(j)[i], y1 = rows_.value(j+1)[i];
+		double t = (level - y0) / (y1 - y0);
+		x = x_.value(i);
+		z = z_.value(j) + t * (z_.value(j+1) - z_.value(j));
+	}
+}
+
+// Find contour segments at specified level in the specified rows of cell blocks, appending their edge pairs to the supplied array
+void ContourGenerator::findSegments(double level, int firstBlockRow, int stride, Array<int>& segments) const
+{
+	const int nCellsX = nX_-1, nCellsZ = nZ_-1, nEdgesX = (nX_-1)*nZ_;
+	const float* cellMin = cellMin_.constArray();
+	const float* cellMax = cellMax_.constArray();
+	const float* blockMin = blockMin_.constArray();
+	const float* blockMax = blockMax_.constArray();
+	int edges[4], crossings[4], nCrossings, i, j, n;
+	double v[4];
+
+	for (int blockRow = firstBlockRow; blockRow < nBlocksZ_; blockRow += stride)
+	{
+		for (int blockColumn = 0; blockColumn < nBlocksX_; ++blockColumn)
+		{
+			// Skip whole block if the level lies outside its range
+			int block = blockRow*nBlocksX_ + blockColumn;
+			if ((level < blockMin[block]) || (level > blockMax[block])) continue;
+
+			int lastJ = std::min((blockRow+1)*CONTOURBLOCKSIZE, nCellsZ), lastI = std::min((blockColumn+1)*CONTOURBLOCKSIZE, nCellsX);
+			for (j = blockRow*CONTOURBLOCKSIZE; j < lastJ; ++j)
+			{
+				const double* y0 = rows_.value(j), *y1 = rows_.value(j+1);
+				for (i = blockColumn*CONTOURBLOCKSIZE; i < lastI; ++i)
+				{
+					// Skip cell if the level lies outside its range
+					if ((level < cellMin[j*nCellsX+i]) || (level > cellMax[j*nCellsX+i])) continue;
+
+					// Corner values, anticlockwise from (i,j), and the edges between them (bottom, right, top, left)
+					v[0] = y0[i];
+					v[1] = y0[i+1];
+					v[2] = y1[i+1];
+					v[3] = y1[i];
+					edges[0] = j*nCellsX + i;
+					edges[1] = nEdgesX + j*nX_ + i + 1;
+					edges[2] = (j+1)*nCellsX + i;
+					edges[3] = nEdgesX + j*nX_ + i;
+
+					// Determine which edges the contour crosses
+					nCrossings = 0;
+					for (n=0; n<4; ++n) if ((v[n] >= level) != (v[(n+1)%4] >= level)) crossings[nCrossings++] = n;
+					if (nCrossings == 2)
+					{
+						segments.add(edges[crossings[0]]);
+						segments.add(edges[crossings[1]]);
+					}
+					else if (nCrossings == 4)
+					{
+						// Saddle point - use the average of the corner values to decide which corners are connected
+						// If the centre lies on the same side of the contour as corner 0, corners 1 and 3 are cut off separately
+						bool centreAbove = (0.25*(v[0]+v[1]+v[2]+v[3]) >= level);
+						if (centreAbove == (v[0] >= level))
+						{
+							segments.add(edges[0]);
+							segments.add(edges[1]);
+							segments.add(edges[2]);
+							segments.add(edges[3]);
+						}
+						else
+						{
+							segments.add(edges[3]);
+							segments.add(edges[0]);
+							segments.add(edges[1]);
+							segments.add(edges[2]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// Extract contour polylines at specified level (x and z coordinates are stored in the x and y arrays of each line)
+void ContourGenerator::extract(double level, List<Data2D>& lines) const
+{
+	lines.clear();
+	if (!hasGrid()) return;
+
+	// Find segments, splitting rows of cell blocks between threads if the grid is large enough to make this worthwhile
+	int nThreads = ((nX_-1)*(nZ_-1) < CONTOURPARALLELCELLS ? 1 : std::min(TaskGroup::maxThreadCount(), nBlocksZ_));
+	Array<int> segments;
+	if (nThreads < 2) findSegments(level, 0, 1, segments);
+	else
+	{
+		Array< Array<int> > threadSegments(nThreads);
+		TaskGroup tasks;
+		for (int n=0; n<nThreads; ++n) tasks.start(new ContourSegmentTask(*this, level, n, nThreads, threadSegments[n]));
+		tasks.waitForDone();
+
+		int nItems = 0;
+		for (int n=0; n<nThreads; ++n) nItems += threadSegments[n].nItems();
+		segments.reserve(nItems);
+		for (int n=0; n<nThreads; ++n)
+		{
+			const Array<int>& threadItems = threadSegments[n];
+			for (int m=0; m<threadItems.nItems(); ++m) segments.add(threadItems.value(m));
+		}
+	}
+	const int nSegments = segments.nItems() / 2;
+	if (nSegments == 0) return;
+
+	// Link segment ends which share an edge - each edge is shared by at most two (adjacent) cells
+	// Sort keys combine the edge index and segment end (2*segment + 0/1) so that ends on the same edge become neighbours
+	const int* edges = segments.constArray();
+	Array<qint64> keys(nSegments*2);
+	qint64* key = keys.array();
+	for (int n=0; n<nSegments*2; ++n) key[n] = (qint64(edges[n]) << 32) | n;
+	std::sort(key, key + nSegments*2);
+	Array<int> link(nSegments*2);
+	int* linked = link.array();
+	for (int n=0; n<nSegments*2; ++n) linked[n] = -1;
+	for (int n=1; n<nSegments*2; ++n)
+	{
+		if ((key[n] >> 32) != (key[n-1] >> 32)) continue;
+		int a = int(key[n-1] & 0xffffffff), b = int(key[n] & 0xffffffff);
+		linked[a] = b;
+		linked[b] = a;
+	}
+
+	// Walk chains of linked segments to form polylines
+	Array<char> visited(nSegments);
+	char* done = visited.array();
+	for (int n=0; n<nSegments; ++n) done[n] = 0;
+	double x, z, lastX = 0.0, lastZ = 0.0;
+	for (int segment = 0; segment < nSegments; ++segment)
+	{
+		if (done[segment]) continue;
+
+		// Find start of chain (an unlinked end), or determine that the chain is closed
+		int end = segment*2, nSteps = 0;
+		bool closed = false;
+		while (linked[end] != -1)
+		{
+			int next = linked[end] ^ 1;
+			if ((next/2 == segment) || (++nSteps > nSegments))
+			{
+				closed = true;
+				end = segment*2;
+				break;
+			}
+			end = next;
+		}
+
+		// Follow chain from start, adding the far end of each segment in turn (and skipping repeated points)
+		Data2D* line = lines.add();
+		line->setZ(level);
+		edgePoint(edges[end], level, x, z);
+		line->addPoint(x, z);
+		lastX = x;
+		lastZ = z;
+		while (end != -1)
+		{
+			done[end/2] = 1;
+			edgePoint(edges[end^1], level, x, z);
+			if ((x != lastX) || (z != lastZ)) line->addPoint(x, z);
+			lastX = x;
+			lastZ = z;
+			end = linked[end^1];
+			if ((end != -1) && done[end/2]) end = -1;
+		}
+
+		// Remove degenerate lines
+		if (line->nPoints() < 2) lines.remove(line);
+		else if (closed && ((line->constArrayX().value(0) != lastX) || (line->constArrayY().value(0) != lastZ))) line->addPoint(line->constArrayX().value(0), line->constArrayY().value(0));
+	}
+}
+
+// Split polylines into pieces with increasing x values, suitable for storage as datasets
+void ContourGenerator::splitMonotonic(const List<Data2D>& lines, List<Data2D>& pieces)
+{
+	pieces.clear();
+	for (Data2D* line = lines.first(); line != NULL; line = line->next)
+	{
+		const double* x = line->constArrayX().constArray();
+		const double* y = line->constArrayY().constArray();
+		int nPoints = line->nPoints(), start = 0;
+		while (start < nPoints-1)
+		{
+			// Find extent of run in which x strictly increases or strictly decreases
+			int end = start+1;
+			if (x[end] == x[start])
+			{
+				// Vertical step, which cannot be represented - skip it
+				start = end;
+				continue;
+			}
+			bool increasing = (x[end] > x[start]);
+			while ((end < nPoints-1) && (increasing ? (x[end+1] > x[end]) : (x[end+1] < x[end]))) ++end;
+
+			// Store piece, reversing it if necessary
+			Data2D* piece = pieces.add();
+			piece->setZ(line->z());
+			if (increasing) for (int n=start; n<=end; ++n) piece->addPoint(x[n], y[n]);
+			else for (int n=end; n>=start; --n) piece->addPoint(x[n], y[n]);
+
+			start = end;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+/*
+	*** Contour Generator
+	*** src/base/contourgenerator.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_CONTOURGENERATOR_H
+#define UCHROMA_CONTOURGENERATOR_H
+
+#include "base/displaydataset.h"
+#include "base/data2d.h"
+#include "templates/list.h"
+#include "templates/array.h"
+
+// Forward Declarations
+/* none */
+
+// Contour Generator
+class ContourGenerator
+{
+	public:
+	// Constructor / Destructor
+	ContourGenerator();
+	~ContourGenerator();
+
+
+	/*
+	 * Grid
+	 */
+	private:
+	// Number of points in grid along x and z
+	int nX_, nZ_;
+	// Abscissa (x) values of grid points
+	Array<double> x_;
+	// Z values of grid rows
+	Array<double> z_;
+	// Y values and point types for each grid row (referencing the source display data)
+	Array<const double*> rows_;
+	Array<const DisplayDataSet::DataPointType*> rowTypes_;
+	// Minimum and maximum values in each grid cell (cells with missing corner points have an empty range)
+	Array<float> cellMin_, cellMax_;
+	// Number of cell blocks along x and z
+	int nBlocksX_, nBlocksZ_;
+	// Minimum and maximum values in each block of cells
+	Array<float> blockMin_, blockMax_;
+
+	public:
+	// Set grid from supplied display data, which must remain unchanged while the grid is in use
+	void setGrid(const Array<double>& abscissa, List<DisplayDataSet>& displayData);
+	// Clear grid
+	void clear();
+	// Return whether a grid is set
+	bool hasGrid() const;
+	// Return number of bytes used by grid
+	long int memoryUsage() const;
+
+
+	/*
+	 * Extraction
+	 */
+	private:
+	// Return coordinates of the contour crossing on the specified grid edge
+	void edgePoint(int edge, double level, double& x, double& z) const;
+
+	public:
+	// Find contour segments at specified level in the specified rows of cell blocks, appending their edge pairs to the supplied array
+	void findSegments(double level, int firstBlockRow, int stride, Array<int>& segments) const;
+	// Extract contour polylines at specified level (x and z coordinates are stored in the x and y arrays of each line)
+	void extract(double level, List<Data2D>& lines) const;
+	// Split polylines into pieces with increasing x values, suitable for storage as datasets
+	static void splitMonotonic(const List<Data2D>& lines, List<Data2D>& pieces);
+};
+
+#endif
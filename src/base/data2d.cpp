@@ -21,6 +21,7 @@
 
 #include "base/data2d.h"
 #include "base/lineparser.h"
+#include "base/bufferedwriter.h"
 #include "base/messenger.h"
 #include "math/constants.h"
 #include "math/mathfunc.h"
@@ -111,6 +112,30 @@ int Data2D::arraySize() const
 	return x_.nItems();
 }
 
+/*!
+ * \brief Return number of bytes allocated for data and interpolation arrays
+ */
+long int Data2D::memoryUsage() const
+{
+	long int nValues = x_.size() + y_.size() + splineA_.size() + splineB_.size() + splineC_.size() + splineD_.size() + splineH_.size();
+	return nValues * sizeof(double);
+}
+
+/*!
+ * \brief Clear data and interpolation arrays, releasing their storage (z is retained)
+ */
+void Data2D::releaseStorage()
+{
+	x_.releaseStorage();
+	y_.releaseStorage();
+	splineA_.releaseStorage();
+	splineB_.releaseStorage();
+	splineC_.releaseStorage();
+	splineD_.releaseStorage();
+	splineH_.releaseStorage();
+	splineInterval_ = -1;
+}
+
 /*!
  * \brief Set specified data point
  */
@@ -585,8 +610,8 @@ bool Data2D::checkBeforeTransform()
 	}
 
 	// Check spacing of data...
-	double deltaX = x_[1] - x_[0], tolerance = 0.001;
-	for (int n=2; n<x_.nItems(); ++n) if (fabs((x_[n] - x_[n-1])-deltaX) > tolerance)
+	double deltaX = x_.value(1) - x_.value(0), tolerance = 0.001;
+	for (int n=2; n<x_.nItems(); ++n) if (fabs((x_.value(n) - x_.value(n-1))-deltaX) > tolerance)
 	{
 		msg.print("Data are unevenly spaced in Data2D. Can't do transform.\n");
 		return false;
@@ -659,15 +684,15 @@ bool Data2D::fourierTransformReal(bool forwardTransform, Data2D::WindowFunction
 	{
 		for (m=1; m<nPoints; ++m)
 		{
-			b = (n+0.5)*k*x_[m];
+			b = (n+0.5)*k*x_.value(m);
 			
 			// Apply window function (Bartlett)
 // 			b *= 1.0 - fabs( ((m/double(nPoints))*0.5)/0.5 );
 
 			cosb = cos(b);
 			sinb = sin(b) * factor;
-			real[n] += y_[m] * cosb;
-			imaginary[n] -= y_[m] * sinb;
+			real[n] += y_.value(m) * cosb;
+			imaginary[n] -= y_.value(m) * sinb;
 		}
 	}
 
@@ -703,7 +728,7 @@ bool Data2D::transformRDF(double atomicDensity, Data2D::WindowFunction wf)
 	// X values of original function are half-bin values, so we must add another bin width on to recover period of original function
 	double lambda = x_.last() - x_.first() + 2.0*x_.first();
 	double k = TWOPI / lambda;
-	double deltaX = x_[1] - x_[0];
+	double deltaX = x_.value(1) - x_.value(0);
 	double windowPos;
 // 	msg.printVerbose("In Data2D::transformRDF(), period of function is %f, real deltaX is %f, and wavenumber is %f\n", lambda, deltaX, k);
 
@@ -722,7 +747,7 @@ bool Data2D::transformRDF(double atomicDensity, Data2D::WindowFunction wf)
 			windowPos = double(m) / double(nPoints-1);
 
 // 			real[n] += x_[m]*x_[m]*y_[m] * sin(x_[m]*Q) * deltaX / (Q * x_[m]);
-			real[n] += sin(x_[m]*Q) * x_[m] * window(wf, windowPos) * y_[m] * deltaX;
+			real[n] += sin(x_.value(m)*Q) * x_.value(m) * window(wf, windowPos) * y_.value(m) * deltaX;
 		}
 
 		// Normalise
@@ -749,7 +774,7 @@ bool Data2D::transformBroadenedRDF(double atomicDensity, double qStep, double fw
 	// X values of original function are half-bin values, so we must add another bin width on to recover period of original function
 	double lambda = x_.last() - x_.first() + 2.0*x_.first();
 	double k = TWOPI / lambda;
-	double deltaX = x_[1] - x_[0];
+	double deltaX = x_.value(1) - x_.value(0);
 	double windowPos, broaden, sigma, sigmaq, sigr, Q, factor, qMax, fq;
 	int n, m, nR = x_.nItems();
 // 	msg.printVerbose("In Data2D::transformBroadenedRDF(), period of function is %f, real deltaX is %f, and wavenumber is %f\n", lambda, deltaX, k);
@@ -772,10 +797,10 @@ bool Data2D::transformBroadenedRDF(double atomicDensity, double qStep, double fw
 			windowPos = double(m) / double(nR-1);
 
 			// Calculate broadening
-			sigr = (sigma + sigmaq*Q) * x_[m];
+			sigr = (sigma + sigmaq*Q) * x_.value(m);
 			broaden = exp(-0.5*sigr*sigr);
 
-			fq += sin(x_[m]*Q) * x_[m] * broaden * window(wf, windowPos) * y_[m] * deltaX;
+			fq += sin(x_.value(m)*Q) * x_.value(m) * broaden * window(wf, windowPos) * y_.value(m) * deltaX;
 		}
 
 		// Normalise
@@ -805,7 +830,7 @@ bool Data2D::transformSQ(double atomicDensity, Data2D::WindowFunction wf)
 	// X values of original function are half-bin values, so we must add another bin width on to recover period of original function
 	double lambda = x_.last() - x_.first() + 2.0*x_.first();
 	double k = TWOPI / lambda;
-	double deltaQ = x_[1] - x_[0];
+	double deltaQ = x_.value(1) - x_.value(0);
 	double windowPos;
 // 	msg.printVerbose("In Data2D::transformSQ(), period of function is %f, real deltaX is %f, and wavenumber is %f\n", lambda, deltaQ, k);
 
@@ -824,7 +849,7 @@ bool Data2D::transformSQ(double atomicDensity, Data2D::WindowFunction wf)
 			windowPos = double(m) / double(nPoints-1);
 			
 // 			real[n] += x_[m]*x_[m]*y_[m] * sin(x_[m]*Q) * deltaX / (Q * x_[m]);
-			real[n] += sin(x_[m]*r) * x_[m] * window(wf, windowPos) * y_[m] * deltaQ;
+			real[n] += sin(x_.value(m)*r) * x_.value(m) * window(wf, windowPos) * y_.value(m) * deltaQ;
 		}
 
 		// Normalise
@@ -851,7 +876,7 @@ bool Data2D::correlateSQ(double atomicDensity)
 	// Assume that the entire dataset constitutes one period of the function...
 	double lambda = x_.last() - x_.first();
 	double k = TWOPI / lambda;
-	double deltaQ = x_[1] - x_[0];
+	double deltaQ = x_.value(1) - x_.value(0);
 // 	msg.printVerbose("In Data2D::correlateSQ(), period of function is %f, real deltaX is %f, and wavenumber is %f\n", lambda, deltaQ, k);
 
 	// Create working arrays
@@ -864,7 +889,7 @@ bool Data2D::correlateSQ(double atomicDensity)
 	for (n=0; n<nPoints; ++n)
 	{
 		r = (n+0.5)*k;
-		for (m=0; m<nPoints; ++m) real[n] += sin(x_[m]*r) * x_[m] * (1.0 - (1.0/y_[m])) * deltaQ;
+		for (m=0; m<nPoints; ++m) real[n] += sin(x_.value(m)*r) * x_.value(m) * (1.0 - (1.0/y_.value(m))) * deltaQ;
 
 		// Normalise
 		factor = 1.0 / (2.0 * PI * PI * atomicDensity * r);
@@ -1003,7 +1028,7 @@ void Data2D::interpolate(bool constrained)
 
 	// Calculate interval array 'h'
 	splineH_.createEmpty(nPoints);
-	for (i=0; i<nPoints-1; ++i) splineH_[i] = x_[i+1] - x_[i];
+	for (i=0; i<nPoints-1; ++i) splineH_[i] = x_.value(i+1) - x_.value(i);
 
 	// Initialise parameter arrays and working array
 	splineA_.createEmpty(nPoints);
@@ -1031,7 +1056,7 @@ void Data2D::interpolate(bool constrained)
 			p = splineH_[i-1];
 			q = 2.0*(splineH_[i-1]+splineH_[i]);
 			r = splineH_[i];
-			s = 6.0 * ((y_[i+1] - y_[i]) / splineH_[i] - (y_[i] - y_[i-1]) / splineH_[i-1]);
+			s = 6.0 * ((y_.value(i+1) - y_.value(i)) / splineH_[i] - (y_.value(i) - y_.value(i-1)) / splineH_[i-1]);
 
 			// -- Calculate r'(i) = r(i) / ( q(i) - r'(i-1)p(i) )
 			rprime[i] = r / (q - rprime[i-1]*p);
@@ -1052,10 +1077,10 @@ void Data2D::interpolate(bool constrained)
 		// splineC_ array now contains m(i)...
 		for (i=0; i<nPoints-1; ++i)
 		{
-			splineB_[i] = (y_[i+1] - y_[i]) / splineH_[i] - 0.5 * splineH_[i] * splineC_[i] - (splineH_[i] * (splineC_[i+1]-splineC_[i]))/6.0;
+			splineB_[i] = (y_.value(i+1) - y_.value(i)) / splineH_[i] - 0.5 * splineH_[i] * splineC_[i] - (splineH_[i] * (splineC_[i+1]-splineC_[i]))/6.0;
 			splineD_[i] = (splineC_[i+1] - splineC_[i]) / (6.0 * splineH_[i]);
 			splineC_[i] *= 0.5;
-			splineA_[i] = y_[i];
+			splineA_[i] = y_.value(i);
 		}
 	}
 	else
@@ -1069,8 +1094,8 @@ void Data2D::interpolate(bool constrained)
 		double gradA, gradB;
 		for (i=1; i<nPoints-1; ++i)
 		{
-			gradA = (x_[i+1] - x_[i])/(y_[i+1] - y_[i]);
-			gradB = (x_[i] - x_[i-1])/(y_[i] - y_[i-1]);
+			gradA = (x_.value(i+1) - x_.value(i))/(y_.value(i+1) - y_.value(i));
+			gradB = (x_.value(i) - x_.value(i-1))/(y_.value(i) - y_.value(i-1));
 			if (UChromaMath::sgn(gradA) != UChromaMath::sgn(gradB)) fp[i] = 0.0;
 			else fp[i] = 2.0 / (gradA + gradB);
 			
@@ -1084,14 +1109,14 @@ void Data2D::interpolate(bool constrained)
 		double fppi, fppim1, dx, dy;
 		for (i=1; i<nPoints; ++i)
 		{
-			dx = x_[i] - x_[i-1];
-			dy = y_[i] - y_[i-1];
+			dx = x_.value(i) - x_.value(i-1);
+			dy = y_.value(i) - y_.value(i-1);
 			fppim1 = -2.0*(fp[i]+2.0*fp[i-1]) / dx + 6.0*dy/(dx*dx);
 			fppi = 2.0*(2.0*fp[i]+fp[i-1]) / dx - 6.0*dy/(dx*dx);
 			splineD_[i-1] = (fppi - fppim1) / (6.0*dx);
-			splineC_[i-1] = (x_[i]*fppim1 - x_[i-1]*fppi) / (2.0*dx);
-			splineB_[i-1] = (dy - splineC_[i-1]*(x_[i]*x_[i] - x_[i-1]*x_[i-1]) - splineD_[i-1]*(x_[i]*x_[i]*x_[i] - x_[i-1]*x_[i-1]*x_[i-1])) / dx;
-			splineA_[i-1] = y_[i-1] - splineB_[i-1]*x_[i-1] - splineC_[i-1]*x_[i-1]*x_[i-1] - splineD_[i-1]*x_[i-1]*x_[i-1]*x_[i-1];
+			splineC_[i-1] = (x_.value(i)*fppim1 - x_.value(i-1)*fppi) / (2.0*dx);
+			splineB_[i-1] = (dy - splineC_[i-1]*(x_.value(i)*x_.value(i) - x_.value(i-1)*x_.value(i-1)) - splineD_[i-1]*(x_.value(i)*x_.value(i)*x_.value(i) - x_.value(i-1)*x_.value(i-1)*x_.value(i-1))) / dx;
+			splineA_[i-1] = y_.value(i-1) - splineB_[i-1]*x_.value(i-1) - splineC_[i-1]*x_.value(i-1)*x_.value(i-1) - splineD_[i-1]*x_.value(i-1)*x_.value(i-1)*x_.value(i-1);
 		}
 	}
 
@@ -1105,7 +1130,19 @@ double Data2D::interpolated(double xvalue)
 {
 	// Do we need to (re)generate the interpolation?
 	if (splineInterval_ == -1) interpolate();
-	
+
+	return interpolated(xvalue, splineInterval_);
+}
+
+/*!
+ * \brief Return spline interpolated y value for supplied x, using and updating the supplied interval (interpolation must already exist)
+ * \details Since the interpolation itself is not modified, a single Data2D may be shared between threads as long as each uses its own interval.
+ * An interval of -1 causes the data to be searched for the correct interval.
+ */
+double Data2D::interpolated(double xvalue, int& interval) const
+{
+	if (interval == -1) interval = 0;
+
 // 	// X and ddy arrays match?
 // 	if (x_.nItems() != splineB_.nItems())
 // 	{
@@ -1116,35 +1153,35 @@ double Data2D::interpolated(double xvalue)
 	// Bracket x-value - we'll assume that access is likely to be more sequential than random...
 
 	// Check old interval (and next one up...)
-	if (xvalue < x_[splineInterval_])
+	if (xvalue < x_.value(interval))
 	{
-		if (splineInterval_ > 0)
+		if (interval > 0)
 		{
-			--splineInterval_;
-			if ((xvalue < x_[splineInterval_]) || (xvalue > x_[splineInterval_+1])) splineInterval_ = -1;
+			--interval;
+			if ((xvalue < x_.value(interval)) || (xvalue > x_.value(interval+1))) interval = -1;
 		}
 		else return y_.first();
 	}
-	else if (xvalue > x_[splineInterval_+1])
+	else if (xvalue > x_.value(interval+1))
 	{
-		if (splineInterval_ < splineB_.nItems()-2)
+		if (interval < splineB_.nItems()-2)
 		{
-			++splineInterval_;
-			if ((xvalue < x_[splineInterval_]) || (xvalue > x_[splineInterval_+1])) splineInterval_ = -1;
+			++interval;
+			if ((xvalue < x_.value(interval)) || (xvalue > x_.value(interval+1))) interval = -1;
 		}
 		else return y_.last();
 	}
 
 	// If interval is now (or still) -1, must search data...
-	if (splineInterval_ == -1)
+	if (interval == -1)
 	{
-		splineInterval_ = 0;
+		interval = 0;
 		int i, right = splineB_.nItems()-1;
-		while ((right-splineInterval_) > 1)
+		while ((right-interval) > 1)
 		{
-			i = (right+splineInterval_) / 2;
-			if (x_[i] > xvalue) right = i;
-			else splineInterval_ = i;
+			i = (right+interval) / 2;
+			if (x_.value(i) > xvalue) right = i;
+			else interval = i;
 		}
 	}
 	
@@ -1156,8 +1193,8 @@ double Data2D::interpolated(double xvalue)
 	
 	// Calculate cubic polynomial
 // 	double result = a*y_[splineBracketLeft_] + b*y_[splineBracketRight_] + ((a*a*a-a)*ddy_[splineBracketLeft_] + (b*b*b-b)*ddy_[splineBracketRight_])*(interval*interval)/6.0;
-	double h = constrainedSpline_ ? xvalue : xvalue - x_[splineInterval_];
-	double result = splineA_[splineInterval_] + splineB_[splineInterval_]*h + splineC_[splineInterval_]*h*h + splineD_[splineInterval_]*h*h*h;
+	double h = constrainedSpline_ ? xvalue : xvalue - x_.value(interval);
+	double result = splineA_.value(interval) + splineB_.value(interval)*h + splineC_.value(interval)*h*h + splineD_.value(interval)*h*h*h;
 	return result;
 }
 
@@ -1173,16 +1210,16 @@ void Data2D::smooth(int avgSize, int skip)
 	for (n=i; n < x_.nItems()-i; n += (1+skip))
 	{
 		y = 0.0;
-		for (m=n-i; m <= n+i; ++m) y += y_[m];
+		for (m=n-i; m <= n+i; ++m) y += y_.value(m);
 		y /= avgSize;
 		
-		avg.addPoint(x_[n], y);
+		avg.addPoint(x_.value(n), y);
 	}
 
 	avg.interpolate();
 
 	// Now go through old data, setting new Y values from the interpolation
-	for (n=0; n<x_.nItems(); ++n) y_[n] = avg.interpolated(x_[n]);
+	for (n=0; n<x_.nItems(); ++n) y_[n] = avg.interpolated(x_.value(n));
 }
 
 /*!
@@ -1258,8 +1295,8 @@ double Data2D::integral()
 	double total = 0.0, y0 = y_.first(), y1, x0 = x_.first(), x1;
 	for (int n=1; n<x_.nItems(); ++n)
 	{
-		x1 = x_[n];
-		y1 = y_[n];
+		x1 = x_.value(n);
+		y1 = y_.value(n);
 		total += (x1 - x0) * (y0 + y1) * 0.5;
 		x0 = x1;
 		y0 = y1;
@@ -1277,8 +1314,8 @@ double Data2D::absIntegral()
 	double total = 0.0, y0 = y_.first(), y1, x0 = x_.first(), x1;
 	for (int n=1; n<x_.nItems(); ++n)
 	{
-		x1 = x_[n];
-		y1 = y_[n];
+		x1 = x_.value(n);
+		y1 = y_.value(n);
 		total += fabs((x1 - x0) * (y0 + y1) * 0.5);
 		x0 = x1;
 		y0 = y1;
@@ -1298,8 +1335,8 @@ void Data2D::medianFilter(int length)
 	// Set boundary values
 	for (m=0; m<n; ++m)
 	{
-		newY[m] = y_[m];
-		newY[x_.nItems()-1-m] = y_[m];
+		newY[m] = y_.value(m);
+		newY[x_.nItems()-1-m] = y_.value(m);
 	}
 
 	// Now loop over remaining points
@@ -1310,7 +1347,7 @@ void Data2D::medianFilter(int length)
 		maxy = 0;
 		for (m=-i; m<=i; ++m)
 		{
-			data[m+i] = y_[n+m];
+			data[m+i] = y_.value(n+m);
 			if (data[m+i] < data[miny]) miny = m+i;
 			if (data[m+i] > data[maxy]) maxy = m+i;
 		}
@@ -1347,7 +1384,7 @@ bool Data2D::convoluteProduct(Data2D& data)
 	}
 	for (int n=0; n<nPoints(); ++n)
 	{
-		if (fabs(data.x(n) - x_[n]) > 1.0e-5)
+		if (fabs(data.x(n) - x_.value(n)) > 1.0e-5)
 		{
 			msg.print("Refusing to convolute by product two datasets with different x-values.\n");
 			return false;
@@ -1372,9 +1409,9 @@ void Data2D::trim(double minX, double maxX)
 	y_.clear();
 	for (int n=0; n<oldX.nItems(); ++n)
 	{
-		if (oldX[n] < minX) continue;
-		if (oldX[n] > maxX) break;
-		addPoint(oldX[n], oldY[n]);
+		if (oldX.value(n) < minX) continue;
+		if (oldX.value(n) > maxX) break;
+		addPoint(oldX.value(n), oldY.value(n));
 	}
 }
 
@@ -1425,19 +1462,21 @@ bool Data2D::load(const char* fileName)
  */
 bool Data2D::save(const char* fileName) const
 {
-	// Open file and check that we're OK to proceed writing to it
-	LineParser parser(fileName, true);
+	// Open file and check that we're OK to proceed writing to it (output is compressed if the filename ends in '.gz')
+	BufferedWriter writer(fileName);
 	msg.print("Writing datafile '%s'...\n", fileName);
 
-	if (!parser.ready())
+	if (!writer.ready())
 	{
 		msg.print("Couldn't open file '%s' for writing.\n", fileName);
 		return false;
 	}
-	
-	for (int n = 0; n<x_.nItems(); ++n) parser.writeLineF("%16.10e  %16.10e\n", x_.value(n), y_.value(n));
-	parser.closeFiles();
-	return true;
+
+	QByteArray text;
+	BufferedWriter::appendData(text, *this);
+	writer.write(text);
+
+	return writer.close();
 }
 
 /*!
@@ -65,6 +65,10 @@ class Data2D : public ListItem<Data2D>
 	void initialise(int size);
 	// Return current array size
 	int arraySize() const;
+	// Return number of bytes allocated for data and interpolation arrays
+	long int memoryUsage() const;
+	// Clear data and interpolation arrays, releasing their storage (z is retained)
+	void releaseStorage();
 	// Set data point 
 	void setPoint(int index, double x, double y);
 	// Return number of defined datapoints
@@ -186,6 +190,8 @@ class Data2D : public ListItem<Data2D>
 	void interpolate(bool constrained = true);
 	// Return spline interpolated y value for supplied x
 	double interpolated(double xvalue);
+	// Return spline interpolated y value for supplied x, using and updating the supplied interval (interpolation must already exist)
+	double interpolated(double xvalue, int& interval) const;
 	// Smooth data
 	void smooth(int avgSize, int skip = 0);
 	// Add interpolated data
@@ -0,0 +1,168 @@
+/*
+	*** Data Cache
+	*** src/base/datacache.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/datacache.h"
+#include "base/collection.h"
+#include "base/viewpane.h"
+#include "session/session.h"
+#include "base/messenger.h"
+
+// Static Members
+long int DataCache::byteBudget_ = 0;
+long int DataCache::residentBytes_ = 0;
+unsigned long int DataCache::accessCounter_ = 0;
+RefList<Collection,long int> DataCache::residentCollections_;
+bool DataCache::compressColdData_ = true;
+
+/*
+ * Resident Data
+ */
+
+// Set maximum number of bytes of deferred data to keep resident (or zero for no limit)
+void DataCache::setByteBudget(long int bytes)
+{
+	byteBudget_ = bytes;
+}
+
+// Return maximum number of bytes of deferred data to keep resident
+long int DataCache::byteBudget()
+{
+	return byteBudget_;
+}
+
+// Return number of bytes of deferred data currently resident
+long int DataCache::residentBytes()
+{
+	return residentBytes_;
+}
+
+// Return new access stamp
+unsigned long int DataCache::nextAccess()
+{
+	return ++accessCounter_;
+}
+
+// Register deferred data made resident in specified collection
+void DataCache::addResident(Collection* collection, long int bytes)
+{
+	RefListItem<Collection,long int>* ri = residentCollections_.contains(collection);
+	if (ri) ri->data += bytes;
+	else residentCollections_.add(collection, bytes);
+
+	residentBytes_ += bytes;
+}
+
+// Register deferred data released from specified collection
+void DataCache::removeResident(Collection* collection, long int bytes)
+{
+	// If the collection is not in the list, its data has already been accounted for
+	RefListItem<Collection,long int>* ri = residentCollections_.contains(collection);
+	if (!ri) return;
+
+	ri->data -= bytes;
+	residentBytes_ -= bytes;
+	if (ri->data <= 0) residentCollections_.remove(ri);
+}
+
+// Forget specified collection (e.g. because it is being deleted)
+void DataCache::removeCollection(Collection* collection)
+{
+	RefListItem<Collection,long int>* ri = residentCollections_.contains(collection);
+	if (!ri) return;
+
+	residentBytes_ -= ri->data;
+	residentCollections_.remove(ri);
+}
+
+// Return whether specified collection is currently displayed (visible, or the target of a pane)
+bool DataCache::isDisplayed(Collection* collection)
+{
+	if (collection->visible()) return true;
+	for (ViewPane* pane = UChromaSession::viewLayout().panes(); pane != NULL; pane = pane->next) if (pane->collectionIsTarget(collection)) return true;
+	return false;
+}
+
+// Evict data from least-recently used, undisplayed collections until within budget, returning number of collections evicted
+int DataCache::enforceBudget(Collection* keep)
+{
+	if (byteBudget_ <= 0) return 0;
+
+	int nEvicted = 0;
+	while (residentBytes_ > byteBudget_)
+	{
+		// Find least-recently used collection - displayed collections are never evicted, since they would only be reloaded on the next redraw
+		RefListItem<Collection,long int>* oldest = NULL;
+		for (RefListItem<Collection,long int>* ri = residentCollections_.first(); ri != NULL; ri = ri->next)
+		{
+			if (ri->item == keep) continue;
+			if (isDisplayed(ri->item)) continue;
+			if ((!oldest) || (ri->item->lastDataAccess() < oldest->item->lastDataAccess())) oldest = ri;
+		}
+		if (!oldest) break;
+
+		// Evict its data
+		Collection* collection = oldest->item;
+		long int bytes = collection->evictDeferredData();
+		msg.print(Messenger::Verbose, "Evicted %li bytes of data from collection '%s'.\n", bytes, qPrintable(collection->name()));
+		residentBytes_ -= oldest->data;
+		residentCollections_.remove(oldest);
+		++nEvicted;
+	}
+
+	return nEvicted;
+}
+
+/*
+ * Cold Data
+ */
+
+// Set whether data values in cold collections are compressed
+void DataCache::setCompressColdData(bool b)
+{
+	compressColdData_ = b;
+}
+
+// Return whether data values in cold collections are compressed
+bool DataCache::compressColdData()
+{
+	return compressColdData_;
+}
+
+// Release memory held by cold collections in the supplied list (and their fits and slices), returning number of bytes freed
+long int DataCache::releaseColdData(Collection* collections)
+{
+	long int bytes = 0;
+	for (Collection* collection = collections; collection != NULL; collection = collection->next)
+	{
+		if (collection->isCold())
+		{
+			long int released = collection->releaseDerivedData();
+			if (compressColdData_) released += collection->compressData();
+			if (released > 0) msg.print(Messenger::Verbose, "Released %li bytes of data from cold collection '%s'.\n", released, qPrintable(collection->name()));
+			bytes += released;
+		}
+
+		bytes += releaseColdData(collection->fits());
+		bytes += releaseColdData(collection->slices());
+	}
+
+	return bytes;
+}
@@ -0,0 +1,85 @@
+/*
+	*** Data Cache
+	*** src/base/datacache.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_DATACACHE_H
+#define UCHROMA_DATACACHE_H
+
+#include "templates/reflist.h"
+
+// Forward Declarations
+class Collection;
+
+// Data Cache
+class DataCache
+{
+	/*
+	 * Resident Data
+	 */
+	private:
+	// Maximum number of bytes of deferred data to keep resident (or zero for no limit)
+	static long int byteBudget_;
+	// Number of bytes of deferred data currently resident
+	static long int residentBytes_;
+	// Counter used to order accesses to deferred data
+	static unsigned long int accessCounter_;
+	// Collections with resident deferred data, and the number of bytes held by each
+	static RefList<Collection,long int> residentCollections_;
+
+	private:
+	// Return whether specified collection is currently displayed (visible, or the target of a pane)
+	static bool isDisplayed(Collection* collection);
+
+	public:
+	// Set maximum number of bytes of deferred data to keep resident (or zero for no limit)
+	static void setByteBudget(long int bytes);
+	// Return maximum number of bytes of deferred data to keep resident
+	static long int byteBudget();
+	// Return number of bytes of deferred data currently resident
+	static long int residentBytes();
+	// Return new access stamp
+	static unsigned long int nextAccess();
+	// Register deferred data made resident in specified collection
+	static void addResident(Collection* collection, long int bytes);
+	// Register deferred data released from specified collection
+	static void removeResident(Collection* collection, long int bytes);
+	// Forget specified collection (e.g. because it is being deleted)
+	static void removeCollection(Collection* collection);
+	// Evict data from least-recently used, undisplayed collections until within budget, returning number of collections evicted
+	static int enforceBudget(Collection* keep = NULL);
+
+
+	/*
+	 * Cold Data
+	 */
+	private:
+	// Whether data values in cold collections are compressed
+	static bool compressColdData_;
+
+	public:
+	// Set whether data values in cold collections are compressed
+	static void setCompressColdData(bool b);
+	// Return whether data values in cold collections are compressed
+	static bool compressColdData();
+	// Release memory held by cold collections in the supplied list (and their fits and slices), returning number of bytes freed
+	static long int releaseColdData(Collection* collections);
+};
+
+#endif
@@ -20,6 +20,9 @@
 */
 
 #include "base/dataset.h"
+#include "base/binarydata.h"
+#include "base/datacache.h"
+#include "base/valuecompressor.h"
 #include "collection.h"
 
 // Data Sources
@@ -49,22 +52,41 @@ DataSet::DataSet() : ListItem<DataSet>()
 	dataSource_ = DataSet::InternalSource;
 	name_ = "New DataSet";
 	parent_ = NULL;
+
+	// Deferred Data
+	deferredFile_ = NULL;
+	deferredOffset_ = -1;
+	deferredNPoints_ = 0;
+	deferredXMin_ = 0.0;
+	deferredXMax_ = 0.0;
+	deferredYMin_ = 0.0;
+	deferredYMax_ = 0.0;
+	dataResident_ = true;
 }
 
 // Destructor
 DataSet::~DataSet()
 {
+	detachDeferredData(false);
 }
 
 // Copy constructor
-DataSet::DataSet(const DataSet& source)
+DataSet::DataSet(const DataSet& source) : ListItem<DataSet>()
 {
+	parent_ = NULL;
+	deferredFile_ = NULL;
+	dataResident_ = true;
+
 	(*this) = source;
 }
 
 // Assignment operator
 void DataSet::operator=(const DataSet& source)
 {
+	// Copies always hold their own (resident) data
+	detachDeferredData(false);
+	source.makeResident();
+
 	sourceFileName_ = source.sourceFileName_;
 	name_ = source.name_;
 	data_ = source.data_;
@@ -145,6 +167,7 @@ bool DataSet::loadData(QDir sourceDir)
 	}
 
 	// Clear any existing data
+	detachDeferredData(false);
 	data_.arrayX().clear();
 	data_.arrayY().clear();
 
@@ -162,18 +185,24 @@ bool DataSet::loadData(QDir sourceDir)
 // Return data
 const Data2D& DataSet::data() const
 {
+	makeResident();
+
 	return data_;
 }
 
 // Return X array from data
 const Array<double>& DataSet::x() const
 {
+	makeResident();
+
 	return data_.constArrayX();
 }
 
 // Return Y array from data
 const Array<double>& DataSet::y() const
 {
+	makeResident();
+
 	return data_.constArrayY();
 }
 
@@ -186,6 +215,8 @@ double DataSet::z() const
 // Transform original data with supplied transformers
 void DataSet::transform(Transformer& xTransformer, Transformer& yTransformer, Transformer& zTransformer)
 {
+	makeResident();
+
 	// X
 	if (xTransformer.enabled()) transformedData_.arrayX() = xTransformer.transformArray(data_.arrayX(), data_.arrayY(), data_.z(), 0);
 	else transformedData_.arrayX() = data_.arrayX();
@@ -205,6 +236,14 @@ Data2D& DataSet::transformedData()
 	return transformedData_;
 }
 
+// Release transformed data, returning number of bytes freed
+long int DataSet::releaseTransformedData()
+{
+	long int bytes = transformedDataSize();
+	transformedData_.releaseStorage();
+	return bytes;
+}
+
 /*
  * Data Operations
  */
@@ -212,6 +251,7 @@ Data2D& DataSet::transformedData()
 // Reset (zero) data
 void DataSet::resetData()
 {
+	detachDeferredData();
 	data_.reset();
 
 	notifyParent();
@@ -220,6 +260,7 @@ void DataSet::resetData()
 // Initialise data to specified number of points
 void DataSet::initialiseData(int nPoints)
 {
+	detachDeferredData(false);
 	data_.initialise(nPoints);
 
 	notifyParent();
@@ -228,6 +269,7 @@ void DataSet::initialiseData(int nPoints)
 // Set data from supplied Data2D
 void DataSet::setData(Data2D& source)
 {
+	detachDeferredData(false);
 	data_ = source;
 
 	notifyParent();
@@ -236,6 +278,7 @@ void DataSet::setData(Data2D& source)
 // Add point to data
 void DataSet::addPoint(double x, double y)
 {
+	detachDeferredData();
 	data_.addPoint(x, y);
 
 	notifyParent();
@@ -244,6 +287,7 @@ void DataSet::addPoint(double x, double y)
 // Set x value
 void DataSet::setX(int index, double newX)
 {
+	detachDeferredData();
 	data_.setX(index, newX);
 
 	notifyParent();
@@ -252,6 +296,7 @@ void DataSet::setX(int index, double newX)
 // Set y value
 void DataSet::setY(int index, double newY)
 {
+	detachDeferredData();
 	data_.setY(index, newY);
 
 	notifyParent();
@@ -268,6 +313,9 @@ void DataSet::setZ(double z)
 // Add to specified axis value
 void DataSet::addConstantValue(int axis, double value)
 {
+	// Z values are not stored in the binary data, so don't need to detach for those
+	if (axis != 2) detachDeferredData();
+
 	if (axis == 0) data_.arrayX() += value;
 	else if (axis == 1) data_.arrayY() += value;
 	else if (axis == 2) data_.addZ(value);
@@ -278,6 +326,8 @@ void DataSet::addConstantValue(int axis, double value)
 // Calculate average y value over x range specified
 double DataSet::averageY(double xMin, double xMax) const
 {
+	makeResident();
+
 	double result = 0.0;
 	int nAdded = 0;
 	for (int n=0; n<data_.nPoints(); ++n)
@@ -289,3 +339,237 @@ double DataSet::averageY(double xMin, double xMax) const
 	}
 	return (nAdded == 0 ? 0.0 : result / nAdded);
 }
+
+// Return data for direct modification, making values resident and detaching them from any binary file if requested (parent is not notified)
+Data2D& DataSet::editableData(bool valuesRequired)
+{
+	// Z values are not stored in the binary data, so don't need to detach for those
+	if (valuesRequired) detachDeferredData();
+
+	return data_;
+}
+
+/*
+ * Deferred Data
+ */
+
+// Make sure deferred data is resident, loading it if necessary
+void DataSet::makeResident() const
+{
+	if (!compressedData_.isEmpty()) const_cast<DataSet*>(this)->decompressData();
+	if (!deferredFile_) return;
+
+	if (!dataResident_) const_cast<DataSet*>(this)->loadDeferredData();
+	if (parent_) parent_->touchDeferredData();
+}
+
+// Load deferred data from binary data file
+void DataSet::loadDeferredData()
+{
+	if (!deferredFile_->readData(deferredOffset_, data_))
+	{
+		// Don't try again - keep whatever we have
+		msg.print("Error: Failed to load deferred data for dataset '%s'.\n", qPrintable(name_));
+		deferredFile_ = NULL;
+		dataResident_ = true;
+		return;
+	}
+
+	dataResident_ = true;
+	if (parent_) DataCache::addResident(parent_, residentSize());
+}
+
+// Return size of resident data in bytes
+long int DataSet::residentSize() const
+{
+	return 2 * sizeof(double) * long(deferredNPoints_);
+}
+
+// Set data to be loaded on demand from the specified binary data file
+void DataSet::setDeferredData(BinaryDataFile* file, qint64 offset, int nPoints, double xMin, double xMax, double yMin, double yMax)
+{
+	detachDeferredData(false);
+
+	// Discard any existing values, but retain z
+	double z = data_.z();
+	data_.clear();
+	data_.setZ(z);
+	transformedData_.clear();
+
+	deferredFile_ = file;
+	deferredOffset_ = offset;
+	deferredNPoints_ = nPoints;
+	deferredXMin_ = xMin;
+	deferredXMax_ = xMax;
+	deferredYMin_ = yMin;
+	deferredYMax_ = yMax;
+	dataResident_ = false;
+}
+
+// Stop deferring data (making it resident first if requested)
+void DataSet::detachDeferredData(bool makeDataResident)
+{
+	// Compressed values are dealt with in the same way, decompressing them or discarding them as requested
+	if (!compressedData_.isEmpty())
+	{
+		if (makeDataResident) decompressData();
+		else
+		{
+			compressedData_.clear();
+			dataResident_ = true;
+		}
+	}
+
+	if (!deferredFile_) return;
+
+	if (makeDataResident) makeResident();
+
+	if (dataResident_ && parent_) DataCache::removeResident(parent_, residentSize());
+	deferredFile_ = NULL;
+	dataResident_ = true;
+}
+
+// Copy data from specified source without making it resident, leaving any deferred (or compressed) data to be loaded by the copy
+void DataSet::copyDeferred(const DataSet& source)
+{
+	detachDeferredData(false);
+
+	sourceFileName_ = source.sourceFileName_;
+	name_ = source.name_;
+	data_ = source.data_;
+	transformedData_ = source.transformedData_;
+	dataSource_ = source.dataSource_;
+
+	// The copy has no parent, so loading its data is not counted against the data cache budget
+	compressedData_ = source.compressedData_;
+	deferredFile_ = source.deferredFile_;
+	deferredOffset_ = source.deferredOffset_;
+	deferredNPoints_ = source.deferredNPoints_;
+	deferredXMin_ = source.deferredXMin_;
+	deferredXMax_ = source.deferredXMax_;
+	deferredYMin_ = source.deferredYMin_;
+	deferredYMax_ = source.deferredYMax_;
+	dataResident_ = source.dataResident_;
+}
+
+// Return whether data is deferred (loaded on demand)
+bool DataSet::isDeferred() const
+{
+	return (deferredFile_ != NULL);
+}
+
+// Return whether data is resident in memory
+bool DataSet::isResident() const
+{
+	return dataResident_;
+}
+
+// Release resident deferred data, returning number of bytes freed
+long int DataSet::evictData()
+{
+	if ((!deferredFile_) || (!dataResident_)) return 0;
+
+	data_.releaseStorage();
+	transformedData_.releaseStorage();
+	dataResident_ = false;
+
+	return residentSize();
+}
+
+// Return number of points in data
+int DataSet::nPoints() const
+{
+	return (dataResident_ ? data_.nPoints() : deferredNPoints_);
+}
+
+// Return minimum x value in data
+double DataSet::xMin() const
+{
+	return (dataResident_ ? data_.xMin() : deferredXMin_);
+}
+
+// Return maximum x value in data
+double DataSet::xMax() const
+{
+	return (dataResident_ ? data_.xMax() : deferredXMax_);
+}
+
+// Return minimum y value in data
+double DataSet::yMin() const
+{
+	return (dataResident_ ? data_.yMin() : deferredYMin_);
+}
+
+// Return maximum y value in data
+double DataSet::yMax() const
+{
+	return (dataResident_ ? data_.yMax() : deferredYMax_);
+}
+
+/*
+ * Compressed Data
+ */
+
+// Decompress data, making it resident
+void DataSet::decompressData()
+{
+	int position = 0;
+	Array<double> x, y;
+	if ((!ValueCompressor::decompress(compressedData_, position, deferredNPoints_, x)) || (!ValueCompressor::decompress(compressedData_, position, deferredNPoints_, y)))
+	{
+		// Keep whatever we have
+		msg.print("Error: Failed to decompress data for dataset '%s'.\n", qPrintable(name_));
+	}
+	data_.arrayX() = x;
+	data_.arrayY() = y;
+
+	compressedData_.clear();
+	dataResident_ = true;
+}
+
+// Compress values held in memory (unless they are deferred), returning number of bytes freed
+long int DataSet::compressData()
+{
+	// Deferred data is evicted rather than compressed, since it can be reloaded from its binary file
+	if (deferredFile_ || (!compressedData_.isEmpty()) || (data_.nPoints() == 0)) return 0;
+
+	// If the values are shared (e.g. with an undo state, or untransformed display data) releasing them here would free nothing
+	if (data_.constArrayX().isShared() || data_.constArrayY().isShared()) return 0;
+
+	long int uncompressedSize = valuesSize();
+	QByteArray compressed;
+	ValueCompressor::compress(data_.constArrayX(), compressed);
+	ValueCompressor::compress(data_.constArrayY(), compressed);
+	if (compressed.size() >= uncompressedSize) return 0;
+
+	// Store number of points and extents, so that they can be returned without decompressing
+	deferredNPoints_ = data_.nPoints();
+	deferredXMin_ = data_.xMin();
+	deferredXMax_ = data_.xMax();
+	deferredYMin_ = data_.yMin();
+	deferredYMax_ = data_.yMax();
+
+	data_.releaseStorage();
+	compressedData_ = compressed;
+	dataResident_ = false;
+
+	return uncompressedSize - valuesSize();
+}
+
+// Return whether data is currently compressed
+bool DataSet::isCompressed() const
+{
+	return (!compressedData_.isEmpty());
+}
+
+// Return number of bytes used by values (whether compressed or not)
+long int DataSet::valuesSize() const
+{
+	return data_.memoryUsage() + compressedData_.size();
+}
+
+// Return number of bytes used by transformed data
+long int DataSet::transformedDataSize() const
+{
+	return transformedData_.memoryUsage();
+}
@@ -26,10 +26,12 @@
 #include "base/transformer.h"
 #include "templates/list.h"
 #include <QDir>
+#include <QByteArray>
 
 // Forward Declarations
 class QTreeWidgetItem;
 class Collection;
+class BinaryDataFile;
 
 // DataSet
 class DataSet: public ListItem<DataSet>
@@ -110,6 +112,8 @@ class DataSet: public ListItem<DataSet>
 	void transform(Transformer& xTransformer, Transformer& yTransformer, Transformer& zTransformer);
 	// Return transformed data
 	Data2D& transformedData();
+	// Release transformed data, returning number of bytes freed
+	long int releaseTransformedData();
 
 
 	/*
@@ -134,6 +138,78 @@ class DataSet: public ListItem<DataSet>
 	void addConstantValue(int axis, double value);
 	// Calculate average y value over x range specified
 	double averageY(double xMin, double xMax) const;
+	// Return data for direct modification, making values resident and detaching them from any binary file if requested (parent is not notified)
+	Data2D& editableData(bool valuesRequired = true);
+
+
+	/*
+	 * Deferred Data
+	 */
+	private:
+	// Binary data file from which data is loaded on demand (if deferred)
+	BinaryDataFile* deferredFile_;
+	// Offset of data in binary data file
+	qint64 deferredOffset_;
+	// Number of points in deferred (or compressed) data
+	int deferredNPoints_;
+	// Extents of deferred (or compressed) data
+	double deferredXMin_, deferredXMax_, deferredYMin_, deferredYMax_;
+	// Whether deferred (or compressed) data is currently resident
+	bool dataResident_;
+
+	private:
+	// Make sure deferred data is resident, loading it if necessary
+	void makeResident() const;
+	// Load deferred data from binary data file
+	void loadDeferredData();
+	// Return size of resident data in bytes
+	long int residentSize() const;
+
+	public:
+	// Set data to be loaded on demand from the specified binary data file
+	void setDeferredData(BinaryDataFile* file, qint64 offset, int nPoints, double xMin, double xMax, double yMin, double yMax);
+	// Stop deferring data (making it resident first if requested)
+	void detachDeferredData(bool makeDataResident = true);
+	// Copy data from specified source without making it resident, leaving any deferred (or compressed) data to be loaded by the copy
+	void copyDeferred(const DataSet& source);
+	// Return whether data is deferred (loaded on demand)
+	bool isDeferred() const;
+	// Return whether data is resident in memory
+	bool isResident() const;
+	// Release resident deferred data, returning number of bytes freed
+	long int evictData();
+	// Return number of points in data
+	int nPoints() const;
+	// Return minimum x value in data
+	double xMin() const;
+	// Return maximum x value in data
+	double xMax() const;
+	// Return minimum y value in data
+	double yMin() const;
+	// Return maximum y value in data
+	double yMax() const;
+
+
+	/*
+	 * Compressed Data
+	 */
+	private:
+	// Compressed x and y values, if data is currently compressed
+	QByteArray compressedData_;
+
+	private:
+	// Decompress data, making it resident
+	void decompressData();
+
+	public:
+	// Compress values held in memory (unless they are deferred), returning number of bytes freed
+	long int compressData();
+	// Return whether data is currently compressed
+	bool isCompressed() const;
+	// Return number of bytes used by values (whether compressed or not)
+	long int valuesSize() const;
+	// Return number of bytes used by transformed data
+	long int transformedDataSize() const;
 };
 
 #endif
@@ -25,6 +25,7 @@
 #include "viewpane.h"
 #include "expression/expression.h"
 #include "expression/variable.h"
+#include <algorithm>
 
 // Constructor
 DataSpaceRange::DataSpaceRange(DataSpace& parent) : ListItem<DataSpaceRange>(), parent_(parent)
@@ -225,22 +226,47 @@ double DataSpaceRange::calculatedY(int xIndex, int zIndex)
 	return yCalculated_.ref(xIndex, zIndex);
 }
 
-// Copy values from stored source collection, using index data provided
-bool DataSpaceRange::copyValues(IndexData xIndex, IndexData zIndex)
+// Copy values from stored source collection, using index data (and statistic, if any) provided
+bool DataSpaceRange::copyValues(IndexData xIndex, IndexData zIndex, Statistics::Statistic statistic)
 {
 	// Grab source abscissa values and display data array
-	int nAbscissaPoints = parent_.sourceCollection()->displayAbscissa().nItems();
+	const Array<double>& abscissa = parent_.sourceCollection()->displayAbscissa();
+	int nAbscissaPoints = abscissa.nItems();
 	List<DisplayDataSet>& dataSets = parent_.sourceCollection()->displayData();
 	DisplayDataSet* dataSet;
 	int actualZ, actualX;
 
 	yReference_ = 0.0;
 
+	// If a statistic is requested, determine the x extent over which it is calculated, shifting the range by any relative offset
+	double statisticXMin = 0.0, statisticXMax = 0.0;
+	bool statisticXValid = false;
+	if (statistic != Statistics::NoStatistic)
+	{
+		int first = abscissaStart_, last = abscissaEnd_;
+		if (xIndex.type() == IndexData::RelativeIndex)
+		{
+			first = std::max(first + xIndex.offset(), 0);
+			last = std::min(last + xIndex.offset(), nAbscissaPoints-1);
+		}
+		if ((first < 0) || (first > last) || (last >= nAbscissaPoints)) msg.print("Warning: X range for statistic (accounting for any offset defined in the X reference) lies outside the available data when copying values.\n");
+		else
+		{
+			statisticXMin = abscissa.value(first);
+			statisticXMax = abscissa.value(last);
+			statisticXValid = true;
+		}
+	}
+
 	// Loop over z indices defined in range
 	for (int z = 0; z < nDataSets_; ++z)
 	{
 		// Grab the dataSet that we want, taking into account the zIndex definition
-		if (zIndex.type() == IndexData::NormalIndex) dataSet = dataSets[z+displayDataSetStart_];
+		if (zIndex.type() == IndexData::NormalIndex)
+		{
+			actualZ = z+displayDataSetStart_;
+			dataSet = dataSets[actualZ];
+		}
 		else if (zIndex.type() == IndexData::RelativeIndex)
 		{
 			// Check current index, accounting for offset defined in zIndex
@@ -267,6 +293,17 @@ bool DataSpaceRange::copyValues(IndexData xIndex, IndexData zIndex)
 		// Check validity of dataset - if none is set, zero the relevant values_ entry and move on
 		if (!dataSet) continue;
 
+		// If a statistic is requested, use its value for the whole dataSet (calculated over the x extent of the range) at every x
+		// -- Only the slice at this dataSet's z is requested, rather than the whole collection
+		if (statistic != Statistics::NoStatistic)
+		{
+			if (!statisticXValid) continue;
+			Statistics* dataSetStatistics = StatisticsEngine::statistics(parent_.sourceCollection(), statisticXMin, statisticXMax, dataSet->z(), dataSet->z()).displayDataSetStatistics(actualZ);
+			double value = (dataSetStatistics ? dataSetStatistics->value(statistic) : 0.0);
+			for (int x = 0; x<nPoints_; ++x) yReference_.ref(x, z) = value;
+			continue;
+		}
+
 		// Grab data from dataSet
 		const Array<double>& yRef = dataSet->y();
 
@@ -25,6 +25,7 @@
 #include "base/indexdata.h"
 #include "base/equationvariable.h"
 #include "base/namedvalue.h"
+#include "base/statistics.h"
 #include "templates/array.h"
 #include "templates/list.h"
 #include "templates/reflist.h"
@@ -117,8 +118,8 @@ class DataSpaceRange : public ListItem<DataSpaceRange>
 	double referenceYMax();
 	// Return calculated y value specified
 	double calculatedY(int xIndex, int zIndex);
-	// Copy values from stored source collection, using index data provided
-	bool copyValues(IndexData xIndex, IndexData zIndex);
+	// Copy values from stored source collection, using index data (and statistic, if any) provided
+	bool copyValues(IndexData xIndex, IndexData zIndex, Statistics::Statistic statistic);
 	// Calculate values from specified equation
 	bool calculateValues(Expression& equation, Variable* xVariable, Variable* zVariable, const RefList<ReferenceVariable,bool>& usedReferences);
 	// Return sos error between stored and referenced values
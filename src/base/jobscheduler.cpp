@@ -0,0 +1,289 @@
+/*
+	*** Job Scheduler
+	*** src/base/jobscheduler.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/jobscheduler.h"
+#include <QtCore/QThreadPool>
+#include <QtCore/QMutexLocker>
+
+/*
+ * Job
+ */
+
+// Constructor
+Job::Job(QString title, void* owner) : QRunnable(), ListItem<Job>()
+{
+	title_ = title;
+	owner_ = owner;
+	cancelled_ = 0;
+	progress_ = 0;
+
+	// The scheduler deletes the job once it has been delivered
+	setAutoDelete(false);
+}
+
+// Destructor
+Job::~Job()
+{
+}
+
+// Return title of job
+QString Job::title()
+{
+	return title_;
+}
+
+// Return object on whose behalf the job is run
+void* Job::owner()
+{
+	return owner_;
+}
+
+// Cancel the job
+void Job::cancel()
+{
+	cancelled_.fetchAndStoreOrdered(1);
+}
+
+// Return whether the job has been cancelled
+bool Job::cancelled()
+{
+	return (cancelled_.loadAcquire() != 0);
+}
+
+// Update progress, returning false if the job has been cancelled
+bool Job::advance(int nDone, int nTotal)
+{
+	progress_.storeRelease(nTotal > 0 ? (1000 * nDone) / nTotal : 0);
+
+	return (!cancelled());
+}
+
+// Return progress of the job (0.0 - 1.0)
+double Job::progress()
+{
+	return progress_.loadAcquire() * 0.001;
+}
+
+// Run the job (called by the thread pool)
+void Job::run()
+{
+	if (!cancelled()) execute();
+
+	JobScheduler::jobFinished(this);
+}
+
+/*
+ * Job Scheduler
+ */
+
+// Static Members
+bool JobScheduler::enabled_ = false;
+QThreadPool* JobScheduler::threadPool_ = NULL;
+QMutex JobScheduler::mutex_;
+List<Job> JobScheduler::activeJobs_;
+List<Job> JobScheduler::finishedJobs_;
+
+// Set whether jobs are run in the background
+void JobScheduler::setEnabled(bool enabled)
+{
+	enabled_ = enabled;
+}
+
+// Return whether jobs are run in the background
+bool JobScheduler::enabled()
+{
+	return enabled_;
+}
+
+// Submit job, taking ownership of it
+void JobScheduler::submit(Job* job)
+{
+	// If we're not running jobs in the background, do everything now
+	if (!enabled_)
+	{
+		job->run();
+		deliverFinished();
+		return;
+	}
+
+	if (!threadPool_) threadPool_ = new QThreadPool;
+
+	mutex_.lock();
+	activeJobs_.own(job);
+	mutex_.unlock();
+
+	threadPool_->start(job);
+}
+
+// Notify that specified job has finished (called in a worker thread)
+void JobScheduler::jobFinished(Job* job)
+{
+	QMutexLocker locker(&mutex_);
+
+	// Jobs run immediately (when disabled) are not in the active list
+	if (activeJobs_.contains(job)) activeJobs_.disown(job);
+	finishedJobs_.own(job);
+}
+
+// Deliver and delete finished jobs, returning the number delivered
+int JobScheduler::deliverFinished()
+{
+	// Grab the finished jobs first, so that delivery (which may submit new jobs) is done without the lock held
+	List<Job> jobs;
+	mutex_.lock();
+	Job* job;
+	while ((job = finishedJobs_.first()) != NULL)
+	{
+		finishedJobs_.disown(job);
+		jobs.own(job);
+	}
+	mutex_.unlock();
+
+	int nDelivered = 0;
+	for (job = jobs.first(); job != NULL; job = job->next)
+	{
+		job->deliver();
+		if (!job->cancelled()) ++nDelivered;
+	}
+
+	return nDelivered;
+}
+
+// Return number of jobs not yet finished
+int JobScheduler::nActiveJobs()
+{
+	QMutexLocker locker(&mutex_);
+
+	return activeJobs_.nItems();
+}
+
+// Return mean progress of jobs not yet finished (0.0 - 1.0)
+double JobScheduler::progress()
+{
+	QMutexLocker locker(&mutex_);
+
+	if (activeJobs_.nItems() == 0) return 1.0;
+
+	double sum = 0.0;
+	for (Job* job = activeJobs_.first(); job != NULL; job = job->next) sum += job->progress();
+
+	return sum / activeJobs_.nItems();
+}
+
+// Cancel all jobs run on behalf of the specified object
+void JobScheduler::cancel(void* owner)
+{
+	QMutexLocker locker(&mutex_);
+
+	for (Job* job = activeJobs_.first(); job != NULL; job = job->next) if (job->owner() == owner) job->cancel();
+}
+
+// Cancel all jobs
+void JobScheduler::cancelAll()
+{
+	QMutexLocker locker(&mutex_);
+
+	for (Job* job = activeJobs_.first(); job != NULL; job = job->next) job->cancel();
+}
+
+// Wait for running jobs to finish (without delivering them)
+void JobScheduler::waitForDone()
+{
+	if (threadPool_) threadPool_->waitForDone();
+}
+
+// Cancel all jobs and wait for them to finish, delivering and deleting them
+void JobScheduler::shutdown()
+{
+	cancelAll();
+
+	waitForDone();
+
+	deliverFinished();
+}
+
+/*
+ * Task Group
+ */
+
+// Task Group Item
+class TaskGroupItem : public QRunnable
+{
+	public:
+	// Constructor
+	TaskGroupItem(QRunnable* task, QSemaphore& finished) : QRunnable(), task_(task), finished_(finished)
+	{
+	}
+
+	private:
+	// Task to run
+	QRunnable* task_;
+	// Semaphore to release once the task has finished
+	QSemaphore& finished_;
+
+	public:
+	// Run the task, and signal that it has finished
+	void run()
+	{
+		task_->run();
+		if (task_->autoDelete()) delete task_;
+		finished_.release();
+	}
+};
+
+// Constructor
+TaskGroup::TaskGroup()
+{
+	nStarted_ = 0;
+}
+
+// Destructor
+TaskGroup::~TaskGroup()
+{
+	waitForDone();
+}
+
+// Return number of tasks that may usefully be run at once
+int TaskGroup::maxThreadCount()
+{
+	return QThreadPool::globalInstance()->maxThreadCount();
+}
+
+// Start task in the shared thread pool, taking ownership of it
+void TaskGroup::start(QRunnable* task)
+{
+	// Tasks share the global pool (rather than the pool running background jobs), and are waited for by the group alone
+	// If no thread is free the task is run here instead, so that groups started from within other tasks cannot wait on each other forever
+	TaskGroupItem* item = new TaskGroupItem(task, finished_);
+	++nStarted_;
+	if (!QThreadPool::globalInstance()->tryStart(item))
+	{
+		item->run();
+		delete item;
+	}
+}
+
+// Wait for all tasks started in this group to finish
+void TaskGroup::waitForDone()
+{
+	finished_.acquire(nStarted_);
+	nStarted_ = 0;
+}
@@ -0,0 +1,164 @@
+/*
+	*** Job Scheduler
+	*** src/base/jobscheduler.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_JOBSCHEDULER_H
+#define UCHROMA_JOBSCHEDULER_H
+
+#include "templates/list.h"
+#include <QtCore/QRunnable>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QSemaphore>
+#include <QtCore/QString>
+
+// Forward Declarations
+class QThreadPool;
+
+// Background Job
+class Job : public QRunnable, public ListItem<Job>
+{
+	public:
+	// Constructor / Destructor
+	Job(QString title, void* owner);
+	virtual ~Job();
+
+
+	/*
+	 * Definition
+	 */
+	private:
+	// Title of job
+	QString title_;
+	// Object on whose behalf the job is run
+	void* owner_;
+
+	public:
+	// Return title of job
+	QString title();
+	// Return object on whose behalf the job is run
+	void* owner();
+
+
+	/*
+	 * Progress
+	 */
+	private:
+	// Whether the job has been cancelled
+	QAtomicInt cancelled_;
+	// Progress of the job (in thousandths)
+	QAtomicInt progress_;
+
+	public:
+	// Cancel the job
+	void cancel();
+	// Return whether the job has been cancelled
+	bool cancelled();
+	// Update progress, returning false if the job has been cancelled
+	bool advance(int nDone, int nTotal);
+	// Return progress of the job (0.0 - 1.0)
+	double progress();
+
+
+	/*
+	 * Execution
+	 */
+	protected:
+	// Perform the job (called in a worker thread)
+	virtual void execute() = 0;
+
+	public:
+	// Deliver results of the job (called in the GUI thread, even if the job was cancelled)
+	virtual void deliver() = 0;
+	// Run the job (called by the thread pool)
+	void run();
+};
+
+// Job Scheduler
+class JobScheduler
+{
+	/*
+	 * Jobs
+	 */
+	private:
+	// Whether jobs are run in the background (otherwise they are run immediately on submission)
+	static bool enabled_;
+	// Thread pool in which jobs are run
+	static QThreadPool* threadPool_;
+	// Mutex protecting job lists
+	static QMutex mutex_;
+	// Jobs submitted and not yet finished
+	static List<Job> activeJobs_;
+	// Jobs finished and awaiting delivery
+	static List<Job> finishedJobs_;
+
+	public:
+	// Set whether jobs are run in the background
+	static void setEnabled(bool enabled);
+	// Return whether jobs are run in the background
+	static bool enabled();
+	// Submit job, taking ownership of it
+	static void submit(Job* job);
+	// Notify that specified job has finished (called in a worker thread)
+	static void jobFinished(Job* job);
+	// Deliver and delete finished jobs, returning the number delivered
+	static int deliverFinished();
+	// Return number of jobs not yet finished
+	static int nActiveJobs();
+	// Return mean progress of jobs not yet finished (0.0 - 1.0)
+	static double progress();
+	// Cancel all jobs run on behalf of the specified object
+	static void cancel(void* owner);
+	// Cancel all jobs
+	static void cancelAll();
+	// Wait for running jobs to finish (without delivering them)
+	static void waitForDone();
+	// Cancel all jobs and wait for them to finish, delivering and deleting them
+	static void shutdown();
+};
+
+// Task Group
+class TaskGroup
+{
+	public:
+	// Constructor / Destructor
+	TaskGroup();
+	~TaskGroup();
+
+
+	/*
+	 * Tasks
+	 */
+	private:
+	// Semaphore released as each task finishes
+	QSemaphore finished_;
+	// Number of tasks started and not yet waited for
+	int nStarted_;
+
+	public:
+	// Return number of tasks that may usefully be run at once
+	static int maxThreadCount();
+	// Start task in the shared thread pool, taking ownership of it
+	void start(QRunnable* task);
+	// Wait for all tasks started in this group to finish
+	void waitForDone();
+};
+
+#endif
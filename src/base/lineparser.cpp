@@ -82,6 +82,12 @@ bool LineParser::atEnd() const
 	return stream_->atEnd();
 }
 
+// Return target filename
+QString LineParser::fileName() const
+{
+	return fileName_;
+}
+
 /*
  * Write
  */
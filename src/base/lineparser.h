@@ -72,6 +72,8 @@ class LineParser
 	bool ready() const;
 	// Return whether the end of the input stream has been reached
 	bool atEnd() const;
+	// Return target filename
+	QString fileName() const;
 
 
 	/*
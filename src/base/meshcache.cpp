@@ -0,0 +1,143 @@
+/*
+	*** Mesh Cache
+	*** src/base/meshcache.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/meshcache.h"
+
+// Static Members
+List<SharedMesh> MeshCache::meshes_;
+
+/*
+ * Shared Mesh
+ */
+
+// Constructor
+SharedMesh::SharedMesh() : ListItem<SharedMesh>()
+{
+	collection_ = NULL;
+	dataVersion_ = -1;
+	colourVersion_ = -1;
+	styleVersion_ = -1;
+	constructedDataVersion_ = -1;
+	constructedColourVersion_ = -1;
+	constructedStyleVersion_ = -1;
+	constructedNDisplayDataSets_ = 0;
+	constructCount_ = 0;
+	uploadCount_ = 0;
+	constructionPending_ = false;
+	refCount_ = 0;
+	imageReleased_ = false;
+}
+
+// Set inputs for which the mesh is to be constructed
+void SharedMesh::setInputs(Collection* collection, int dataVersion, int colourVersion, int styleVersion, const QString& axesSignature)
+{
+	collection_ = collection;
+	dataVersion_ = dataVersion;
+	colourVersion_ = colourVersion;
+	styleVersion_ = styleVersion;
+	axesSignature_ = axesSignature;
+	constructionPending_ = false;
+
+	// GL resources created for the mesh are reported against its collection
+	primitive_.setOwner(collection_);
+	image_.setOwner(collection_);
+}
+
+// Flag that the mesh has been constructed for its current inputs
+void SharedMesh::setConstructed(int nDisplayDataSets)
+{
+	constructedDataVersion_ = dataVersion_;
+	constructedColourVersion_ = colourVersion_;
+	constructedStyleVersion_ = styleVersion_;
+	constructedAxesSignature_ = axesSignature_;
+	constructedNDisplayDataSets_ = nDisplayDataSets;
+	constructionPending_ = false;
+	++constructCount_;
+}
+
+// Return whether the mesh is to be constructed from the inputs specified
+bool SharedMesh::hasInputs(Collection* collection, int dataVersion, int colourVersion, int styleVersion, const QString& axesSignature) const
+{
+	return ((collection_ == collection) && (dataVersion_ == dataVersion) && (colourVersion_ == colourVersion) && (styleVersion_ == styleVersion) && (axesSignature_ == axesSignature));
+}
+
+// Return whether the mesh has been constructed for its current inputs
+bool SharedMesh::isConstructed() const
+{
+	return ((constructedDataVersion_ == dataVersion_) && (constructedColourVersion_ == colourVersion_) && (constructedStyleVersion_ == styleVersion_) && (constructedAxesSignature_ == axesSignature_));
+}
+
+// Return number of target primitives using the mesh
+int SharedMesh::refCount() const
+{
+	return refCount_;
+}
+
+/*
+ * Mesh Cache
+ */
+
+// Create a new (unshared) mesh
+SharedMesh* MeshCache::create()
+{
+	SharedMesh* mesh = meshes_.add();
+	mesh->refCount_ = 1;
+	return mesh;
+}
+
+// Return mesh for the inputs specified, sharing an existing mesh or updating the current one in place where possible
+SharedMesh* MeshCache::acquire(SharedMesh* current, Collection* collection, int dataVersion, int colourVersion, int styleVersion, const QString& axesSignature)
+{
+	// Is the current mesh already for these inputs?
+	if (current && current->hasInputs(collection, dataVersion, colourVersion, styleVersion, axesSignature)) return current;
+
+	// Another target (e.g. in a different pane) may already have a mesh for these inputs, in which case we share it
+	for (SharedMesh* mesh = meshes_.first(); mesh != NULL; mesh = mesh->next)
+	{
+		if (!mesh->hasInputs(collection, dataVersion, colourVersion, styleVersion, axesSignature)) continue;
+
+		++mesh->refCount_;
+		release(current);
+		return mesh;
+	}
+
+	// If nothing else is using the current mesh, update it in place so its existing data (and GL instances) can be reused
+	if (current && (current->refCount_ == 1))
+	{
+		current->setInputs(collection, dataVersion, colourVersion, styleVersion, axesSignature);
+		return current;
+	}
+
+	// Need a new mesh
+	release(current);
+	SharedMesh* mesh = create();
+	mesh->setInputs(collection, dataVersion, colourVersion, styleVersion, axesSignature);
+	return mesh;
+}
+
+// Release mesh, deleting it if it is no longer used
+void MeshCache::release(SharedMesh* mesh)
+{
+	if (mesh == NULL) return;
+
+	--mesh->refCount_;
+	if (mesh->refCount_ <= 0) meshes_.remove(mesh);
+}
@@ -0,0 +1,100 @@
+/*
+	*** Mesh Cache
+	*** src/base/meshcache.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_MESHCACHE_H
+#define UCHROMA_MESHCACHE_H
+
+#include "render/primitivelist.h"
+#include "render/imageprimitive.h"
+#include "templates/list.h"
+#include <QString>
+
+// Forward Declarations
+class Collection;
+
+// Shared Mesh
+class SharedMesh : public ListItem<SharedMesh>
+{
+	public:
+	// Constructor
+	SharedMesh();
+	// Friend classes
+	friend class MeshCache;
+	friend class TargetPrimitive;
+
+	private:
+	// Collection from which the mesh is constructed
+	Collection* collection_;
+	// Collection data, colour, and style versions for which the mesh is to be constructed
+	int dataVersion_, colourVersion_, styleVersion_;
+	// Axes transform signature for which the mesh is to be constructed
+	QString axesSignature_;
+	// Collection data, colour, and style versions for which the mesh was last constructed
+	int constructedDataVersion_, constructedColourVersion_, constructedStyleVersion_;
+	// Axes transform signature for which the mesh was last constructed
+	QString constructedAxesSignature_;
+	// Number of display datasets from which the mesh was last constructed
+	int constructedNDisplayDataSets_;
+	// Counter incremented each time the mesh is constructed, and its value when the mesh was last sent to GL
+	int constructCount_, uploadCount_;
+	// Whether construction of the mesh is pending (after being prepared in advance of rendering)
+	bool constructionPending_;
+	// Number of target primitives using the mesh
+	int refCount_;
+	// Primitive for display of collection
+	PrimitiveList primitive_;
+	// Image for display of collection (if using image style)
+	ImagePrimitive image_;
+	// Whether image data has been released, and its textures must be released when next sent to GL
+	bool imageReleased_;
+
+	private:
+	// Set inputs for which the mesh is to be constructed
+	void setInputs(Collection* collection, int dataVersion, int colourVersion, int styleVersion, const QString& axesSignature);
+	// Flag that the mesh has been constructed for its current inputs
+	void setConstructed(int nDisplayDataSets);
+
+	public:
+	// Return whether the mesh is to be constructed from the inputs specified
+	bool hasInputs(Collection* collection, int dataVersion, int colourVersion, int styleVersion, const QString& axesSignature) const;
+	// Return whether the mesh has been constructed for its current inputs
+	bool isConstructed() const;
+	// Return number of target primitives using the mesh
+	int refCount() const;
+};
+
+// Mesh Cache
+class MeshCache
+{
+	private:
+	// Meshes currently in use
+	static List<SharedMesh> meshes_;
+
+	public:
+	// Create a new (unshared) mesh
+	static SharedMesh* create();
+	// Return mesh for the inputs specified, sharing an existing mesh or updating the current one in place where possible
+	static SharedMesh* acquire(SharedMesh* current, Collection* collection, int dataVersion, int colourVersion, int styleVersion, const QString& axesSignature);
+	// Release mesh, deleting it if it is no longer used
+	static void release(SharedMesh* mesh);
+};
+
+#endif
@@ -55,6 +55,18 @@ NumberFormat::~NumberFormat()
 {
 }
 
+// Equality operator
+bool NumberFormat::operator==(const NumberFormat& other) const
+{
+	return ((type_ == other.type_) && (nDecimals_ == other.nDecimals_) && (forcePrecedingPlus_ == other.forcePrecedingPlus_) && (useUpperCaseExponent_ == other.useUpperCaseExponent_) && (useENotation_ == other.useENotation_));
+}
+
+// Inequality operator
+bool NumberFormat::operator!=(const NumberFormat& other) const
+{
+	return !(*this == other);
+}
+
 /*
  * Definition
  */
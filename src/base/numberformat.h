@@ -40,6 +40,10 @@ class NumberFormat
 	static FormatType formatType(QString s);
 	// Convert FormatType to text string
 	static const char* formatType(FormatType id);
+	// Equality operator
+	bool operator==(const NumberFormat& other) const;
+	// Inequality operator
+	bool operator!=(const NumberFormat& other) const;
 
 
 	/*
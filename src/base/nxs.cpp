@@ -22,6 +22,36 @@
 #include "base/nxs.h"
 #include "base/messenger.h"
 #include <hdf5.h>
+#include <algorithm>
+
+/*
+ * HDF5 Handle
+ */
+
+// Constructor
+NexusHandle::NexusHandle(hid_t id, herr_t (*closeFunction)(hid_t))
+{
+	id_ = id;
+	closeFunction_ = closeFunction;
+}
+
+// Destructor
+NexusHandle::~NexusHandle()
+{
+	if (id_ >= 0) closeFunction_(id_);
+}
+
+// Return HDF5 identifier
+hid_t NexusHandle::id() const
+{
+	return id_;
+}
+
+// Return whether the identifier is valid
+bool NexusHandle::valid() const
+{
+	return (id_ >= 0);
+}
 
 // Iterator callback for HDF5 (group access)
 herr_t NexusHelper::nexusGroupIterator(hid_t loc_id, const char* name, const H5L_info_t *info, void *operator_data)
@@ -131,6 +161,7 @@ bool NexusHelper::nexusExtractString(hid_t rootLocation, const char* name, QStri
 	{
 		msg.print("Warning - Tried to extract a single value from a multi-arrayed dataset '%s'.\n", name);
 		delete[] nValues;
+		H5Sclose(space);
 		H5Dclose(dataSet);
 		return false;
 	}
@@ -138,6 +169,7 @@ bool NexusHelper::nexusExtractString(hid_t rootLocation, const char* name, QStri
 	{
 		msg.print("Warning - Tried to extract a single value from a multi-valued dataset '%s'.\n", name);
 		delete[] nValues;
+		H5Sclose(space);
 		H5Dclose(dataSet);
 		return false;
 	}
@@ -164,12 +196,15 @@ bool NexusHelper::nexusExtractString(hid_t rootLocation, const char* name, QStri
 			status = H5Tset_size(memType, 256);
 			status = H5Dread(dataSet, memType, H5S_ALL, H5S_ALL, H5P_DEFAULT, &charBuffer);
 			dest = charBuffer;
+			H5Tclose(memType);
 			break;
 	}
 
 	// Cleanup
 	delete[] nValues;
+	H5Tclose(valueType);
 	H5Sclose(space);
+	H5Dclose(dataSet);
 	
 	return true;
 }
@@ -311,155 +346,245 @@ bool NexusHelper::nexusExtractString(hid_t rootLocation, const char* name, QStri
 // 	return true;
 // }
 
-bool NexusHelper::loadSlice(QString fileName, QString root, QString xAxisValues, QString yAxisValues, QString zAxisValues, QString dataSpaceName, int zSlice, List<Data2D>& slices)
+// Return whether the specified HDF5 dataset holds numeric (integer or floating point) values
+bool NexusHelper::isNumeric(hid_t dataSet)
 {
-	// Open HDF5 file
-	hid_t file = H5Fopen(qPrintable(fileName), H5F_ACC_RDONLY, H5P_DEFAULT);
+	NexusHandle type(H5Dget_type(dataSet), H5Tclose);
+	if (!type.valid()) return false;
+
+	H5T_class_t typeClass = H5Tget_class(type.id());
+	return ((typeClass == H5T_INTEGER) || (typeClass == H5T_FLOAT));
+}
 
-	// Check that root group exists
-	hid_t rootGroup = H5Gopen1(file, qPrintable(root));
-	if (rootGroup <= 0)
+// Read one-dimensional dataset directly into supplied array
+bool NexusHelper::readAxisValues(hid_t group, QString name, Array<double>& values)
+{
+	NexusHandle dataSet(H5Dopen2(group, qPrintable(name), H5P_DEFAULT), H5Dclose);
+	if (!dataSet.valid())
 	{
-		msg.print("Couldn't open root group '%s' in Nexus file '%s'.\n", qPrintable(root), qPrintable(fileName));
-		H5Fclose(file);
+		msg.print("Error: Failed to open axis dataset '%s' in Nexus file.\n", qPrintable(name));
+		return false;
+	}
+	NexusHandle space(H5Dget_space(dataSet.id()), H5Sclose);
+	if (H5Sget_simple_extent_ndims(space.id()) != 1)
+	{
+		msg.print("Error: Axis dataset '%s' in Nexus file is not one-dimensional.\n", qPrintable(name));
+		return false;
+	}
+	if (!isNumeric(dataSet.id()))
+	{
+		msg.print("Error: Axis dataset '%s' in Nexus file does not contain integer or floating point values.\n", qPrintable(name));
 		return false;
 	}
 
-	// Get dataspaces for each specified dataset
-	Vec3<bool> hasAxis;
-	Vec3<hid_t> axisDataSet, axisDataSpace, axisDataType;
-	Vec3<int> axisNDims;
-	hsize_t axisDim[3];
-	QString axisDataSetNames[3] = { xAxisValues, yAxisValues, zAxisValues };
-	for (int axis=0; axis<3; ++axis)
+	// Read values straight into the array - HDF5 performs any necessary type conversion
+	hsize_t nValues;
+	H5Sget_simple_extent_dims(space.id(), &nValues, NULL);
+	values.createEmpty(nValues);
+	if ((nValues > 0) && (H5Dread(dataSet.id(), H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, values.array()) < 0))
 	{
-		hasAxis[axis] = false;
-		if (axisDataSetNames[axis].isEmpty()) continue;
+		msg.print("Error: Failed to read values from axis dataset '%s' in Nexus file.\n", qPrintable(name));
+		return false;
+	}
+
+	return true;
+}
+
+// Read rows of two- or three-dimensional dataset into new slices
+bool NexusHelper::readDataSpace(hid_t group, QString name, const Array<double>& x, QString zAxisValues, int zSlice, List<Data2D>& slices)
+{
+	// Open dataset, and determine its chunking (if any) so that we can set up a suitable chunk cache
+	NexusHandle firstOpen(H5Dopen2(group, qPrintable(name), H5P_DEFAULT), H5Dclose);
+	if (!firstOpen.valid())
+	{
+		msg.print("Error: Failed to open dataset '%s' in Nexus file.\n", qPrintable(name));
+		return false;
+	}
+	NexusHandle fileSpace(H5Dget_space(firstOpen.id()), H5Sclose);
+	int rank = H5Sget_simple_extent_ndims(fileSpace.id());
+	if ((rank != 2) && (rank != 3))
+	{
+		msg.print("Error: Dataset '%s' in Nexus file must be two- or three-dimensional (it has %i dimensions).\n", qPrintable(name), rank);
+		return false;
+	}
+	if (!isNumeric(firstOpen.id()))
+	{
+		msg.print("Error: Dataset '%s' in Nexus file does not contain integer or floating point values.\n", qPrintable(name));
+		return false;
+	}
+	hsize_t dims[3], chunkDims[3] = { 1, 1, 1 };
+	H5Sget_simple_extent_dims(fileSpace.id(), dims, NULL);
+	NexusHandle createProperties(H5Dget_create_plist(firstOpen.id()), H5Pclose);
+	bool chunked = (H5Pget_layout(createProperties.id()) == H5D_CHUNKED) && (H5Pget_chunk(createProperties.id(), rank, chunkDims) == rank);
+	NexusHandle type(H5Dget_type(firstOpen.id()), H5Tclose);
+	size_t typeSize = H5Tget_size(type.id());
+
+	// The last (fastest-varying) dimension runs along x, the one before it along z
+	const hsize_t nX = dims[rank-1], nRows = dims[rank-2];
+	if ((nX == 0) || (nRows == 0))
+	{
+		msg.print("Error: Dataset '%s' in Nexus file contains no data.\n", qPrintable(name));
+		return false;
+	}
+	if (nX != hsize_t(x.nItems()))
+	{
+		msg.print("Error: Number of x values (%i) does not match the last dimension of dataset '%s' (%llu).\n", x.nItems(), qPrintable(name), (unsigned long long) nX);
+		return false;
+	}
 
-// 		printf("Axis %i = %s\n", axis, qPrintable(axisDataSetNames[axis]));
-		// Open DataSet
-		axisDataSet[axis] = H5Dopen2(rootGroup, qPrintable(axisDataSetNames[axis]), H5P_DEFAULT);
-		if (axisDataSet[axis] <= 0)
+	// Determine frame (for 3D data) or single row (for 2D data) to read
+	hsize_t frame = 0, firstRow = 0, lastRow = nRows-1;
+	if (rank == 3)
+	{
+		if ((zSlice < 0) || (hsize_t(zSlice) >= dims[0]))
 		{
-			msg.print("Failed to open dataset for axis %i (name '%s') in Nexus file '%s', root group '%s'.\n", axis, qPrintable(axisDataSetNames[axis]), qPrintable(fileName), qPrintable(root));
-			H5Fclose(file);
+			msg.print("Error: Slice index %i is out of range for three-dimensional dataset '%s' (%llu slices).\n", zSlice, qPrintable(name), (unsigned long long) dims[0]);
 			return false;
 		}
-		// Open DataSpace
-		axisDataSpace[axis] = H5Dget_space(axisDataSet[axis]);
-		axisNDims[axis] = H5Sget_simple_extent_ndims(axisDataSpace[axis]);
-
-		// Check dataspace
-		if (axisNDims[axis] != 1)
+		frame = zSlice;
+	}
+	else if (zSlice >= 0)
+	{
+		if (hsize_t(zSlice) >= nRows)
 		{
-			msg.print("Can't read Nexus data - DataSpace for axis %i is multi-dimensional (%i).\n", axis, axisNDims[axis]);
-			H5Fclose(file);
+			msg.print("Error: Row index %i is out of range for dataset '%s' (%llu rows).\n", zSlice, qPrintable(name), (unsigned long long) nRows);
 			return false;
 		}
+		firstRow = lastRow = zSlice;
+	}
 
-		// Get size of array
-// 		axisDims[axis] = new hsize_t[axisNDims[axis]];
-		H5Sget_simple_extent_dims(axisDataSpace[axis], &axisDim[axis], NULL);
-		axisDataType[axis] = H5Dget_type(axisDataSet[axis]);
-		hasAxis[axis] = true;
+	// Read z values
+	Array<double> z;
+	if (!readAxisValues(group, zAxisValues, z)) return false;
+	if (hsize_t(z.nItems()) != nRows)
+	{
+		msg.print("Error: Number of z values (%i) does not match the number of rows in dataset '%s' (%llu).\n", z.nItems(), qPrintable(name), (unsigned long long) nRows);
+		return false;
 	}
 
-	// Is a dataspace provided?
-	bool hasDataSpace = false;
-	hid_t dataSpaceSet, dataSpace, dataSpaceType;
-	int dataSpaceNDims, nDataSpaceElements;
-	hsize_t* dataSpaceDims;
-	if (!dataSpaceName.isEmpty())
+	// Re-open the dataset with a chunk cache large enough to hold one block of rows (i.e. all chunks spanning x for one chunk of rows).
+	// Each chunk is then read (and decompressed) only once, however the individual rows within the block are selected.
+	hsize_t blockRows = (chunked ? chunkDims[rank-2] : 1);
+	NexusHandle accessProperties(H5Pcreate(H5P_DATASET_ACCESS), H5Pclose);
+	if (chunked)
 	{
-		// Open DataSet
-		dataSpaceSet = H5Dopen2(rootGroup, qPrintable(dataSpaceName), H5P_DEFAULT);
-		if (dataSpaceSet <= 0)
-		{
-			msg.print("Failed to open dataset for dataSpace specified (name '%s') in Nexus file '%s', root group '%s'.\n", qPrintable(dataSpaceName), qPrintable(fileName), qPrintable(root));
-			H5Fclose(file);
-			return false;
-		}
-		// Open DataSpace
-		dataSpace = H5Dget_space(dataSpaceSet);
-		dataSpaceNDims = H5Sget_simple_extent_ndims(dataSpace);
+		hsize_t nChunksAcross = (nX + chunkDims[rank-1] - 1) / chunkDims[rank-1];
+		size_t chunkBytes = typeSize;
+		for (int n=0; n<rank; ++n) chunkBytes *= chunkDims[n];
+		H5Pset_chunk_cache(accessProperties.id(), 12421, 2 * nChunksAcross * chunkBytes, 1.0);
+	}
+	NexusHandle dataSet(H5Dopen2(group, qPrintable(name), accessProperties.id()), H5Dclose);
+	if (!dataSet.valid())
+	{
+		msg.print("Error: Failed to re-open dataset '%s' in Nexus file.\n", qPrintable(name));
+		return false;
+	}
 
-		// Check dataspace
-		if (dataSpaceNDims == 1)
+	// Create slices, with their final sizes, before we read any data
+	for (hsize_t row = firstRow; row <= lastRow; ++row)
+	{
+		Data2D* data = slices.add();
+		data->arrayX() = x;
+		data->arrayY().createEmpty(nX);
+		data->setZ(z[row]);
+	}
+
+	// Read data block by block (aligned to chunk boundaries), with each row going straight into the y array of its slice
+	NexusHandle memorySpace(H5Screate_simple(1, &nX, NULL), H5Sclose);
+	hsize_t start[3] = { frame, 0, 0 }, count[3] = { 1, 1, 1 };
+	count[rank-1] = nX;
+	Data2D* data = slices.first();
+	for (hsize_t blockStart = firstRow - (firstRow % blockRows); blockStart <= lastRow; blockStart += blockRows)
+	{
+		hsize_t blockEnd = std::min(blockStart + blockRows - 1, lastRow);
+		for (hsize_t row = std::max(blockStart, firstRow); row <= blockEnd; ++row, data = data->next)
 		{
-			msg.print("Can't read Nexus data - DataSpace for specified dataSpace is one-dimensional.\n");
-			H5Fclose(file);
-			return false;
+			start[rank-2] = row;
+			if ((H5Sselect_hyperslab(fileSpace.id(), H5S_SELECT_SET, start, NULL, count, NULL) < 0) || (H5Dread(dataSet.id(), H5T_NATIVE_DOUBLE, memorySpace.id(), fileSpace.id(), H5P_DEFAULT, data->arrayY().array()) < 0))
+			{
+				msg.print("Error: Failed to read row %llu from dataset '%s' in Nexus file.\n", (unsigned long long) row, qPrintable(name));
+				return false;
+			}
 		}
+	}
+
+	msg.print(Messenger::Verbose, "Read %llu rows of %llu values from dataset '%s' (blocks of %llu rows).\n", (unsigned long long) (lastRow-firstRow+1), (unsigned long long) nX, qPrintable(name), (unsigned long long) blockRows);
+
+	return true;
+}
 
-		// Get size of array
-		dataSpaceDims = new hsize_t[dataSpaceNDims];
-		H5Sget_simple_extent_dims(dataSpace, dataSpaceDims, NULL);
-		dataSpaceType = H5Dget_type(dataSpaceSet);
-		hasDataSpace = true;
-		nDataSpaceElements = dataSpaceDims[0];
-		for (int n=1; n<dataSpaceNDims; ++n) nDataSpaceElements *= dataSpaceDims[n];
-		printf("NElements in dataSpace = %i\n", nDataSpaceElements);
+// Load slice data from NXS file
+bool NexusHelper::loadSlice(QString fileName, QString root, QString xAxisValues, QString yAxisValues, QString zAxisValues, QString dataSpaceName, int zSlice, List<Data2D>& slices)
+{
+	slices.clear();
+
+	// Open HDF5 file and root group
+	NexusHandle file(H5Fopen(qPrintable(fileName), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+	if (!file.valid())
+	{
+		msg.print("Couldn't open Nexus file '%s'.\n", qPrintable(fileName));
+		return false;
+	}
+	NexusHandle rootGroup(H5Gopen2(file.id(), qPrintable(root), H5P_DEFAULT), H5Gclose);
+	if (!rootGroup.valid())
+	{
+		msg.print("Couldn't open root group '%s' in Nexus file '%s'.\n", qPrintable(root), qPrintable(fileName));
+		return false;
+	}
+
+	// X values are always required
+	if (xAxisValues.isEmpty())
+	{
+		msg.print("Can't read Nexus data - no dataset containing x values was specified.\n");
+		return false;
 	}
+	Array<double> x;
+	if (!readAxisValues(rootGroup.id(), xAxisValues, x)) return false;
 
-	// See what we can do....
-	int* intBuffer;
-	double* doubleBuffer;
-	hid_t status;
-	if (hasAxis[0] && hasAxis[1] && (!hasAxis[2]))
+	bool result;
+	if (dataSpaceName.isEmpty())
 	{
-		if (hasDataSpace)
+		// Simple XY data, with x values in one dataset and y values in another
+		if (yAxisValues.isEmpty())
 		{
-			hsize_t dims[2] = { 1, 10 };
-			hsize_t offset_in[2] = { 1, 0 }, offset_out[2] = { 0, 0 };
-			hid_t sliceSpace = H5Screate_simple(2, dataSpaceDims, NULL);
-			status = H5Sselect_hyperslab(sliceSpace, H5S_SELECT_SET, offset_out, NULL, dims, NULL);
-			switch (H5Tget_class(dataSpaceType))
-			{
-// 				case (H5T_INTEGER):
-// 					intBuffer = new int[(long int) 10];
-// 					status = H5Dread(value, H5T_NATIVE_INT_g, H5S_ALL, H5S_ALL, H5P_DEFAULT, intBuffer);
-// 					for (int n=0; n<nValue[0]; ++n) data->addRelativePoint(startTime_.addSecs(timeData[n]), (double) intBuffer[n]);
-// 					delete[] intBuffer;
-// 					break;
-				case (H5T_FLOAT):
-					doubleBuffer = new double[(long int) nDataSpaceElements];
-					status = H5Sselect_hyperslab(dataSpace, H5S_SELECT_SET, offset_out, NULL, dims, NULL);
-					status = H5Dread(dataSpaceSet, H5T_NATIVE_DOUBLE_g, dataSpace, sliceSpace, H5P_DEFAULT, doubleBuffer);
-					for (int n=0; n<10; ++n) printf("Read value: %f\n", doubleBuffer[n]);
-					delete[] doubleBuffer;
-					break;
-			}
+			msg.print("Can't read Nexus data - neither a y values dataset nor a dataspace was specified.\n");
+			return false;
 		}
-		else
+		Data2D* data = slices.add();
+		result = readAxisValues(rootGroup.id(), yAxisValues, data->arrayY());
+		if (result && (data->arrayY().nItems() != x.nItems()))
 		{
-			// Looks like simple XY data, with x values in one dataset and y values in another...
+			msg.print("Sizes of specified X and Y value DataSpaces do not match (%i, %i).\n", x.nItems(), data->arrayY().nItems());
+			result = false;
+		}
+		data->arrayX() = x;
 
-			// Check that the number of datapoints in each dataspace is the same...
-			if (axisDim[0] != axisDim[1])
+		// Take z value from the z axis values (if specified), using the requested slice index
+		if (result && (!zAxisValues.isEmpty()))
+		{
+			Array<double> z;
+			int index = (zSlice < 0 ? 0 : zSlice);
+			result = readAxisValues(rootGroup.id(), zAxisValues, z);
+			if (result && (index >= z.nItems()))
 			{
-				msg.print("Sizes of specified X and Y value DataSpaces do not match (%i, %i).\n", axisDim[0], axisDim[1]);
-				H5Fclose(file);
-				return false;
+				msg.print("Slice index %i is out of range for z values dataset '%s' (%i values).\n", index, qPrintable(zAxisValues), z.nItems());
+				result = false;
 			}
-
-			// TODO
+			if (result) data->setZ(z[index]);
 		}
 	}
-	else if (yAxisValues.isEmpty())
+	else
 	{
-		// Check that the number of datapoints in each dataspace is the same...
-		if (axisDim[0] != axisDim[1])
+		// Rows of values in a 2D or 3D dataspace, with the z value of each row taken from the z axis values
+		if (zAxisValues.isEmpty())
 		{
-			msg.print("Sizes of specified X and Y value DataSpaces do not match (%i, %i).\n", axisDim[0], axisDim[1]);
-			H5Fclose(file);
+			msg.print("Can't read Nexus dataspace '%s' - no dataset containing z values was specified.\n", qPrintable(dataSpaceName));
 			return false;
 		}
-
-		// TODO
+		result = readDataSpace(rootGroup.id(), dataSpaceName, x, zAxisValues, zSlice, slices);
 	}
 
-	// Done
-	H5Fclose(file);
-	
-	return true;
+	if (!result) slices.clear();
+
+	return result;
 }
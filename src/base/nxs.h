@@ -23,12 +23,39 @@
 #define UCHROMA_NXS_H
 
 #include "base/data2d.h"
+#include "templates/list.h"
 #include <hdf5.h>
 #include <QString>
 
 // Forward Declarations
 /* none */
 
+// HDF5 Handle (closed automatically when it goes out of scope)
+class NexusHandle
+{
+	public:
+	// Constructor / Destructor
+	NexusHandle(hid_t id, herr_t (*closeFunction)(hid_t));
+	~NexusHandle();
+
+	private:
+	// Copying is not allowed
+	NexusHandle(const NexusHandle& source);
+	void operator=(const NexusHandle& source);
+
+	private:
+	// HDF5 identifier
+	hid_t id_;
+	// Function used to close identifier
+	herr_t (*closeFunction_)(hid_t);
+
+	public:
+	// Return HDF5 identifier
+	hid_t id() const;
+	// Return whether the identifier is valid
+	bool valid() const;
+};
+
 // Nexus File Helper
 class NexusHelper
 {
@@ -53,7 +80,20 @@ class NexusHelper
 	static herr_t nexusBlockIterator(hid_t loc_id, const char* name, const H5L_info_t *info, void *operator_data);
 	// Parse Nexus file
 // 	static bool parseNexusFile(RunData* runData, QString fileName);
+
+	private:
+	// Return whether the specified HDF5 dataset holds numeric (integer or floating point) values
+	static bool isNumeric(hid_t dataSet);
+	// Read one-dimensional dataset directly into supplied array
+	static bool readAxisValues(hid_t group, QString name, Array<double>& values);
+	// Read rows of two- or three-dimensional dataset into new slices
+	static bool readDataSpace(hid_t group, QString name, const Array<double>& x, QString zAxisValues, int zSlice, List<Data2D>& slices);
+
+	public:
 	// Load slice data from NXS file
+	// Either x and y values are read from separate one-dimensional datasets, or rows of y values are read from a 2D [z][x] dataspace
+	// or (selected by zSlice) from a 3D [slice][z][x] dataspace, with x and z values from the named axis datasets (both required).
+	// For 2D dataspaces, a non-negative zSlice reads only that row.
 	static bool loadSlice(QString fileName, QString root, QString xAxisValues, QString yAxisValues, QString zAxisValues, QString dataSpaceName, int zSlice, List< Data2D >& slices);
 };
 
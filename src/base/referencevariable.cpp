@@ -32,6 +32,7 @@ ReferenceVariable::ReferenceVariable() : ListItem<ReferenceVariable>()
 
 	// Reference Definition
 	sourceCollection_ = NULL;
+	statistic_ = Statistics::NoStatistic;
 	currentReferenceRange_ = NULL;
 }
 
@@ -59,6 +60,7 @@ void ReferenceVariable::operator=(const ReferenceVariable& source)
 	xIndex_ = source.xIndex_;
 	zIndex_ = source.zIndex_;
 	zDataSetName_ = source.zDataSetName_;
+	statistic_ = source.statistic_;
 }
 
 // Set name
@@ -154,6 +156,18 @@ QString ReferenceVariable::zDataSetName()
 	return zDataSetName_;
 }
 
+// Set statistic of reference dataset to use in place of its individual values
+void ReferenceVariable::setStatistic(Statistics::Statistic statistic)
+{
+	statistic_ = statistic;
+}
+
+// Return statistic of reference dataset to use in place of its individual values
+Statistics::Statistic ReferenceVariable::statistic()
+{
+	return statistic_;
+}
+
 /*
  * Reference Data
  */
@@ -186,7 +200,7 @@ bool ReferenceVariable::initialiseDataSpace(Collection* fitCollection, DataSpace
 	// Generate values within the dataspace, employing offsets defined in the ReferenceVariable
 	for (DataSpaceRange* range = referenceSpace_.dataSpaceRanges(); range != NULL; range = range->next)
 	{
-		range->copyValues(xIndex_, zIndex_);
+		range->copyValues(xIndex_, zIndex_, statistic_);
 	}
 
 	return true;
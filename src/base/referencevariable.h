@@ -24,6 +24,7 @@
 
 #include "base/dataspace.h"
 #include "base/indexdata.h"
+#include "base/statistics.h"
 #include <QString>
 
 // Forward Declarations
@@ -84,6 +85,8 @@ class ReferenceVariable : public ListItem<ReferenceVariable>
 	IndexData zIndex_;
 	// Z DataSet name
 	QString zDataSetName_;
+	// Statistic of reference dataset to use in place of its individual values (if any)
+	Statistics::Statistic statistic_;
 
 	public:
 	// Set source collection
@@ -98,6 +101,10 @@ class ReferenceVariable : public ListItem<ReferenceVariable>
 	void setZDataSetName(QString name);
 	// Return Z DataSet name
 	QString zDataSetName();
+	// Set statistic of reference dataset to use in place of its individual values
+	void setStatistic(Statistics::Statistic statistic);
+	// Return statistic of reference dataset to use in place of its individual values
+	Statistics::Statistic statistic();
 
 
 	/*
@@ -0,0 +1,574 @@
+/*
+	*** Statistics
+	*** src/base/statistics.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/statistics.h"
+#include "base/collection.h"
+#include "base/jobscheduler.h"
+#include <QRunnable>
+#include <algorithm>
+#include <math.h>
+
+// Statistic keywords
+const char* StatisticKeywords[] = { "None", "Count", "Minimum", "Maximum", "Mean", "Variance", "StdDev", "Median" };
+
+// Convert text string to Statistic
+Statistics::Statistic Statistics::statistic(QString s)
+{
+	for (int n=0; n<Statistics::nStatistics; ++n) if (s == StatisticKeywords[n]) return (Statistics::Statistic) n;
+	return Statistics::nStatistics;
+}
+
+// Convert Statistic to text string
+const char* Statistics::statistic(Statistics::Statistic stat)
+{
+	return StatisticKeywords[stat];
+}
+
+/*
+ * Summation
+ */
+
+// Return sum of values
+// -- Four independent partial sums are used, so that successive additions do not depend on each other and the loop can be pipelined (or vectorised)
+static double sumValues(const double* values, int nValues)
+{
+	double partial[4] = { 0.0, 0.0, 0.0, 0.0 };
+	int n, nBlocked = nValues - nValues%4;
+	for (n=0; n<nBlocked; n += 4)
+	{
+		partial[0] += values[n];
+		partial[1] += values[n+1];
+		partial[2] += values[n+2];
+		partial[3] += values[n+3];
+	}
+	for (; n<nValues; ++n) partial[0] += values[n];
+
+	return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+// Return sum of squared deviations of values from specified mean
+static double sumSquaredDeviations(const double* values, int nValues, double mean)
+{
+	double partial[4] = { 0.0, 0.0, 0.0, 0.0 }, delta[4];
+	int n, nBlocked = nValues - nValues%4;
+	for (n=0; n<nBlocked; n += 4)
+	{
+		delta[0] = values[n] - mean;
+		delta[1] = values[n+1] - mean;
+		delta[2] = values[n+2] - mean;
+		delta[3] = values[n+3] - mean;
+		partial[0] += delta[0]*delta[0];
+		partial[1] += delta[1]*delta[1];
+		partial[2] += delta[2]*delta[2];
+		partial[3] += delta[3]*delta[3];
+	}
+	for (; n<nValues; ++n) partial[0] += (values[n] - mean)*(values[n] - mean);
+
+	return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+/*
+ * Statistics
+ */
+
+// Constructor
+Statistics::Statistics() : ListItem<Statistics>()
+{
+	z_ = 0.0;
+	clear();
+}
+
+// Clear all values
+void Statistics::clear()
+{
+	nValues_ = 0;
+	minimum_ = 0.0;
+	maximum_ = 0.0;
+	sum_ = 0.0;
+	mean_ = 0.0;
+	variance_ = 0.0;
+	percentiles_.clear();
+	histogram_.clear();
+	histogramMinimum_ = 0.0;
+	histogramMaximum_ = 0.0;
+}
+
+// Calculate moments and percentiles from supplied values (which must be sorted)
+void Statistics::calculate(const double* sortedValues, int nValues)
+{
+	clear();
+	if (nValues < 1) return;
+
+	nValues_ = nValues;
+	minimum_ = sortedValues[0];
+	maximum_ = sortedValues[nValues-1];
+
+	// Variance is calculated from the deviations from the mean (rather than the sum of squares) to avoid cancellation
+	sum_ = sumValues(sortedValues, nValues);
+	mean_ = sum_ / nValues;
+	variance_ = sumSquaredDeviations(sortedValues, nValues, mean_) / nValues;
+
+	calculatePercentiles(sortedValues, nValues);
+}
+
+// Combine moments with those of another (disjoint) set of values
+void Statistics::combine(const Statistics& other)
+{
+	if (other.nValues_ == 0) return;
+	if (nValues_ == 0)
+	{
+		nValues_ = other.nValues_;
+		minimum_ = other.minimum_;
+		maximum_ = other.maximum_;
+		sum_ = other.sum_;
+		mean_ = other.mean_;
+		variance_ = other.variance_;
+		return;
+	}
+
+	// Combine means and variances using the pairwise formula of Chan et al.
+	int nTotal = nValues_ + other.nValues_;
+	double delta = other.mean_ - mean_;
+	double m2 = variance_*nValues_ + other.variance_*other.nValues_ + delta*delta*(double(nValues_)*other.nValues_/nTotal);
+	mean_ += delta*other.nValues_/nTotal;
+	variance_ = m2 / nTotal;
+	sum_ += other.sum_;
+	minimum_ = std::min(minimum_, other.minimum_);
+	maximum_ = std::max(maximum_, other.maximum_);
+	nValues_ = nTotal;
+}
+
+// Calculate percentiles from supplied values (which must be sorted)
+void Statistics::calculatePercentiles(const double* sortedValues, int nValues)
+{
+	percentiles_.clear();
+	if (nValues < 1) return;
+
+	// Interpolate linearly between the closest ranks
+	percentiles_.createEmpty(101);
+	double position, fraction;
+	int index;
+	for (int p=0; p<=100; ++p)
+	{
+		position = p*0.01*(nValues-1);
+		index = std::min(int(position), nValues-1);
+		fraction = position - index;
+		percentiles_[p] = (index == nValues-1 ? sortedValues[index] : sortedValues[index] + fraction*(sortedValues[index+1] - sortedValues[index]));
+	}
+}
+
+// Calculate histogram of supplied values (which must be sorted) over specified range
+void Statistics::calculateHistogram(const double* sortedValues, int nValues, double minimum, double maximum, int nBins)
+{
+	histogram_.clear();
+	histogramMinimum_ = minimum;
+	histogramMaximum_ = maximum;
+	if (nBins < 1) return;
+
+	histogram_.createEmpty(nBins, 0);
+	if (nValues < 1) return;
+
+	// Since the values are sorted, the count in each bin is simply the distance between the positions of its lower and upper edges
+	// The last bin includes values equal to the maximum
+	double width = (maximum - minimum) / nBins;
+	const double* end = sortedValues + nValues;
+	const double* lower = std::lower_bound(sortedValues, end, minimum);
+	const double* upper;
+	for (int bin=0; bin<nBins; ++bin)
+	{
+		upper = (bin == nBins-1 ? std::upper_bound(lower, end, maximum) : std::lower_bound(lower, end, minimum + (bin+1)*width));
+		histogram_[bin] = upper - lower;
+		lower = upper;
+	}
+}
+
+// Set z value of slice
+void Statistics::setZ(double z)
+{
+	z_ = z;
+}
+
+// Return z value of slice
+double Statistics::z() const
+{
+	return z_;
+}
+
+// Return number of values
+int Statistics::nValues() const
+{
+	return nValues_;
+}
+
+// Return minimum value
+double Statistics::minimum() const
+{
+	return minimum_;
+}
+
+// Return maximum value
+double Statistics::maximum() const
+{
+	return maximum_;
+}
+
+// Return sum of values
+double Statistics::sum() const
+{
+	return sum_;
+}
+
+// Return mean value
+double Statistics::mean() const
+{
+	return mean_;
+}
+
+// Return (population) variance of values
+double Statistics::variance() const
+{
+	return variance_;
+}
+
+// Return standard deviation of values
+double Statistics::standardDeviation() const
+{
+	return sqrt(variance_);
+}
+
+// Return median value
+double Statistics::median() const
+{
+	return percentile(50.0);
+}
+
+// Return value at specified percentile (0 to 100)
+double Statistics::percentile(double p) const
+{
+	if (percentiles_.nItems() == 0) return 0.0;
+
+	// Values at whole percentiles are exact - intermediate values are interpolated between them
+	p = std::max(0.0, std::min(100.0, p));
+	int index = std::min(int(p), 99);
+	double fraction = p - index;
+	return percentiles_.value(index) + fraction*(percentiles_.value(index+1) - percentiles_.value(index));
+}
+
+// Return value of specified statistic
+double Statistics::value(Statistics::Statistic stat) const
+{
+	switch (stat)
+	{
+		case (Statistics::CountStatistic):
+			return nValues_;
+		case (Statistics::MinimumStatistic):
+			return minimum_;
+		case (Statistics::MaximumStatistic):
+			return maximum_;
+		case (Statistics::MeanStatistic):
+			return mean_;
+		case (Statistics::VarianceStatistic):
+			return variance_;
+		case (Statistics::StandardDeviationStatistic):
+			return standardDeviation();
+		case (Statistics::MedianStatistic):
+			return median();
+		default:
+			printf("Internal Error: Statistic %i not accounted for in Statistics::value().\n", stat);
+			break;
+	}
+
+	return 0.0;
+}
+
+// Return histogram counts
+const Array<int>& Statistics::histogram() const
+{
+	return histogram_;
+}
+
+// Return minimum of histogram range
+double Statistics::histogramMinimum() const
+{
+	return histogramMinimum_;
+}
+
+// Return maximum of histogram range
+double Statistics::histogramMaximum() const
+{
+	return histogramMaximum_;
+}
+
+// Return width of histogram bins
+double Statistics::histogramBinWidth() const
+{
+	return (histogram_.nItems() == 0 ? 0.0 : (histogramMaximum_ - histogramMinimum_) / histogram_.nItems());
+}
+
+/*
+ * Collection Statistics
+ */
+
+// Pass Task
+class StatisticsPassTask : public QRunnable
+{
+	public:
+	// Constructor
+	StatisticsPassTask(CollectionStatistics& statistics, int firstIndex, int stride, int nSlices) : QRunnable(), statistics_(statistics)
+	{
+		firstIndex_ = firstIndex;
+		stride_ = stride;
+		nSlices_ = nSlices;
+	}
+
+	private:
+	// Parent statistics
+	CollectionStatistics& statistics_;
+	// Index of first slice to process, and stride between slices
+	int firstIndex_, stride_;
+	// Total number of slices
+	int nSlices_;
+
+	public:
+	// Apply current pass to our share of the slices
+	void run()
+	{
+		for (int n=firstIndex_; n<nSlices_; n += stride_) statistics_.applyPass(n);
+	}
+};
+
+// Constructor
+CollectionStatistics::CollectionStatistics() : ListItem<CollectionStatistics>()
+{
+	collection_ = NULL;
+	dataVersion_ = -1;
+	xMin_ = 0.0;
+	xMax_ = 0.0;
+	zMin_ = 0.0;
+	zMax_ = 0.0;
+	nBins_ = 0;
+	passType_ = CollectionStatistics::SlicePass;
+	abscissaStart_ = 0;
+	abscissaEnd_ = -1;
+}
+
+// Return whether the statistics were calculated from the inputs specified
+bool CollectionStatistics::matches(Collection* collection, int dataVersion, double xMin, double xMax, double zMin, double zMax, int nBins) const
+{
+	return ((collection_ == collection) && (dataVersion_ == dataVersion) && (xMin_ == xMin) && (xMax_ == xMax) && (zMin_ == zMin) && (zMax_ == zMax) && (nBins_ == nBins));
+}
+
+// Return source collection
+Collection* CollectionStatistics::collection() const
+{
+	return collection_;
+}
+
+// Return statistics over all values in range
+const Statistics& CollectionStatistics::total() const
+{
+	return total_;
+}
+
+// Return statistics for each display dataset (slice) in range
+Statistics* CollectionStatistics::slices() const
+{
+	return slices_.first();
+}
+
+// Return number of slices in range
+int CollectionStatistics::nSlices() const
+{
+	return slices_.nItems();
+}
+
+// Return display dataset index of specified slice
+int CollectionStatistics::displayDataSetIndex(int slice) const
+{
+	return sliceIndices_.value(slice);
+}
+
+// Return statistics for display dataset with specified index (or NULL if it is outside the range)
+Statistics* CollectionStatistics::displayDataSetStatistics(int index) const
+{
+	for (int n=0; n<sliceIndices_.nItems(); ++n) if (sliceIndices_.value(n) == index) return slices_.item(n);
+
+	return NULL;
+}
+
+// Calculate statistics from the collection's current display data
+void CollectionStatistics::calculate()
+{
+	total_.clear();
+	slices_.clear();
+	sliceIndices_.clear();
+	sources_.clear();
+
+	// Display data are generated on demand, so make sure they are up to date here rather than in the pass tasks
+	const Array<double>& abscissa = collection_->displayAbscissa();
+	List<DisplayDataSet>& displayData = collection_->displayData();
+
+	// The display abscissa is in ascending order, so points within the x range form a contiguous block
+	const double* x = abscissa.constArray();
+	abscissaStart_ = std::lower_bound(x, x+abscissa.nItems(), xMin_) - x;
+	abscissaEnd_ = (std::upper_bound(x, x+abscissa.nItems(), xMax_) - x) - 1;
+
+	// Select display datasets within the z range
+	int index = 0;
+	for (DisplayDataSet* dataSet = displayData.first(); dataSet != NULL; dataSet = dataSet->next, ++index)
+	{
+		if ((dataSet->z() < zMin_) || (dataSet->z() > zMax_)) continue;
+		sources_.add(dataSet);
+		sliceIndices_.add(index);
+		slices_.add()->setZ(dataSet->z());
+	}
+
+	// Gather, sort, and analyse the values in each slice
+	// -- Requesting the item array also builds the index used by List::operator[]
+	slices_.array();
+	sliceValues_.createEmpty(slices_.nItems());
+	runPass(CollectionStatistics::SlicePass);
+
+	// Combine the moments of the slices, and merge their sorted values so that percentiles over the whole range are exact
+	Array<int> runStart;
+	runStart.add(0);
+	for (Statistics* slice = slices_.first(); slice != NULL; slice = slice->next)
+	{
+		total_.combine(*slice);
+		runStart.add(runStart.last() + slice->nValues());
+	}
+	const int nRuns = slices_.nItems();
+	Array<double> allValues(total_.nValues());
+	double* values = allValues.array();
+	const Array<double>* runs = sliceValues_.constArray();
+	for (int n=0; n<nRuns; ++n) std::copy(runs[n].array(), runs[n].array() + runs[n].nItems(), values + runStart.value(n));
+	for (int width = 1; width < nRuns; width *= 2)
+	{
+		for (int n=0; n+width<nRuns; n += 2*width) std::inplace_merge(values + runStart.value(n), values + runStart.value(n+width), values + runStart.value(std::min(n+2*width, nRuns)));
+	}
+	total_.calculatePercentiles(values, total_.nValues());
+	total_.calculateHistogram(values, total_.nValues(), total_.minimum(), total_.maximum(), nBins_);
+
+	// Accumulate histograms of the slices over the same range as the total, so that they may be compared directly
+	runPass(CollectionStatistics::HistogramPass);
+
+	sources_.clear();
+	sliceValues_.releaseStorage();
+}
+
+// Run pass of specified type over all slices
+void CollectionStatistics::runPass(PassType type)
+{
+	passType_ = type;
+
+	// Split the slices between threads, unless there are too few to make this worthwhile
+	int nSlices = slices_.nItems();
+	int nThreads = std::min(TaskGroup::maxThreadCount(), nSlices);
+	if (nThreads < 2) for (int n=0; n<nSlices; ++n) applyPass(n);
+	else
+	{
+		TaskGroup tasks;
+		for (int n=0; n<nThreads; ++n) tasks.start(new StatisticsPassTask(*this, n, nThreads, nSlices));
+		tasks.waitForDone();
+	}
+}
+
+// Apply current pass to slice with specified index (called by pass tasks)
+void CollectionStatistics::applyPass(int index)
+{
+	Statistics* slice = slices_[index];
+	Array<double>& values = sliceValues_[index];
+
+	switch (passType_)
+	{
+		case (CollectionStatistics::SlicePass):
+		{
+			// Gather values in the x range, skipping those points which have no value
+			const DisplayDataSet* source = sources_.value(index);
+			const double* y = source->y().constArray();
+			const DisplayDataSet::DataPointType* types = source->yType().constArray();
+			int last = std::min(abscissaEnd_, source->y().nItems()-1);
+			values.reserve(std::max(last - abscissaStart_ + 1, 0));
+			for (int n=abscissaStart_; n<=last; ++n) if (types[n] != DisplayDataSet::NoPoint) values.add(y[n]);
+
+			std::sort(values.array(), values.array() + values.nItems());
+			slice->calculate(values.array(), values.nItems());
+			break;
+		}
+		case (CollectionStatistics::HistogramPass):
+			slice->calculateHistogram(values.array(), values.nItems(), total_.minimum(), total_.maximum(), nBins_);
+			break;
+	}
+}
+
+/*
+ * Statistics Engine
+ */
+
+// Static Members
+List<CollectionStatistics> StatisticsEngine::results_;
+
+// Return statistics for collection over specified x and z ranges, calculating them if necessary
+// -- The returned reference remains valid until the next call
+const CollectionStatistics& StatisticsEngine::statistics(Collection* collection, double xMin, double xMax, double zMin, double zMax, int nBins)
+{
+	const int maxResults = 16;
+	int dataVersion = collection->dataVersion();
+
+	// Check for statistics calculated from identical inputs, discarding any calculated from an older version of the collection's data
+	CollectionStatistics* result = results_.first();
+	while (result != NULL)
+	{
+		if (result->matches(collection, dataVersion, xMin, xMax, zMin, zMax, nBins)) break;
+		if ((result->collection_ == collection) && (result->dataVersion_ != dataVersion)) result = results_.removeAndGetNext(result);
+		else result = result->next;
+	}
+	if (result)
+	{
+		results_.moveToStart(result);
+		return *result;
+	}
+
+	// Calculate new statistics, discarding the least-recently used if we have too many
+	result = results_.addAt(0);
+	result->collection_ = collection;
+	result->dataVersion_ = dataVersion;
+	result->xMin_ = xMin;
+	result->xMax_ = xMax;
+	result->zMin_ = zMin;
+	result->zMax_ = zMax;
+	result->nBins_ = nBins;
+	result->calculate();
+	if (results_.nItems() > maxResults) results_.removeLast();
+
+	return *result;
+}
+
+// Forget specified collection (e.g. because it is being deleted)
+void StatisticsEngine::removeCollection(Collection* collection)
+{
+	CollectionStatistics* result = results_.first();
+	while (result != NULL)
+	{
+		if (result->collection_ == collection) result = results_.removeAndGetNext(result);
+		else result = result->next;
+	}
+}
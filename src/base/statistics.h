@@ -0,0 +1,205 @@
+/*
+	*** Statistics
+	*** src/base/statistics.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_STATISTICS_H
+#define UCHROMA_STATISTICS_H
+
+#include "templates/list.h"
+#include "templates/array.h"
+#include <QString>
+
+// Forward Declarations
+class Collection;
+class DisplayDataSet;
+
+// Statistics
+class Statistics : public ListItem<Statistics>
+{
+	public:
+	// Constructor
+	Statistics();
+	// Statistic types
+	enum Statistic { NoStatistic, CountStatistic, MinimumStatistic, MaximumStatistic, MeanStatistic, VarianceStatistic, StandardDeviationStatistic, MedianStatistic, nStatistics };
+	// Convert text string to Statistic
+	static Statistic statistic(QString s);
+	// Convert Statistic to text string
+	static const char* statistic(Statistic stat);
+
+
+	/*
+	 * Values
+	 */
+	private:
+	// Number of values
+	int nValues_;
+	// Minimum, maximum, and sum of values
+	double minimum_, maximum_, sum_;
+	// Mean and (population) variance of values
+	double mean_, variance_;
+	// Values at each whole percentile (0 to 100 inclusive)
+	Array<double> percentiles_;
+	// Histogram counts
+	Array<int> histogram_;
+	// Range over which the histogram was accumulated
+	double histogramMinimum_, histogramMaximum_;
+	// Z value of slice (if the statistics describe a single slice)
+	double z_;
+
+	public:
+	// Clear all values
+	void clear();
+	// Calculate moments and percentiles from supplied values (which must be sorted)
+	void calculate(const double* sortedValues, int nValues);
+	// Combine moments with those of another (disjoint) set of values
+	void combine(const Statistics& other);
+	// Calculate percentiles from supplied values (which must be sorted)
+	void calculatePercentiles(const double* sortedValues, int nValues);
+	// Calculate histogram of supplied values (which must be sorted) over specified range
+	void calculateHistogram(const double* sortedValues, int nValues, double minimum, double maximum, int nBins);
+	// Set z value of slice
+	void setZ(double z);
+	// Return z value of slice
+	double z() const;
+	// Return number of values
+	int nValues() const;
+	// Return minimum value
+	double minimum() const;
+	// Return maximum value
+	double maximum() const;
+	// Return sum of values
+	double sum() const;
+	// Return mean value
+	double mean() const;
+	// Return (population) variance of values
+	double variance() const;
+	// Return standard deviation of values
+	double standardDeviation() const;
+	// Return median value
+	double median() const;
+	// Return value at specified percentile (0 to 100)
+	double percentile(double p) const;
+	// Return value of specified statistic
+	double value(Statistic stat) const;
+	// Return histogram counts
+	const Array<int>& histogram() const;
+	// Return minimum of histogram range
+	double histogramMinimum() const;
+	// Return maximum of histogram range
+	double histogramMaximum() const;
+	// Return width of histogram bins
+	double histogramBinWidth() const;
+};
+
+// Collection Statistics
+class CollectionStatistics : public ListItem<CollectionStatistics>
+{
+	public:
+	// Constructor
+	CollectionStatistics();
+	// Friend classes
+	friend class StatisticsEngine;
+	// Pass types
+	enum PassType { SlicePass, HistogramPass };
+
+
+	/*
+	 * Definition
+	 */
+	private:
+	// Source collection
+	Collection* collection_;
+	// Data version of collection from which the statistics were calculated
+	int dataVersion_;
+	// X and Z ranges over which the statistics were calculated
+	double xMin_, xMax_, zMin_, zMax_;
+	// Number of histogram bins
+	int nBins_;
+
+	public:
+	// Return whether the statistics were calculated from the inputs specified
+	bool matches(Collection* collection, int dataVersion, double xMin, double xMax, double zMin, double zMax, int nBins) const;
+	// Return source collection
+	Collection* collection() const;
+
+
+	/*
+	 * Results
+	 */
+	private:
+	// Statistics over all values in range
+	Statistics total_;
+	// Statistics for each display dataset (slice) in range
+	List<Statistics> slices_;
+	// Display dataset index of each slice
+	Array<int> sliceIndices_;
+
+	public:
+	// Return statistics over all values in range
+	const Statistics& total() const;
+	// Return statistics for each display dataset (slice) in range
+	Statistics* slices() const;
+	// Return number of slices in range
+	int nSlices() const;
+	// Return display dataset index of specified slice
+	int displayDataSetIndex(int slice) const;
+	// Return statistics for display dataset with specified index (or NULL if it is outside the range)
+	Statistics* displayDataSetStatistics(int index) const;
+
+
+	/*
+	 * Calculation
+	 */
+	private:
+	// Type of current pass
+	PassType passType_;
+	// Source display datasets
+	Array<const DisplayDataSet*> sources_;
+	// Range of abscissa indices to use
+	int abscissaStart_, abscissaEnd_;
+	// Valid values for each slice, sorted
+	Array< Array<double> > sliceValues_;
+
+	private:
+	// Calculate statistics from the collection's current display data
+	void calculate();
+	// Run pass of specified type over all slices
+	void runPass(PassType type);
+
+	public:
+	// Apply current pass to slice with specified index (called by pass tasks)
+	void applyPass(int index);
+};
+
+// Statistics Engine
+class StatisticsEngine
+{
+	private:
+	// Calculated statistics, most-recently used first
+	static List<CollectionStatistics> results_;
+
+	public:
+	// Return statistics for collection over specified x and z ranges, calculating them if necessary
+	static const CollectionStatistics& statistics(Collection* collection, double xMin, double xMax, double zMin, double zMax, int nBins = 20);
+	// Forget specified collection (e.g. because it is being deleted)
+	static void removeCollection(Collection* collection);
+};
+
+#endif
@@ -23,20 +23,24 @@
 #include "base/axes.h"
 #include "base/collection.h"
 #include "render/surface.h"
+#include <QElapsedTimer>
 
 // Constructor
 TargetPrimitive::TargetPrimitive() : ListItem<TargetPrimitive>()
 {
 	collection_ = NULL;
-	primitiveDataUsedAt_ = -1;
-	primitiveColourUsedAt_ = -1;
-	primitiveStyleUsedAt_ = -1;
-	primitiveAxesUsedAt_ = -1;
+	mesh_ = MeshCache::create();
+	regenerationTime_ = 0.0;
+	rebuilt_ = false;
+	preparedFirstSlice_ = 0;
+	axesUsed_ = NULL;
+	axesVersionUsed_ = -1;
 }
 
 // Destructor
 TargetPrimitive::~TargetPrimitive()
 {
+	MeshCache::release(mesh_);
 }
 
 /*
@@ -46,7 +50,13 @@ TargetPrimitive::~TargetPrimitive()
 // Set pointer to target collection
 void TargetPrimitive::setCollection(Collection* collection)
 {
+	if (collection == collection_) return;
+
 	collection_ = collection;
+
+	// Any existing mesh was constructed from the old collection, so start afresh
+	MeshCache::release(mesh_);
+	mesh_ = MeshCache::create();
 }
 
 // Return pointer to target collection
@@ -59,64 +69,222 @@ Collection* TargetPrimitive::collection()
  * GL
  */
 
+// Return transform signature of specified axes
+const QString& TargetPrimitive::axesSignature(const Axes& axes)
+{
+	// Only regenerate the signature if the axes (or their display version) have changed since it was last requested
+	if ((axesUsed_ != &axes) || (axesVersionUsed_ != axes.displayVersion()))
+	{
+		axesSignature_ = axes.transformSignature();
+		axesUsed_ = &axes;
+		axesVersionUsed_ = axes.displayVersion();
+	}
+
+	return axesSignature_;
+}
+
+// Return whether primitive data is up to date
+bool TargetPrimitive::isUpToDate(const Axes& axes)
+{
+	return (mesh_->hasInputs(collection_, collection_->dataVersion(), collection_->colourVersion(), collection_->displayStyleVersion(), axesSignature(axes)) && mesh_->isConstructed());
+}
+
+// Return whether the update of the primitive should be deferred, since display data is being regenerated in the background
+bool TargetPrimitive::deferUpdate()
+{
+	// If the collection's data has changed and its display data is being regenerated in the background, keep showing the existing primitive (if any) until it is ready
+	return ((mesh_->constructedDataVersion_ != collection_->dataVersion()) && collection_->requestBackgroundUpdate());
+}
+
+// Return index of first display dataset for which primitive data must be constructed
+int TargetPrimitive::firstSliceToConstruct(const Axes& axes, bool forceUpdate, bool pushAndPop)
+{
+	// If datasets have only been appended to the collection since the mesh was last constructed, and nothing else has changed,
+	// primitives for the existing display data can be kept and only those for the new data created
+	if ((!forceUpdate) && (!pushAndPop) && (mesh_->constructedAxesSignature_ == mesh_->axesSignature_) && (mesh_->constructedColourVersion_ == mesh_->colourVersion_) && (mesh_->constructedStyleVersion_ == mesh_->styleVersion_) && collection_->displayDataAppendedSince(mesh_->constructedDataVersion_)) return mesh_->constructedNDisplayDataSets_;
+
+	return 0;
+}
+
+// Construct primitive data from the collection, without sending anything to GL
+void TargetPrimitive::constructPrimitive(const Axes& axes, int firstSlice, bool forceUpdate, bool pushAndPop)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	PrimitiveList& primitive = mesh_->primitive_;
+	ImagePrimitive& image = mesh_->image_;
+
+	// Release image data if we are no longer using it
+	if ((collection_->displayStyle() != Collection::ImageStyle) && image.hasImage() && (!pushAndPop))
+	{
+		image.clear();
+		mesh_->imageReleased_ = true;
+	}
+
+	// Recreate primitive depending on current style
+	switch (collection_->displayStyle())
+	{
+		case (Collection::LineXYStyle):
+			Surface::constructLineXY(primitive, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale(), firstSlice);
+			break;
+		case (Collection::LineZYStyle):
+			Surface::constructLineZY(primitive, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale());
+			break;
+		case (Collection::GridStyle):
+			Surface::constructGrid(primitive, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale());
+			break;
+		case (Collection::SurfaceStyle):
+		case (Collection::UnlitSurfaceStyle):
+			Surface::constructFull(primitive, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale(), firstSlice);
+			break;
+		case (Collection::ImageStyle):
+			// The grid only needs regenerating if something other than the colour scale has changed, since colours are applied from a lookup table
+			if (forceUpdate || (mesh_->constructedAxesSignature_ != mesh_->axesSignature_) || (mesh_->constructedDataVersion_ != mesh_->dataVersion_) || (mesh_->constructedStyleVersion_ != mesh_->styleVersion_) || (!image.hasImage()))
+			{
+				image.set(axes, collection_->displayAbscissa(), collection_->displayData());
+				constructImageOutline();
+			}
+			image.setColourScale(collection_->colourScale());
+			break;
+		default:
+			printf("Internal Error: Display style %i not accounted for in TargetPrimitive::constructPrimitive().\n", collection_->displayStyle());
+			break;
+	}
+
+	mesh_->setConstructed(collection_->displayData().nItems());
+	rebuilt_ = true;
+
+	regenerationTime_ = timer.nsecsElapsed() * 1.0e-6;
+}
+
+// Check whether primitive data needs to be constructed, preparing the collection's display data for construct() if so
+bool TargetPrimitive::prepare(const Axes& axes)
+{
+	// Check collection validity
+	if (!Collection::objectValid(collection_, "collection in TargetPrimitive::prepare")) return false;
+
+	if (isUpToDate(axes) || deferUpdate()) return false;
+
+	// Acquire the mesh for the current inputs - if it is shared with a target in another pane, it may already have been constructed (or be about to be)
+	mesh_ = MeshCache::acquire(mesh_, collection_, collection_->dataVersion(), collection_->colourVersion(), collection_->displayStyleVersion(), axesSignature(axes));
+	if (mesh_->isConstructed() || mesh_->constructionPending_) return false;
+
+	// Display data and the colour scale are generated on demand, so make sure they are up to date here rather than in construct() (which may be running alongside others using the same collection)
+	// -- Requesting the item array also builds the index used by List::operator[]
+	collection_->displayData().array();
+	collection_->displayAbscissa();
+	collection_->colourScale();
+	preparedFirstSlice_ = firstSliceToConstruct(axes, false, false);
+	mesh_->constructionPending_ = true;
+
+	return true;
+}
+
+// Construct primitive data in advance of the next update (may be called from a worker thread after prepare())
+void TargetPrimitive::construct(const Axes& axes)
+{
+	constructPrimitive(axes, preparedFirstSlice_, false, false);
+}
+
 // Update and send primitive
-void TargetPrimitive::updateAndSendPrimitive(const Axes& axes, bool forceUpdate, bool pushAndPop, const QOpenGLContext* context)
+bool TargetPrimitive::updateAndSendPrimitive(const Axes& axes, bool forceUpdate, bool pushAndPop, const QOpenGLContext* context)
 {
 	// Check collection validity
-	if (!Collection::objectValid(collection_, "collection in TargetPrimitive::updateAndSendPrimitive")) return;
+	if (!Collection::objectValid(collection_, "collection in TargetPrimitive::updateAndSendPrimitive")) return false;
 
 	// Check whether the primitive for this collection needs updating
-	bool upToDate = true;
-	if (forceUpdate) upToDate = false;
-	else if (primitiveAxesUsedAt_ != axes.displayVersion()) upToDate = false;
-	else if (primitiveColourUsedAt_ != collection_->colourVersion()) upToDate = false;
-	else if (primitiveDataUsedAt_ != collection_->dataVersion()) upToDate = false;
-	else if (primitiveStyleUsedAt_ != collection_->displayStyleVersion()) upToDate = false;
-
-	// If the primitive is out of date, recreate it's data.
+	bool upToDate = (!forceUpdate) && isUpToDate(axes);
+
+	// If display data is being regenerated in the background, keep showing the existing primitive (if any) until it is ready
+	if ((!upToDate) && (!forceUpdate) && (!pushAndPop) && deferUpdate())
+	{
+		sendToGL();
+		return false;
+	}
+
+	// If the primitive is out of date, recreate it's data (unless this has already been done in advance, or by a target sharing the same mesh)
 	if (!upToDate)
 	{
-		// Recreate primitive depending on current style
-		switch (collection_->displayStyle())
+		mesh_ = MeshCache::acquire(mesh_, collection_, collection_->dataVersion(), collection_->colourVersion(), collection_->displayStyleVersion(), axesSignature(axes));
+		if (forceUpdate || pushAndPop || (!mesh_->isConstructed())) constructPrimitive(axes, firstSliceToConstruct(axes, forceUpdate, pushAndPop), forceUpdate, pushAndPop);
+	}
+
+	PrimitiveList& primitive = mesh_->primitive_;
+	ImagePrimitive& image = mesh_->image_;
+	bool imageStyle = (collection_->displayStyle() == Collection::ImageStyle);
+
+	// Image grid values are released once uploaded, so regenerate them if the instance to be sent needs them again (e.g. a new context, or colours generated on the CPU)
+	if (imageStyle && image.valuesRequired(context, pushAndPop)) image.restoreValues(axes, collection_->displayAbscissa(), collection_->displayData());
+
+	if (pushAndPop)
+	{
+		// Push a new temporary instance, send it, and pop it again
+		primitive.pushInstance(context);
+		if (imageStyle) image.pushInstance(context);
+		sendToGL();
+		primitive.popInstance(context);
+		if (imageStyle) image.popInstance(context);
+	}
+	else
+	{
+		// If the mesh has been constructed since it was last sent to GL, update its existing instance in-place.
+		// Updating reuses the existing buffer objects, and only uploads data for those primitives (e.g. surface strips) which have changed.
+		// A shared mesh is only uploaded once, by whichever target first sends it after construction.
+		if (mesh_->uploadCount_ != mesh_->constructCount_)
 		{
-			case (Collection::LineXYStyle):
-				Surface::constructLineXY(primitive_, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale());
-				break;
-			case (Collection::LineZYStyle):
-				Surface::constructLineZY(primitive_, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale());
-				break;
-			case (Collection::GridStyle):
-				Surface::constructGrid(primitive_, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale());
-				break;
-			case (Collection::SurfaceStyle):
-			case (Collection::UnlitSurfaceStyle):
-				Surface::constructFull(primitive_, axes, collection_->displayAbscissa(), collection_->displayData(), collection_->colourScale());
-				break;
-			default:
-				printf("Internal Error: Display style %i not accounted for in TargetPrimitive::updateAndSendPrimitive().\n", collection_->displayStyle());
-				break;
+			// Release textures of image data we are no longer using
+			if (mesh_->imageReleased_)
+			{
+				image.updateInstance(context);
+				mesh_->imageReleased_ = false;
+			}
+
+			primitive.updateInstance(context);
+			if (imageStyle) image.updateInstance(context);
+			mesh_->uploadCount_ = mesh_->constructCount_;
 		}
 
-		// Pop old primitive instance (unless flagged not to)
-		if ((!pushAndPop) && (primitive_.nInstances() != 0)) primitive_.popInstance(context);
-	
-		// Push a new instance to create the new display list / vertex array
-		primitive_.pushInstance(context);
+		// Send primitive
+		sendToGL();
 	}
 
-	// Send primitive
-	sendToGL();
+	// Return whether this target constructed its mesh since the last update
+	bool result = rebuilt_;
+	rebuilt_ = false;
+
+	return result;
+}
+
+// Return time taken (in ms) to regenerate primitive data at last update
+double TargetPrimitive::regenerationTime() const
+{
+	return regenerationTime_;
+}
+
+// Return primitive list for display of target collection
+PrimitiveList& TargetPrimitive::primitive()
+{
+	return mesh_->primitive_;
+}
 
-	// Pop current instance (if flagged)
-	if (pushAndPop) primitive_.popInstance(context);
+// Construct outline of image in primitive, so that the image can be picked in the same way as other styles
+void TargetPrimitive::constructImageOutline()
+{
+	PrimitiveList& primitive = mesh_->primitive_;
+	ImagePrimitive& image = mesh_->image_;
 
-	// Store version points for the up-to-date primitive
-	primitiveAxesUsedAt_ = axes.displayVersion();
-	primitiveColourUsedAt_ = collection_->colourVersion();
-	primitiveDataUsedAt_ = collection_->dataVersion();
-	primitiveStyleUsedAt_ = collection_->displayStyleVersion();
+	primitive.reinitialise(1, true, GL_TRIANGLES, false);
+	if (!image.hasImage()) return;
 
-	return;
+	Primitive* outline = primitive[0];
+	Vec3<double> normal(0.0, 1.0, 0.0);
+	GLuint a = outline->defineVertex(image.corner(0), normal);
+	GLuint b = outline->defineVertex(image.corner(1), normal);
+	GLuint c = outline->defineVertex(image.corner(2), normal);
+	GLuint d = outline->defineVertex(image.corner(3), normal);
+	outline->defineIndices(a, b, c);
+	outline->defineIndices(c, d, a);
 }
 
 // Send collection data to GL, including any associated fit and extracted data
@@ -128,6 +296,14 @@ void TargetPrimitive::sendToGL()
 	// If this collection is not visible return now
 	if (!collection_->visible()) return;
 
+	// Image style is drawn from textures, rather than the primitive (which holds only its outline)
+	if (collection_->displayStyle() == Collection::ImageStyle)
+	{
+		glDisable(GL_LIGHTING);
+		mesh_->image_.sendToGL();
+		return;
+	}
+
 	if (collection_->displayStyle() == Collection::SurfaceStyle)
 	{
 		glEnable(GL_LIGHTING);
@@ -141,5 +317,5 @@ void TargetPrimitive::sendToGL()
 	}
 
 	// Send Primitives to display
-	primitive_.sendToGL();
+	mesh_->primitive_.sendToGL();
 }
@@ -22,7 +22,7 @@
 #ifndef UCHROMA_TARGETPRIMITIVE_H
 #define UCHROMA_TARGETPRIMITIVE_H
 
-#include "render/primitivelist.h"
+#include "base/meshcache.h"
 
 // Forward Declarations
 class Collection;
@@ -55,20 +55,45 @@ class TargetPrimitive : public ListItem<TargetPrimitive>
 	 * GL
 	 */
 	private:
-	// Primitive for display of target collection (if necessary)
-	PrimitiveList primitive_;
-	// Collection data version at which primitive was last created
-	int primitiveDataUsedAt_;
-	// Collection colour version at which primitive was last created
-	int primitiveColourUsedAt_;
-	// ViewPane axes version at which primitive was last created
-	int primitiveAxesUsedAt_;
-	// Collection style version at which primitive was last created
-	int primitiveStyleUsedAt_;
+	// Mesh (primitive and image) for display of target collection, which may be shared with targets in other panes
+	SharedMesh* mesh_;
+	// Time taken (in ms) to regenerate primitive data at last update
+	double regenerationTime_;
+	// Whether the mesh has been constructed since the last update
+	bool rebuilt_;
+	// First display dataset for which primitive data is to be constructed in advance
+	int preparedFirstSlice_;
+	// Axes (and their display version) for which the transform signature was last generated
+	const Axes* axesUsed_;
+	int axesVersionUsed_;
+	// Transform signature of axes last used
+	QString axesSignature_;
+
+	private:
+	// Return transform signature of specified axes
+	const QString& axesSignature(const Axes& axes);
+	// Return whether primitive data is up to date
+	bool isUpToDate(const Axes& axes);
+	// Return whether the update of the primitive should be deferred, since display data is being regenerated in the background
+	bool deferUpdate();
+	// Return index of first display dataset for which primitive data must be constructed
+	int firstSliceToConstruct(const Axes& axes, bool forceUpdate, bool pushAndPop);
+	// Construct primitive data from the collection, without sending anything to GL
+	void constructPrimitive(const Axes& axes, int firstSlice, bool forceUpdate, bool pushAndPop);
+	// Construct outline of image in primitive, so that the image can be picked in the same way as other styles
+	void constructImageOutline();
 
 	public:
+	// Check whether primitive data needs to be constructed, preparing the collection's display data for construct() if so
+	bool prepare(const Axes& axes);
+	// Construct primitive data in advance of the next update (may be called from a worker thread after prepare())
+	void construct(const Axes& axes);
 	// Update primitive for target collection, returning if data was changed
-	void updateAndSendPrimitive(const Axes& axes, bool forceUpdate, bool pushAndPop, const QOpenGLContext* context);
+	bool updateAndSendPrimitive(const Axes& axes, bool forceUpdate, bool pushAndPop, const QOpenGLContext* context);
+	// Return time taken (in ms) to regenerate primitive data at last update
+	double regenerationTime() const;
+	// Return primitive list for display of target collection
+	PrimitiveList& primitive();
 	// Send primitive to GL
 	void sendToGL();
 };
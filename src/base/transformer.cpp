@@ -130,8 +130,8 @@ Array<double> Transformer::transformArray(Array<double> sourceX, Array<double> s
 	for (int n=0; n<sourceX.nItems(); ++n)
 	{
 		// Set x and y values in equation
-		x_->set(sourceX[n]);
-		y_->set(sourceY[n]);
+		x_->set(sourceX.value(n));
+		y_->set(sourceY.value(n));
 		newArray[n] = equation_.execute(success);
 		if (!success) break;
 	}
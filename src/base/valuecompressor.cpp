@@ -0,0 +1,115 @@
+/*
+	*** Value Compressor
+	*** src/base/valuecompressor.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "base/valuecompressor.h"
+#include <string.h>
+
+// Return bit pattern of value
+static inline quint64 valueBits(double value)
+{
+	quint64 bits;
+	memcpy(&bits, &value, sizeof(double));
+	return bits;
+}
+
+// Return value with specified bit pattern
+static inline double bitsValue(quint64 bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(double));
+	return value;
+}
+
+// Encode values using specified prediction method, appending to destination
+void ValueCompressor::encode(const Array<double>& values, ValueCompressor::PredictionMethod method, QByteArray& destination)
+{
+	destination.append(char(method));
+
+	double previous = 0.0, beforePrevious = 0.0, predicted;
+	unsigned char bytes[9];
+	for (int n=0; n<values.nItems(); ++n)
+	{
+		// Predict value, and store only the bits which differ
+		predicted = ((method == LinearPrediction) && (n > 1) ? 2.0*previous - beforePrevious : previous);
+		quint64 x = valueBits(values.value(n)) ^ valueBits(predicted);
+		beforePrevious = previous;
+		previous = values.value(n);
+
+		// Count leading and trailing zero bytes - a control byte stores both, followed by the remaining bytes (most significant first)
+		int nLeading = 0, nTrailing = 0;
+		if (x == 0) nLeading = 8;
+		else
+		{
+			while ((x >> (56 - 8*nLeading)) == 0) ++nLeading;
+			while (((x >> (8*nTrailing)) & 0xff) == 0) ++nTrailing;
+		}
+		int nBytes = 8 - nLeading - nTrailing;
+		bytes[0] = (unsigned char) ((nLeading << 4) | nTrailing);
+		for (int i=0; i<nBytes; ++i) bytes[i+1] = (unsigned char) ((x >> (8*(nTrailing + nBytes - 1 - i))) & 0xff);
+		destination.append((const char*) bytes, nBytes+1);
+	}
+}
+
+// Compress values, appending to destination
+void ValueCompressor::compress(const Array<double>& values, QByteArray& destination)
+{
+	// Try both prediction methods, keeping whichever gives the smaller result
+	QByteArray previous, linear;
+	encode(values, PreviousPrediction, previous);
+	encode(values, LinearPrediction, linear);
+
+	destination.append(linear.size() < previous.size() ? linear : previous);
+}
+
+// Decompress specified number of values from source, starting at (and advancing) the supplied position
+bool ValueCompressor::decompress(const QByteArray& source, int& position, int nValues, Array<double>& destination)
+{
+	const unsigned char* data = (const unsigned char*) source.constData();
+	int size = source.size();
+
+	destination.reserve(nValues);
+	if (position >= size) return false;
+	PredictionMethod method = (PredictionMethod) data[position++];
+	if (method >= nPredictionMethods) return false;
+
+	double previous = 0.0, beforePrevious = 0.0, predicted, value;
+	for (int n=0; n<nValues; ++n)
+	{
+		if (position >= size) return false;
+		int nLeading = data[position] >> 4, nTrailing = data[position] & 0x0f;
+		int nBytes = 8 - nLeading - nTrailing;
+		++position;
+		if ((nBytes < 0) || (position + nBytes > size)) return false;
+
+		quint64 x = 0;
+		for (int i=0; i<nBytes; ++i) x = (x << 8) | data[position+i];
+		if (nBytes > 0) x <<= 8*nTrailing;
+		position += nBytes;
+
+		predicted = ((method == LinearPrediction) && (n > 1) ? 2.0*previous - beforePrevious : previous);
+		value = bitsValue(x ^ valueBits(predicted));
+		destination.add(value);
+		beforePrevious = previous;
+		previous = value;
+	}
+
+	return true;
+}
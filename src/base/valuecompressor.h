@@ -0,0 +1,51 @@
+/*
+	*** Value Compressor
+	*** src/base/valuecompressor.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_VALUECOMPRESSOR_H
+#define UCHROMA_VALUECOMPRESSOR_H
+
+#include "templates/array.h"
+#include <QByteArray>
+
+// Value Compressor
+class ValueCompressor
+{
+	/*
+	 * Each value is stored as the XOR of its bit pattern with that of a predicted value, with leading and trailing zero bytes
+	 * removed. The prediction is either the previous value, or a linear extrapolation from the previous two (best for regular
+	 * grids), whichever gives the smaller result for the array as a whole. Compression is lossless.
+	 */
+	private:
+	// Prediction methods
+	enum PredictionMethod { PreviousPrediction, LinearPrediction, nPredictionMethods };
+
+	private:
+	// Encode values using specified prediction method, appending to destination
+	static void encode(const Array<double>& values, PredictionMethod method, QByteArray& destination);
+
+	public:
+	// Compress values, appending to destination
+	static void compress(const Array<double>& values, QByteArray& destination);
+	// Decompress specified number of values from source, starting at (and advancing) the supplied position
+	static bool decompress(const QByteArray& source, int& position, int nValues, Array<double>& destination);
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "base/collection.h"
 #include "base/viewlayout.h"
 #include "math/cuboid.h"
+#include "render/fontinstance.h"
 #include "session/session.h"
 #include <algorithm>
 #include <cmath>
@@ -32,6 +33,52 @@ template<class ViewPane> RefList<ViewPane,int> ObjectStore<ViewPane>::objects_;
 template<class ViewPane> int ObjectStore<ViewPane>::objectCount_;
 const double ViewPane::zOffset_ = -10.0;
 
+/*
+ * View Solution
+ */
+
+// Constructor
+ViewSolution::ViewSolution() : ListItem<ViewSolution>()
+{
+}
+
+// Set solution data
+void ViewSolution::set(QString key, Vec3<double> stretch, Vec3<double> axisPixelLength, Vec3<double> viewTranslation)
+{
+	key_ = key;
+	stretch_ = stretch;
+	axisPixelLength_ = axisPixelLength;
+	viewTranslation_ = viewTranslation;
+}
+
+// Return key describing the inputs from which the solution was found
+QString ViewSolution::key() const
+{
+	return key_;
+}
+
+// Return axis stretch factors
+Vec3<double> ViewSolution::stretch() const
+{
+	return stretch_;
+}
+
+// Return pixel 'lengths' of axes
+Vec3<double> ViewSolution::axisPixelLength() const
+{
+	return axisPixelLength_;
+}
+
+// Return view translation
+Vec3<double> ViewSolution::viewTranslation() const
+{
+	return viewTranslation_;
+}
+
+/*
+ * View Pane
+ */
+
 // Constructor
 ViewPane::ViewPane(ViewLayout& parent) : ListItem<ViewPane>(), ObjectStore<ViewPane>(this, ObjectTypes::ViewPaneObject), parent_(parent), axes_(*this)
 {
@@ -53,6 +100,7 @@ ViewPane::ViewPane(ViewLayout& parent) : ListItem<ViewPane>(), ObjectStore<ViewP
 	viewTranslation_.set(0.0, 0.0, zOffset_);
 	viewViewportUsedAt_ = -1;
 	viewAxesUsedAt_ = -1;
+	viewOverhang_.zero();
 	viewRotationPoint_ = 0;
 	viewRotationInversePoint_ = -1;
 
@@ -71,6 +119,7 @@ ViewPane::ViewPane(ViewLayout& parent) : ListItem<ViewPane>(), ObjectStore<ViewP
 	interactionPrimitive_.setNoInstances();
 	interactionBoxPrimitive_.setNoInstances();
 	boundingBoxPrimitive_.setNoInstances();
+	contourPrimitive_.setNoInstances();
 }
 
 // Destructor
@@ -109,6 +158,8 @@ void ViewPane::operator=(const ViewPane& source)
 	viewTranslation_ = source.viewTranslation_;
 	viewViewportUsedAt_ = -1;
 	viewAxesUsedAt_ = -1;
+	viewSolutions_.clear();
+	viewOverhang_.zero();
 
 	// Collection / Axes
 	axes_ = source.axes_;
@@ -434,6 +485,16 @@ TargetData* ViewPane::collectionTargets()
 // View types
 const char* ViewTypeKeywords[ViewPane::nViewTypes] = { "Normal", "AutoStretched", "FlatXY", "FlatXZ", "FlatZY", "Linked" };
 
+// Return key describing all inputs to the current view layout solution
+QString ViewPane::viewSolutionKey()
+{
+	// Label text follows from the axis limits and style, and its size from the font, point sizes and text scaling
+	QString key = QString("%1 %2 %3 %4 %5 %6 %7 %8").arg(viewType_).arg(hasPerspective_).arg(viewTranslation_.z, 0, 'g', 17).arg(viewportMatrix_[2]).arg(viewportMatrix_[3]).arg(textZScale_, 0, 'g', 17).arg(labelPointSize_, 0, 'g', 17).arg(titlePointSize_, 0, 'g', 17);
+	key += QString(" %1 %2 %3").arg(flatLabels_).arg(FontInstance::fontVersion()).arg(axes_.styleVersion());
+	for (int axis=0; axis<3; ++axis) key += QString(" %1 %2").arg(axes_.min(axis), 0, 'g', 17).arg(axes_.max(axis), 0, 'g', 17);
+	return key;
+}
+
 // Convert text string to ViewType
 ViewPane::ViewType ViewPane::viewType(QString s)
 {
@@ -827,21 +888,8 @@ void ViewPane::recalculateView(bool force)
 	// Create a temporary, orthographic projection matrix
 	Matrix tempProjection = calculateProjectionMatrix(false, zOffset_);
 
-	// To begin, set the stretch factors to our best first estimate, dividing the pane width by the range of the axes
-	// Doing this first will allow us to get much better values for the pixel overlaps we need later on
-	// -- Project a point one unit each along X and Y and subtract off the viewport centre coordinate in order to get literal 'pixels per unit' for (screen) X and Y 
-	Vec3<double> unit = modelToScreen(Vec3<double>(1.0, 1.0, 0.0), tempProjection, Matrix());
-	unit.x -= viewportMatrix_[0] + viewportMatrix_[2]/2.0;
-	unit.y -= viewportMatrix_[1] + viewportMatrix_[3]/2.0;
-	unit.z = unit.y;
-
-	// Get axis min/max, accounting for logarithmic axes
-	Vec3<double> axisMin, axisMax;
-	for (axis=0; axis<3; ++axis)
-	{
-		axisMin[axis] = axes_.logarithmic(axis) ? log10(axes_.min(axis)) : axes_.min(axis);
-		axisMax[axis] = axes_.logarithmic(axis) ? log10(axes_.max(axis)) : axes_.max(axis);
-	}
+	// Update text scaling for the new projection, since the sizes of labels and titles depend on it
+	calculateFontScaling();
 
 	// Decide how we will set stretch factors for each axis (initially set to standard xyy)
 	int axisX = 0, axisY = 1;
@@ -853,20 +901,57 @@ void ViewPane::recalculateView(bool force)
 		axisX = 2;
 	}
 
+	// Check for a previous solution with identical inputs (unless forced to recalculate) - if there is one, we can use it directly
+	const int maxSolutions = 16;
+	QString key = viewSolutionKey();
+	ViewSolution* solution = NULL;
+	if (!force) for (solution = viewSolutions_.first(); solution != NULL; solution = solution->next) if (solution->key() == key) break;
+	if (solution)
+	{
+		viewSolutions_.moveToStart(solution);
+		for (axis=0; axis<3; ++axis) if (axes_.stretch(axis) != solution->stretch()[axis]) axes_.setStretch(axis, solution->stretch()[axis]);
+		axisPixelLength_ = solution->axisPixelLength();
+		if (viewType_ > ViewPane::AutoStretchedView)
+		{
+			viewRotation_.setIdentity();
+			if (viewType_ == ViewPane::FlatXZView) viewRotation_.applyRotationX(90.0);
+			else if (viewType_ == ViewPane::FlatZYView) viewRotation_.applyRotationY(-90.0);
+			viewTranslation_ = solution->viewTranslation();
+		}
+
+		// Store new versions of view
+		viewAxesUsedAt_ = axes().axesVersion();
+		viewViewportUsedAt_ = viewportVersion_;
+		return;
+	}
+
+	// To begin, set the stretch factors to our best first estimate, dividing the pane width by the range of the axes
+	// Doing this first will allow us to get much better values for the pixel overlaps we need later on
+	// -- Project a point one unit each along X and Y and subtract off the viewport centre coordinate in order to get literal 'pixels per unit' for (screen) X and Y 
+	Vec3<double> unit = modelToScreen(Vec3<double>(1.0, 1.0, 0.0), tempProjection, Matrix());
+	unit.x -= viewportMatrix_[0] + viewportMatrix_[2]/2.0;
+	unit.y -= viewportMatrix_[1] + viewportMatrix_[3]/2.0;
+	unit.z = unit.y;
+
 	// Set axis stretch factors to fill available pixel width/height
+	// For the two axes in the plane of the screen, remove the overhang of labels and titles found at the last solution, since it is usually a good estimate of the current one
+	const double margin = 10.0;
+	double pixels;
 	for (axis=0; axis<3; ++axis)
 	{
-		axes_.setStretch(axis, viewportMatrix_[axisDir[axis]+2] / (unit[axisDir[axis]] * (axes_.realRange(axis))));
+		pixels = viewportMatrix_[axisDir[axis]+2];
+		if (((axis == axisX) || (axis == axisY)) && (pixels - 2*margin - viewOverhang_[axis] > 0.0)) pixels -= 2*margin + viewOverhang_[axis];
+		axes_.setStretch(axis, pixels / (unit[axisDir[axis]] * (axes_.realRange(axis))));
 		if (!std::isnormal(axes_.stretch(axis))) axes_.setStretch(axis, 1.0);
 	}
 	
-	const double margin = 10.0;
 	Matrix viewMat, B, viewMatrixInverse;
-	double tempMin, tempMax;
+	double tempMin, tempMax, overhang, factor;
 	Vec3<double> coordMin[3], coordMax[3], labelMin, labelMax, a, b, globalMin, globalMax;
 
-	// Iterate for a few cycles
-	for (int cycle = 0; cycle < 5; ++cycle)
+	// Iterate until the axis lengths are stable (to within half a pixel), or for a few cycles at most
+	bool converged = false;
+	for (int cycle = 0; (cycle < 5) && (!converged); ++cycle)
 	{
 		// We will now calculate more accurate stretch factors to apply to the X and Y axes.
 		// Project the axis limits on to the screen using the relevant viewmatrix + coordinate centre translation
@@ -924,23 +1009,26 @@ void ViewPane::recalculateView(bool force)
 		}
 
 		// Now have screen coordinates of all necessary objects (axes and labels)
-		// Calculate total width and height of objects as they are arranged
-		double globalWidth = globalMax.x - globalMin.x;
-		double globalHeight = globalMax.y - globalMin.y;
 		axisPixelLength_[axisX] = coordMax[axisX].x - coordMin[axisX].x;
 		axisPixelLength_[axisY] = coordMax[axisY].y - coordMin[axisY].y;
-// 		double labelWidth = labelMax.x - labelMin.x;
-// 		double labelHeight = labelMax.y - labelMin.y;
-
-		// Now, we know the width and height of the axis on its own, and the extra 'added' by the labels, so work out how much we need to shrink the axis by
-		double deltaWidth = (viewportMatrix_[2] - 2*margin) - globalWidth;
-		double deltaHeight = (viewportMatrix_[3] - 2*margin) - globalHeight;
-
-		// So, need to lose deltaWidth and deltaHeight pixels from the axis exents - we'll do this by scaling the stretchfactor
-		double factor = axisPixelLength_[axisX] / (axisPixelLength_[axisX] - deltaWidth);
-		axes_.setStretch(axisX, axes_.stretch(axisX) * factor);
-		factor = axisPixelLength_[axisY] / (axisPixelLength_[axisY] - deltaHeight);
-		axes_.setStretch(axisY, axes_.stretch(axisY) * factor);
+
+		// Labels and titles have a fixed size on screen, so the amount by which they overhang the axes does not depend on the stretch factors.
+		// We can therefore scale each axis directly to the length which leaves just enough room for its overhang within the margins.
+		converged = true;
+		for (int n=0; n<2; ++n)
+		{
+			axis = (n == 0 ? axisX : axisY);
+			overhang = (globalMax[n] - globalMin[n]) - axisPixelLength_[axis];
+			factor = (viewportMatrix_[n+2] - 2*margin - overhang) / axisPixelLength_[axis];
+
+			// If there is no room left for the axis there is not much we can do, so leave it as it is
+			if ((!std::isnormal(factor)) || (factor < 0.0)) continue;
+
+			viewOverhang_[axis] = overhang;
+			if (fabs(factor - 1.0) * axisPixelLength_[axis] < 0.5) continue;
+			axes_.setStretch(axis, axes_.stretch(axis) * factor);
+			converged = false;
+		}
 	}
 	
 	// Set new rotation matrix and translation vector (if not AutoStretchedView)
@@ -957,6 +1045,11 @@ void ViewPane::recalculateView(bool force)
 		viewTranslation_[1] = (margin - (globalMin.y - viewportMatrix_[1])) / unit.y;
 	}
 
+	// Store the solution, discarding the least-recently used if we have too many
+	solution = viewSolutions_.addAt(0);
+	solution->set(key, Vec3<double>(axes_.stretch(0), axes_.stretch(1), axes_.stretch(2)), axisPixelLength_, viewTranslation_);
+	if (viewSolutions_.nItems() > maxSolutions) viewSolutions_.removeLast();
+
 	// Recalculate font scaling
 	calculateFontScaling();
 
@@ -1016,6 +1109,7 @@ void ViewPane::showAllData()
 // Return absolute minimum transformed values over all displayed collections
 Vec3<double> ViewPane::transformedDataMinima()
 {
+	// Limits of collections being regenerated in the background are those currently displayed, and are updated when the new display data is delivered
 	// Set starting values from first display collection we find
 	int nCounted = 0;
 	Vec3<double> v, minima;
@@ -1024,10 +1118,10 @@ Vec3<double> ViewPane::transformedDataMinima()
 		// Loop over display targets
 		for (TargetPrimitive* prim = target->displayPrimitives(); prim != NULL; prim = prim->next)
 		{
-			if (nCounted == 0) minima = prim->collection()->transformMin();
+			if (nCounted == 0) minima = prim->collection()->transformMin(true);
 			else
 			{
-				v = target->collection()->transformMin();
+				v = target->collection()->transformMin(true);
 				if (v.x < minima.x) minima.x = v.x;
 				if (v.y < minima.y) minima.y = v.y;
 				if (v.z < minima.z) minima.z = v.z;
@@ -1056,10 +1150,10 @@ Vec3<double> ViewPane::transformedDataMaxima()
 			if (prim->collection()->nDataPoints() == 0) continue;
 
 			// Set limits...
-			if (nCounted == 0) maxima = prim->collection()->transformMax();
+			if (nCounted == 0) maxima = prim->collection()->transformMax(true);
 			else
 			{
-				v = target->collection()->transformMax();
+				v = target->collection()->transformMax(true);
 				if (v.x > maxima.x) maxima.x = v.x;
 				if (v.y > maxima.y) maxima.y = v.y;
 				if (v.z > maxima.z) maxima.z = v.z;
@@ -1084,10 +1178,10 @@ Vec3<double> ViewPane::transformedDataPositiveMinima()
 		// Loop over display targets
 		for (TargetPrimitive* prim = target->displayPrimitives(); prim != NULL; prim = prim->next)
 		{
-			if (nCounted == 0) minima = prim->collection()->transformMinPositive();
+			if (nCounted == 0) minima = prim->collection()->transformMinPositive(true);
 			else
 			{
-				v = target->collection()->transformMinPositive();
+				v = target->collection()->transformMinPositive(true);
 				if (v.x < minima.x) minima.x = v.x;
 				if (v.y < minima.y) minima.y = v.y;
 				if (v.z < minima.z) minima.z = v.z;
@@ -1112,10 +1206,10 @@ Vec3<double> ViewPane::transformedDataPositiveMaxima()
 		// Loop over display targets
 		for (TargetPrimitive* prim = target->displayPrimitives(); prim != NULL; prim = prim->next)
 		{
-			if (nCounted == 0) maxima = prim->collection()->transformMaxPositive();
+			if (nCounted == 0) maxima = prim->collection()->transformMaxPositive(true);
 			else
 			{
-				v = target->collection()->transformMaxPositive();
+				v = target->collection()->transformMaxPositive(true);
 				if (v.x > maxima.x) maxima.x = v.x;
 				if (v.y > maxima.y) maxima.y = v.y;
 				if (v.z > maxima.z) maxima.z = v.z;
@@ -1222,6 +1316,9 @@ void ViewPane::collectionsUpdateCurrentSlices(int axis, double axisValue)
 			prim->collection()->updateCurrentSlice(axis, axisValue);
 		}
 	}
+
+	// Slices at fixed Y are contours, which are also shown in this pane
+	if (axis == 1) updateContourPrimitive(axisValue);
 }
 
 /*
@@ -1344,6 +1441,12 @@ int ViewPane::axisTitleAt(int screenX, int screenY)
 	return -1;
 }
 
+// Return spatial index of displayed primitives
+PickingIndex& ViewPane::pickingIndex()
+{
+	return pickingIndex_;
+}
+
 /*
  * GL
  */
@@ -1374,6 +1477,8 @@ void ViewPane::updateInteractionPrimitive(int axis)
 	interactionPrimitive_.forgetAll();
 	interactionBoxPrimitive_.initialise(GL_LINES, false);
 	interactionBoxPrimitive_.forgetAll();
+	contourPrimitive_.initialise(GL_LINES, false);
+	contourPrimitive_.forgetAll();
 
 	if (axis == -1) return;
 
@@ -1439,6 +1544,43 @@ Primitive& ViewPane::interactionBoxPrimitive()
 	return interactionBoxPrimitive_;
 }
 
+// Update contour primitive from current contour lines (at specified Y value) of collections displayed in this pane
+void ViewPane::updateContourPrimitive(double level)
+{
+	contourPrimitive_.initialise(GL_LINES, false);
+	contourPrimitive_.forgetAll();
+
+	// Each contour line holds z values as the ordinate - complete lines are used rather than the slice datasets, which are split where x does not increase
+	Vec3<double> normal(0.0, 1.0, 0.0), v;
+	v.y = axes_.transformY(level);
+	GLuint lastVertex = 0, vertex;
+	for (TargetData* target = collectionTargets_.first(); target != NULL; target = target->next)
+	{
+		for (TargetPrimitive* prim = target->displayPrimitives(); prim != NULL; prim = prim->next)
+		{
+			for (Data2D* line = prim->collection()->currentContourLines(); line != NULL; line = line->next)
+			{
+				const double* x = line->constArrayX().constArray();
+				const double* z = line->constArrayY().constArray();
+				for (int n=0; n<line->nPoints(); ++n)
+				{
+					v.x = axes_.transformX(x[n]);
+					v.z = axes_.transformZ(z[n]);
+					vertex = contourPrimitive_.defineVertex(v, normal);
+					if (n > 0) contourPrimitive_.defineIndices(lastVertex, vertex);
+					lastVertex = vertex;
+				}
+			}
+		}
+	}
+}
+
+// Return contour primitive
+Primitive& ViewPane::contourPrimitive()
+{
+	return contourPrimitive_;
+}
+
 // Return bounding box primitive
 Primitive& ViewPane::boundingBoxPrimitive()
 {
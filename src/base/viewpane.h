@@ -26,6 +26,7 @@
 #include "base/collection.h"
 #include "base/targetdata.h"
 #include "base/signal.h"
+#include "render/pickingindex.h"
 #include "math/matrix.h"
 #include "templates/list.h"
 #include "templates/reflist.h"
@@ -39,6 +40,36 @@
 // Forward Declarations
 class ViewLayout;
 
+// Solved layout of flat / autostretched view
+class ViewSolution : public ListItem<ViewSolution>
+{
+	public:
+	// Constructor
+	ViewSolution();
+
+	private:
+	// Key describing the inputs from which the solution was found
+	QString key_;
+	// Axis stretch factors
+	Vec3<double> stretch_;
+	// Pixel 'lengths' of axes
+	Vec3<double> axisPixelLength_;
+	// View translation
+	Vec3<double> viewTranslation_;
+
+	public:
+	// Set solution data
+	void set(QString key, Vec3<double> stretch, Vec3<double> axisPixelLength, Vec3<double> viewTranslation);
+	// Return key describing the inputs from which the solution was found
+	QString key() const;
+	// Return axis stretch factors
+	Vec3<double> stretch() const;
+	// Return pixel 'lengths' of axes
+	Vec3<double> axisPixelLength() const;
+	// Return view translation
+	Vec3<double> viewTranslation() const;
+};
+
 // ViewPane
 class ViewPane : public ListItem<ViewPane>, public ObjectStore<ViewPane>
 {
@@ -200,10 +231,16 @@ class ViewPane : public ListItem<ViewPane>, public ObjectStore<ViewPane>
 	int viewAxesUsedAt_;
 	// Viewport version at which view matrix was last calculated
 	int viewViewportUsedAt_;
+	// Recently-used view layout solutions, most recent first
+	List<ViewSolution> viewSolutions_;
+	// Pixel overhang of labels and titles beyond each axis at the last solution, used to seed the next
+	Vec3<double> viewOverhang_;
 
 	private:
 	// Return calculated projection matrix
 	Matrix calculateProjectionMatrix(bool hasPerspective, double orthoZoom = 0.0) const;
+	// Return key describing all inputs to the current view layout solution
+	QString viewSolutionKey();
 	// Update primitive
 	void updatePrimitive(Collection* collection, PrimitiveList& primitive, bool forcePrimitiveUpdate = false, bool dontPopInstance = false);
 
@@ -337,9 +374,15 @@ class ViewPane : public ListItem<ViewPane>, public ObjectStore<ViewPane>
 	/*
 	 * Interaction
 	 */
+	private:
+	// Spatial index of displayed primitives, used for object picking
+	PickingIndex pickingIndex_;
+
 	public:
 	// Return axis title at specified coordinates (if any)
 	int axisTitleAt(int screenX, int screenY);
+	// Return spatial index of displayed primitives
+	PickingIndex& pickingIndex();
 
 
 	/*
@@ -348,6 +391,8 @@ class ViewPane : public ListItem<ViewPane>, public ObjectStore<ViewPane>
 	private:
 	// Display primitives
 	Primitive interactionPrimitive_, interactionBoxPrimitive_, boundingBoxPrimitive_;
+	// Contour lines for slices at fixed Y through collections displayed in this pane
+	Primitive contourPrimitive_;
 
 	public:
 	// Create bounding box
@@ -358,6 +403,10 @@ class ViewPane : public ListItem<ViewPane>, public ObjectStore<ViewPane>
 	Primitive& interactionPrimitive();
 	// Return interaction box primitive
 	Primitive& interactionBoxPrimitive();
+	// Update contour primitive from current slices (at specified Y value) of collections displayed in this pane
+	void updateContourPrimitive(double level);
+	// Return contour primitive
+	Primitive& contourPrimitive();
 	// Return bounding box primitive
 	Primitive& boundingBoxPrimitive();
 
@@ -0,0 +1,91 @@
+/*
+	*** Analyse - Statistics Dialog
+	*** src/gui/analyse_statistics.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_ANALYSE_STATISTICS_H
+#define UCHROMA_ANALYSE_STATISTICS_H
+
+#include "gui/ui_analyse_statistics.h"
+#include <QDialog>
+#include <QObject>
+
+// Forward Declarations
+class Collection;
+class Statistics;
+
+/*
+ * Statistics Dialog
+ */
+class AnalyseStatisticsDialog : public QDialog
+{
+	Q_OBJECT
+
+	public:
+	// Constructor
+	AnalyseStatisticsDialog(QWidget* parent);
+	// Destructor
+	~AnalyseStatisticsDialog();
+	// Main form declaration
+	Ui::AnalyseStatisticsDialog ui;
+
+
+	/*
+	 * Local Variables
+	 */
+	private:
+	// Whether window is currently refreshing
+	bool refreshing_;
+	// Collection whose statistics are shown
+	Collection* targetCollection_;
+
+
+	/*
+	 * Slots
+	 */
+	public slots:
+	void on_XRangeMinSpin_valueChanged(double value);
+	void on_XRangeMaxSpin_valueChanged(double value);
+	void on_ZRangeMinSpin_valueChanged(double value);
+	void on_ZRangeMaxSpin_valueChanged(double value);
+	void on_HistogramBinsSpin_valueChanged(int value);
+	void on_FullRangeButton_clicked(bool checked);
+	void on_StatisticsTable_currentCellChanged(int row, int column, int previousRow, int previousColumn);
+	void on_CloseButton_clicked(bool checked);
+
+
+	/*
+	 * Update / Show
+	 */
+	private:
+	// Set ranges to include all data in target collection
+	void setFullRange();
+	// Add row of statistics to table
+	void addStatisticsRow(int row, QString name, const Statistics& statistics);
+	// Update statistics table
+	void updateStatistics();
+	// Update histogram table for selected row of statistics table
+	void updateHistogram();
+
+	public:
+	// Show dialog, targetting specified collection
+	bool updateAndExec(Collection* targetCollection);
+};
+
+#endif
@@ -0,0 +1,231 @@
+/*
+	*** Analyse - Statistics Functions
+	*** src/gui/analyse_statistics_funcs.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gui/analyse_statistics.h"
+#include "base/collection.h"
+#include "base/statistics.h"
+#include <algorithm>
+
+// Constructor
+AnalyseStatisticsDialog::AnalyseStatisticsDialog(QWidget* parent) : QDialog(parent)
+{
+	ui.setupUi(this);
+
+	refreshing_ = false;
+	targetCollection_ = NULL;
+
+	// Set table headers
+	QStringList headerItems;
+	headerItems << "DataSet" << "Z" << "Count" << "Minimum" << "Maximum" << "Mean" << "Std. Dev." << "Median" << "5%" << "95%";
+	ui.StatisticsTable->setColumnCount(headerItems.count());
+	ui.StatisticsTable->setHorizontalHeaderLabels(headerItems);
+	headerItems.clear();
+	headerItems << "From" << "To" << "Count";
+	ui.HistogramTable->setColumnCount(headerItems.count());
+	ui.HistogramTable->setHorizontalHeaderLabels(headerItems);
+}
+
+// Destructor
+AnalyseStatisticsDialog::~AnalyseStatisticsDialog()
+{
+}
+
+/*
+ * Slots
+ */
+
+void AnalyseStatisticsDialog::on_XRangeMinSpin_valueChanged(double value)
+{
+	if (refreshing_) return;
+
+	updateStatistics();
+}
+
+void AnalyseStatisticsDialog::on_XRangeMaxSpin_valueChanged(double value)
+{
+	if (refreshing_) return;
+
+	updateStatistics();
+}
+
+void AnalyseStatisticsDialog::on_ZRangeMinSpin_valueChanged(double value)
+{
+	if (refreshing_) return;
+
+	updateStatistics();
+}
+
+void AnalyseStatisticsDialog::on_ZRangeMaxSpin_valueChanged(double value)
+{
+	if (refreshing_) return;
+
+	updateStatistics();
+}
+
+void AnalyseStatisticsDialog::on_HistogramBinsSpin_valueChanged(int value)
+{
+	if (refreshing_) return;
+
+	updateStatistics();
+}
+
+void AnalyseStatisticsDialog::on_FullRangeButton_clicked(bool checked)
+{
+	setFullRange();
+
+	updateStatistics();
+}
+
+void AnalyseStatisticsDialog::on_StatisticsTable_currentCellChanged(int row, int column, int previousRow, int previousColumn)
+{
+	if (refreshing_) return;
+
+	updateHistogram();
+}
+
+void AnalyseStatisticsDialog::on_CloseButton_clicked(bool checked)
+{
+	accept();
+}
+
+/*
+ * Update / Show
+ */
+
+// Set ranges to include all data in target collection
+void AnalyseStatisticsDialog::setFullRange()
+{
+	refreshing_ = true;
+
+	const Array<double>& abscissa = targetCollection_->displayAbscissa();
+	ui.XRangeMinSpin->setValue(abscissa.nItems() == 0 ? 0.0 : abscissa.first());
+	ui.XRangeMaxSpin->setValue(abscissa.nItems() == 0 ? 0.0 : abscissa.last());
+
+	double zMin = 0.0, zMax = 0.0;
+	DisplayDataSet* dataSet = targetCollection_->displayData().first();
+	if (dataSet)
+	{
+		zMin = dataSet->z();
+		zMax = dataSet->z();
+		for (dataSet = dataSet->next; dataSet != NULL; dataSet = dataSet->next)
+		{
+			if (dataSet->z() < zMin) zMin = dataSet->z();
+			else if (dataSet->z() > zMax) zMax = dataSet->z();
+		}
+	}
+	ui.ZRangeMinSpin->setValue(zMin);
+	ui.ZRangeMaxSpin->setValue(zMax);
+
+	refreshing_ = false;
+}
+
+// Add row of statistics to table
+void AnalyseStatisticsDialog::addStatisticsRow(int row, QString name, const Statistics& statistics)
+{
+	QTableWidgetItem* item;
+	int column = 0;
+
+	item = new QTableWidgetItem(name);
+	ui.StatisticsTable->setItem(row, column++, item);
+	item = new QTableWidgetItem(row == 0 ? QString() : QString::number(statistics.z()));
+	ui.StatisticsTable->setItem(row, column++, item);
+	item = new QTableWidgetItem(QString::number(statistics.nValues()));
+	ui.StatisticsTable->setItem(row, column++, item);
+	if (statistics.nValues() == 0) return;
+
+	double values[] = { statistics.minimum(), statistics.maximum(), statistics.mean(), statistics.standardDeviation(), statistics.median(), statistics.percentile(5.0), statistics.percentile(95.0) };
+	for (int n=0; n<7; ++n)
+	{
+		item = new QTableWidgetItem(QString::number(values[n], 'e'));
+		ui.StatisticsTable->setItem(row, column++, item);
+	}
+}
+
+// Update statistics table
+void AnalyseStatisticsDialog::updateStatistics()
+{
+	refreshing_ = true;
+
+	const CollectionStatistics& statistics = StatisticsEngine::statistics(targetCollection_, ui.XRangeMinSpin->value(), ui.XRangeMaxSpin->value(), ui.ZRangeMinSpin->value(), ui.ZRangeMaxSpin->value(), ui.HistogramBinsSpin->value());
+
+	// Keep the same row selected, if possible
+	int currentRow = std::max(ui.StatisticsTable->currentRow(), 0);
+
+	// First row contains statistics over all data in range, followed by those for individual datasets
+	ui.StatisticsTable->clearContents();
+	ui.StatisticsTable->setRowCount(statistics.nSlices() + 1);
+	addStatisticsRow(0, "All", statistics.total());
+	int slice = 0;
+	for (Statistics* sliceStatistics = statistics.slices(); sliceStatistics != NULL; sliceStatistics = sliceStatistics->next, ++slice)
+	{
+		DataSet* dataSet = targetCollection_->dataSet(statistics.displayDataSetIndex(slice));
+		addStatisticsRow(slice+1, dataSet ? dataSet->name() : QString::number(statistics.displayDataSetIndex(slice)+1), *sliceStatistics);
+	}
+	ui.StatisticsTable->setCurrentCell(std::min(currentRow, statistics.nSlices()), 0);
+
+	refreshing_ = false;
+
+	updateHistogram();
+}
+
+// Update histogram table for selected row of statistics table
+void AnalyseStatisticsDialog::updateHistogram()
+{
+	ui.HistogramTable->clearContents();
+
+	// Statistics are cached, so this simply retrieves those already shown in the statistics table
+	const CollectionStatistics& statistics = StatisticsEngine::statistics(targetCollection_, ui.XRangeMinSpin->value(), ui.XRangeMaxSpin->value(), ui.ZRangeMinSpin->value(), ui.ZRangeMaxSpin->value(), ui.HistogramBinsSpin->value());
+	int row = ui.StatisticsTable->currentRow();
+	const Statistics* selected = (row < 1 ? &statistics.total() : statistics.displayDataSetStatistics(statistics.displayDataSetIndex(row-1)));
+	if (!selected)
+	{
+		ui.HistogramTable->setRowCount(0);
+		return;
+	}
+
+	const Array<int>& histogram = selected->histogram();
+	double width = selected->histogramBinWidth();
+	QTableWidgetItem* item;
+	ui.HistogramTable->setRowCount(histogram.nItems());
+	for (int bin=0; bin<histogram.nItems(); ++bin)
+	{
+		item = new QTableWidgetItem(QString::number(selected->histogramMinimum() + bin*width, 'e'));
+		ui.HistogramTable->setItem(bin, 0, item);
+		item = new QTableWidgetItem(QString::number(selected->histogramMinimum() + (bin+1)*width, 'e'));
+		ui.HistogramTable->setItem(bin, 1, item);
+		item = new QTableWidgetItem(QString::number(histogram.value(bin)));
+		ui.HistogramTable->setItem(bin, 2, item);
+	}
+}
+
+// Show dialog, targetting specified collection
+bool AnalyseStatisticsDialog::updateAndExec(Collection* targetCollection)
+{
+	targetCollection_ = targetCollection;
+	if (!Collection::objectValid(targetCollection_, "target collection in AnalyseStatisticsDialog::updateAndExec()")) return false;
+
+	setWindowTitle("Statistics ("+targetCollection_->name()+")");
+
+	setFullRange();
+	updateStatistics();
+
+	return exec();
+}
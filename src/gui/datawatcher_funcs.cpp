@@ -0,0 +1,454 @@
+/*
+	*** Data Watcher
+	*** src/gui/datawatcher_funcs.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gui/datawatcher.hui"
+#include "base/collection.h"
+#include "base/messenger.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRegExp>
+
+/*
+ * Data Watcher Worker
+ */
+
+// Constructor
+DataWatcherWorker::DataWatcherWorker(DataWatcher& watcher, bool sequentialXY, QString path, QStringList nameFilters, Vec3<int> columns, int nStartSkip) : QObject(), watcher_(watcher)
+{
+	sequentialXY_ = sequentialXY;
+	path_ = path;
+	nameFilters_ = nameFilters;
+	columns_ = columns;
+	nStartSkip_ = nStartSkip;
+
+	fileOffset_ = 0;
+	nFileSlices_ = 0;
+	nLinesToSkip_ = nStartSkip_;
+	lastFileSize_ = -1;
+	reportedOffset_ = 0;
+}
+
+// Read two-column XY data from specified file into dataset
+bool DataWatcherWorker::readXYFile(QString fileName, DataSet* dataSet, QStringList& messages)
+{
+	// Messenger output is not thread-safe, so any messages are passed back to the watcher to print
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		messages << QString("Couldn't open file '%1' for reading.").arg(fileName);
+		return false;
+	}
+
+	dataSet->setName(QFileInfo(fileName).fileName());
+	dataSet->setDataSource(DataSet::FileSource);
+	dataSet->setSourceFileName(fileName);
+
+	QRegExp delimiters("[\\s,]+");
+	QStringList args;
+	while (!file.atEnd())
+	{
+		args = QString::fromLatin1(file.readLine()).split(delimiters, QString::SkipEmptyParts);
+		if (args.count() == 0) continue;
+		if (args.count() < 2)
+		{
+			messages << QString("Error reading from file '%1'.").arg(fileName);
+			return false;
+		}
+
+		dataSet->addPoint(args.at(0).toDouble(), args.at(1).toDouble());
+	}
+
+	messages << QString("Loaded %1 points from file '%2'.").arg(dataSet->data().nPoints()).arg(fileName);
+
+	return true;
+}
+
+// Check watched directory for new files
+void DataWatcherWorker::scanDirectory()
+{
+	List<DataSet> newDataSets;
+	QStringList messages;
+	bool rescanRequired = false;
+
+	QDir directory(path_);
+	QFileInfoList files = directory.entryInfoList(nameFilters_, QDir::Files, QDir::Name);
+	foreach (const QFileInfo& fileInfo, files)
+	{
+		QString fileName = fileInfo.absoluteFilePath();
+		if (readFiles_.contains(fileName)) continue;
+
+		// Only read a file once it is the same size as it was at the last scan, so we don't catch it half-written
+		qint64 size = fileInfo.size();
+		if ((size == 0) || (!pendingFileSizes_.contains(fileName)) || (pendingFileSizes_.value(fileName) != size))
+		{
+			pendingFileSizes_[fileName] = size;
+			rescanRequired = true;
+			continue;
+		}
+		pendingFileSizes_.remove(fileName);
+		readFiles_.insert(fileName);
+
+		DataSet* dataSet = newDataSets.add();
+		if (!readXYFile(fileName, dataSet, messages)) newDataSets.remove(dataSet);
+	}
+
+	watcher_.addPending(newDataSets, messages, rescanRequired);
+}
+
+// Read any new, complete slices from sequential XY file
+void DataWatcherWorker::scanFile()
+{
+	List<DataSet> newDataSets;
+	QStringList messages;
+
+	QFile file(path_);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		messages << QString("Couldn't open watched file '%1' for reading.").arg(path_);
+		watcher_.addPending(newDataSets, messages, false);
+		return;
+	}
+
+	// If the file has shrunk, assume it has been replaced and start again from the beginning
+	qint64 size = file.size();
+	if (size < fileOffset_)
+	{
+		messages << QString("Watched file '%1' has been truncated - reading it again from the start.").arg(path_);
+		fileOffset_ = 0;
+		nFileSlices_ = 0;
+		nLinesToSkip_ = nStartSkip_;
+		reportedOffset_ = 0;
+	}
+	bool settled = (size == lastFileSize_);
+	lastFileSize_ = size;
+
+	// Read all new data since last time
+	QByteArray bytes;
+	if ((size > fileOffset_) && file.seek(fileOffset_)) bytes = file.read(size - fileOffset_);
+	file.close();
+
+	// Parse complete lines, using the same rules as ImportDialog::importSequentialXY() - slices are separated by blank lines.
+	// A slice is only taken once it is followed by a blank line, or once the file has stopped growing.
+	QRegExp delimiters("[\\s,]+");
+	QStringList args;
+	int maxColumn = columns_.max();
+	int lineStart = 0, lineEnd, consumed = 0, nPoints = 0;
+	DataSet* dataSet = NULL;
+	while ((lineEnd = bytes.indexOf('\n', lineStart)) != -1)
+	{
+		args = QString::fromLatin1(bytes.constData() + lineStart, lineEnd - lineStart).split(delimiters, QString::SkipEmptyParts);
+		lineStart = lineEnd + 1;
+
+		// Skip lines at start of file
+		if (nLinesToSkip_ > 0)
+		{
+			--nLinesToSkip_;
+			consumed = lineStart;
+			continue;
+		}
+
+		// Is there anything on this line? If not, the current slice (if any) is complete
+		if (args.count() == 0)
+		{
+			if (dataSet)
+			{
+				++nFileSlices_;
+				dataSet = NULL;
+				nPoints = 0;
+			}
+			consumed = lineStart;
+			continue;
+		}
+
+		// Check requested columns against available columns
+		// -- Lines within an incomplete slice are read again at the next scan, so each bad line is only reported once, and is skipped for good if no slice is in progress
+		if (maxColumn >= args.count())
+		{
+			if ((fileOffset_ + lineStart) > reportedOffset_)
+			{
+				messages << QString("Not enough columns in file '%1'.").arg(path_);
+				reportedOffset_ = fileOffset_ + lineStart;
+			}
+			if (!dataSet) consumed = lineStart;
+			continue;
+		}
+
+		// Start new slice if necessary, and add datapoint
+		if (!dataSet)
+		{
+			dataSet = newDataSets.add();
+			dataSet->setName(QString("%1 (%2)").arg(QFileInfo(path_).fileName()).arg(nFileSlices_+1));
+			dataSet->setZ(nFileSlices_);
+		}
+		dataSet->addPoint(columns_.x == -1 ? nPoints : args.at(columns_.x).toDouble(), args.at(columns_.y).toDouble());
+		if (columns_.z != -1) dataSet->setZ(args.at(columns_.z).toDouble());
+		++nPoints;
+	}
+
+	// Deal with a trailing slice not yet followed by a blank line - keep it if the file has settled, otherwise read it again next time
+	if (dataSet)
+	{
+		if (settled && (lineStart == bytes.size()))
+		{
+			++nFileSlices_;
+			consumed = lineStart;
+		}
+		else newDataSets.remove(dataSet);
+	}
+	fileOffset_ += consumed;
+
+	watcher_.addPending(newDataSets, messages, consumed != bytes.size());
+}
+
+// Check source for new data
+void DataWatcherWorker::scan()
+{
+	if (sequentialXY_) scanFile();
+	else scanDirectory();
+}
+
+/*
+ * Data Watcher
+ */
+
+// Constructor
+DataWatcher::DataWatcher(QObject* parent) : QObject(parent)
+{
+	collection_ = NULL;
+	mode_ = DataWatcher::DirectoryMode;
+	columns_.set(0, 1, -1);
+	nStartSkip_ = 0;
+	batchInterval_ = 2000;
+	worker_ = NULL;
+	rescanRequired_ = false;
+
+	connect(&fileSystemWatcher_, SIGNAL(directoryChanged(QString)), this, SLOT(pathChanged(QString)));
+	connect(&fileSystemWatcher_, SIGNAL(fileChanged(QString)), this, SLOT(pathChanged(QString)));
+	connect(&batchTimer_, SIGNAL(timeout()), this, SLOT(appendPending()));
+}
+
+// Destructor
+DataWatcher::~DataWatcher()
+{
+	stop();
+}
+
+/*
+ * Setup
+ */
+
+// Set name filters for files in watched directory
+void DataWatcher::setNameFilters(QStringList nameFilters)
+{
+	nameFilters_ = nameFilters;
+}
+
+// Set columns to use for x, y, and z data in sequential XY file
+void DataWatcher::setColumns(Vec3<int> columns)
+{
+	columns_ = columns;
+}
+
+// Set number of lines to skip at start of sequential XY file
+void DataWatcher::setStartSkip(int nStartSkip)
+{
+	nStartSkip_ = nStartSkip;
+}
+
+// Set interval (in ms) at which new data is appended to the collection
+void DataWatcher::setBatchInterval(int interval)
+{
+	batchInterval_ = interval;
+
+	if (batchTimer_.isActive()) batchTimer_.start(batchInterval_);
+}
+
+// Return interval (in ms) at which new data is appended to the collection
+int DataWatcher::batchInterval() const
+{
+	return batchInterval_;
+}
+
+// Start watching specified directory or file, appending new data to the collection given
+bool DataWatcher::start(Collection* collection, DataWatcher::WatchMode mode, QString path)
+{
+	stop();
+
+	if (!Collection::objectValid(collection, "collection in DataWatcher::start()")) return false;
+
+	QFileInfo fileInfo(path);
+	if ((mode == DataWatcher::DirectoryMode) && (!fileInfo.isDir()))
+	{
+		msg.print("Error: Can't watch '%s' - it is not a directory.\n", qPrintable(path));
+		return false;
+	}
+	else if ((mode == DataWatcher::SequentialXYMode) && (!fileInfo.isFile()))
+	{
+		msg.print("Error: Can't watch '%s' - it is not a file.\n", qPrintable(path));
+		return false;
+	}
+
+	collection_ = collection;
+	mode_ = mode;
+	path_ = fileInfo.absoluteFilePath();
+
+	// Create worker and start its thread
+	worker_ = new DataWatcherWorker(*this, mode_ == DataWatcher::SequentialXYMode, path_, nameFilters_, columns_, nStartSkip_);
+	worker_->moveToThread(&workerThread_);
+	connect(this, SIGNAL(scanRequested()), worker_, SLOT(scan()));
+	workerThread_.start();
+
+	// Watch path, and start batch timer
+	fileSystemWatcher_.addPath(path_);
+	batchTimer_.start(batchInterval_);
+
+	msg.print("Watching %s '%s' for new data (appending every %i ms).\n", mode_ == DataWatcher::DirectoryMode ? "directory" : "file", qPrintable(path_), batchInterval_);
+
+	// Read any existing data
+	emit(scanRequested());
+
+	return true;
+}
+
+// Stop watching
+void DataWatcher::stop()
+{
+	if (!worker_) return;
+
+	batchTimer_.stop();
+	if (!fileSystemWatcher_.files().isEmpty()) fileSystemWatcher_.removePaths(fileSystemWatcher_.files());
+	if (!fileSystemWatcher_.directories().isEmpty()) fileSystemWatcher_.removePaths(fileSystemWatcher_.directories());
+
+	// Stop the worker thread - once it has finished, the worker can be safely deleted
+	workerThread_.quit();
+	workerThread_.wait();
+	delete worker_;
+	worker_ = NULL;
+
+	// Discard anything not yet appended
+	QMutexLocker locker(&pendingMutex_);
+	pendingDataSets_.clear();
+	pendingMessages_.clear();
+	rescanRequired_ = false;
+
+	msg.print("Stopped watching '%s'.\n", qPrintable(path_));
+}
+
+// Return whether we are currently watching
+bool DataWatcher::watching() const
+{
+	return (worker_ != NULL);
+}
+
+// Return target collection
+Collection* DataWatcher::collection() const
+{
+	return collection_;
+}
+
+// Return watched path
+QString DataWatcher::path() const
+{
+	return path_;
+}
+
+/*
+ * Ingestion
+ */
+
+// Add new datasets and messages from the worker (called from the worker thread)
+void DataWatcher::addPending(List<DataSet>& dataSets, QStringList& messages, bool rescanRequired)
+{
+	QMutexLocker locker(&pendingMutex_);
+
+	DataSet* dataSet;
+	while ((dataSet = dataSets.first()) != NULL)
+	{
+		dataSets.disown(dataSet);
+		pendingDataSets_.own(dataSet);
+	}
+	pendingMessages_ << messages;
+	if (rescanRequired) rescanRequired_ = true;
+}
+
+// Watched directory or file has changed
+void DataWatcher::pathChanged(const QString& path)
+{
+	// A file which is replaced (rather than written to) is no longer watched, so add it again
+	if ((mode_ == DataWatcher::SequentialXYMode) && (!fileSystemWatcher_.files().contains(path_)) && QFile::exists(path_)) fileSystemWatcher_.addPath(path_);
+
+	emit(scanRequested());
+}
+
+// Append any pending datasets to the collection
+void DataWatcher::appendPending()
+{
+	// Take everything the worker has read since the last batch
+	List<DataSet> newDataSets;
+	QStringList messages;
+	bool rescanRequired;
+	pendingMutex_.lock();
+	DataSet* dataSet;
+	while ((dataSet = pendingDataSets_.first()) != NULL)
+	{
+		pendingDataSets_.disown(dataSet);
+		newDataSets.own(dataSet);
+	}
+	messages = pendingMessages_;
+	pendingMessages_.clear();
+	rescanRequired = rescanRequired_;
+	rescanRequired_ = false;
+	pendingMutex_.unlock();
+
+	foreach (const QString& message, messages) msg.print("%s\n", qPrintable(message));
+
+	// If the worker is waiting on incomplete files, ask it to check them again
+	if (rescanRequired) emit(scanRequested());
+
+	if (newDataSets.nItems() == 0) return;
+
+	// Check the collection still exists
+	if (!Collection::objectValid(collection_, "collection in DataWatcher::appendPending()"))
+	{
+		stop();
+		return;
+	}
+
+	// Datasets from individual files are placed at increasing z, as in Collection::appendDataSet()
+	if (mode_ == DataWatcher::DirectoryMode)
+	{
+		double z = (collection_->nDataSets() > 0 ? collection_->lastDataSet()->data().z() + 1.0 : 0.0);
+		for (dataSet = newDataSets.first(); dataSet != NULL; dataSet = dataSet->next)
+		{
+			dataSet->setZ(z);
+			dataSet->setSourceFileName(collection_->dataFileDirectory().relativeFilePath(dataSet->sourceFileName()));
+			z += 1.0;
+		}
+	}
+
+	// Append all new datasets in one go, so derived data is only updated once per batch
+	int nAppended = collection_->appendDataSets(newDataSets);
+	msg.print(Messenger::Verbose, "Appended %i new dataset(s) to collection '%s'.\n", nAppended, qPrintable(collection_->name()));
+
+	emit(dataAppended(nAppended));
+}
@@ -265,6 +265,7 @@ void EditFitKernelDialog::updateReferencesTable()
 		if (refVar->zIndex().type() == IndexData::NormalIndex) s += "Z=norm]";
 		else if (refVar->zIndex().type() == IndexData::FixedIndex) s += "Z=fixed("+QString::number(refVar->zIndex().index()+1)+")]";
 		else if (refVar->zIndex().type() == IndexData::RelativeIndex) s += "Z=rel("+QString::number(refVar->zIndex().offset())+")]";
+		if (refVar->statistic() != Statistics::NoStatistic) s += " " + QString(Statistics::statistic(refVar->statistic()));
 		item->setText(s);
 		item->setData(Qt::UserRole, VariantPointer<ReferenceVariable>(refVar));
 		ui.VariableReferenceList->addItem(item);
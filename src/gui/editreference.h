@@ -86,6 +86,7 @@ class EditReferenceDialog : public QDialog
 	void on_ZRelativeRadio_clicked(bool checked);
 	void on_ZRelativeSpin_valueChanged(int value);	
 	void on_ZDataSetCombo_currentIndexChanged(int index);
+	void on_StatisticCombo_currentIndexChanged(int index);
 
 
 	private:
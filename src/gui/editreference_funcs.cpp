@@ -105,6 +105,8 @@ bool EditReferenceDialog::call(ReferenceVariable* target, FitKernel* parentKerne
 	ui.ZDataSetCombo->setCurrentIndex(reference_.zIndex().index());
 	ui.ZRelativeSpin->setValue(reference_.zIndex().index());
 	ui.ZRelativeSpin->setRange(-nZ, nZ);
+	// -- Statistic
+	ui.StatisticCombo->setCurrentIndex(reference_.statistic());
 
 	refreshing_ = false;
 
@@ -281,6 +283,13 @@ void EditReferenceDialog::on_ZRelativeSpin_valueChanged(int value)
 	updateLabels();
 }
 
+void EditReferenceDialog::on_StatisticCombo_currentIndexChanged(int index)
+{
+	if (refreshing_) return;
+
+	reference_.setStatistic((Statistics::Statistic) index);
+}
+
 // Update labels
 void EditReferenceDialog::updateLabels()
 {
@@ -0,0 +1,395 @@
+/*
+	*** Headless Renderer
+	*** src/gui/headless.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gui/headless.h"
+#include "gui/viewer.hui"
+#include "session/session.h"
+#include "session/pipeline.h"
+#include "render/fontinstance.h"
+#include "base/messenger.h"
+#include "base/lineparser.h"
+#include "base/datacache.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QStringList>
+#include <string.h>
+
+// Static Members
+Viewer* HeadlessRenderer::viewer_ = NULL;
+QString HeadlessRenderer::fontFileName_;
+bool HeadlessRenderer::fontSetup_ = false;
+int HeadlessRenderer::maxTileSize_ = 2048;
+const int HeadlessRenderer::referenceWidth_ = 1024;
+const int HeadlessRenderer::referenceHeight_ = 768;
+QString HeadlessRenderer::sessionFile_;
+QDateTime HeadlessRenderer::sessionFileModified_;
+
+/*
+ * Setup
+ */
+
+// Initialise offscreen rendering
+bool HeadlessRenderer::initialise()
+{
+	if (viewer_) return true;
+
+	// Create a Viewer which we never show, and set it up for offscreen rendering only
+	viewer_ = new Viewer(NULL);
+	if (!viewer_->initialiseOffscreen(referenceWidth_, referenceHeight_))
+	{
+		msg.print("Error: Failed to initialise offscreen rendering.\n");
+		delete viewer_;
+		viewer_ = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+// Finalise, releasing offscreen resources
+void HeadlessRenderer::finalise()
+{
+	if (viewer_) delete viewer_;
+	viewer_ = NULL;
+}
+
+// Set maximum tile size to use when rendering
+void HeadlessRenderer::setMaxTileSize(int size)
+{
+	maxTileSize_ = size;
+}
+
+/*
+ * Rendering
+ */
+
+// Load session from file specified, unless it is already loaded and unchanged
+bool HeadlessRenderer::loadSession(QString fileName)
+{
+	// Is this the session we already have?
+	QFileInfo fileInfo(fileName);
+	if ((fileInfo.absoluteFilePath() == sessionFile_) && (fileInfo.lastModified() == sessionFileModified_))
+	{
+		msg.print(Messenger::Verbose, "Session '%s' is already loaded.\n", qPrintable(fileName));
+		return true;
+	}
+
+	msg.print("Loading session '%s'...\n", qPrintable(fileName));
+	sessionFile_.clear();
+	if (!UChromaSession::loadSession(fileName)) return false;
+	sessionFile_ = fileInfo.absoluteFilePath();
+	sessionFileModified_ = fileInfo.lastModified();
+
+	// Set up the font requested by the session, unless it is the one we already have
+	if ((!fontSetup_) || (fontFileName_ != UChromaSession::viewerFontFileName()))
+	{
+		fontFileName_ = UChromaSession::viewerFontFileName();
+		fontSetup_ = FontInstance::setup(fontFileName_);
+		if (!fontSetup_) msg.print("Warning: Failed to setup font '%s' - text will not be rendered.\n", qPrintable(fontFileName_));
+	}
+
+	return true;
+}
+
+// Render current session (or only the named pane) to the image file specified
+bool HeadlessRenderer::renderImage(QString fileName, int width, int height, QString paneName)
+{
+	if (!initialise()) return false;
+
+	// Find target pane, if one was specified
+	ViewPane* pane = NULL;
+	if (!paneName.isEmpty())
+	{
+		pane = UChromaSession::viewLayout().pane(paneName);
+		if (!pane)
+		{
+			msg.print("Error: No pane named '%s' exists in the current session.\n", qPrintable(paneName));
+			return false;
+		}
+	}
+
+	// If no size was given, use the image export size stored in the session
+	if ((width <= 0) || (height <= 0))
+	{
+		width = UChromaSession::imageExportWidth();
+		height = UChromaSession::imageExportHeight();
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// Generate the image
+	QPixmap pixmap = viewer_->generateImage(width, height, maxTileSize_, pane);
+	if (pixmap.isNull())
+	{
+		msg.print("Error: Failed to render image '%s'.\n", qPrintable(fileName));
+		return false;
+	}
+	qint64 renderTime = timer.elapsed();
+
+	// Release any deferred data in excess of the budget
+	DataCache::enforceBudget();
+
+	// Save the image - if the filename has no suffix, use the image export format stored in the session
+	bool result;
+	if (QFileInfo(fileName).suffix().isEmpty()) result = pixmap.save(fileName, UChromaSession::imageFormatExtension(UChromaSession::imageExportFormat()), -1);
+	else result = pixmap.save(fileName);
+	if (!result)
+	{
+		msg.print("Error: Failed to save image '%s'.\n", qPrintable(fileName));
+		return false;
+	}
+
+	msg.print("Rendered image '%s' (%ix%i) in %.3f s (%.3f s including save).\n", qPrintable(fileName), width, height, renderTime*0.001, timer.elapsed()*0.001);
+
+	return true;
+}
+
+// Render all jobs in the specified batch manifest
+bool HeadlessRenderer::renderBatch(QString manifestFile)
+{
+	/*
+	 * Each non-blank line in the manifest describes a single job:
+	 *
+	 *   <session.ucr>  <pane|*>  <W>x<H>|*  <output>
+	 *
+	 * A '*' for the pane renders all panes in the layout, while a '*' for the size uses the export size stored in the session.
+	 * Comments beginning with '#' are ignored. Jobs using the same session should be grouped together, since the session is
+	 * only reloaded when it differs from (or has been modified since) the one used in the previous job.
+	 */
+	LineParser parser(manifestFile);
+	if (!parser.ready())
+	{
+		msg.print("Error: Can't open batch manifest '%s' for reading.\n", qPrintable(manifestFile));
+		return false;
+	}
+
+	if (!initialise()) return false;
+
+	QElapsedTimer totalTimer, jobTimer;
+	totalTimer.start();
+	int nJobs = 0, nFailed = 0;
+	double totalPixels = 0.0;
+	while (!parser.atEnd())
+	{
+		if (!parser.getArgs(LineParser::UseQuotes + LineParser::SkipBlanks + LineParser::StripComments)) break;
+		if (parser.nArgs() == 0) continue;
+		++nJobs;
+		if (parser.nArgs() != 4)
+		{
+			msg.print("Error: Job %i in batch manifest has %i arguments (expected 4) - skipped.\n", nJobs, parser.nArgs());
+			++nFailed;
+			continue;
+		}
+
+		// Parse image size
+		int width = 0, height = 0;
+		if (parser.argString(2) != "*")
+		{
+			QStringList parts = parser.argString(2).split('x');
+			if (parts.count() == 2)
+			{
+				width = parts.at(0).toInt();
+				height = parts.at(1).toInt();
+			}
+			if ((width <= 0) || (height <= 0))
+			{
+				msg.print("Error: Invalid image size '%s' for job %i - skipped.\n", parser.argChar(2), nJobs);
+				++nFailed;
+				continue;
+			}
+		}
+
+		jobTimer.start();
+
+		// Load session (if it differs from the current one)
+		if (!loadSession(parser.argString(0)))
+		{
+			msg.print("Error: Failed to load session for job %i - skipped.\n", nJobs);
+			++nFailed;
+			continue;
+		}
+		qint64 loadTime = jobTimer.elapsed();
+
+		// Render image
+		if (!renderImage(parser.argString(3), width, height, parser.argString(1) == "*" ? QString() : parser.argString(1)))
+		{
+			++nFailed;
+			continue;
+		}
+		if ((width <= 0) || (height <= 0)) totalPixels += double(UChromaSession::imageExportWidth()) * UChromaSession::imageExportHeight();
+		else totalPixels += double(width) * height;
+
+		msg.print("Job %i completed in %.3f s (session load %.3f s).\n", nJobs, jobTimer.elapsed()*0.001, loadTime*0.001);
+	}
+	parser.closeFiles();
+
+	// Print summary
+	double totalTime = totalTimer.elapsed()*0.001;
+	int nSucceeded = nJobs - nFailed;
+	if ((nSucceeded > 0) && (totalTime > 0.0)) msg.print("Batch complete: %i of %i jobs succeeded in %.3f s (%.2f images/s, %.2f Mpixel/s).\n", nSucceeded, nJobs, totalTime, nSucceeded / totalTime, totalPixels * 1.0e-6 / totalTime);
+	else msg.print("Batch complete: %i of %i jobs succeeded in %.3f s.\n", nSucceeded, nJobs, totalTime);
+
+	return (nFailed == 0);
+}
+
+/*
+ * Command-line Operation
+ */
+
+// Return whether headless operation was requested in the supplied arguments
+bool HeadlessRenderer::requested(int argc, char* argv[])
+{
+	for (int n=1; n<argc; ++n) if ((strcmp(argv[n], "-render") == 0) || (strcmp(argv[n], "-batch") == 0) || (strcmp(argv[n], "-process") == 0)) return true;
+	return false;
+}
+
+// Print headless command-line options
+void HeadlessRenderer::printOptions()
+{
+	printf("\nHeadless rendering options (no main window is created):\n\n");
+	printf("\t-render <file.ucr>\tRender the specified session to an image and exit.\n");
+	printf("\t-batch <manifest>\tRender all jobs in the manifest and exit. Each line of the manifest gives\n");
+	printf("\t\t\t\t'<session.ucr> <pane|*> <W>x<H>|* <output>', with '*' meaning all panes / the session's export size.\n");
+	printf("\t-process <pipeline>\tRun the stages in the pipeline file for each input file given after the switches,\n");
+	printf("\t\t\t\tor once if there are none, printing per-stage timings. No rendering is performed.\n");
+	printf("\t-pane <name>\t\tRender only the named pane (with -render).\n");
+	printf("\t-o <file>\t\tOutput image file (default is the export filename stored in the session).\n");
+	printf("\t-size <W>x<H>\t\tImage size (default is the export size stored in the session).\n");
+	printf("\t-tile <N>\t\tMaximum tile size to render in a single pass (default is %i).\n", maxTileSize_);
+	printf("\t-l\t\t\tLoad binary dataset values only when they are required.\n");
+	printf("\t-m <MB>\t\t\tMaximum amount of on-demand dataset values to keep in memory (with -l).\n");
+	Pipeline::printKeywords();
+	printf("\nIf neither QT_QPA_PLATFORM nor DISPLAY are set, the 'offscreen' Qt platform is used.\n");
+	printf("Set LIBGL_ALWAYS_SOFTWARE=1 to force software (e.g. llvmpipe) rendering.\n");
+}
+
+// Run headless operation described by the supplied arguments, returning the exit code
+int HeadlessRenderer::run(int argc, char* argv[])
+{
+	QString sessionFile, imageFile, manifestFile, pipelineFile, paneName;
+	QStringList inputFiles;
+	int width = 0, height = 0;
+
+	// Parse arguments
+	int n = 1;
+	while (n < argc)
+	{
+		QString arg = argv[n];
+
+		// All recognised switches take a single argument, except for the -a, -l, and -v flags. Other non-switch arguments are input files (for -process)
+		if (arg == "-a") UChromaSession::setHardIOFail(true);
+		else if (arg == "-l") UChromaSession::setLazyLoading(true);
+		else if (arg == "-v") msg.addOutputType(Messenger::Verbose);
+		else if ((arg == "-render") || (arg == "-batch") || (arg == "-process") || (arg == "-o") || (arg == "-pane") || (arg == "-size") || (arg == "-tile") || (arg == "-m"))
+		{
+			if (n+1 >= argc)
+			{
+				msg.print("Error: Argument expected but none was given for switch '%s'\n", argv[n]);
+				return 1;
+			}
+			QString value = argv[++n];
+
+			if (arg == "-render") sessionFile = value;
+			else if (arg == "-batch") manifestFile = value;
+			else if (arg == "-process") pipelineFile = value;
+			else if (arg == "-o") imageFile = value;
+			else if (arg == "-pane") paneName = value;
+			else if (arg == "-size")
+			{
+				QStringList parts = value.split('x');
+				if (parts.count() == 2)
+				{
+					width = parts.at(0).toInt();
+					height = parts.at(1).toInt();
+				}
+				if ((width <= 0) || (height <= 0))
+				{
+					msg.print("Error: Invalid image size '%s' - expected e.g. '1024x768'.\n", qPrintable(value));
+					return 1;
+				}
+			}
+			else if (arg == "-m") DataCache::setByteBudget(value.toLong() * 1048576);
+			else if (arg == "-tile")
+			{
+				setMaxTileSize(value.toInt());
+				if (maxTileSize_ <= 0)
+				{
+					msg.print("Error: Invalid tile size '%s'.\n", qPrintable(value));
+					return 1;
+				}
+			}
+		}
+		else if (!arg.startsWith('-')) inputFiles << arg;
+		else
+		{
+			msg.print("Unrecognised command-line switch '%s' in headless mode.\n", argv[n]);
+			msg.print("Run with -h to see available switches.\n");
+			return 1;
+		}
+
+		++n;
+	}
+
+	// Start a new, empty session
+	UChromaSession::startNewSession(true);
+	UChromaSession::setSessionFileDirectory(QDir::current());
+
+	// Input files are only accepted by pipeline processing
+	if ((!inputFiles.isEmpty()) && pipelineFile.isEmpty())
+	{
+		msg.print("Error: Input files may only be given with -process.\n");
+		return 1;
+	}
+
+	// Pipeline processing mode?
+	if (!pipelineFile.isEmpty())
+	{
+		if (!Pipeline::read(pipelineFile)) return 1;
+		return Pipeline::runAll(inputFiles);
+	}
+
+	// Batch mode?
+	if (!manifestFile.isEmpty())
+	{
+		bool result = renderBatch(manifestFile);
+		finalise();
+		return (result ? 0 : 1);
+	}
+
+	// Load the specified session file
+	if (!loadSession(sessionFile)) return 1;
+
+	// Determine output filename
+	if (imageFile.isEmpty()) imageFile = UChromaSession::imageExportFileName();
+	if (imageFile.isEmpty())
+	{
+		msg.print("Error: No output image file given, and none is stored in the session.\n");
+		return 1;
+	}
+
+	// Render the image
+	bool result = renderImage(imageFile, width, height, paneName);
+
+	finalise();
+
+	return (result ? 0 : 1);
+}
@@ -0,0 +1,88 @@
+/*
+	*** Headless Renderer
+	*** src/gui/headless.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_HEADLESS_H
+#define UCHROMA_HEADLESS_H
+
+#include <QString>
+#include <QDateTime>
+
+// Forward Declarations
+class Viewer;
+
+// Headless Renderer
+class HeadlessRenderer
+{
+	/*
+	 * Setup
+	 */
+	private:
+	// Viewer used for offscreen rendering (never shown)
+	static Viewer* viewer_;
+	// Font file currently set up
+	static QString fontFileName_;
+	// Whether a font has been set up
+	static bool fontSetup_;
+	// Maximum tile size to use when rendering
+	static int maxTileSize_;
+	// Reference width and height against which line widths and text sizes are scaled
+	static const int referenceWidth_, referenceHeight_;
+
+	public:
+	// Initialise offscreen rendering
+	static bool initialise();
+	// Finalise, releasing offscreen resources
+	static void finalise();
+	// Set maximum tile size to use when rendering
+	static void setMaxTileSize(int size);
+
+
+	/*
+	 * Rendering
+	 */
+	private:
+	// Absolute path of currently-loaded session file
+	static QString sessionFile_;
+	// Modification time of currently-loaded session file
+	static QDateTime sessionFileModified_;
+
+	public:
+	// Load session from file specified, unless it is already loaded and unchanged
+	static bool loadSession(QString fileName);
+	// Render current session (or only the named pane) to the image file specified
+	static bool renderImage(QString fileName, int width, int height, QString paneName = QString());
+	// Render all jobs in the specified batch manifest
+	static bool renderBatch(QString manifestFile);
+
+
+	/*
+	 * Command-line Operation
+	 */
+	public:
+	// Return whether headless operation was requested in the supplied arguments
+	static bool requested(int argc, char* argv[]);
+	// Print headless command-line options
+	static void printOptions();
+	// Run headless operation described by the supplied arguments, returning the exit code
+	static int run(int argc, char* argv[]);
+};
+
+#endif
@@ -77,6 +77,10 @@ class ImportDialog : public QDialog
 	QString filename();
 	// Return whether a new collection should be created for the imported data
 	bool createNewCollection();
+	// Return columns (x, y, z) selected for sequential XY import (-1 for x or z to use a count instead)
+	Vec3<int> sequentialXYColumns();
+	// Return number of lines to skip at start of file for sequential XY import
+	int sequentialXYStartSkip();
 
 
 	/*
@@ -80,6 +80,18 @@ bool ImportDialog::createNewCollection()
 	return ui.ImportIntoNewCollectionRadio->isChecked();
 }
 
+// Return columns (x, y, z) selected for sequential XY import (-1 for x or z to use a count instead)
+Vec3<int> ImportDialog::sequentialXYColumns()
+{
+	return Vec3<int>(ui.SeqXYColumnXSpin->value()-1, ui.SeqXYColumnYSpin->value()-1,  ui.SeqXYColumnZSpin->value()-1);
+}
+
+// Return number of lines to skip at start of file for sequential XY import
+int ImportDialog::sequentialXYStartSkip()
+{
+	return ui.SeqXYNSkip->value();
+}
+
 /*
  * Private Slots
  */
@@ -29,9 +29,9 @@ bool ImportDialog::importSequentialXY()
 	importedDataSets_.clear();
 
 	// Grab some values from the UI
-	Vec3<int> columns(ui.SeqXYColumnXSpin->value()-1, ui.SeqXYColumnYSpin->value()-1,  ui.SeqXYColumnZSpin->value()-1);
+	Vec3<int> columns = sequentialXYColumns();
 	int maxColumn = columns.max();
-	int nStartSkip = ui.SeqXYNSkip->value();
+	int nStartSkip = sequentialXYStartSkip();
 	
 	// Open file and check that we're OK to proceed reading from it
 	LineParser parser(ui.DataFileEdit->text());
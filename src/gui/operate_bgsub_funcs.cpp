@@ -22,6 +22,7 @@
 #include "gui/operate_bgsub.h"
 #include "gui/uchroma.h"
 #include "base/collection.h"
+#include "base/collectionoperations.h"
 #include "expression/variable.h"
 #include <QFileDialog>
 #include <QMessageBox>
@@ -165,16 +166,15 @@ void OperateBGSubDialog::on_CancelButton_clicked(bool checked)
 
 void OperateBGSubDialog::on_ApplyButton_clicked(bool checked)
 {
-	if (ui.ConstantValueRadio->isChecked()) targetCollection_->addConstantValue(1, -constantValue_);
+	CollectionOperations operations(targetCollection_);
+	if (ui.ConstantValueRadio->isChecked()) operations.offsetY(-constantValue_);
 	else if (ui.AverageOverXRadio->isChecked())
 	{
-		for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next)
-		{
-			double avg = dataSet->averageY(xRangeMin_, xRangeMax_);
-			msg.print("Average level (%e < x  %e) for dataset '%s' is %e\n", xRangeMin_, xRangeMax_, qPrintable(dataSet->name()), avg);
-			dataSet->addConstantValue(1, -avg);
-		}
+		operations.subtractAverageOverX(xRangeMin_, xRangeMax_);
+		int n = 0;
+		for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next, ++n) msg.print("Average level (%e < x  %e) for dataset '%s' is %e\n", xRangeMin_, xRangeMax_, qPrintable(dataSet->name()), operations.lastValues().value(n));
 	}
+	operations.finish();
 // 	else if (ui.AverageOverZRadio->isChecked()) result = setZFromSourceFiles();
 
 	targetCollection_ = NULL;
@@ -21,6 +21,7 @@
 
 #include "gui/operate_setz.h"
 #include "base/collection.h"
+#include "base/collectionoperations.h"
 #include "base/lineparser.h"
 #include "expression/variable.h"
 #include <QFileDialog>
@@ -150,23 +151,24 @@ bool OperateSetZDialog::setZFromEquation()
 {
 	if (!equation_.isValid()) return false;
 
+	// Evaluate all new z values first, and then set them in one go
+	Array<double> zValues;
 	int count = 0;
 	bool success;
 	for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next)
 	{
 		indexVariable_->set(count);
-		zVariable_->set(dataSet->data().z());
-		double newZ = equation_.execute(success);
+		zVariable_->set(dataSet->z());
+		zValues.add(equation_.execute(success));
 		if (!success)
 		{
 			QMessageBox::critical(this, "Expression error", "Failed to run expression");
 			return false;
 		}
-		targetCollection_->setDataSetZ(dataSet, newZ);
 		++count;
 	}
 
-	return true;
+	return CollectionOperations(targetCollection_).setZ(zValues).success();
 }
 
 // Set Z from source files
@@ -180,8 +182,14 @@ bool OperateSetZDialog::setZFromSourceFiles()
 	int nFailed = 0;
 	double earliest = 0.0;
 	QDateTime referenceTime(QDate(1970,1,1)), extractedTime;
+	Array<double> zValues;
+	int index = -1;
 	for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next)
 	{
+		// Datasets for which no new value can be found keep their current z
+		zValues.add(dataSet->z());
+		++index;
+
 		if (dataSet->dataSource() != DataSet::FileSource)
 		{
 			++nFailed;
@@ -213,8 +221,8 @@ bool OperateSetZDialog::setZFromSourceFiles()
 				extractedTime = QDateTime::fromString(sourceFilesRegExp_.cap(1), ui.FromSourceFilesDateTimeEdit->text());
 				if (extractedTime.isValid())
 				{
-					dataSet->setZ(referenceTime.secsTo(extractedTime));
-					if ((earliest == 0) || (dataSet->data().z() < earliest)) earliest = dataSet->data().z();
+					zValues[index] = referenceTime.secsTo(extractedTime);
+					if ((earliest == 0) || (zValues[index] < earliest)) earliest = zValues[index];
 				}
 				else
 				{
@@ -222,15 +230,15 @@ bool OperateSetZDialog::setZFromSourceFiles()
 					++nFailed;
 				}
 			}
-			else targetCollection_->setDataSetZ(dataSet, sourceFilesRegExp_.cap(1).toDouble());
+			else zValues[index] = sourceFilesRegExp_.cap(1).toDouble();
 		}
 	}
 
-	// Offset values if we were using date/time
-	if (ui.FromSourceFilesDateTimeCheck->isChecked())
-	{
-		for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next) targetCollection_->setDataSetZ(dataSet, dataSet->data().z() - earliest);
-	}
+	// Offset values if we were using date/time, and set new values
+	CollectionOperations operations(targetCollection_);
+	operations.setZ(zValues);
+	if (ui.FromSourceFilesDateTimeCheck->isChecked()) operations.offsetZ(-earliest);
+	operations.finish();
 
 	// Any failures?
 	if (nFailed > 0) QMessageBox::warning(this, "Errors encountered", "One or more errors were encountered while processing files. See the Log Window for details.");
@@ -251,6 +259,7 @@ bool OperateSetZDialog::setZFromTimeStamps()
 	QString s;
 	double earliest = 0.0;
 	QDateTime referenceTime(QDate(1970,1,1));
+	Array<double> zValues;
 	for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next)
 	{
 		// Construct filename to search for
@@ -260,15 +269,15 @@ bool OperateSetZDialog::setZFromTimeStamps()
 		if (!fileInfo.exists())
 		{
 			QMessageBox::warning(this, "Failed to Open File", "The file '" + s + "' could not be found.");
-			break;
+			return false;
 		}
-		dataSet->setZ(referenceTime.secsTo(fileInfo.lastModified()));
+		zValues.add(referenceTime.secsTo(fileInfo.lastModified()));
 
-		if ((earliest == 0) || (dataSet->data().z() < earliest)) earliest = dataSet->data().z();
+		if ((earliest == 0) || (zValues.last() < earliest)) earliest = zValues.last();
 	}
 	
-	// Set correct offset
-	for (DataSet* dataSet = targetCollection_->dataSets(); dataSet != NULL; dataSet = dataSet->next) targetCollection_->setDataSetZ(dataSet, dataSet->data().z() - earliest);
+	// Set new values, with correct offset
+	CollectionOperations(targetCollection_).setZ(zValues).offsetZ(-earliest);
 
 	return true;
 }
@@ -663,8 +663,9 @@ void StyleWindow::updateControls(bool force)
 
 	// Enable/disable groups specific to one style
 	bool isSurface = ((currentCollection->displayStyle() == Collection::SurfaceStyle) || (currentCollection->displayStyle() == Collection::UnlitSurfaceStyle));
+	bool isImage = (currentCollection->displayStyle() == Collection::ImageStyle);
 	ui.SurfaceOptionsGroup->setEnabled(isSurface);
-	ui.LineOptionsGroup->setEnabled(!isSurface);
+	ui.LineOptionsGroup->setEnabled((!isSurface) && (!isImage));
 
 	refreshing_ = false;
 }
@@ -33,9 +33,13 @@
 #include "gui/view.h"
 #include "gui/saveimage.h"
 #include "gui/import.h"
+#include "gui/datawatcher.hui"
 #include "base/collection.h"
 #include "base/transformer.h"
 #include "base/viewlayout.h"
+#include <QTimer>
+#include <QProgressBar>
+#include <QToolButton>
 
 // Forward Declarations
 /* None */
@@ -206,8 +210,49 @@ class UChromaWindow : public QMainWindow
 	void on_actionDataLoadXY_triggered(bool checked);
 	void on_actionDataImport_triggered(bool checked);
 	void on_actionDataReload_triggered(bool checked);
+	void on_actionDataWatchDirectory_triggered(bool checked);
+	void on_actionDataWatchFile_triggered(bool checked);
+	void on_actionDataStopWatching_triggered(bool checked);
 	void on_actionDataView_triggered(bool checked);
 
+	private:
+	// Watcher for streamed data
+	DataWatcher dataWatcher_;
+
+	private slots:
+	// Update after new data has been appended by the data watcher
+	void watchedDataAppended(int nDataSets);
+
+
+	/*
+	 * Background Jobs
+	 */
+	private:
+	// Timer used to collect the results of finished background jobs
+	QTimer jobTimer_;
+	// Statusbar background job progress indicator
+	QProgressBar* statusBarJobProgress_;
+	// Statusbar background job cancel button
+	QToolButton* statusBarJobCancelButton_;
+
+	private slots:
+	// Deliver results of finished background jobs, and update progress indicator
+	void updateJobs();
+	// Cancel all background jobs
+	void cancelJobs();
+
+
+	/*
+	 * Memory
+	 */
+	private:
+	// Timer used to periodically release memory held by cold collections
+	QTimer coldDataTimer_;
+
+	private slots:
+	// Release memory held by cold collections, and update memory usage information
+	void releaseColdData();
+
 
 	/*
 	 * Operate Actions
@@ -226,6 +271,7 @@ class UChromaWindow : public QMainWindow
 	void on_actionAnalyseUpdateFit_triggered(bool checked);
 	void on_actionAnalyseResetAndRestartFit_triggered(bool checked);
 	void on_actionAnalyseViewFitResults_triggered(bool checked);
+	void on_actionAnalyseStatistics_triggered(bool checked);
 
 
 	/*
@@ -127,6 +127,14 @@ void UChromaWindow::on_CollectionRemoveButton_clicked(bool checked)
 	updateGUI();
 }
 
+// Return memory size as a string
+QString memoryString(long int bytes)
+{
+	if (bytes < 1024) return QString("%1 B").arg(bytes);
+	else if (bytes < 1048576) return QString("%1 kB").arg(bytes / 1024.0, 0, 'f', 1);
+	else return QString("%1 MB").arg(bytes / 1048576.0, 0, 'f', 1);
+}
+
 // Update item in collections tree
 void UChromaWindow::updateCollectionTreeItem(QTreeWidgetItem* item)
 {
@@ -144,6 +152,12 @@ void UChromaWindow::updateCollectionTreeItem(QTreeWidgetItem* item)
 	// Set icon
 	item->setIcon(0, QIcon(collection->iconString(UChromaSession::viewLayout().collectionUsed(collection, ViewPane::StandardRole))));
 
+	// Set memory usage
+	QString toolTip = "Data: " + memoryString(collection->valuesSize());
+	if (collection->nCompressedDataSets() > 0) toolTip += QString(" (%1 of %2 datasets compressed)").arg(collection->nCompressedDataSets()).arg(collection->nDataSets());
+	toolTip += "\nDerived data: " + memoryString(collection->derivedDataSize());
+	item->setToolTip(0, toolTip);
+
 	// If this is the current collection, select it
 	if (UChromaSession::isCurrentCollection(collection)) item->setSelected(true);
 }
@@ -266,11 +280,13 @@ void UChromaWindow::updateCollectionInfo()
 	{
 		ui.CollectionNSlicesLabel->setText(QString::number(UChromaSession::currentCollection()->nDataSets()));
 		ui.CollectionNPointsLabel->setText(QString::number(UChromaSession::currentCollection()->nDataPoints()));
+		ui.CollectionMemoryLabel->setText(memoryString(UChromaSession::currentCollection()->valuesSize() + UChromaSession::currentCollection()->derivedDataSize()));
 	}
 	else
 	{
 		ui.CollectionNSlicesLabel->setText("0");
 		ui.CollectionNPointsLabel->setText("0");
+		ui.CollectionMemoryLabel->setText("0 B");
 	}
 
 	// Set number of collections in the current session
@@ -20,6 +20,8 @@
 */
 
 #include "gui/uchroma.h"
+#include "base/jobscheduler.h"
+#include "base/datacache.h"
 #include "render/fontinstance.h"
 #include "session/session.h"
 #include "templates/reflist.h"
@@ -27,6 +29,7 @@
 #include "version.h"
 #include <QMessageBox>
 #include <QSettings>
+#include <QTreeWidgetItemIterator>
 
 // Constructor
 UChromaWindow::UChromaWindow(QMainWindow *parent) : QMainWindow(parent),
@@ -62,6 +65,9 @@ UChromaWindow::UChromaWindow(QMainWindow *parent) : QMainWindow(parent),
 	// Connect signals / slots between the Viewer and uChroma
 	connect(ui.MainView, SIGNAL(renderComplete(QString)), this, SLOT(updateRenderTimeLabel(QString)));
 
+	// Connect data watcher so that the GUI is updated when new data arrives
+	connect(&dataWatcher_, SIGNAL(dataAppended(int)), this, SLOT(watchedDataAppended(int)));
+
 	// Hide LeftWidgets (Collection list etc.) initially
 	ui.LeftWidgetsWidget->setVisible(false);
 
@@ -97,6 +103,27 @@ UChromaWindow::UChromaWindow(QMainWindow *parent) : QMainWindow(parent),
 	ui.StatusBar->addWidget(statusBarInfoLabel_);
 	statusBarRenderingTimeLabel_ = new QLabel(this);
 	ui.StatusBar->addPermanentWidget(statusBarRenderingTimeLabel_);	
+	statusBarJobProgress_ = new QProgressBar(this);
+	statusBarJobProgress_->setRange(0, 100);
+	statusBarJobProgress_->setMaximumWidth(200);
+	statusBarJobProgress_->setVisible(false);
+	ui.StatusBar->addPermanentWidget(statusBarJobProgress_);
+	statusBarJobCancelButton_ = new QToolButton(this);
+	statusBarJobCancelButton_->setText("Cancel");
+	statusBarJobCancelButton_->setVisible(false);
+	connect(statusBarJobCancelButton_, SIGNAL(clicked(bool)), this, SLOT(cancelJobs()));
+	ui.StatusBar->addPermanentWidget(statusBarJobCancelButton_);
+
+	// Run collection updates in the background, collecting results periodically
+	JobScheduler::setEnabled(true);
+	jobTimer_.setInterval(50);
+	connect(&jobTimer_, SIGNAL(timeout()), this, SLOT(updateJobs()));
+	jobTimer_.start();
+
+	// Periodically release derived data (and compress values) in collections which are not visible
+	coldDataTimer_.setInterval(30000);
+	connect(&coldDataTimer_, SIGNAL(timeout()), this, SLOT(releaseColdData()));
+	coldDataTimer_.start();
 
 	// Set initial interaction mode
 	setInteractionMode(InteractionMode::ViewInteraction, -1);
@@ -105,6 +132,9 @@ UChromaWindow::UChromaWindow(QMainWindow *parent) : QMainWindow(parent),
 // Destructor
 UChromaWindow::~UChromaWindow()
 {
+	jobTimer_.stop();
+	coldDataTimer_.stop();
+	JobScheduler::shutdown();
 }
 
 /*
@@ -132,6 +162,9 @@ void UChromaWindow::loadSettings()
 
 	// Viewer font
 	if (settings.contains("ViewerFont")) UChromaSession::setViewerFontFileName(settings.value("ViewerFont").toString());
+
+	// Interval at which watched data is appended
+	if (settings.contains("DataWatchInterval")) dataWatcher_.setBatchInterval(settings.value("DataWatchInterval").toInt());
 }
 
 // Save settings
@@ -141,6 +174,9 @@ void UChromaWindow::saveSettings()
 
 	// Viewer font
 	settings.setValue("ViewerFont", UChromaSession::viewerFontFileName());
+
+	// Interval at which watched data is appended
+	settings.setValue("DataWatchInterval", dataWatcher_.batchInterval());
 }
 
 /*
@@ -219,3 +255,50 @@ void UChromaWindow::updateUndoRedo()
 	ui.actionEditRedo->setText(currentRedoState ? "Redo " + currentRedoState->title() : "Redo");
 	ui.actionEditRedo->setEnabled(currentRedoState);
 }
+
+/*
+ * Background Jobs
+ */
+
+// Deliver results of finished background jobs, and update progress indicator
+void UChromaWindow::updateJobs()
+{
+	// If new results have arrived, update everything that depends on limits or display data
+	if (JobScheduler::deliverFinished() > 0)
+	{
+		ViewPane* viewPane = UChromaSession::currentViewPane();
+		if (ViewPane::objectValid(viewPane)) viewPane->updateAxisLimits();
+		updateSubWindows();
+		updateDisplay();
+	}
+
+	int nJobs = JobScheduler::nActiveJobs();
+	statusBarJobProgress_->setVisible(nJobs > 0);
+	statusBarJobCancelButton_->setVisible(nJobs > 0);
+	if (nJobs == 0) return;
+
+	statusBarJobProgress_->setFormat(nJobs == 1 ? "Updating (%p%)" : QString("Updating %1 (%p%)").arg(nJobs));
+	statusBarJobProgress_->setValue(JobScheduler::progress() * 100);
+}
+
+// Cancel all background jobs
+void UChromaWindow::cancelJobs()
+{
+	JobScheduler::cancelAll();
+}
+
+/*
+ * Memory
+ */
+
+// Release memory held by cold collections, and update memory usage information
+void UChromaWindow::releaseColdData()
+{
+	if (DataCache::releaseColdData(UChromaSession::collections()) == 0) return;
+
+	// Update memory usage shown in collection tree and info
+	refreshing_ = true;
+	for (QTreeWidgetItemIterator it(ui.CollectionTree); *it; ++it) updateCollectionTreeItem(*it);
+	refreshing_ = false;
+	updateCollectionInfo();
+}
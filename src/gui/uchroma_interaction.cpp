@@ -167,7 +167,6 @@ void UChromaWindow::startInteraction(int mouseX, int mouseY, Qt::KeyboardModifie
 	if (interactionMode_ == InteractionMode::ViewInteraction)
 	{
 		ui.MainView->setQueryCoordinates(mouseX, mouseY);
-		ui.MainView->repaint();
 		clickedObject_ = ui.MainView->objectAtQueryCoordinates();
 		clickedObjectInfo_ = ui.MainView->infoAtQueryCoordinates();
 		if (clickedObject_ == Viewer::CollectionObject)
@@ -320,7 +319,6 @@ double UChromaWindow::currentInteractionCoordinate()
 void UChromaWindow::doubleClickInteraction(int mouseX, int mouseY)
 {
 	ui.MainView->setQueryCoordinates(mouseX, mouseY);
-	ui.MainView->repaint();
 	clickedObject_ = ui.MainView->objectAtQueryCoordinates();
 	clickedObjectInfo_ = ui.MainView->infoAtQueryCoordinates();
 
@@ -20,6 +20,7 @@
 */
 
 #include "gui/uchroma.h"
+#include "gui/analyse_statistics.h"
 #include "gui/editviewlayout.h"
 #include "gui/editfitresults.h"
 #include "gui/operate_bgsub.h"
@@ -31,6 +32,7 @@
 #include <QMessageBox>
 #include <QCloseEvent>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QProgressDialog>
 #include <QPainter>
 
@@ -113,9 +115,15 @@ void UChromaWindow::on_actionFileSaveSession_triggered(bool checked)
 void UChromaWindow::on_actionFileSaveSessionAs_triggered(bool checked)
 {
 	// Get a filename from the user
-	QString fileName = QFileDialog::getSaveFileName(this, "Choose save file name", UChromaSession::sessionFileDirectory().absolutePath(), "uChroma files (*.ucr);;All files (*.*)");
+	const QString textFilter = "uChroma files (*.ucr)", binaryFilter = "uChroma files with binary data (*.ucr)";
+	QString selectedFilter = UChromaSession::binaryData() ? binaryFilter : textFilter;
+	QString fileName = QFileDialog::getSaveFileName(this, "Choose save file name", UChromaSession::sessionFileDirectory().absolutePath(), textFilter + ";;" + binaryFilter + ";;All files (*.*)", &selectedFilter);
 	if (fileName.isEmpty()) return;
 
+	// Store dataset values in a binary sidecar file?
+	if (selectedFilter == binaryFilter) UChromaSession::setBinaryData(true);
+	else if (selectedFilter == textFilter) UChromaSession::setBinaryData(false);
+
 	// Make sure the file has the right extension
 	QFileInfo fileInfo(fileName);
 	if (fileInfo.suffix() != "ucr") fileName += ".ucr";
@@ -512,6 +520,56 @@ void UChromaWindow::on_actionDataReload_triggered(bool checked)
 	dataWindow_.reloadDataSets();
 }
 
+void UChromaWindow::on_actionDataWatchDirectory_triggered(bool checked)
+{
+	// Check current Collection
+	Collection* currentCollection = UChromaSession::currentCollection();
+	if (!Collection::objectValid(currentCollection, "collection in UChromaWindow::on_actionDataWatchDirectory_triggered()")) return;
+
+	QString directory = QFileDialog::getExistingDirectory(this, "Choose directory to watch", currentCollection->dataFileDirectory().absolutePath());
+	if (directory.isEmpty()) return;
+
+	bool ok;
+	QString filters = QInputDialog::getText(this, "Watch Directory", "Files to read (e.g. '*.dat *.txt'):", QLineEdit::Normal, "*", &ok);
+	if (!ok) return;
+
+	dataWatcher_.setNameFilters(filters.split(' ', QString::SkipEmptyParts));
+	ui.actionDataStopWatching->setEnabled(dataWatcher_.start(currentCollection, DataWatcher::DirectoryMode, directory));
+}
+
+void UChromaWindow::on_actionDataWatchFile_triggered(bool checked)
+{
+	// Check current Collection
+	Collection* currentCollection = UChromaSession::currentCollection();
+	if (!Collection::objectValid(currentCollection, "collection in UChromaWindow::on_actionDataWatchFile_triggered()")) return;
+
+	QString fileName = QFileDialog::getOpenFileName(this, "Choose sequential XY file to watch", currentCollection->dataFileDirectory().absolutePath(), "All files (*)");
+	if (fileName.isEmpty()) return;
+
+	// Use the current sequential XY settings from the import dialog
+	dataWatcher_.setColumns(importDialog_.sequentialXYColumns());
+	dataWatcher_.setStartSkip(importDialog_.sequentialXYStartSkip());
+	ui.actionDataStopWatching->setEnabled(dataWatcher_.start(currentCollection, DataWatcher::SequentialXYMode, fileName));
+}
+
+void UChromaWindow::on_actionDataStopWatching_triggered(bool checked)
+{
+	dataWatcher_.stop();
+
+	ui.actionDataStopWatching->setEnabled(false);
+}
+
+// Update after new data has been appended by the data watcher
+void UChromaWindow::watchedDataAppended(int nDataSets)
+{
+	// Only those things which depend on the data itself need updating - display data and primitives are updated incrementally when next drawn
+	ViewPane* viewPane = UChromaSession::currentViewPane();
+	if (ViewPane::objectValid(viewPane, "view pane in UChromaWindow::watchedDataAppended()")) viewPane->updateAxisLimits();
+	dataWindow_.updateControls();
+	updateCollectionInfo();
+	updateDisplay();
+}
+
 void UChromaWindow::on_actionDataView_triggered(bool checked)
 {
 	ui.actionWindowData->trigger();
@@ -646,6 +704,16 @@ void UChromaWindow::on_actionAnalyseViewFitResults_triggered(bool checked)
 	}
 }
 
+void UChromaWindow::on_actionAnalyseStatistics_triggered(bool checked)
+{
+	// Check current Collection
+	Collection* currentCollection = UChromaSession::currentCollection();
+	if (!Collection::objectValid(currentCollection, "collection in UChromaWindow::on_actionAnalyseStatistics_triggered()")) return;
+
+	AnalyseStatisticsDialog statisticsDialog(this);
+	statisticsDialog.updateAndExec(currentCollection);
+}
+
 /*
  * Interact Actions
  */
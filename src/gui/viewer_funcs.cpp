@@ -23,6 +23,8 @@
 #include "gui/uchroma.h"
 #include "base/messenger.h"
 #include "render/fontinstance.h"
+#include "base/datacache.h"
+#include "render/glresourcemanager.h"
 
 // Constructor
 Viewer::Viewer(QWidget *parent) : QOpenGLWidget(parent)
@@ -38,8 +40,6 @@ Viewer::Viewer(QWidget *parent) : QOpenGLWidget(parent)
 	highlightCollection_ = NULL;
 
 	// Query
-	objectQueryX_ = -1;
-	objectQueryY_ = -1;
 	depthAtQueryCoordinates_ = 1.0;
 	objectAtQueryCoordinates_ = Viewer::NoObject;
 
@@ -50,6 +50,14 @@ Viewer::Viewer(QWidget *parent) : QOpenGLWidget(parent)
 // Destructor
 Viewer::~Viewer()
 {
+	// Release GPU timer queries while our context is current
+	if (valid_)
+	{
+		makeCurrent();
+		frameTiming_.releaseGpuQueries();
+		GLResourceManager::deleteReleased(context());
+		doneCurrent();
+	}
 }
 
 // Set UChromaWindow pointer
@@ -111,12 +119,25 @@ void Viewer::paintGL()
 	// Setup basic GL stuff
 	setupGL();
 
+	// Delete any GL resources released since the last frame (e.g. by removed collections)
+	GLResourceManager::deleteReleased(context());
+
+	// Reset counts of data uploaded to GL buffers for this frame
+	Primitive::resetUploadCounts();
+
 	// Render full scene
+	frameTiming_.beginFrame();
 	renderFullScene();
+	frameTiming_.endFrame(Primitive::verticesUploaded());
+	if (Primitive::bytesUploaded() > 0) msg.print(Messenger::Verbose, "Uploaded %li bytes of primitive data to GL this frame.\n", Primitive::bytesUploaded());
+
+	// Draw timing overlay (if requested)
+	if (frameTiming_.showOverlay()) renderTimingOverlay();
+
+	emit(renderComplete(QString("%1 ms").arg(frameTiming_.lastFrameTime(), 0, 'f', 1)));
 
-	// Reset query coordinate
-	objectQueryX_ = -1;
-	objectQueryY_ = -1;
+	// Now that the frame is complete, release any deferred data in excess of the budget
+	DataCache::enforceBudget();
 
 	// Set the rendering flag to false
 	drawing_ = false;
@@ -180,35 +201,53 @@ void Viewer::postRedisplay()
 	update();
 }
 
-/*
- * Object Querying
- */
-
-// Update depth at query coordinates, returning whether it is closer
-bool Viewer::updateQueryDepth()
+// Initialise for offscreen rendering only, without an on-screen context
+bool Viewer::initialiseOffscreen(int referenceWidth, int referenceHeight)
 {
-	// Return immediately if we are not querying
-	if (objectQueryX_ == -1) return false;
+	msg.enter("Viewer::initialiseOffscreen");
 
-	// Sample a small area centred at the supplied position
-	GLfloat depth[9];
-	
-	glReadPixels(objectQueryX_, objectQueryY_, objectQueryWidth_, objectQueryHeight_, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
+	// Setup offscreen context and surface, using the default surface format
+	msg.print(Messenger::Verbose, "Setting up offscreen context and surface...");
+	offscreenContext_.setFormat(QSurfaceFormat::defaultFormat());
+	if (!offscreenContext_.create())
+	{
+		msg.print("Error: Failed to create offscreen context.\n");
+		msg.exit("Viewer::initialiseOffscreen");
+		return false;
+	}
+	offscreenSurface_.setFormat(offscreenContext_.format());
+	offscreenSurface_.create();
+	if (!offscreenContext_.makeCurrent(&offscreenSurface_))
+	{
+		msg.print("Error: Failed to make offscreen context current.\n");
+		msg.exit("Viewer::initialiseOffscreen");
+		return false;
+	}
+	msg.print(Messenger::Verbose, "Done.");
 
-	bool result = false;
-	for (int i=0; i<objectQueryWidth_*objectQueryHeight_; ++i)
+	// Setup function pointers to OpenGL extension functions
+	initializeOpenGLFunctions();
+
+	// Check for vertex buffer extensions
+	if ((!hasOpenGLFeature(QOpenGLFunctions::Buffers)) && (PrimitiveInstance::globalInstanceType() == PrimitiveInstance::VBOInstance))
 	{
-		if (depth[i] < depthAtQueryCoordinates_)
-		{
-			depthAtQueryCoordinates_ = depth[i];
-			result = true;
-		}
+		printf("VBO extension is requested but not available, so reverting to display lists instead.\n");
+		PrimitiveInstance::setGlobalInstanceType(PrimitiveInstance::ListInstance);
 	}
-	// 	printf("Current averageDepth at %i,%i is now %f\n", objectQueryX_, objectQueryY_, averageDepth);
 
-	return result;
+	// There is no on-screen context, so set the reference size against which line widths and text are scaled
+	contextWidth_ = referenceWidth;
+	contextHeight_ = referenceHeight;
+
+	msg.exit("Viewer::initialiseOffscreen");
+
+	return true;
 }
 
+/*
+ * Object Querying
+ */
+
 // Set information of query object
 void Viewer::setQueryObject(Viewer::ViewObject objectType, QString info)
 {
@@ -216,7 +255,32 @@ void Viewer::setQueryObject(Viewer::ViewObject objectType, QString info)
 	infoAtQueryCoordinates_ = info;
 }
 
-// Set coordinates to query at next redraw
+// Update sources of picking index for specified pane, rebuilding it if necessary
+void Viewer::updatePickingIndex(ViewPane* pane)
+{
+	PickingIndex& index = pane->pickingIndex();
+	index.beginSources();
+
+	// Axis and grid lines
+	int axis, skipAxis = -1;
+	if (pane->viewType() == ViewPane::FlatXYView) skipAxis = 2;
+	else if (pane->viewType() == ViewPane::FlatXZView) skipAxis = 1;
+	else if (pane->viewType() == ViewPane::FlatZYView) skipAxis = 0;
+	for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis)) index.addSource(pane->axes().gridLineMinorPrimitive(axis), Viewer::GridLineMinorObject, QString::number(axis));
+	for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis)) index.addSource(pane->axes().gridLineMajorPrimitive(axis), Viewer::GridLineMajorObject, QString::number(axis));
+	for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis)) index.addSource(pane->axes().axisPrimitive(axis), Viewer::AxisLineObject, QString::number(axis));
+
+	// Collection targets (subject to the y-axis clip planes)
+	for (TargetData* target = pane->collectionTargets(); target != NULL; target = target->next)
+	{
+		if (!target->collection()->visible()) continue;
+		for (TargetPrimitive* primitive = target->displayPrimitives(); primitive != NULL; primitive = primitive->next) index.addSources(primitive->primitive(), Viewer::CollectionObject, target->collection()->locator(), true);
+	}
+
+	if (index.updateIndex()) msg.print(Messenger::Verbose, "Rebuilt picking index for pane '%s' (%i elements) in %0.2f ms.\n", qPrintable(pane->name()), index.nElements(), index.buildTime());
+}
+
+// Set coordinates to query, determining the closest object displayed at them
 void Viewer::setQueryCoordinates(int mouseX, int mouseY)
 {
 	depthAtQueryCoordinates_ = 1.0;
@@ -224,31 +288,38 @@ void Viewer::setQueryCoordinates(int mouseX, int mouseY)
 	infoAtQueryCoordinates_.clear();
 
 	// Check for invalid coordinates
-	if ((mouseX < 0) || (mouseX >= width()) || (mouseY < 0) || (mouseY >= height()))
-	{
-		objectQueryX_ = -1;
-		objectQueryY_ = -1;
-		return;
-	}
+	if ((mouseX < 0) || (mouseX >= width()) || (mouseY < 0) || (mouseY >= height())) return;
 
-	// Setup area to sample around central pixel
-	objectQueryWidth_ = 3;
-	objectQueryX_ = mouseX-1;
-	if (mouseX == 0)
+	// Query the pane(s) containing the coordinates
+	int object;
+	QString info;
+	for (ViewPane* pane = UChromaSession::viewLayout().panes(); pane != NULL; pane = pane->next)
 	{
-		--objectQueryWidth_;
-		++mouseX;
-	}
-	else if (mouseX == (width()-1)) --objectQueryWidth_;
+		if (!pane->containsCoordinate(mouseX, mouseY)) continue;
+
+		Matrix viewMatrix = pane->viewMatrix();
+		Matrix viewRotationInverse = pane->viewRotationInverse();
+		Matrix projectionMatrix = pane->projectionMatrix();
+		int skipAxis = -1;
+		if (pane->viewType() == ViewPane::FlatXYView) skipAxis = 2;
+		else if (pane->viewType() == ViewPane::FlatXZView) skipAxis = 1;
+		else if (pane->viewType() == ViewPane::FlatZYView) skipAxis = 0;
+
+		// Axis text - bounding quads depend on the view rotation, so are calculated for each query
+		if (FontInstance::fontOK()) for (int axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis))
+		{
+			queryTextQuads_.clear();
+			pane->axes().labelPrimitive(axis).boundingQuads(viewRotationInverse, pane->textZScale(), queryTextQuads_);
+			if (PickingIndex::pickQuads(mouseX, mouseY, queryTextQuads_, viewMatrix, projectionMatrix, pane->viewportMatrix(), depthAtQueryCoordinates_)) setQueryObject(Viewer::AxisTickLabelObject, QString::number(axis));
+			queryTextQuads_.clear();
+			pane->axes().titlePrimitive(axis).boundingQuads(viewRotationInverse, pane->textZScale(), queryTextQuads_);
+			if (PickingIndex::pickQuads(mouseX, mouseY, queryTextQuads_, viewMatrix, projectionMatrix, pane->viewportMatrix(), depthAtQueryCoordinates_)) setQueryObject(Viewer::AxisTitleLabelObject, QString::number(axis));
+		}
 
-	objectQueryHeight_ = 3;
-	objectQueryY_ = mouseY-1;
-	if (mouseY == 0)
-	{
-		--objectQueryHeight_;
-		++mouseY;
+		// Axis lines, grid lines, and collection data
+		updatePickingIndex(pane);
+		if (pane->pickingIndex().pick(mouseX, mouseY, viewMatrix, projectionMatrix, pane->viewportMatrix(), pane->axes().clipPlaneYMin(), pane->axes().clipPlaneYMax(), depthAtQueryCoordinates_, object, info)) setQueryObject((Viewer::ViewObject) object, info);
 	}
-	else if (mouseY == (height()-1)) --objectQueryHeight_;
 }
 
 // Return object type at query coordinates
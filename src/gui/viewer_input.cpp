@@ -193,6 +193,14 @@ void Viewer::keyPressEvent(QKeyEvent *event)
 			refresh = true;
 			ignore = false;
 			break;
+		// Toggle frame timing (with overlay, or log only if Shift is held)
+		case (Qt::Key_F12):
+			frameTiming_.setEnabled(!frameTiming_.enabled());
+			frameTiming_.setShowOverlay(frameTiming_.enabled() && (!km.testFlag(Qt::ShiftModifier)));
+			msg.print("Frame timing is now %s.\n", frameTiming_.enabled() ? "on" : "off");
+			refresh = true;
+			ignore = false;
+			break;
 		default:
 			break;
 	}
@@ -23,9 +23,13 @@
 #include "gui/uchroma.h"
 #include "base/messenger.h"
 #include "render/fontinstance.h"
+#include "render/glresourcemanager.h"
+#include "base/jobscheduler.h"
 #include <QOpenGLFramebufferObjectFormat>
 #include <QPainter>
 #include <QProgressDialog>
+#include <QRunnable>
+#include <algorithm>
 
 // Setup basic GL properties (called each time before renderScene())
 void Viewer::setupGL()
@@ -91,8 +95,67 @@ void Viewer::setupGL()
 	msg.exit("Viewer::setupGL");
 }
 
-// Draw full scene
-void Viewer::renderFullScene(int xOffset, int yOffset)
+// Task constructing data for a single target primitive
+class TargetPrimitiveTask : public QRunnable
+{
+	public:
+	// Constructor
+	TargetPrimitiveTask(TargetPrimitive* primitive, const Axes& axes) : QRunnable(), axes_(axes)
+	{
+		primitive_ = primitive;
+	}
+
+	private:
+	// Target primitive
+	TargetPrimitive* primitive_;
+	// Axes to use
+	const Axes& axes_;
+
+	public:
+	// Construct primitive data
+	void run()
+	{
+		primitive_->construct(axes_);
+	}
+};
+
+// Prepare views, axes, and collection primitives for all panes (or only the specified pane) ahead of rendering
+void Viewer::prepareScene(ViewPane* onlyPane)
+{
+	msg.enter("Viewer::prepareScene");
+
+	// Views and axes primitives are updated first, since collection primitives depend on the resulting stretch factors
+	// These use the text parser and font metrics (neither of which is thread-safe) and record undo information, so are done serially
+	RefList<TargetPrimitive,const Axes*> stalePrimitives;
+	for (ViewPane* pane = UChromaSession::viewLayout().panes(); pane != NULL; pane = pane->next)
+	{
+		if (onlyPane && (pane != onlyPane)) continue;
+
+		pane->axes().resetRegenerationTimes();
+		pane->recalculateView();
+		pane->axes().updateAxisPrimitives();
+
+		// Find collection primitives which need to be constructed, preparing their display data as we go
+		for (TargetData* target = pane->collectionTargets(); target != NULL; target = target->next)
+		{
+			for (TargetPrimitive* primitive = target->displayPrimitives(); primitive != NULL; primitive = primitive->next) if (primitive->prepare(pane->axes())) stalePrimitives.add(primitive, &pane->axes());
+		}
+	}
+
+	// Construct collection primitives concurrently (if there is more than one)
+	if (stalePrimitives.nItems() == 1) stalePrimitives.first()->item->construct(*stalePrimitives.first()->data);
+	else if (stalePrimitives.nItems() > 1)
+	{
+		TaskGroup tasks;
+		for (RefListItem<TargetPrimitive,const Axes*>* ri = stalePrimitives.first(); ri != NULL; ri = ri->next) tasks.start(new TargetPrimitiveTask(ri->item, *ri->data));
+		tasks.waitForDone();
+	}
+
+	msg.exit("Viewer::prepareScene");
+}
+
+// Draw full scene (or only the specified pane)
+void Viewer::renderFullScene(int xOffset, int yOffset, ViewPane* onlyPane)
 {
 	msg.enter("Viewer::renderFullScene");
 
@@ -115,10 +178,30 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 
 	// Loop over defined viewpanes
 	GLdouble clipPlaneBottom[4] = { 0.0, 1.0, 0.0, 0.0 }, clipPlaneTop[4] = { 0.0, -1.0, 0.0, 0.0 };
+	FrameTiming* timing = ((!renderingOffScreen_) && frameTiming_.enabled()) ? &frameTiming_ : NULL;
+
+	// Bring everything up to date before rendering, so that the loop below is (mostly) just submission to GL
+	// When rendering offscreen, all primitives are regenerated for the offscreen context anyway
+	if (!renderingOffScreen_)
+	{
+		FrameTimingScope prepareScope(timing, "prepare");
+		prepareScene(onlyPane);
+	}
+
 	for (ViewPane* pane = UChromaSession::viewLayout().panes(); pane != NULL; pane = pane->next)
 	{
+		// Skip this pane if we are only rendering a specific one
+		if (onlyPane && (pane != onlyPane)) continue;
+
+		// Start timing for this pane
+		QString paneLabel = timing ? pane->name() : QString();
+		FrameTimingScope paneScope(timing, paneLabel);
+		if (timing) frameTiming_.beginGpuSection(paneLabel);
+
 		// Before we do anything else, make sure the view is up to date
+		FrameTimingScope viewScope(timing, paneLabel + " : view");
 		pane->recalculateView();
+		viewScope.stop();
 
 		// Set viewport
 		glViewport(pane->viewportMatrix()[0] + xOffset, pane->viewportMatrix()[1] + yOffset, pane->viewportMatrix()[2], pane->viewportMatrix()[3]);
@@ -179,6 +262,7 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 		else if (pane->viewType() == ViewPane::FlatZYView) skipAxis = 0;
 
 		// -- Render axis text
+		FrameTimingScope axisTextScope(timing, paneLabel + " : axis text");
 		glEnable(GL_MULTISAMPLE);
 		glEnable(GL_BLEND);
 		if (FontInstance::fontOK())
@@ -187,13 +271,14 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 			for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis))
 			{
 				pane->axes().labelPrimitive(axis).renderAll(viewMatrix, viewRotationInverse, pane->textZScale());
-				if (updateQueryDepth()) setQueryObject(Viewer::AxisTickLabelObject, QString::number(axis));
 				pane->axes().titlePrimitive(axis).renderAll(viewMatrix, viewRotationInverse, pane->textZScale());
-				if (updateQueryDepth()) setQueryObject(Viewer::AxisTitleLabelObject, QString::number(axis));
 			}
 		}
 
+		axisTextScope.stop();
+
 		// -- Render axis (and grid) lines
+		FrameTimingScope axisLinesScope(timing, paneLabel + " : axis lines");
 		glLoadMatrixd(viewMatrix.matrix());
 		glDisable(GL_LIGHTING);
 		glEnable(GL_LINE_SMOOTH);
@@ -201,34 +286,39 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 		{
 			pane->axes().gridLineMinorStyle(axis).apply();
 			pane->axes().gridLineMinorPrimitive(axis).sendToGL();
-			if (updateQueryDepth()) setQueryObject(Viewer::GridLineMinorObject, QString::number(axis));
 		}
 		for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis))
 		{
 			pane->axes().gridLineMajorStyle(axis).apply();
 			pane->axes().gridLineMajorPrimitive(axis).sendToGL();
-			if (updateQueryDepth()) setQueryObject(Viewer::GridLineMajorObject, QString::number(axis));
 		}
 		LineStyle::revert();
-		for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis))
-		{
-			pane->axes().axisPrimitive(axis).sendToGL();
-			if (updateQueryDepth()) setQueryObject(Viewer::AxisLineObject, QString::number(axis));
-		}
+		for (axis=0; axis<3; ++axis) if (pane->axes().visible(axis) && (axis != skipAxis)) pane->axes().axisPrimitive(axis).sendToGL();
 		glEnable(GL_LIGHTING);
 		glDisable(GL_LINE_SMOOTH);
 
 		// Render bounding box
 		pane->boundingBoxPrimitive().sendToGL();
+		axisLinesScope.stop();
+
+		// Report time spent regenerating axis primitives (which will mostly have happened while preparing the scene)
+		if (timing) for (axis=0; axis<3; ++axis) if (pane->axes().regenerationTime(axis) > 0.0) frameTiming_.addTime(QString("%1 : %2 axis (rebuild)").arg(paneLabel).arg(QChar('X'+axis)), pane->axes().regenerationTime(axis));
 
 		// Render selection markers (if needed)
 		glLoadMatrixd(viewMatrix.matrix());
-		int interactionAxis = uChromaWindow_->interactionAxis();
+		int interactionAxis = (uChromaWindow_ ? uChromaWindow_->interactionAxis() : -1);
 		if ((pane == UChromaSession::currentViewPane()) && (interactionAxis != -1))
 		{
 			// Note - we do not need to check for inverted or logarithmic axes here, since the transformation matrix A takes care of that
 			Vec3<double> v;
 
+			// Draw contour lines through collections at the current Y value (these are already in local axes coordinates)
+			if (interactionAxis == 1)
+			{
+				glColor4d(1.0, 0.0, 0.0, 1.0);
+				pane->contourPrimitive().sendToGL();
+			}
+
 			// Draw starting interaction point (if the interaction has been started)
 			if (uChromaWindow_->interactionStarted())
 			{
@@ -263,6 +353,9 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 		// Render pane data - loop over collection targets
 		for (TargetData* target = pane->collectionTargets(); target != NULL; target = target->next)
 		{
+			QString collectionLabel = timing ? paneLabel + " : " + target->collection()->name() : QString();
+			FrameTimingScope collectionScope(timing, collectionLabel);
+
 			// If this is the collection to highlight, set color to transparent grey and disable material colouring....
 			if (target->collection() == highlightCollection_)
 			{
@@ -277,12 +370,13 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 			for (TargetPrimitive* primitive = target->displayPrimitives(); primitive != NULL; primitive = primitive->next)
 			{
 				// Make sure the primitive is up to date and send it to GL
-				primitive->updateAndSendPrimitive(pane->axes(), renderingOffScreen_, renderingOffScreen_, context());
+				if (primitive->updateAndSendPrimitive(pane->axes(), renderingOffScreen_, renderingOffScreen_, renderingOffScreen_ ? &offscreenContext_ : context()) && timing)
+				{
+					frameTiming_.addMeshRebuildTime(primitive->regenerationTime());
+					frameTiming_.addTime(collectionLabel + " (rebuild)", primitive->regenerationTime());
+				}
 			}
 
-			// Update query
-			if (updateQueryDepth()) setQueryObject(Viewer::CollectionObject, target->collection()->locator());
-
 			glEnable(GL_COLOR_MATERIAL);
 		}
 
@@ -290,6 +384,8 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 		glDisable(GL_CLIP_PLANE0);
 		glDisable(GL_CLIP_PLANE1);
 
+		if (timing) frameTiming_.endGpuSection();
+
 		// Render toolbar?
 // 		// Setup an orthographic matrix
 // 		glMatrixMode(GL_PROJECTION);
@@ -319,6 +415,43 @@ void Viewer::renderFullScene(int xOffset, int yOffset)
 }
 
 
+// Draw frame timing overlay
+void Viewer::renderTimingOverlay()
+{
+	if ((!FontInstance::fontOK()) || (FontInstance::fontFullHeight() <= 0.0)) return;
+
+	// Setup an orthographic matrix covering the whole context
+	glViewport(0, 0, contextWidth_, contextHeight_);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0, contextWidth_, 0, contextHeight_, -10, 10);
+	glMatrixMode(GL_MODELVIEW);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Draw summary text, one line at a time, from the top-left corner
+	const double lineHeight = 14.0;
+	double scale = (lineHeight - 2.0) / FontInstance::fontFullHeight();
+	FontInstance::font()->FaceSize(1);
+	QStringList lines = frameTiming_.summary();
+	lines << QString("GPU memory : %1 kB in %2 resources").arg(GLResourceManager::totalBytesUsed() / 1024.0, 0, 'f', 1).arg(GLResourceManager::nResources());
+	for (Collection* collection = UChromaSession::collections(); collection != NULL; collection = collection->nextCollection(true))
+	{
+		long int bytes = GLResourceManager::bytesUsed(collection);
+		if (bytes > 0) lines << QString("GPU memory : %1 : %2 kB").arg(collection->name()).arg(bytes / 1024.0, 0, 'f', 1);
+	}
+	for (int n=0; n<lines.count(); ++n)
+	{
+		glLoadIdentity();
+		glTranslated(4.0, contextHeight_ - (n+1)*lineHeight, 0.0);
+		glScaled(scale, scale, scale);
+		FontInstance::font()->Render(qPrintable(lines.at(n)));
+	}
+
+	glEnable(GL_DEPTH_TEST);
+}
+
 // Set whether we are currently rendering offscreen
 void Viewer::setRenderingOffScreen(bool b)
 {
@@ -342,9 +475,9 @@ QPixmap Viewer::frameBuffer()
 }
 
 // Render or grab image
-QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
+QPixmap Viewer::generateImage(int imageWidth, int imageHeight, int maxTileSize, ViewPane* onlyPane)
 {
-	msg.print("Viewer::generateImage");
+	msg.enter("Viewer::generateImage");
 
 	// Flag that we are rendering offscreen, and that we want high quality primitives
 	renderingOffScreen_ = true;
@@ -352,12 +485,24 @@ QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
 	// Scale current line width and text scaling to reflect size of exported image
 	setObjectScaling( double(imageHeight) / double(contextHeight()) );
 
-	// Make the offscreen surface the current context
+	// Make the offscreen surface the current context, and delete any GL resources released in its share group
 	offscreenContext_.makeCurrent(&offscreenSurface_);
-
-	// Set tile size
-	int tileWidth = 512;
-	int tileHeight = 512;
+	GLResourceManager::deleteReleased(&offscreenContext_);
+
+	// Set tile size - use the largest tiles the context allows (up to the maximum requested), since every tile requires the full scene to be drawn
+	GLint maxViewportDims[2], maxRenderbufferSize;
+	glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewportDims);
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+	int tileWidth = std::min(std::min(maxTileSize, imageWidth), std::min((int) maxViewportDims[0], (int) maxRenderbufferSize));
+	int tileHeight = std::min(std::min(maxTileSize, imageHeight), std::min((int) maxViewportDims[1], (int) maxRenderbufferSize));
+	if ((tileWidth < 1) || (tileHeight < 1))
+	{
+		msg.print("Invalid tile size (%ix%i) when generating image.\n", tileWidth, tileHeight);
+		renderingOffScreen_ = false;
+		msg.exit("Viewer::generateImage");
+		return QPixmap();
+	}
+	msg.print(Messenger::Verbose, "Rendering image of size %ix%i using tiles of size %ix%i.\n", imageWidth, imageHeight, tileWidth, tileHeight);
 
 	// Initialise framebuffer format and object
 	QOpenGLFramebufferObjectFormat fboFormat;
@@ -369,6 +514,7 @@ QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
 	if (!frameBufferObject.bind())
 	{
 		msg.print("Failed to bind framebuffer object when generating image.");
+		renderingOffScreen_ = false;
 		msg.exit("Viewer::generateImage");
 		return QPixmap();
 	}
@@ -380,9 +526,7 @@ QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
 	painter.setBrush(Qt::white);
 	painter.drawRect(0,0,imageWidth, imageHeight);
 
-	// Calculate scale factors for ViewLayout, so that the context width/height is scaled to the desired image size
-	double xScale = double(imageWidth) / double(tileWidth);
-	double yScale = double(imageHeight) / double(tileHeight);
+	// Calculate number of tiles required
 	int nX = imageWidth / tileWidth + ((imageWidth %tileWidth) ? 1 : 0);
 	int nY = imageHeight / tileHeight + ((imageHeight %tileHeight) ? 1 : 0);
 
@@ -390,21 +534,42 @@ QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
 	UChromaSession::viewLayout().setOffsetAndScale(0, 0, 1.0, 1.0);
 	UChromaSession::viewLayout().recalculate(imageWidth, imageHeight);
 
-	// Loop over tiles in x and y
-	QProgressDialog progress("Generating tiled image", "Cancel", 0, nX*nY, uChromaWindow_);
-	progress.setWindowTitle("uChroma");
+	// If we are only rendering a single pane, make its viewport fill the whole image
+	if (onlyPane)
+	{
+		int gridWidth = imageWidth / onlyPane->width(), gridHeight = imageHeight / onlyPane->height();
+		onlyPane->recalculateViewport(gridWidth, gridHeight, onlyPane->leftEdge()+onlyPane->width(), onlyPane->bottomEdge()+onlyPane->height(), imageWidth - gridWidth*onlyPane->width(), imageHeight - gridHeight*onlyPane->height());
+		onlyPane->translateViewport(-int(onlyPane->viewportMatrix()[0]), -int(onlyPane->viewportMatrix()[1]));
+		onlyPane->recalculateView();
+	}
+
+	// Loop over tiles in x and y (only show progress if we have a main window)
+	QProgressDialog* progress = NULL;
+	if (uChromaWindow_)
+	{
+		progress = new QProgressDialog("Generating tiled image", "Cancel", 0, nX*nY, uChromaWindow_);
+		progress->setWindowTitle("uChroma");
+	}
+	bool cancelled = false;
 	for (int x=0; x<nX; ++x)
 	{
 		for (int y=0; y<nY; ++y)
 		{
 			// Set progress value and check for cancellation
-			if (progress.wasCanceled()) break;
-			progress.setValue(x*nY+y);
+			if (progress)
+			{
+				if (progress->wasCanceled())
+				{
+					cancelled = true;
+					break;
+				}
+				progress->setValue(x*nY+y);
+			}
 
 			// Generate this tile
 			if (!frameBufferObject.bind()) printf("Failed to bind framebuffer object.\n");
 			setupGL();
-			renderFullScene(-x*tileWidth, -y*tileHeight);
+			renderFullScene(-x*tileWidth, -y*tileHeight, onlyPane);
 			QImage fboImage(frameBufferObject.toImage());
 			QImage tile(fboImage.constBits(), fboImage.width(), fboImage.height(), QImage::Format_ARGB32);
 
@@ -412,8 +577,9 @@ QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
 			painter.drawImage(x*tileWidth, imageHeight-(y+1)*tileHeight, tile);
 // 			tile.save(QString("tile-%1%2.png").arg(x).arg(y), "png");
 		}
-		if (progress.wasCanceled()) break;
+		if (cancelled) break;
 	}
+	if (progress) delete progress;
 
 	// Finalise and save
 	painter.end();
@@ -428,9 +594,14 @@ QPixmap Viewer::generateImage(int imageWidth, int imageHeight)
 	UChromaSession::viewLayout().setOffsetAndScale(0, 0, 1.0, 1.0);
 	UChromaSession::viewLayout().recalculate(contextWidth_, contextHeight_);
 
+	// Delete GL resources released by primitive instances popped during rendering
+	GLResourceManager::deleteReleased(&offscreenContext_);
+
 	// Reset context back to main view
 	makeCurrent();
 
+	msg.exit("Viewer::generateImage");
+
 	return pixmap;
 }
 
@@ -439,3 +610,9 @@ void Viewer::setHighlightCollection(Collection* collection)
 {
 	highlightCollection_ = collection;
 }
+
+// Return frame timing information
+FrameTiming& Viewer::frameTiming()
+{
+	return frameTiming_;
+}
@@ -21,7 +21,9 @@
 
 #include "version.h"
 #include "gui/uchroma.h"
+#include "gui/headless.h"
 #include "render/fontinstance.h"
+#include "base/datacache.h"
 #include <QMessageBox>
 
 int main(int argc, char *argv[])
@@ -29,6 +31,10 @@ int main(int argc, char *argv[])
 	/* Uncomment here for extra debug output */
 // 	msg.addOutputType(Messenger::UndoRedo);
 
+	/* Check for headless operation - if there is no display available, use the offscreen platform plugin */
+	bool headless = HeadlessRenderer::requested(argc, argv);
+	if (headless && qgetenv("QT_QPA_PLATFORM").isEmpty() && qgetenv("DISPLAY").isEmpty()) qputenv("QT_QPA_PLATFORM", "offscreen");
+
 	/* Create the main QApplication */
 	QApplication app(argc, argv);
 	QCoreApplication::setOrganizationName("uChroma");
@@ -40,6 +46,9 @@ int main(int argc, char *argv[])
 	surfaceFormat.setSamples(2);
 	QSurfaceFormat::setDefaultFormat(surfaceFormat);
 
+	/* If running headless, hand over now, since the main window must not be created */
+	if (headless) return HeadlessRenderer::run(argc, argv);
+
 	/* Create the main window */
 	UChromaWindow mainWindow;
 
@@ -86,12 +95,22 @@ int main(int argc, char *argv[])
 					printf("UChroma revision %s\n\nAvailable CLI options are:\n\n", UCHROMAVERSION);
 					printf("\t-h\t\tShow this help\n");
 					printf("\t-a\tForce warnings generated during input file read to be treated as errors.\n");
+					printf("\t-l\tLoad binary dataset values only when they are required (must precede session files).\n");
+					printf("\t-m <MB>\tMaximum amount of on-demand dataset values to keep in memory (with -l).\n");
 					printf("\t-v\tEnable verbosity (for debugging purposes).\n");
+					HeadlessRenderer::printOptions();
 					return 1;
 					break;
 				case ('a'):
 					UChromaSession::setHardIOFail(true);
 					break;
+				case ('l'):
+					UChromaSession::setLazyLoading(true);
+					break;
+				case ('m'):
+					if (n+1 < argc) DataCache::setByteBudget(atol(argv[++n]) * 1048576);
+					else missingArg = true;
+					break;
 				case ('v'):
 					msg.addOutputType(Messenger::Verbose);
 					break;
@@ -78,6 +78,17 @@ Matrix Matrix::operator-(const Matrix &B) const
 	return A;
 }
 
+bool Matrix::operator==(const Matrix &B) const
+{
+	for (int n=0; n<16; ++n) if (matrix_[n] != B.matrix_[n]) return false;
+	return true;
+}
+
+bool Matrix::operator!=(const Matrix &B) const
+{
+	return !(*this == B);
+}
+
 Vec3<double> Matrix::operator*(const Vec3<double> &v) const
 {
 	Vec3<double> result;
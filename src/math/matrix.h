@@ -57,6 +57,8 @@ class Matrix
 	Vec4<double> operator*(const Vec4<double> &v) const;
 	Matrix &operator*=(const Matrix &B);
 	double &operator[](int);
+	bool operator==(const Matrix &B) const;
+	bool operator!=(const Matrix &B) const;
 
 
 	/*
@@ -21,6 +21,7 @@
 
 #include "render/fontinstance.h"
 #include "base/messenger.h"
+#include <QVector>
 
 // Static Members
 QString FontInstance::fontFile_ = "";
@@ -29,10 +30,18 @@ FTFont* FontInstance::font_ = NULL;
 double FontInstance::fontBaseHeight_ = 0.0;
 double FontInstance::fontFullHeight_ = 0.0;
 double FontInstance::dotWidth_ = 0.0;
+int FontInstance::fontVersion_ = 0;
+QHash<uint,FTBBox> FontInstance::glyphBoxes_;
+QHash<quint64,double> FontInstance::glyphAdvances_;
 
 // Setup font specified
 bool FontInstance::setup(QString fontFileName)
 {
+	// Bump font version, since any cached metrics are now invalid
+	++fontVersion_;
+	glyphBoxes_.clear();
+	glyphAdvances_.clear();
+
 	// Delete any previous font
 	if (font_) delete font_;
 	font_ = NULL;
@@ -97,21 +106,67 @@ double FontInstance::fontBaseHeight()
 	return fontBaseHeight_;
 }
 
+// Return version of font
+int FontInstance::fontVersion()
+{
+	return fontVersion_;
+}
+
 // Return full height of font
 double FontInstance::fontFullHeight()
 {
 	return fontFullHeight_;
 }
 
+// Return (cached) bounding box of single glyph
+FTBBox FontInstance::glyphBox(uint character)
+{
+	QHash<uint,FTBBox>::const_iterator it = glyphBoxes_.constFind(character);
+	if (it != glyphBoxes_.constEnd()) return it.value();
+
+	FTBBox box = font_->BBox(QString::fromUcs4(&character, 1).toUtf8().constData());
+	glyphBoxes_.insert(character, box);
+	return box;
+}
+
+// Return (cached) advance from glyph to the next, accounting for kerning
+double FontInstance::glyphAdvance(uint character, uint nextCharacter)
+{
+	quint64 key = (quint64(character) << 32) | nextCharacter;
+	QHash<quint64,double>::const_iterator it = glyphAdvances_.constFind(key);
+	if (it != glyphAdvances_.constEnd()) return it.value();
+
+	// FTGL only exposes kerning through whole-string advances, so take the difference between the pair and the second glyph alone
+	double advance;
+	if (nextCharacter == 0) advance = font_->Advance(QString::fromUcs4(&character, 1).toUtf8().constData());
+	else
+	{
+		uint pair[2] = { character, nextCharacter };
+		advance = font_->Advance(QString::fromUcs4(pair, 2).toUtf8().constData()) - font_->Advance(QString::fromUcs4(&nextCharacter, 1).toUtf8().constData());
+	}
+	glyphAdvances_.insert(key, advance);
+	return advance;
+}
+
 // Return bounding box for specified string
 FTBBox FontInstance::boundingBox(QString text)
 {
 	if (!font_) return FTBBox();
 
 	// Need to be a little careful here - we will put a '.' either side of the text so we get the full width of strings with trailing spaces..
-	FTBBox box = font_->BBox(qPrintable("." + text.toUtf8() + "."));
-// 	double newWidth = box.Upper().X() - dotWidth_;
-// 	box.Upper().X(newWidth);
+	// The box is assembled from cached glyph metrics in the same way as FTFont::BBox(), avoiding a full layout by FTGL for each string
+	QVector<uint> characters = ("." + text + ".").toUcs4();
+	FTBBox box;
+	double pen = 0.0;
+	for (int n=0; n<characters.count(); ++n)
+	{
+		FTBBox charBox = glyphBox(characters.at(n));
+		charBox += FTPoint(pen, 0.0);
+		if (n == 0) box = charBox;
+		else box |= charBox;
+		pen += glyphAdvance(characters.at(n), n < characters.count()-1 ? characters.at(n+1) : 0);
+	}
+
 	return FTBBox(box.Lower(), FTPoint(box.Upper().X()-dotWidth_, box.Upper().Y()));
 }
 
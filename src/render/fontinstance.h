@@ -26,6 +26,7 @@
 #include <FTGL/ftgl.h>
 #include <QString>
 #include <QResource>
+#include <QHash>
 
 // Forward Declarations
 /* none */
@@ -46,6 +47,18 @@ class FontInstance
 	static double fontBaseHeight_;
 	// Width of double dot (used for correction of width of strings with trailing spaces)
 	static double dotWidth_;
+	// Version of font, incremented every time a new font is set up
+	static int fontVersion_;
+	// Cached bounding boxes of individual glyphs, keyed by character code
+	static QHash<uint,FTBBox> glyphBoxes_;
+	// Cached advances of glyph pairs (including kerning), keyed by both character codes
+	static QHash<quint64,double> glyphAdvances_;
+
+	private:
+	// Return (cached) bounding box of single glyph
+	static FTBBox glyphBox(uint character);
+	// Return (cached) advance from glyph to the next, accounting for kerning
+	static double glyphAdvance(uint character, uint nextCharacter);
 
 	public:
 	// Setup font specified
@@ -58,6 +71,8 @@ class FontInstance
 	static double fontFullHeight();
 	// Return base height of font
 	static double fontBaseHeight();
+	// Return version of font
+	static int fontVersion();
 	// Return bounding box for specified string
 	static FTBBox boundingBox(QString text);
 	// Calculate bounding box for specified string
@@ -0,0 +1,365 @@
+/*
+	*** Frame Timing
+	*** src/render/frametiming.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "render/frametiming.h"
+#include "base/messenger.h"
+#include <QOpenGLTimerQuery>
+#include <algorithm>
+
+/*
+ * Frame Timing Record
+ */
+
+// Constructor
+FrameTimingRecord::FrameTimingRecord() : ListItem<FrameTimingRecord>()
+{
+	time_ = 0.0;
+	count_ = 0;
+}
+
+// Set label for record
+void FrameTimingRecord::setLabel(QString label)
+{
+	label_ = label;
+}
+
+// Return label for record
+QString FrameTimingRecord::label() const
+{
+	return label_;
+}
+
+// Add time (ms) to record
+void FrameTimingRecord::addTime(double time, int count)
+{
+	time_ += time;
+	count_ += count;
+}
+
+// Return total time (ms) accumulated in record
+double FrameTimingRecord::time() const
+{
+	return time_;
+}
+
+// Return number of times added to record
+int FrameTimingRecord::count() const
+{
+	return count_;
+}
+
+/*
+ * Frame Timing
+ */
+
+// Static Members
+const int FrameTiming::historyLength_ = 100;
+
+// Constructor
+FrameTiming::FrameTiming()
+{
+	// Control
+	enabled_ = false;
+	showOverlay_ = false;
+
+	// Frame Data
+	meshRebuildTime_ = 0.0;
+	lastFrameTime_ = 0.0;
+	lastVerticesUploaded_ = 0;
+
+	// GPU Timing
+	gpuTimingAvailable_ = true;
+	nGpuQueriesUsed_ = 0;
+	gpuQueryOpen_ = false;
+
+	// Statistics
+	historyIndex_ = 0;
+	nFramesSinceLog_ = 0;
+}
+
+// Destructor
+FrameTiming::~FrameTiming()
+{
+	// Queries should have been released while their context was current, but make sure we don't leak the objects
+	for (int n=0; n<gpuQueries_.count(); ++n) delete gpuQueries_.at(n);
+}
+
+/*
+ * Control
+ */
+
+// Set whether detailed timing (and logging) is enabled
+void FrameTiming::setEnabled(bool enabled)
+{
+	enabled_ = enabled;
+
+	// Reset statistics
+	frameTimeHistory_.clear();
+	meshRebuildHistory_.clear();
+	verticesUploadedHistory_.clear();
+	historyIndex_ = 0;
+	nFramesSinceLog_ = 0;
+	logRecords_.clear();
+	lastFrameRecords_.clear();
+}
+
+// Return whether detailed timing (and logging) is enabled
+bool FrameTiming::enabled() const
+{
+	return enabled_;
+}
+
+// Set whether the timing overlay should be drawn
+void FrameTiming::setShowOverlay(bool show)
+{
+	showOverlay_ = show;
+}
+
+// Return whether the timing overlay should be drawn
+bool FrameTiming::showOverlay() const
+{
+	return showOverlay_;
+}
+
+/*
+ * Frame Data
+ */
+
+// Return record with specified label in list, creating it if necessary
+FrameTimingRecord* FrameTiming::record(List<FrameTimingRecord>& records, QString label)
+{
+	for (FrameTimingRecord* rec = records.first(); rec != NULL; rec = rec->next) if (rec->label() == label) return rec;
+
+	FrameTimingRecord* rec = records.add();
+	rec->setLabel(label);
+	return rec;
+}
+
+// Begin new frame
+void FrameTiming::beginFrame()
+{
+	frameRecords_.clear();
+	meshRebuildTime_ = 0.0;
+
+	// Results from last frame's GPU queries should now be available
+	if (enabled_) collectGpuResults();
+
+	frameTimer_.start();
+}
+
+// End current frame
+void FrameTiming::endFrame(long int verticesUploaded)
+{
+	lastFrameTime_ = frameTimer_.nsecsElapsed() * 1.0e-6;
+	lastVerticesUploaded_ = verticesUploaded;
+
+	if (!enabled_) return;
+
+	// Store frame data in rolling history
+	if (frameTimeHistory_.nItems() < historyLength_)
+	{
+		frameTimeHistory_.add(lastFrameTime_);
+		meshRebuildHistory_.add(meshRebuildTime_);
+		verticesUploadedHistory_.add(verticesUploaded);
+	}
+	else
+	{
+		frameTimeHistory_[historyIndex_] = lastFrameTime_;
+		meshRebuildHistory_[historyIndex_] = meshRebuildTime_;
+		verticesUploadedHistory_[historyIndex_] = verticesUploaded;
+	}
+	historyIndex_ = (historyIndex_ + 1) % historyLength_;
+
+	// Store records for this frame, and accumulate them for the log
+	lastFrameRecords_.clear();
+	for (FrameTimingRecord* rec = frameRecords_.first(); rec != NULL; rec = rec->next)
+	{
+		record(lastFrameRecords_, rec->label())->addTime(rec->time(), rec->count());
+		record(logRecords_, rec->label())->addTime(rec->time(), rec->count());
+	}
+
+	// Time to write the log?
+	++nFramesSinceLog_;
+	if (nFramesSinceLog_ == historyLength_) log();
+}
+
+// Add time (ms) to record with specified label
+void FrameTiming::addTime(QString label, double time)
+{
+	record(frameRecords_, label)->addTime(time);
+}
+
+// Add mesh regeneration time (ms)
+void FrameTiming::addMeshRebuildTime(double time)
+{
+	meshRebuildTime_ += time;
+}
+
+// Return total time (ms) taken by last completed frame
+double FrameTiming::lastFrameTime() const
+{
+	return lastFrameTime_;
+}
+
+/*
+ * GPU Timing
+ */
+
+// Collect any available GPU timer query results from last frame
+void FrameTiming::collectGpuResults()
+{
+	// Don't wait for results - if they aren't available yet, skip them
+	for (int n=0; n<nGpuQueriesUsed_; ++n)
+	{
+		QOpenGLTimerQuery* query = gpuQueries_.at(n);
+		if (!query->isResultAvailable()) continue;
+		addTime("GPU : " + gpuQueryLabels_.at(n), query->waitForResult() * 1.0e-6);
+	}
+	nGpuQueriesUsed_ = 0;
+}
+
+// Begin GPU-timed section with specified label (requires current GL context)
+void FrameTiming::beginGpuSection(QString label)
+{
+	if ((!enabled_) || (!gpuTimingAvailable_) || gpuQueryOpen_) return;
+
+	// Need a new query object?
+	if (nGpuQueriesUsed_ == gpuQueries_.count())
+	{
+		QOpenGLTimerQuery* query = new QOpenGLTimerQuery;
+		if (!query->create())
+		{
+			msg.print(Messenger::Verbose, "GPU timer queries are not available in this context.\n");
+			delete query;
+			gpuTimingAvailable_ = false;
+			return;
+		}
+		gpuQueries_.append(query);
+		gpuQueryLabels_.append(QString());
+	}
+
+	gpuQueryLabels_[nGpuQueriesUsed_] = label;
+	gpuQueries_.at(nGpuQueriesUsed_)->begin();
+	gpuQueryOpen_ = true;
+}
+
+// End current GPU-timed section
+void FrameTiming::endGpuSection()
+{
+	if (!gpuQueryOpen_) return;
+
+	gpuQueries_.at(nGpuQueriesUsed_)->end();
+	++nGpuQueriesUsed_;
+	gpuQueryOpen_ = false;
+}
+
+// Release GPU timer queries (requires the context in which they were created to be current)
+void FrameTiming::releaseGpuQueries()
+{
+	for (int n=0; n<gpuQueries_.count(); ++n)
+	{
+		gpuQueries_.at(n)->destroy();
+		delete gpuQueries_.at(n);
+	}
+	gpuQueries_.clear();
+	gpuQueryLabels_.clear();
+	nGpuQueriesUsed_ = 0;
+	gpuQueryOpen_ = false;
+}
+
+/*
+ * Statistics
+ */
+
+// Return specified percentile (0-100) of data in array
+double FrameTiming::percentile(Array<double>& data, double p)
+{
+	if (data.nItems() == 0) return 0.0;
+
+	// Sort a copy of the data
+	Array<double> sorted = data;
+	std::sort(sorted.array(), sorted.array() + sorted.nItems());
+
+	// Use nearest-rank method
+	int rank = int(p * 0.01 * sorted.nItems() + 0.5) - 1;
+	if (rank < 0) rank = 0;
+	else if (rank >= sorted.nItems()) rank = sorted.nItems() - 1;
+
+	return sorted[rank];
+}
+
+// Write summary of statistics since last log
+void FrameTiming::log()
+{
+	double totalVertices = 0.0;
+	for (int n=0; n<verticesUploadedHistory_.nItems(); ++n) totalVertices += verticesUploadedHistory_.value(n);
+
+	msg.print("Frame timing over last %i frames: frame p50 = %.2f ms, p95 = %.2f ms; mesh rebuild p50 = %.2f ms, p95 = %.2f ms; vertices uploaded = %.0f per frame.\n", nFramesSinceLog_, percentile(frameTimeHistory_, 50.0), percentile(frameTimeHistory_, 95.0), percentile(meshRebuildHistory_, 50.0), percentile(meshRebuildHistory_, 95.0), totalVertices / std::max(1, verticesUploadedHistory_.nItems()));
+	for (FrameTimingRecord* rec = logRecords_.first(); rec != NULL; rec = rec->next)
+	{
+		msg.print("    %-50s  %8.3f ms/frame\n", qPrintable(rec->label()), rec->time() / nFramesSinceLog_);
+	}
+
+	logRecords_.clear();
+	nFramesSinceLog_ = 0;
+}
+
+// Return summary text for current statistics
+QStringList FrameTiming::summary()
+{
+	QStringList lines;
+	lines << QString("Frame : %1 ms (p50 %2 ms, p95 %3 ms)").arg(lastFrameTime_, 0, 'f', 2).arg(percentile(frameTimeHistory_, 50.0), 0, 'f', 2).arg(percentile(frameTimeHistory_, 95.0), 0, 'f', 2);
+	lines << QString("Mesh rebuild : p50 %1 ms, p95 %2 ms").arg(percentile(meshRebuildHistory_, 50.0), 0, 'f', 2).arg(percentile(meshRebuildHistory_, 95.0), 0, 'f', 2);
+	lines << QString("Vertices uploaded : %1").arg(lastVerticesUploaded_);
+	for (FrameTimingRecord* rec = lastFrameRecords_.first(); rec != NULL; rec = rec->next) lines << QString("%1 : %2 ms").arg(rec->label()).arg(rec->time(), 0, 'f', 3);
+
+	return lines;
+}
+
+/*
+ * Scoped Frame Timer
+ */
+
+// Constructor
+FrameTimingScope::FrameTimingScope(FrameTiming* timing, QString label)
+{
+	timing_ = timing;
+	if (timing_)
+	{
+		label_ = label;
+		timer_.start();
+	}
+}
+
+// Destructor
+FrameTimingScope::~FrameTimingScope()
+{
+	stop();
+}
+
+// Stop timer and record elapsed time
+void FrameTimingScope::stop()
+{
+	if (!timing_) return;
+
+	timing_->addTime(label_, timer_.nsecsElapsed() * 1.0e-6);
+	timing_ = NULL;
+}
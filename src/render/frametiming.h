@@ -0,0 +1,201 @@
+/*
+	*** Frame Timing
+	*** src/render/frametiming.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_FRAMETIMING_H
+#define UCHROMA_FRAMETIMING_H
+
+#include "templates/list.h"
+#include "templates/array.h"
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QElapsedTimer>
+
+// Forward Declarations
+class QOpenGLTimerQuery;
+
+// Frame Timing Record
+class FrameTimingRecord : public ListItem<FrameTimingRecord>
+{
+	public:
+	// Constructor
+	FrameTimingRecord();
+
+	private:
+	// Label for record
+	QString label_;
+	// Total time (ms) accumulated in record
+	double time_;
+	// Number of times added to record
+	int count_;
+
+	public:
+	// Set label for record
+	void setLabel(QString label);
+	// Return label for record
+	QString label() const;
+	// Add time (ms) to record
+	void addTime(double time, int count = 1);
+	// Return total time (ms) accumulated in record
+	double time() const;
+	// Return number of times added to record
+	int count() const;
+};
+
+// Frame Timing
+class FrameTiming
+{
+	public:
+	// Constructor / Destructor
+	FrameTiming();
+	~FrameTiming();
+
+
+	/*
+	 * Control
+	 */
+	private:
+	// Whether detailed timing (and logging) is enabled
+	bool enabled_;
+	// Whether the timing overlay should be drawn
+	bool showOverlay_;
+
+	public:
+	// Set whether detailed timing (and logging) is enabled
+	void setEnabled(bool enabled);
+	// Return whether detailed timing (and logging) is enabled
+	bool enabled() const;
+	// Set whether the timing overlay should be drawn
+	void setShowOverlay(bool show);
+	// Return whether the timing overlay should be drawn
+	bool showOverlay() const;
+
+
+	/*
+	 * Frame Data
+	 */
+	private:
+	// Timer for current frame
+	QElapsedTimer frameTimer_;
+	// Timing records for current frame
+	List<FrameTimingRecord> frameRecords_;
+	// Timing records for last completed frame
+	List<FrameTimingRecord> lastFrameRecords_;
+	// Timing records accumulated since last log
+	List<FrameTimingRecord> logRecords_;
+	// Time (ms) spent regenerating meshes in current frame
+	double meshRebuildTime_;
+	// Total time (ms) taken by last completed frame
+	double lastFrameTime_;
+	// Number of vertices uploaded in last completed frame
+	long int lastVerticesUploaded_;
+
+	private:
+	// Return record with specified label in list, creating it if necessary
+	FrameTimingRecord* record(List<FrameTimingRecord>& records, QString label);
+
+	public:
+	// Begin new frame
+	void beginFrame();
+	// End current frame
+	void endFrame(long int verticesUploaded);
+	// Add time (ms) to record with specified label
+	void addTime(QString label, double time);
+	// Add mesh regeneration time (ms)
+	void addMeshRebuildTime(double time);
+	// Return total time (ms) taken by last completed frame
+	double lastFrameTime() const;
+
+
+	/*
+	 * GPU Timing
+	 */
+	private:
+	// Whether GPU timer queries are (potentially) available
+	bool gpuTimingAvailable_;
+	// Pool of GPU timer queries
+	QList<QOpenGLTimerQuery*> gpuQueries_;
+	// Labels for GPU timer queries issued in last frame
+	QStringList gpuQueryLabels_;
+	// Number of GPU timer queries issued in last frame
+	int nGpuQueriesUsed_;
+	// Whether a GPU timer query is currently open
+	bool gpuQueryOpen_;
+
+	private:
+	// Collect any available GPU timer query results from last frame
+	void collectGpuResults();
+
+	public:
+	// Begin GPU-timed section with specified label (requires current GL context)
+	void beginGpuSection(QString label);
+	// End current GPU-timed section
+	void endGpuSection();
+	// Release GPU timer queries (requires the context in which they were created to be current)
+	void releaseGpuQueries();
+
+
+	/*
+	 * Statistics
+	 */
+	private:
+	// Number of frames in rolling history, and between log outputs
+	static const int historyLength_;
+	// Rolling history of frame times (ms), mesh regeneration times (ms), and vertices uploaded
+	Array<double> frameTimeHistory_, meshRebuildHistory_, verticesUploadedHistory_;
+	// Index of next entry in history
+	int historyIndex_;
+	// Number of frames since last log
+	int nFramesSinceLog_;
+
+	private:
+	// Return specified percentile (0-100) of data in array
+	static double percentile(Array<double>& data, double p);
+	// Write summary of statistics since last log
+	void log();
+
+	public:
+	// Return summary text for current statistics
+	QStringList summary();
+};
+
+// Scoped Frame Timer
+class FrameTimingScope
+{
+	public:
+	// Constructor / Destructor
+	FrameTimingScope(FrameTiming* timing, QString label);
+	~FrameTimingScope();
+
+	private:
+	// Target FrameTiming (or NULL if inactive)
+	FrameTiming* timing_;
+	// Label for timing
+	QString label_;
+	// Timer
+	QElapsedTimer timer_;
+
+	public:
+	// Stop timer and record elapsed time
+	void stop();
+};
+
+#endif
@@ -0,0 +1,200 @@
+/*
+	*** GL Resource Manager
+	*** src/render/glresourcemanager.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "render/glresourcemanager.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QMutexLocker>
+
+// Static Members
+// -- The lists are created on first use and never destroyed, since primitives may release their resources during static destruction
+List<GLResource>* GLResourceManager::resources_ = NULL;
+List<GLResource>* GLResourceManager::releasedResources_ = NULL;
+QMutex GLResourceManager::mutex_;
+
+/*
+ * GL Resource
+ */
+
+// Constructor
+GLResource::GLResource() : ListItem<GLResource>()
+{
+	type_ = GLResource::BufferResource;
+	object_ = 0;
+	shareGroup_ = NULL;
+	owner_ = NULL;
+	size_ = 0;
+	refCount_ = 0;
+}
+
+// Return type of resource
+GLResource::ResourceType GLResource::type() const
+{
+	return type_;
+}
+
+// Return GL object name
+GLuint GLResource::object() const
+{
+	return object_;
+}
+
+// Return owner of the resource
+const void* GLResource::owner() const
+{
+	return owner_;
+}
+
+// Return size (in bytes) of data stored in the resource
+long int GLResource::size() const
+{
+	return size_;
+}
+
+// Return whether the resource is used by more than one user
+bool GLResource::isShared() const
+{
+	return (refCount_ > 1);
+}
+
+// Return whether the resource may be used in the specified context
+bool GLResource::usableIn(const QOpenGLContext* context) const
+{
+	return (context && (context->shareGroup() == shareGroup_));
+}
+
+/*
+ * GL Resource Manager
+ */
+
+// Return list of resources currently in use
+List<GLResource>& GLResourceManager::resources()
+{
+	if (resources_ == NULL) resources_ = new List<GLResource>;
+	return *resources_;
+}
+
+// Return list of resources awaiting deletion
+List<GLResource>& GLResourceManager::releasedResources()
+{
+	if (releasedResources_ == NULL) releasedResources_ = new List<GLResource>;
+	return *releasedResources_;
+}
+
+// Create new resource of the specified type in the supplied (current) context
+GLResource* GLResourceManager::create(GLResource::ResourceType type, const QOpenGLContext* context, const void* owner)
+{
+	// Generate GL object
+	GLuint object = 0;
+	if (type == GLResource::BufferResource) context->functions()->glGenBuffers(1, &object);
+	else if (type == GLResource::DisplayListResource) object = glGenLists(1);
+	else if (type == GLResource::TextureResource) glGenTextures(1, &object);
+	if (object == 0)
+	{
+		printf("Internal Error: Failed to generate GL object of type %i in GLResourceManager::create().\n", type);
+		return NULL;
+	}
+
+	QMutexLocker locker(&mutex_);
+	GLResource* resource = resources().add();
+	resource->type_ = type;
+	resource->object_ = object;
+	resource->shareGroup_ = context->shareGroup();
+	resource->owner_ = owner;
+	resource->refCount_ = 1;
+
+	return resource;
+}
+
+// Add a user to the specified resource
+GLResource* GLResourceManager::reference(GLResource* resource)
+{
+	QMutexLocker locker(&mutex_);
+	if (resource) ++resource->refCount_;
+	return resource;
+}
+
+// Remove a user from the specified resource, queueing it for deletion if it is no longer used
+void GLResourceManager::release(GLResource* resource)
+{
+	if (resource == NULL) return;
+
+	QMutexLocker locker(&mutex_);
+	--resource->refCount_;
+	if (resource->refCount_ > 0) return;
+
+	// The GL object can only be deleted while a context in its share group is current, so leave that to deleteReleased()
+	resources().disown(resource);
+	releasedResources().own(resource);
+}
+
+// Set size (in bytes) of data stored in resource
+void GLResourceManager::setSize(GLResource* resource, long int size)
+{
+	QMutexLocker locker(&mutex_);
+	if (resource) resource->size_ = size;
+}
+
+// Delete released resources belonging to the share group of the supplied (current) context
+void GLResourceManager::deleteReleased(const QOpenGLContext* context)
+{
+	QMutexLocker locker(&mutex_);
+	if ((releasedResources_ == NULL) || (context == NULL)) return;
+
+	GLResource* resource = releasedResources_->first(), *nextResource;
+	while (resource)
+	{
+		nextResource = resource->next;
+		if (resource->usableIn(context))
+		{
+			if (resource->type_ == GLResource::BufferResource) context->functions()->glDeleteBuffers(1, &resource->object_);
+			else if (resource->type_ == GLResource::DisplayListResource) glDeleteLists(resource->object_, 1);
+			else if (resource->type_ == GLResource::TextureResource) glDeleteTextures(1, &resource->object_);
+			releasedResources_->remove(resource);
+		}
+		resource = nextResource;
+	}
+}
+
+// Return total size (in bytes) of resources belonging to the specified owner
+long int GLResourceManager::bytesUsed(const void* owner)
+{
+	QMutexLocker locker(&mutex_);
+	long int bytes = 0;
+	for (GLResource* resource = resources().first(); resource != NULL; resource = resource->next) if (resource->owner_ == owner) bytes += resource->size_;
+	return bytes;
+}
+
+// Return total size (in bytes) of all resources currently in use
+long int GLResourceManager::totalBytesUsed()
+{
+	QMutexLocker locker(&mutex_);
+	long int bytes = 0;
+	for (GLResource* resource = resources().first(); resource != NULL; resource = resource->next) bytes += resource->size_;
+	return bytes;
+}
+
+// Return number of resources currently in use
+int GLResourceManager::nResources()
+{
+	QMutexLocker locker(&mutex_);
+	return resources().nItems();
+}
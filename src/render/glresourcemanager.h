@@ -0,0 +1,117 @@
+/*
+	*** GL Resource Manager
+	*** src/render/glresourcemanager.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_GLRESOURCEMANAGER_H
+#define UCHROMA_GLRESOURCEMANAGER_H
+
+#ifndef __APPLE__
+#include <GL/gl.h>
+#else
+#include <OpenGL/gl3.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#include "glext.h"
+#endif
+#include "templates/list.h"
+#include <QMutex>
+
+// Forward Declarations
+class QOpenGLContext;
+class QOpenGLContextGroup;
+
+// GL Resource
+class GLResource : public ListItem<GLResource>
+{
+	public:
+	// Constructor
+	GLResource();
+	// Resource Type
+	enum ResourceType { BufferResource, DisplayListResource, TextureResource };
+	// Friend class
+	friend class GLResourceManager;
+
+	private:
+	// Type of resource
+	ResourceType type_;
+	// GL object name
+	GLuint object_;
+	// Share group of the context in which the resource was created
+	QOpenGLContextGroup* shareGroup_;
+	// Owner of the resource (e.g. source collection) used when reporting memory usage
+	const void* owner_;
+	// Size (in bytes) of data stored in the resource
+	long int size_;
+	// Number of users of the resource
+	int refCount_;
+
+	public:
+	// Return type of resource
+	ResourceType type() const;
+	// Return GL object name
+	GLuint object() const;
+	// Return owner of the resource
+	const void* owner() const;
+	// Return size (in bytes) of data stored in the resource
+	long int size() const;
+	// Return whether the resource is used by more than one user
+	bool isShared() const;
+	// Return whether the resource may be used in the specified context
+	bool usableIn(const QOpenGLContext* context) const;
+};
+
+// GL Resource Manager
+class GLResourceManager
+{
+	private:
+	// Resources currently in use
+	static List<GLResource>* resources_;
+	// Resources no longer in use, awaiting deletion when a context in their share group is current
+	static List<GLResource>* releasedResources_;
+	// Mutex protecting the lists and reference counts (primitives may be destroyed while constructing meshes on worker threads)
+	static QMutex mutex_;
+
+	private:
+	// Return list of resources currently in use
+	static List<GLResource>& resources();
+	// Return list of resources awaiting deletion
+	static List<GLResource>& releasedResources();
+
+	public:
+	// Create new resource of the specified type in the supplied (current) context
+	static GLResource* create(GLResource::ResourceType type, const QOpenGLContext* context, const void* owner);
+	// Add a user to the specified resource
+	static GLResource* reference(GLResource* resource);
+	// Remove a user from the specified resource, queueing it for deletion if it is no longer used
+	static void release(GLResource* resource);
+	// Set size (in bytes) of data stored in resource
+	static void setSize(GLResource* resource, long int size);
+	// Delete released resources belonging to the share group of the supplied (current) context
+	static void deleteReleased(const QOpenGLContext* context);
+	// Return total size (in bytes) of resources belonging to the specified owner
+	static long int bytesUsed(const void* owner);
+	// Return total size (in bytes) of all resources currently in use
+	static long int totalBytesUsed();
+	// Return number of resources currently in use
+	static int nResources();
+};
+
+#endif
@@ -0,0 +1,691 @@
+/*
+	*** Image Primitive
+	*** src/render/imageprimitive.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "render/imageprimitive.h"
+#include "base/axes.h"
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#endif
+#include <algorithm>
+#include <math.h>
+
+// Texture formats which may not be defined by older GL headers
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_R32F
+#define GL_R32F 0x822E
+#endif
+#ifndef GL_RG32F
+#define GL_RG32F 0x8230
+#endif
+
+// Number of entries in colour table
+#define IMAGECOLOURTABLESIZE 1024
+// Maximum number of entries in coordinate remap tables
+#define IMAGEMAXREMAPSIZE 4096
+
+// Fragment shader used to colour the image
+// Texture coordinates give the fractional position across the image, which is remapped onto the (possibly non-uniform) grid before looking up the value and its colour
+const char* ImageFragmentShader =
+	"#version 110\n"
+	"uniform sampler2D values;\n"
+	"uniform sampler1D colours;\n"
+	"uniform sampler1D remapX;\n"
+	"uniform sampler1D remapZ;\n"
+	"uniform vec2 remapSize;\n"
+	"uniform vec2 colourRange;\n"
+	"uniform float colourTableSize;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 u = gl_TexCoord[0].st;\n"
+	"	vec2 t = vec2(texture1D(remapX, (u.s*(remapSize.x-1.0)+0.5)/remapSize.x).r, texture1D(remapZ, (u.t*(remapSize.y-1.0)+0.5)/remapSize.y).r);\n"
+	"	vec4 v = texture2D(values, t);\n"
+	"	if (v.g < 0.5) discard;\n"
+	"	float c = clamp((v.r/v.g - colourRange.x) * colourRange.y, 0.0, 1.0);\n"
+	"	gl_FragColor = texture1D(colours, (c*(colourTableSize-1.0)+0.5)/colourTableSize);\n"
+	"}\n";
+
+/*
+ * Image Instance
+ */
+
+// Constructor
+ImageInstance::ImageInstance() : ListItem<ImageInstance>()
+{
+	context_ = NULL;
+	shaderAvailable_ = false;
+	useShader_ = false;
+	program_ = NULL;
+	valueTexture_ = NULL;
+	colourTexture_ = NULL;
+	remapTextures_[0] = NULL;
+	remapTextures_[1] = NULL;
+	imageTexture_ = NULL;
+	dataVersion_ = -1;
+	colourVersion_ = -1;
+}
+
+// Destructor
+ImageInstance::~ImageInstance()
+{
+	releaseTextures();
+}
+
+// Release textures
+void ImageInstance::releaseTextures()
+{
+	// Textures are deleted by the resource manager once a context in their share group is current
+	GLResourceManager::release(valueTexture_);
+	GLResourceManager::release(colourTexture_);
+	GLResourceManager::release(remapTextures_[0]);
+	GLResourceManager::release(remapTextures_[1]);
+	GLResourceManager::release(imageTexture_);
+	valueTexture_ = NULL;
+	colourTexture_ = NULL;
+	remapTextures_[0] = NULL;
+	remapTextures_[1] = NULL;
+	imageTexture_ = NULL;
+}
+
+/*
+ * Image Primitive
+ */
+
+// Constructor
+ImagePrimitive::ImagePrimitive()
+{
+	nX_ = 0;
+	nZ_ = 0;
+	dataVersion_ = 0;
+	valuesReleased_ = false;
+	colourMin_ = 0.0;
+	colourScale_ = 0.0;
+	colourVersion_ = 0;
+	imageWidth_ = 0;
+	imageHeight_ = 0;
+	imageDataVersion_ = -1;
+	imageColourVersion_ = -1;
+	owner_ = NULL;
+}
+
+// Destructor
+ImagePrimitive::~ImagePrimitive()
+{
+	for (ImageInstance* instance = instances_.first(); instance != NULL; instance = instance->next) if (instance->program_) delete instance->program_;
+}
+
+/*
+ * Grid Data
+ */
+
+// Sort supplied local axes coordinates, returning their order and fractional positions across the overall extent
+void ImagePrimitive::sortPositions(Array<double>& coordinates, Array<int>& order, Array<double>& positions)
+{
+	int nPoints = coordinates.nItems(), n;
+	order.createEmpty(nPoints);
+	int* indices = order.array();
+	for (n=0; n<nPoints; ++n) indices[n] = n;
+	const double* values = coordinates.constArray();
+	std::stable_sort(indices, indices + nPoints, [values](int a, int b) { return values[a] < values[b]; });
+
+	double minValue = values[indices[0]], range = values[indices[nPoints-1]] - minValue;
+	positions.createEmpty(nPoints);
+	for (n=0; n<nPoints; ++n) positions[n] = (range > 0.0 ? (values[indices[n]] - minValue) / range : 0.0);
+}
+
+// Calculate fractional grid indices at evenly-spaced positions across the image, using the supplied grid positions
+void ImagePrimitive::fractionalIndices(const Array<double>& positions, int nSamples, Array<double>& indices)
+{
+	const double* q = positions.constArray();
+	int nPoints = positions.nItems(), i = 0;
+	indices.createEmpty(nSamples);
+	double u, delta;
+	for (int k=0; k<nSamples; ++k)
+	{
+		u = (nSamples > 1 ? double(k) / (nSamples-1) : 0.0);
+		while ((i < nPoints-2) && (q[i+1] < u)) ++i;
+		delta = q[i+1] - q[i];
+		indices[k] = std::min(std::max(delta > 0.0 ? i + (u - q[i]) / delta : double(i), 0.0), double(nPoints-1));
+	}
+}
+
+// Generate grid data from display data, within the limits of the supplied axes
+void ImagePrimitive::generate(const Axes& axes, const Array<double>& abscissa, List<DisplayDataSet>& displayData)
+{
+	valuesReleased_ = false;
+
+	// Select points and slices which lie within the axis limits, along with their local axes coordinates
+	Array<int> columns, rows, orderX, orderZ;
+	Array<double> coordinates;
+	int n;
+	coordinates.reserve(abscissa.nItems());
+	columns.reserve(abscissa.nItems());
+	for (n=0; n<abscissa.nItems(); ++n)
+	{
+		double x = abscissa.value(n);
+		if ((x < axes.min(0)) || (x > axes.max(0))) continue;
+		columns.add(n);
+		coordinates.add(axes.transformX(x));
+	}
+	if (columns.nItems() < 2)
+	{
+		clear();
+		return;
+	}
+	sortPositions(coordinates, orderX, positions_[0]);
+	cornerMin_.x = coordinates.value(orderX.value(0));
+	cornerMax_.x = coordinates.value(orderX.value(columns.nItems()-1));
+
+	coordinates.reserve(displayData.nItems());
+	rows.reserve(displayData.nItems());
+	n = 0;
+	for (DisplayDataSet* displayDataSet = displayData.first(); displayDataSet != NULL; displayDataSet = displayDataSet->next, ++n)
+	{
+		double z = displayDataSet->z();
+		if ((z < axes.min(2)) || (z > axes.max(2))) continue;
+		rows.add(n);
+		coordinates.add(axes.transformZ(z));
+	}
+	if (rows.nItems() < 2)
+	{
+		clear();
+		return;
+	}
+	sortPositions(coordinates, orderZ, positions_[1]);
+	cornerMin_.z = coordinates.value(orderZ.value(0));
+	cornerMax_.z = coordinates.value(orderZ.value(rows.nItems()-1));
+
+	// Image lies in the plane at the bottom of the vertical axis
+	cornerMin_.y = std::min(axes.transformY(axes.min(1)), axes.transformY(axes.max(1)));
+	cornerMax_.y = cornerMin_.y;
+
+	// Store values, premultiplied by their validity so that missing points do not contribute when interpolating
+	nX_ = columns.nItems();
+	nZ_ = rows.nItems();
+	values_.createEmpty(nX_*nZ_*2);
+	GLfloat* values = values_.array();
+	bool logarithmic = axes.logarithmic(1);
+	for (int j=0; j<nZ_; ++j)
+	{
+		DisplayDataSet* displayDataSet = displayData[rows.value(orderZ.value(j))];
+		const double* y = displayDataSet->y().constArray();
+		const DisplayDataSet::DataPointType* yType = displayDataSet->yType().constArray();
+		int nPoints = std::min(displayDataSet->y().nItems(), displayDataSet->yType().nItems());
+		GLfloat* row = values + j*nX_*2;
+		for (int i=0; i<nX_; ++i)
+		{
+			int index = columns.value(orderX.value(i));
+			if ((index >= nPoints) || (yType[index] == DisplayDataSet::NoPoint) || (logarithmic && (y[index] <= 0.0))) continue;
+			row[i*2] = y[index];
+			row[i*2+1] = 1.0;
+		}
+	}
+
+	// Create coordinate remap tables - evenly-spaced grids need only their end points, since the remap is then linear
+	for (int axis=0; axis<2; ++axis)
+	{
+		int nPoints = positions_[axis].nItems(), nSamples = 2;
+		for (n=1; n<nPoints-1; ++n) if (fabs(positions_[axis].value(n) - double(n)/(nPoints-1)) > 1.0e-6) break;
+		if (n < nPoints-1) nSamples = std::min(nPoints*8, IMAGEMAXREMAPSIZE);
+		Array<double> indices;
+		fractionalIndices(positions_[axis], nSamples, indices);
+		remap_[axis].createEmpty(nSamples);
+		for (n=0; n<nSamples; ++n) remap_[axis][n] = (indices.value(n) + 0.5) / nPoints;
+	}
+}
+
+// Release grid values if they have been uploaded to all instances, and are not needed to generate a colour image
+void ImagePrimitive::releaseUploadedValues()
+{
+	if (valuesReleased_ || (!hasImage()) || (instances_.nItems() == 0)) return;
+	for (ImageInstance* instance = instances_.first(); instance != NULL; instance = instance->next) if ((!instance->useShader_) || (instance->dataVersion_ != dataVersion_)) return;
+
+	values_.releaseStorage();
+	valuesReleased_ = true;
+}
+
+// Set grid data from display data, within the limits of the supplied axes
+void ImagePrimitive::set(const Axes& axes, const Array<double>& abscissa, List<DisplayDataSet>& displayData)
+{
+	++dataVersion_;
+
+	generate(axes, abscissa, displayData);
+}
+
+// Return whether grid values must be restored before updating the instance for the specified context (or pushing a new one)
+bool ImagePrimitive::valuesRequired(const QOpenGLContext* context, bool push) const
+{
+	if (!valuesReleased_) return false;
+
+	// A new instance needs everything uploading, while an existing shader instance needs only the colour table once its values are uploaded
+	ImageInstance* instance = instances_.last();
+	if (push || (instance == NULL) || (instance->context_ != context)) return true;
+	return ((!instance->useShader_) || (instance->dataVersion_ != dataVersion_));
+}
+
+// Restore released grid values from the display data they were set from
+void ImagePrimitive::restoreValues(const Axes& axes, const Array<double>& abscissa, List<DisplayDataSet>& displayData)
+{
+	if (!valuesReleased_) return;
+
+	// The display data is unchanged since the grid was set, so the grid version is kept (and existing textures remain valid)
+	generate(axes, abscissa, displayData);
+}
+
+// Clear grid data
+void ImagePrimitive::clear()
+{
+	++dataVersion_;
+	valuesReleased_ = false;
+	nX_ = 0;
+	nZ_ = 0;
+	values_.releaseStorage();
+	positions_[0].releaseStorage();
+	positions_[1].releaseStorage();
+	remap_[0].releaseStorage();
+	remap_[1].releaseStorage();
+	image_.releaseStorage();
+	imageDataVersion_ = -1;
+}
+
+// Return whether there is an image to display
+bool ImagePrimitive::hasImage() const
+{
+	return ((nX_ > 1) && (nZ_ > 1));
+}
+
+// Return corner of image (0-3, anticlockwise from minimum x and z) in local axes coordinates
+Vec3<double> ImagePrimitive::corner(int index) const
+{
+	if (index == 1) return Vec3<double>(cornerMax_.x, cornerMin_.y, cornerMin_.z);
+	else if (index == 2) return Vec3<double>(cornerMax_.x, cornerMin_.y, cornerMax_.z);
+	else if (index == 3) return Vec3<double>(cornerMin_.x, cornerMin_.y, cornerMax_.z);
+	return cornerMin_;
+}
+
+/*
+ * Colour
+ */
+
+// Set colour table from supplied colour scale
+void ImagePrimitive::setColourScale(const ColourScale& colourScale)
+{
+	++colourVersion_;
+
+	// Determine range of values covered by colour scale
+	double minValue = 0.0, maxValue = 0.0;
+	if (colourScale.firstPoint())
+	{
+		minValue = colourScale.firstPoint()->value();
+		maxValue = minValue;
+		for (ColourScalePoint* point = colourScale.firstPoint(); point != NULL; point = point->next)
+		{
+			if (point->value() < minValue) minValue = point->value();
+			else if (point->value() > maxValue) maxValue = point->value();
+		}
+	}
+	colourMin_ = minValue;
+	colourScale_ = (maxValue > minValue ? 1.0 / (maxValue - minValue) : 0.0);
+
+	// Sample colour scale at evenly-spaced values
+	colourTable_.createEmpty(IMAGECOLOURTABLESIZE*4);
+	GLfloat* table = colourTable_.array();
+	Vec4<GLfloat> colour;
+	for (int n=0; n<IMAGECOLOURTABLESIZE; ++n)
+	{
+		colourScale.colour(minValue + (maxValue - minValue) * n / (IMAGECOLOURTABLESIZE-1), colour);
+		table[n*4] = colour.x;
+		table[n*4+1] = colour.y;
+		table[n*4+2] = colour.z;
+		table[n*4+3] = colour.w;
+	}
+}
+
+/*
+ * Colour Image (CPU Fallback)
+ */
+
+// Update colour image, with maximum size specified
+void ImagePrimitive::updateImage(int maxSize)
+{
+	if ((imageDataVersion_ == dataVersion_) && (imageColourVersion_ == colourVersion_) && (imageWidth_ <= maxSize) && (imageHeight_ <= maxSize)) return;
+	imageDataVersion_ = dataVersion_;
+	imageColourVersion_ = colourVersion_;
+
+	if ((!hasImage()) || (colourTable_.nItems() == 0))
+	{
+		image_.releaseStorage();
+		imageWidth_ = 0;
+		imageHeight_ = 0;
+		return;
+	}
+
+	// Resample grid onto evenly-spaced positions across the image, so that a single textured quad can be drawn
+	imageWidth_ = std::min(nX_, maxSize);
+	imageHeight_ = std::min(nZ_, maxSize);
+	Array<double> indicesX, indicesZ;
+	fractionalIndices(positions_[0], imageWidth_, indicesX);
+	fractionalIndices(positions_[1], imageHeight_, indicesZ);
+	image_.createEmpty(imageWidth_*imageHeight_*4);
+	GLubyte* pixel = image_.array();
+	const GLfloat* values = values_.constArray();
+	const GLfloat* table = colourTable_.constArray();
+	const GLfloat* rowA, *rowB;
+	double fx, fz, value, weight, weights[4];
+	int i0, i1, j0, j1, entry, n;
+	for (int b=0; b<imageHeight_; ++b)
+	{
+		j0 = std::min(int(indicesZ.value(b)), nZ_-2);
+		j1 = j0 + 1;
+		fz = indicesZ.value(b) - j0;
+		rowA = values + j0*nX_*2;
+		rowB = values + j1*nX_*2;
+		for (int a=0; a<imageWidth_; ++a, pixel += 4)
+		{
+			i0 = std::min(int(indicesX.value(a)), nX_-2);
+			i1 = i0 + 1;
+			fx = indicesX.value(a) - i0;
+
+			// Bilinear interpolation of values, ignoring missing points
+			weights[0] = (1.0-fx)*(1.0-fz);
+			weights[1] = fx*(1.0-fz);
+			weights[2] = (1.0-fx)*fz;
+			weights[3] = fx*fz;
+			value = weights[0]*rowA[i0*2] + weights[1]*rowA[i1*2] + weights[2]*rowB[i0*2] + weights[3]*rowB[i1*2];
+			weight = weights[0]*rowA[i0*2+1] + weights[1]*rowA[i1*2+1] + weights[2]*rowB[i0*2+1] + weights[3]*rowB[i1*2+1];
+			if (weight < 0.5)
+			{
+				pixel[0] = 0;
+				pixel[1] = 0;
+				pixel[2] = 0;
+				pixel[3] = 0;
+				continue;
+			}
+
+			// Look up colour
+			value = std::min(std::max((value/weight - colourMin_) * colourScale_, 0.0), 1.0);
+			entry = int(value * (IMAGECOLOURTABLESIZE-1) + 0.5) * 4;
+			for (n=0; n<4; ++n) pixel[n] = GLubyte(table[entry+n] * 255.0 + 0.5);
+		}
+	}
+}
+
+/*
+ * Instances
+ */
+
+// Return whether the specified context supports colouring the image with a shader
+bool ImagePrimitive::shaderAvailable(const QOpenGLContext* context)
+{
+	if (context->isOpenGLES()) return false;
+	if (!context->functions()->hasOpenGLFeature(QOpenGLFunctions::Shaders)) return false;
+
+	// Floating-point, single / dual channel textures are required to hold the grid values and remap tables
+	if (context->format().majorVersion() >= 3) return true;
+	return (context->hasExtension("GL_ARB_texture_float") && context->hasExtension("GL_ARB_texture_rg"));
+}
+
+// Bind specified texture (creating it in the instance's context if necessary) and set its sampling parameters
+void ImagePrimitive::bindTexture(ImageInstance* instance, GLenum target, GLResource*& texture)
+{
+	if (texture == NULL) texture = GLResourceManager::create(GLResource::TextureResource, instance->context_, owner_);
+	glBindTexture(target, texture ? texture->object() : 0);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	if (target == GL_TEXTURE_2D) glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+// Upload data to textures in supplied instance
+void ImagePrimitive::uploadTextures(ImageInstance* instance)
+{
+	// Nothing to do if the instance is already up to date, or there is nothing to display
+	bool dataChanged = (instance->dataVersion_ != dataVersion_), colourChanged = (instance->colourVersion_ != colourVersion_);
+	if ((!dataChanged) && (!colourChanged)) return;
+	if (!hasImage())
+	{
+		instance->releaseTextures();
+		instance->dataVersion_ = dataVersion_;
+		instance->colourVersion_ = colourVersion_;
+		return;
+	}
+
+	// Clear the error flag
+	glGetError();
+
+	// Grab the QOpenGLFunctions object pointer
+	QOpenGLFunctions* glFunctions = instance->context_->functions();
+	glFunctions->glActiveTexture(GL_TEXTURE0);
+
+	// The grid and remap tables must fit within the maximum texture size in order to use the shader
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	bool useShader = instance->shaderAvailable_ && (nX_ <= maxSize) && (nZ_ <= maxSize) && (remap_[0].nItems() <= maxSize) && (remap_[1].nItems() <= maxSize);
+	if (useShader && (instance->program_ == NULL))
+	{
+		instance->program_ = new QOpenGLShaderProgram;
+		if ((!instance->program_->addShaderFromSourceCode(QOpenGLShader::Fragment, ImageFragmentShader)) || (!instance->program_->link()))
+		{
+			printf("Failed to create shader program for image display - colours will be generated on the CPU instead.\n%s\n", qPrintable(instance->program_->log()));
+			delete instance->program_;
+			instance->program_ = NULL;
+			instance->shaderAvailable_ = false;
+			useShader = false;
+		}
+	}
+
+	// If we have switched between shader and CPU colouring, remove the old textures and upload everything
+	if (useShader != instance->useShader_)
+	{
+		instance->releaseTextures();
+		instance->useShader_ = useShader;
+		dataChanged = true;
+		colourChanged = true;
+	}
+
+	if (useShader)
+	{
+		// Upload grid values and remap tables when the data has changed, and the colour table when the colour scale has changed
+		if (dataChanged)
+		{
+			bindTexture(instance, GL_TEXTURE_2D, instance->valueTexture_);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, nX_, nZ_, 0, GL_RG, GL_FLOAT, values_.constArray());
+			GLResourceManager::setSize(instance->valueTexture_, long(nX_) * nZ_ * 2 * sizeof(GLfloat));
+			for (int axis=0; axis<2; ++axis)
+			{
+				bindTexture(instance, GL_TEXTURE_1D, instance->remapTextures_[axis]);
+				glTexImage1D(GL_TEXTURE_1D, 0, GL_R32F, remap_[axis].nItems(), 0, GL_RED, GL_FLOAT, remap_[axis].constArray());
+				GLResourceManager::setSize(instance->remapTextures_[axis], remap_[axis].nItems() * sizeof(GLfloat));
+			}
+		}
+		if (colourChanged)
+		{
+			bindTexture(instance, GL_TEXTURE_1D, instance->colourTexture_);
+			glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, IMAGECOLOURTABLESIZE, 0, GL_RGBA, GL_FLOAT, colourTable_.constArray());
+			GLResourceManager::setSize(instance->colourTexture_, IMAGECOLOURTABLESIZE * 4);
+		}
+		glBindTexture(GL_TEXTURE_1D, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		// If the upload failed (e.g. through lack of memory for the float texture), generate colours on the CPU instead
+		if (glGetError() != GL_NO_ERROR)
+		{
+			printf("Error occurred while uploading textures for image display - colours will be generated on the CPU instead.\n");
+			instance->shaderAvailable_ = false;
+			instance->dataVersion_ = -1;
+			uploadTextures(instance);
+			return;
+		}
+	}
+	else
+	{
+		// Regenerate colour image, and upload it
+		updateImage(maxSize);
+		bindTexture(instance, GL_TEXTURE_2D, instance->imageTexture_);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imageWidth_, imageHeight_, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_.constArray());
+		GLResourceManager::setSize(instance->imageTexture_, long(imageWidth_) * imageHeight_ * 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	instance->dataVersion_ = dataVersion_;
+	instance->colourVersion_ = colourVersion_;
+}
+
+// Set owner of GL resources created for instances
+void ImagePrimitive::setOwner(const void* owner)
+{
+	owner_ = owner;
+}
+
+// Push instance layer from current data
+void ImagePrimitive::pushInstance(const QOpenGLContext* context)
+{
+	ImageInstance* instance = instances_.add();
+	instance->context_ = context;
+	instance->shaderAvailable_ = shaderAvailable(context);
+	uploadTextures(instance);
+	releaseUploadedValues();
+}
+
+// Pop topmost instance layer
+void ImagePrimitive::popInstance(const QOpenGLContext* context)
+{
+	ImageInstance* instance = instances_.last();
+	if (instance == NULL) return;
+
+	// Textures are released when the instance is removed, and deleted once a context in their share group is current
+	if (instance->context_ == context)
+	{
+		if (instance->program_) delete instance->program_;
+		instance->program_ = NULL;
+	}
+	instances_.removeLast();
+}
+
+// Update topmost instance layer from current data, reusing existing textures where possible
+void ImagePrimitive::updateInstance(const QOpenGLContext* context)
+{
+	// If the topmost instance does not belong to this context, we can't reuse it, so recreate it instead
+	ImageInstance* instance = instances_.last();
+	if ((instance == NULL) || (instance->context_ != context))
+	{
+		if (instance != NULL) popInstance(context);
+		pushInstance(context);
+		return;
+	}
+
+	uploadTextures(instance);
+	releaseUploadedValues();
+}
+
+// Send to OpenGL (i.e. render)
+void ImagePrimitive::sendToGL()
+{
+	// If there is no image, nothing to do...
+	if (!hasImage()) return;
+
+	// Grab topmost instance
+	ImageInstance* instance = instances_.last();
+	if (instance == NULL)
+	{
+		printf("Internal Error: No instance on stack in image primitive %p.\n", this);
+		return;
+	}
+
+	// Textures may be missing if they could not be created
+	if (instance->useShader_ && ((instance->valueTexture_ == NULL) || (instance->colourTexture_ == NULL) || (instance->remapTextures_[0] == NULL) || (instance->remapTextures_[1] == NULL))) return;
+
+	// Set up textures - when using the shader, texture coordinates are the fractional position across the image, while the colour image
+	// is already evenly spaced, and so texture coordinates are offset to place the centres of the end texels at the image edges
+	QOpenGLFunctions* glFunctions = instance->context_->functions();
+	GLfloat s[2] = { 0.0, 1.0 }, t[2] = { 0.0, 1.0 };
+	if (instance->useShader_)
+	{
+		instance->program_->bind();
+		glFunctions->glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, instance->valueTexture_->object());
+		glFunctions->glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_1D, instance->colourTexture_->object());
+		glFunctions->glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_1D, instance->remapTextures_[0]->object());
+		glFunctions->glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_1D, instance->remapTextures_[1]->object());
+		glFunctions->glActiveTexture(GL_TEXTURE0);
+		instance->program_->setUniformValue("values", 0);
+		instance->program_->setUniformValue("colours", 1);
+		instance->program_->setUniformValue("remapX", 2);
+		instance->program_->setUniformValue("remapZ", 3);
+		instance->program_->setUniformValue("remapSize", GLfloat(remap_[0].nItems()), GLfloat(remap_[1].nItems()));
+		instance->program_->setUniformValue("colourRange", GLfloat(colourMin_), GLfloat(colourScale_));
+		instance->program_->setUniformValue("colourTableSize", GLfloat(IMAGECOLOURTABLESIZE));
+	}
+	else
+	{
+		if ((instance->imageTexture_ == NULL) || (imageWidth_ == 0) || (imageHeight_ == 0)) return;
+		glFunctions->glActiveTexture(GL_TEXTURE0);
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, instance->imageTexture_->object());
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+		s[0] = 0.5 / imageWidth_;
+		s[1] = 1.0 - s[0];
+		t[0] = 0.5 / imageHeight_;
+		t[1] = 1.0 - t[0];
+	}
+
+	// Draw image
+	glBegin(GL_QUADS);
+	glNormal3d(0.0, 1.0, 0.0);
+	glTexCoord2f(s[0], t[0]);
+	glVertex3d(cornerMin_.x, cornerMin_.y, cornerMin_.z);
+	glTexCoord2f(s[1], t[0]);
+	glVertex3d(cornerMax_.x, cornerMin_.y, cornerMin_.z);
+	glTexCoord2f(s[1], t[1]);
+	glVertex3d(cornerMax_.x, cornerMin_.y, cornerMax_.z);
+	glTexCoord2f(s[0], t[1]);
+	glVertex3d(cornerMin_.x, cornerMin_.y, cornerMax_.z);
+	glEnd();
+
+	// Revert to normal operation
+	if (instance->useShader_)
+	{
+		instance->program_->release();
+		glFunctions->glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_1D, 0);
+		glFunctions->glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_1D, 0);
+		glFunctions->glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_1D, 0);
+		glFunctions->glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		glDisable(GL_TEXTURE_2D);
+	}
+}
@@ -0,0 +1,194 @@
+/*
+	*** Image Primitive
+	*** src/render/imageprimitive.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_IMAGEPRIMITIVE_H
+#define UCHROMA_IMAGEPRIMITIVE_H
+
+#ifdef _WIN32
+#include <windows.h>
+#include <GL/gl.h>
+#include "glext.h"
+#endif
+#include "base/displaydataset.h"
+#include "base/colourscale.h"
+#include "render/glresourcemanager.h"
+#include "templates/list.h"
+#include "templates/vector3.h"
+#include "templates/array.h"
+#include <QOpenGLFunctions>
+
+// Forward Declarations
+class Axes;
+class QOpenGLShaderProgram;
+
+// Image Instance
+class ImageInstance : public ListItem<ImageInstance>
+{
+	public:
+	// Constructor / Destructor
+	ImageInstance();
+	~ImageInstance();
+
+	private:
+	// Context to which instance is associated
+	const QOpenGLContext* context_;
+	// Whether the context supports colouring the image with a fragment shader
+	bool shaderAvailable_;
+	// Whether the image is currently coloured by the shader (or from a colour image generated on the CPU)
+	bool useShader_;
+	// Shader program used to colour the image (if using shader)
+	QOpenGLShaderProgram* program_;
+	// Texture containing grid values (if using shader)
+	GLResource* valueTexture_;
+	// Lookup texture containing colour table (if using shader)
+	GLResource* colourTexture_;
+	// Coordinate remap textures for x and z (if using shader)
+	GLResource* remapTextures_[2];
+	// Texture containing colour image (if not using shader)
+	GLResource* imageTexture_;
+	// Grid data and colour versions currently uploaded
+	int dataVersion_, colourVersion_;
+
+	private:
+	// Release textures
+	void releaseTextures();
+
+	public:
+	// Friend class
+	friend class ImagePrimitive;
+};
+
+// Image Primitive
+class ImagePrimitive
+{
+	public:
+	// Constructor / Destructor
+	ImagePrimitive();
+	~ImagePrimitive();
+
+
+	/*
+	 * Grid Data
+	 */
+	private:
+	// Number of grid points along x and z
+	int nX_, nZ_;
+	// Grid values (premultiplied by validity) and validity, interleaved and in row (z) order
+	Array<GLfloat> values_;
+	// Fractional positions of grid points across the image along x and z
+	Array<double> positions_[2];
+	// Coordinate remap tables for x and z, converting fractional position across the image to grid texture coordinate
+	Array<GLfloat> remap_[2];
+	// Corners of image in local axes coordinates
+	Vec3<double> cornerMin_, cornerMax_;
+	// Version of grid data, incremented whenever it is set
+	int dataVersion_;
+	// Whether grid values have been released (since they have been uploaded to all instances)
+	bool valuesReleased_;
+
+	private:
+	// Sort supplied local axes coordinates, returning their order and fractional positions across the overall extent
+	static void sortPositions(Array<double>& coordinates, Array<int>& order, Array<double>& positions);
+	// Calculate fractional grid indices at evenly-spaced positions across the image, using the supplied grid positions
+	static void fractionalIndices(const Array<double>& positions, int nSamples, Array<double>& indices);
+	// Generate grid data from display data, within the limits of the supplied axes
+	void generate(const Axes& axes, const Array<double>& abscissa, List<DisplayDataSet>& displayData);
+	// Release grid values if they have been uploaded to all instances, and are not needed to generate a colour image
+	void releaseUploadedValues();
+
+	public:
+	// Set grid data from display data, within the limits of the supplied axes
+	void set(const Axes& axes, const Array<double>& abscissa, List<DisplayDataSet>& displayData);
+	// Return whether grid values must be restored before updating the instance for the specified context (or pushing a new one)
+	bool valuesRequired(const QOpenGLContext* context, bool push) const;
+	// Restore released grid values from the display data they were set from
+	void restoreValues(const Axes& axes, const Array<double>& abscissa, List<DisplayDataSet>& displayData);
+	// Clear grid data
+	void clear();
+	// Return whether there is an image to display
+	bool hasImage() const;
+	// Return corner of image (0-3, anticlockwise from minimum x and z) in local axes coordinates
+	Vec3<double> corner(int index) const;
+
+
+	/*
+	 * Colour
+	 */
+	private:
+	// Colour table, sampled evenly between the minimum and maximum values of the colour scale
+	Array<GLfloat> colourTable_;
+	// Value at first entry in colour table, and reciprocal of range of values covered
+	double colourMin_, colourScale_;
+	// Version of colour table, incremented whenever it is set
+	int colourVersion_;
+
+	public:
+	// Set colour table from supplied colour scale
+	void setColourScale(const ColourScale& colourScale);
+
+
+	/*
+	 * Colour Image (CPU Fallback)
+	 */
+	private:
+	// Colour image, resampled onto evenly-spaced positions across the image
+	Array<GLubyte> image_;
+	// Size of colour image
+	int imageWidth_, imageHeight_;
+	// Grid data and colour versions from which colour image was generated
+	int imageDataVersion_, imageColourVersion_;
+
+	private:
+	// Update colour image, with maximum size specified
+	void updateImage(int maxSize);
+
+
+	/*
+	 * Instances
+	 */
+	private:
+	// Stack of texture objects and the contexts in which they were created
+	List<ImageInstance> instances_;
+	// Owner of GL resources created for instances (e.g. source collection)
+	const void* owner_;
+
+	private:
+	// Return whether the specified context supports colouring the image with a shader
+	static bool shaderAvailable(const QOpenGLContext* context);
+	// Bind specified texture (creating it in the instance's context if necessary) and set its sampling parameters
+	void bindTexture(ImageInstance* instance, GLenum target, GLResource*& texture);
+	// Upload data to textures in supplied instance
+	void uploadTextures(ImageInstance* instance);
+
+	public:
+	// Set owner of GL resources created for instances
+	void setOwner(const void* owner);
+	// Push instance layer from current data
+	void pushInstance(const QOpenGLContext* context);
+	// Pop topmost instance layer
+	void popInstance(const QOpenGLContext* context);
+	// Update topmost instance layer from current data, reusing existing textures where possible
+	void updateInstance(const QOpenGLContext* context);
+	// Send to OpenGL (i.e. render)
+	void sendToGL();
+};
+
+#endif
@@ -0,0 +1,574 @@
+/*
+	*** Picking Index
+	*** src/render/pickingindex.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "render/pickingindex.h"
+#include "render/primitivelist.h"
+#include "templates/vector4.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <math.h>
+
+// Maximum number of elements in a leaf node
+#define PICKINGLEAFSIZE 8
+// Tolerance (in pixels) for hits on lines and points
+#define PICKINGTOLERANCE 2.0
+
+/*
+ * Picking Source
+ */
+
+// Constructor
+PickingSource::PickingSource() : ListItem<PickingSource>()
+{
+	primitive = NULL;
+	dataVersion = -1;
+	nVertexData = 0;
+	nIndexData = 0;
+	object = -1;
+	clipped = false;
+}
+
+// Return whether this source describes the same geometry and object as that supplied
+bool PickingSource::matches(const PickingSource& other) const
+{
+	if (primitive != other.primitive) return false;
+	if (dataVersion != other.dataVersion) return false;
+	if ((nVertexData != other.nVertexData) || (nIndexData != other.nIndexData)) return false;
+	if ((object != other.object) || (clipped != other.clipped)) return false;
+	return (info == other.info);
+}
+
+/*
+ * Local Functions
+ */
+
+// Project model coordinate into screen coordinates (x and y) and depth (z, in the range 0-1), returning false if it lies behind the viewer
+static bool projectToScreen(const Matrix& viewProjection, const GLuint* viewport, double x, double y, double z, Vec3<double>& screenr, double& w)
+{
+	Vec4<double> clipr = viewProjection * Vec4<double>(x, y, z, 1.0);
+	if (clipr.w <= 0.0) return false;
+
+	w = clipr.w;
+	screenr.set(viewport[0] + viewport[2]*(clipr.x/w+1.0)*0.5, viewport[1] + viewport[3]*(clipr.y/w+1.0)*0.5, (clipr.z/w+1.0)*0.5);
+	return true;
+}
+
+// Return whether screen point lies within projected triangle, calculating barycentric weights of a and b if so
+static bool pointInTriangle(double px, double py, const Vec3<double>& a, const Vec3<double>& b, const Vec3<double>& c, double& u, double& v)
+{
+	double area = (b.x-a.x)*(c.y-a.y) - (c.x-a.x)*(b.y-a.y);
+	if (fabs(area) < 1.0e-12) return false;
+
+	u = ((b.x-px)*(c.y-py) - (c.x-px)*(b.y-py)) / area;
+	v = ((c.x-px)*(a.y-py) - (a.x-px)*(c.y-py)) / area;
+	return ((u >= 0.0) && (v >= 0.0) && ((u+v) <= 1.0));
+}
+
+// Return number of elements described by primitive of specified type and sequence length
+static int nPrimitiveElements(GLenum type, int nSequence)
+{
+	if (type == GL_TRIANGLES) return nSequence / 3;
+	else if (type == GL_LINES) return nSequence / 2;
+	else if (type == GL_LINE_STRIP) return (nSequence > 1 ? nSequence-1 : 0);
+	else if (type == GL_LINE_LOOP) return (nSequence > 2 ? nSequence : (nSequence > 1 ? 1 : 0));
+	else if (type == GL_POINTS) return nSequence;
+	return 0;
+}
+
+// Comparison of element centroids along a single axis
+class CentroidComparison
+{
+	public:
+	CentroidComparison(const GLfloat* centroids, int axis) : centroids_(centroids), axis_(axis)
+	{
+	}
+
+	private:
+	const GLfloat* centroids_;
+	int axis_;
+
+	public:
+	bool operator()(int a, int b) const
+	{
+		return (centroids_[a*3+axis_] < centroids_[b*3+axis_]);
+	}
+};
+
+/*
+ * Picking Index
+ */
+
+// Constructor
+PickingIndex::PickingIndex()
+{
+	nPendingSources_ = 0;
+	buildTime_ = 0.0;
+	queryViewport_ = NULL;
+	queryX_ = 0.0;
+	queryY_ = 0.0;
+	queryTolerance_ = PICKINGTOLERANCE;
+	queryClipYMin_ = 0.0;
+	queryClipYMax_ = 0.0;
+}
+
+// Destructor
+PickingIndex::~PickingIndex()
+{
+}
+
+// Copy constructor
+PickingIndex::PickingIndex(const PickingIndex& source)
+{
+	// Index contents are not copied - the index will be rebuilt on its first query
+	nPendingSources_ = 0;
+	buildTime_ = 0.0;
+	queryViewport_ = NULL;
+	queryX_ = 0.0;
+	queryY_ = 0.0;
+	queryTolerance_ = PICKINGTOLERANCE;
+	queryClipYMin_ = 0.0;
+	queryClipYMax_ = 0.0;
+}
+
+// Assignment operator
+void PickingIndex::operator=(const PickingIndex& source)
+{
+	// Index contents are not copied - the index will be rebuilt on its next query
+	sources_.clear();
+	pendingSources_.clear();
+	nPendingSources_ = 0;
+	clearIndex();
+}
+
+/*
+ * Sources
+ */
+
+// Begin declaration of sources
+void PickingIndex::beginSources()
+{
+	nPendingSources_ = 0;
+}
+
+// Declare primitive as a source
+void PickingIndex::addSource(Primitive& primitive, int object, QString info, bool clipped)
+{
+	// Reuse an existing pending source if we can
+	PickingSource* source = (nPendingSources_ < pendingSources_.nItems() ? pendingSources_[nPendingSources_] : pendingSources_.add());
+	++nPendingSources_;
+
+	source->primitive = &primitive;
+	source->dataVersion = primitive.dataVersion();
+	source->nVertexData = primitive.vertexData().nItems();
+	source->nIndexData = primitive.indexData().nItems();
+	source->object = object;
+	source->info = info;
+	source->clipped = clipped;
+}
+
+// Declare all primitives in list as sources
+void PickingIndex::addSources(PrimitiveList& primitiveList, int object, QString info, bool clipped)
+{
+	for (Primitive* primitive = primitiveList.primitives(); primitive != NULL; primitive = primitive->next) addSource(*primitive, object, info, clipped);
+}
+
+// Rebuild index if the declared sources differ from those used to build it, returning whether it was rebuilt
+bool PickingIndex::updateIndex()
+{
+	// Compare pending sources with those used to build the current index
+	bool upToDate = (nPendingSources_ == sources_.nItems());
+	PickingSource* pending = pendingSources_.first();
+	for (PickingSource* source = sources_.first(); upToDate && (source != NULL); source = source->next, pending = pending->next) if (!source->matches(*pending)) upToDate = false;
+	if (upToDate) return false;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	// Store new source list
+	sources_.clear();
+	pending = pendingSources_.first();
+	for (int n=0; n<nPendingSources_; ++n, pending = pending->next)
+	{
+		PickingSource* source = sources_.add();
+		source->primitive = pending->primitive;
+		source->dataVersion = pending->dataVersion;
+		source->nVertexData = pending->nVertexData;
+		source->nIndexData = pending->nIndexData;
+		source->object = pending->object;
+		source->info = pending->info;
+		source->clipped = pending->clipped;
+	}
+
+	// Reserve space for vertex positions and elements, since Array grows in fixed increments
+	clearIndex();
+	int nVertices = 0, nElements = 0;
+	for (PickingSource* source = sources_.first(); source != NULL; source = source->next)
+	{
+		int nSourceVertices = source->nVertexData / source->primitive->dataPerVertex();
+		nVertices += nSourceVertices;
+		nElements += nPrimitiveElements(source->primitive->type(), source->nIndexData ? source->nIndexData : nSourceVertices);
+	}
+	positions_.reserve(nVertices*3);
+	elements_.reserve(nElements*4);
+	sourceIndex_.reserve(sources_.nItems());
+
+	// Add elements from all sources
+	int sourceId = 0;
+	for (PickingSource* source = sources_.first(); source != NULL; source = source->next, ++sourceId)
+	{
+		sourceIndex_.add(source);
+		addElements(source, sourceId);
+	}
+
+	// Calculate element centroids and build hierarchy
+	nElements = elements_.nItems() / 4;
+	if (nElements > 0)
+	{
+		elementOrder_.reserve(nElements);
+		centroids_.reserve(nElements*3);
+		Vec3<double> minima, maxima;
+		for (int n=0; n<nElements; ++n)
+		{
+			elementOrder_.add(n);
+			elementExtents(n, minima, maxima);
+			centroids_.add((minima.x+maxima.x)*0.5);
+			centroids_.add((minima.y+maxima.y)*0.5);
+			centroids_.add((minima.z+maxima.z)*0.5);
+		}
+		nodes_.reserve(4*nElements/PICKINGLEAFSIZE + 1);
+		buildNode(0, nElements);
+		centroids_.releaseStorage();
+	}
+
+	buildTime_ = timer.nsecsElapsed() * 1.0e-6;
+
+	return true;
+}
+
+/*
+ * Index
+ */
+
+// Clear index data
+void PickingIndex::clearIndex()
+{
+	positions_.releaseStorage();
+	elements_.releaseStorage();
+	elementOrder_.releaseStorage();
+	centroids_.releaseStorage();
+	nodes_.releaseStorage();
+	sourceIndex_.releaseStorage();
+}
+
+// Add elements from specified source
+void PickingIndex::addElements(PickingSource* source, int sourceId)
+{
+	const Primitive* primitive = source->primitive;
+	const int stride = primitive->dataPerVertex();
+	const int nVertices = primitive->vertexData().nItems() / stride;
+	const int offset = positions_.nItems() / 3;
+
+	// Store vertex positions (the last three values of each vertex)
+	const GLfloat* vertexData = primitive->vertexData().constArray();
+	for (int n=0; n<nVertices; ++n)
+	{
+		positions_.add(vertexData[n*stride+stride-3]);
+		positions_.add(vertexData[n*stride+stride-2]);
+		positions_.add(vertexData[n*stride+stride-1]);
+	}
+
+	// Determine vertex sequence - if no indices are defined, vertices are used in order
+	const int nSequence = primitive->indexData().nItems() ? primitive->indexData().nItems() : nVertices;
+	const GLuint* indices = primitive->indexData().nItems() ? primitive->indexData().array() : NULL;
+	Array<int> sequence(nSequence);
+	for (int n=0; n<nSequence; ++n)
+	{
+		int vertex = (indices ? int(indices[n]) : n);
+		sequence[n] = ((vertex >= 0) && (vertex < nVertices) ? offset + vertex : -1);
+	}
+	const int* seq = sequence.constArray();
+
+	// Create elements for the primitive type
+	int a, b, c, step = 1, nVerticesPerElement = 2;
+	GLenum type = primitive->type();
+	if (type == GL_TRIANGLES)
+	{
+		step = 3;
+		nVerticesPerElement = 3;
+	}
+	else if (type == GL_LINES) step = 2;
+	else if (type == GL_POINTS) nVerticesPerElement = 1;
+	else if ((type != GL_LINE_STRIP) && (type != GL_LINE_LOOP)) return;
+
+	for (int n=0; (n+nVerticesPerElement) <= nSequence; n += step)
+	{
+		a = seq[n];
+		b = (nVerticesPerElement > 1 ? seq[n+1] : a);
+		c = (nVerticesPerElement > 2 ? seq[n+2] : -1);
+		if ((a == -1) || (b == -1) || ((nVerticesPerElement > 2) && (c == -1))) continue;
+
+		elements_.add(sourceId);
+		elements_.add(a);
+		elements_.add(nVerticesPerElement > 1 ? b : -1);
+		elements_.add(c);
+	}
+
+	// Close line loop
+	if ((type == GL_LINE_LOOP) && (nSequence > 2) && (seq[nSequence-1] != -1) && (seq[0] != -1))
+	{
+		elements_.add(sourceId);
+		elements_.add(seq[nSequence-1]);
+		elements_.add(seq[0]);
+		elements_.add(-1);
+	}
+}
+
+// Calculate extents of specified element
+void PickingIndex::elementExtents(int element, Vec3<double>& minima, Vec3<double>& maxima) const
+{
+	const int* vertices = elements_.constArray() + element*4 + 1;
+	const GLfloat* positions = positions_.constArray();
+	const GLfloat* r = &positions[vertices[0]*3];
+	minima.set(r[0], r[1], r[2]);
+	maxima = minima;
+	for (int n=1; (n<3) && (vertices[n] != -1); ++n)
+	{
+		r = &positions[vertices[n]*3];
+		for (int m=0; m<3; ++m)
+		{
+			if (r[m] < minima[m]) minima[m] = r[m];
+			if (r[m] > maxima[m]) maxima[m] = r[m];
+		}
+	}
+}
+
+// Build node from specified range of elementOrder_, returning its index
+int PickingIndex::buildNode(int first, int count)
+{
+	int* order = elementOrder_.array();
+	const GLfloat* centroids = centroids_.constArray();
+
+	// Determine extents of elements, and of their centroids
+	Node node;
+	Vec3<double> minima, maxima, centroidMin, centroidMax;
+	for (int n=first; n<first+count; ++n)
+	{
+		elementExtents(order[n], minima, maxima);
+		const GLfloat* centroid = &centroids[order[n]*3];
+		if (n == first)
+		{
+			node.minima = minima;
+			node.maxima = maxima;
+			centroidMin.set(centroid[0], centroid[1], centroid[2]);
+			centroidMax = centroidMin;
+		}
+		for (int m=0; m<3; ++m)
+		{
+			if (minima[m] < node.minima[m]) node.minima[m] = minima[m];
+			if (maxima[m] > node.maxima[m]) node.maxima[m] = maxima[m];
+			if (centroid[m] < centroidMin[m]) centroidMin[m] = centroid[m];
+			if (centroid[m] > centroidMax[m]) centroidMax[m] = centroid[m];
+		}
+	}
+	node.first = first;
+	node.count = count;
+	node.left = -1;
+	node.right = -1;
+
+	int index = nodes_.nItems();
+	nodes_.add(node);
+
+	// Leaf node?
+	Vec3<double> centroidRange = centroidMax - centroidMin;
+	int axis = centroidRange.absMaxElement();
+	if ((count <= PICKINGLEAFSIZE) || (centroidRange[axis] <= 0.0)) return index;
+
+	// Split elements at the median centroid along the longest axis
+	int mid = first + count/2;
+	std::nth_element(order+first, order+mid, order+first+count, CentroidComparison(centroids, axis));
+	int left = buildNode(first, mid-first);
+	int right = buildNode(mid, first+count-mid);
+	nodes_[index].left = left;
+	nodes_[index].right = right;
+
+	return index;
+}
+
+// Return number of elements in index
+int PickingIndex::nElements() const
+{
+	return elements_.nItems() / 4;
+}
+
+// Return time taken (in ms) to build index at last update
+double PickingIndex::buildTime() const
+{
+	return buildTime_;
+}
+
+/*
+ * Query
+ */
+
+// Return whether the screen projection of the specified node could contain the query point at a depth less than that supplied
+bool PickingIndex::nodeCandidate(const Node& node, double depth) const
+{
+	Vec3<double> screenr, screenMin, screenMax;
+	double w;
+	for (int n=0; n<8; ++n)
+	{
+		// If any corner of the node lies behind the viewer, we cannot cull it
+		if (!projectToScreen(queryMatrix_, queryViewport_, n&1 ? node.maxima.x : node.minima.x, n&2 ? node.maxima.y : node.minima.y, n&4 ? node.maxima.z : node.minima.z, screenr, w)) return true;
+		if (n == 0)
+		{
+			screenMin = screenr;
+			screenMax = screenr;
+		}
+		else for (int m=0; m<3; ++m)
+		{
+			if (screenr[m] < screenMin[m]) screenMin[m] = screenr[m];
+			if (screenr[m] > screenMax[m]) screenMax[m] = screenr[m];
+		}
+	}
+
+	if ((queryX_ < screenMin.x-queryTolerance_) || (queryX_ > screenMax.x+queryTolerance_)) return false;
+	if ((queryY_ < screenMin.y-queryTolerance_) || (queryY_ > screenMax.y+queryTolerance_)) return false;
+	return (screenMin.z < depth);
+}
+
+// Test element against query point, updating depth if a closer hit is found
+bool PickingIndex::testElement(int element, double& depth) const
+{
+	const int* data = elements_.constArray() + element*4;
+	const PickingSource* source = sourceIndex_.value(data[0]);
+	const GLfloat* positions = positions_.constArray();
+
+	// Project vertices of element
+	Vec3<double> screenr[3];
+	double w[3];
+	int nVertices = (data[3] != -1 ? 3 : (data[2] != -1 ? 2 : 1));
+	for (int n=0; n<nVertices; ++n)
+	{
+		const GLfloat* r = &positions[data[n+1]*3];
+		if (!projectToScreen(queryMatrix_, queryViewport_, r[0], r[1], r[2], screenr[n], w[n])) return false;
+	}
+
+	// Determine screen-space hit (if any), and the depth and (perspective-correct) model y coordinate at that point
+	double hitDepth, modelY;
+	if (nVertices == 3)
+	{
+		double u, v;
+		if (!pointInTriangle(queryX_, queryY_, screenr[0], screenr[1], screenr[2], u, v)) return false;
+		double t = 1.0 - u - v;
+		hitDepth = u*screenr[0].z + v*screenr[1].z + t*screenr[2].z;
+		double pu = u/w[0], pv = v/w[1], pt = t/w[2];
+		modelY = (pu*positions[data[1]*3+1] + pv*positions[data[2]*3+1] + pt*positions[data[3]*3+1]) / (pu+pv+pt);
+	}
+	else
+	{
+		Vec3<double> delta = screenr[1] - screenr[0];
+		double length2 = delta.x*delta.x + delta.y*delta.y;
+		double t = (length2 > 0.0 ? ((queryX_-screenr[0].x)*delta.x + (queryY_-screenr[0].y)*delta.y) / length2 : 0.0);
+		if (t < 0.0) t = 0.0;
+		else if (t > 1.0) t = 1.0;
+		double dx = screenr[0].x + t*delta.x - queryX_, dy = screenr[0].y + t*delta.y - queryY_;
+		if ((dx*dx + dy*dy) > queryTolerance_*queryTolerance_) return false;
+		hitDepth = screenr[0].z + t*delta.z;
+		double p0 = (1.0-t)/w[0], p1 = t/w[1];
+		modelY = (p0*positions[data[1]*3+1] + p1*positions[data[nVertices]*3+1]) / (p0+p1);
+	}
+
+	// Check hit depth against the near and far planes and current closest hit, and the model y coordinate against the clip planes
+	if ((hitDepth < 0.0) || (hitDepth > 1.0) || (hitDepth >= depth)) return false;
+	if (source->clipped && ((modelY < queryClipYMin_) || (modelY > queryClipYMax_))) return false;
+
+	depth = hitDepth;
+	return true;
+}
+
+// Find closest object at supplied screen coordinates, updating depth, object, and info if a hit closer than the supplied depth is found
+bool PickingIndex::pick(int screenX, int screenY, const Matrix& viewMatrix, const Matrix& projectionMatrix, const GLuint* viewport, double clipYMin, double clipYMax, double& depth, int& object, QString& info)
+{
+	if (nodes_.nItems() == 0) return false;
+
+	// Set up query - sample at the centre of the supplied pixel
+	queryMatrix_ = viewMatrix * projectionMatrix;
+	queryViewport_ = viewport;
+	queryX_ = screenX + 0.5;
+	queryY_ = screenY + 0.5;
+	queryClipYMin_ = clipYMin;
+	queryClipYMax_ = clipYMax;
+
+	// Traverse hierarchy, visiting only those nodes whose projection contains the query point
+	int stack[128], nStack = 0, hitElement = -1;
+	const Node* nodes = nodes_.constArray();
+	const int* order = elementOrder_.constArray();
+	stack[nStack++] = 0;
+	while (nStack > 0)
+	{
+		const Node& node = nodes[stack[--nStack]];
+		if (!nodeCandidate(node, depth)) continue;
+
+		if (node.left == -1)
+		{
+			for (int n=node.first; n<node.first+node.count; ++n) if (testElement(order[n], depth)) hitElement = order[n];
+		}
+		else
+		{
+			stack[nStack++] = node.right;
+			stack[nStack++] = node.left;
+		}
+	}
+	if (hitElement == -1) return false;
+
+	const PickingSource* source = sourceIndex_.value(elements_.value(hitElement*4));
+	object = source->object;
+	info = source->info;
+
+	return true;
+}
+
+// Test supplied (model-space) quads at screen coordinates, updating depth and returning true if a hit closer than that supplied is found
+bool PickingIndex::pickQuads(int screenX, int screenY, const Array< Vec3<double> >& corners, const Matrix& viewMatrix, const Matrix& projectionMatrix, const GLuint* viewport, double& depth)
+{
+	Matrix viewProjection = viewMatrix * projectionMatrix;
+	const Vec3<double>* r = corners.constArray();
+	Vec3<double> screenr[4];
+	double w, u, v, hitDepth, px = screenX + 0.5, py = screenY + 0.5;
+	bool result = false;
+	for (int n=0; n+3<corners.nItems(); n += 4)
+	{
+		bool visible = true;
+		for (int m=0; m<4; ++m) if (!projectToScreen(viewProjection, viewport, r[n+m].x, r[n+m].y, r[n+m].z, screenr[m], w)) visible = false;
+		if (!visible) continue;
+
+		// Test the two triangles making up the quad
+		if (pointInTriangle(px, py, screenr[0], screenr[1], screenr[2], u, v)) hitDepth = u*screenr[0].z + v*screenr[1].z + (1.0-u-v)*screenr[2].z;
+		else if (pointInTriangle(px, py, screenr[0], screenr[2], screenr[3], u, v)) hitDepth = u*screenr[0].z + v*screenr[2].z + (1.0-u-v)*screenr[3].z;
+		else continue;
+
+		if ((hitDepth < 0.0) || (hitDepth > 1.0) || (hitDepth >= depth)) continue;
+		depth = hitDepth;
+		result = true;
+	}
+
+	return result;
+}
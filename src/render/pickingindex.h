@@ -0,0 +1,169 @@
+/*
+	*** Picking Index
+	*** src/render/pickingindex.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_PICKINGINDEX_H
+#define UCHROMA_PICKINGINDEX_H
+
+#include "math/matrix.h"
+#include "templates/list.h"
+#include "templates/array.h"
+#include "templates/vector3.h"
+#include <QString>
+#ifndef __APPLE__
+#include <GL/gl.h>
+#else
+#include <OpenGL/gl3.h>
+#endif
+
+// Forward Declarations
+class Primitive;
+class PrimitiveList;
+
+// Picking Source
+class PickingSource : public ListItem<PickingSource>
+{
+	public:
+	// Constructor
+	PickingSource();
+
+	public:
+	// Primitive providing geometry
+	Primitive* primitive;
+	// Data version of primitive
+	int dataVersion;
+	// Number of vertex and index data in primitive
+	int nVertexData, nIndexData;
+	// Object type and info to report for hits on this source
+	int object;
+	QString info;
+	// Whether hits on this source are subject to the y clipping planes
+	bool clipped;
+
+	public:
+	// Return whether this source describes the same geometry and object as that supplied
+	bool matches(const PickingSource& other) const;
+};
+
+// Picking Index
+class PickingIndex
+{
+	public:
+	// Constructor / Destructor
+	PickingIndex();
+	~PickingIndex();
+	// Copy constructor
+	PickingIndex(const PickingIndex& source);
+	// Assignment operator
+	void operator=(const PickingIndex& source);
+
+
+	/*
+	 * Sources
+	 */
+	private:
+	// Sources from which the current index was built
+	List<PickingSource> sources_;
+	// Sources declared since the last call to beginSources()
+	List<PickingSource> pendingSources_;
+	// Number of pending sources declared
+	int nPendingSources_;
+
+	public:
+	// Begin declaration of sources
+	void beginSources();
+	// Declare primitive as a source
+	void addSource(Primitive& primitive, int object, QString info, bool clipped = false);
+	// Declare all primitives in list as sources
+	void addSources(PrimitiveList& primitiveList, int object, QString info, bool clipped = false);
+	// Rebuild index if the declared sources differ from those used to build it, returning whether it was rebuilt
+	bool updateIndex();
+
+
+	/*
+	 * Index
+	 */
+	private:
+	// Node in bounding volume hierarchy
+	struct Node
+	{
+		// Extents of elements within node
+		Vec3<double> minima, maxima;
+		// First element (in elementOrder_) and number of elements in node (leaf nodes only)
+		int first, count;
+		// Child node indices (or -1 for leaf nodes)
+		int left, right;
+	};
+	// Model-space vertex positions (xyz triplets)
+	Array<GLfloat> positions_;
+	// Elements (source index followed by up to three vertex indices, with -1 for unused vertices)
+	Array<int> elements_;
+	// Order of elements in hierarchy
+	Array<int> elementOrder_;
+	// Element centroids used during construction
+	Array<GLfloat> centroids_;
+	// Bounding volume hierarchy nodes (root node first)
+	Array<Node> nodes_;
+	// Pointers to sources, indexed by element source index
+	Array<PickingSource*> sourceIndex_;
+	// Time taken (in ms) to build index at last update
+	double buildTime_;
+
+	private:
+	// Clear index data
+	void clearIndex();
+	// Add elements from specified source
+	void addElements(PickingSource* source, int sourceId);
+	// Calculate extents of specified element
+	void elementExtents(int element, Vec3<double>& minima, Vec3<double>& maxima) const;
+	// Build node from specified range of elementOrder_, returning its index
+	int buildNode(int first, int count);
+
+	public:
+	// Return number of elements in index
+	int nElements() const;
+	// Return time taken (in ms) to build index at last update
+	double buildTime() const;
+
+
+	/*
+	 * Query
+	 */
+	private:
+	// Projection used by current query
+	Matrix queryMatrix_;
+	const GLuint* queryViewport_;
+	double queryX_, queryY_, queryTolerance_;
+	double queryClipYMin_, queryClipYMax_;
+
+	private:
+	// Return whether the screen projection of the specified node could contain the query point at a depth less than that supplied
+	bool nodeCandidate(const Node& node, double depth) const;
+	// Test element against query point, updating depth if a closer hit is found
+	bool testElement(int element, double& depth) const;
+
+	public:
+	// Find closest object at supplied screen coordinates, updating depth, object, and info if a hit closer than the supplied depth is found
+	bool pick(int screenX, int screenY, const Matrix& viewMatrix, const Matrix& projectionMatrix, const GLuint* viewport, double clipYMin, double clipYMax, double& depth, int& object, QString& info);
+	// Test supplied (model-space) quads at screen coordinates, updating depth and returning true if a hit closer than that supplied is found
+	static bool pickQuads(int screenX, int screenY, const Array< Vec3<double> >& corners, const Matrix& viewMatrix, const Matrix& projectionMatrix, const GLuint* viewport, double& depth);
+};
+
+#endif
@@ -27,6 +27,10 @@
 #include <OpenGL/gl.h>
 #endif
 
+// Static members
+long int Primitive::bytesUploaded_ = 0;
+long int Primitive::verticesUploaded_ = 0;
+
 // Constructor
 Primitive::Primitive() : ListItem<Primitive>()
 {
@@ -34,7 +38,9 @@ Primitive::Primitive() : ListItem<Primitive>()
 	type_ = GL_TRIANGLES;
 	dataPerVertex_ = 6;
 	nDefinedVertices_ = 0;
+	dataVersion_ = 0;
 	useInstances_ = true;
+	owner_ = NULL;
 }
 
 // Destructor
@@ -68,6 +74,7 @@ void Primitive::forgetAll()
 	vertexData_.clear();
 	indexData_.clear();
 	nDefinedVertices_ = 0;
+	++dataVersion_;
 }
 
 // Return number of vertices currently defined in primitive
@@ -88,6 +95,36 @@ bool Primitive::colouredVertexData() const
 	return colouredVertexData_;
 }
 
+// Return GL primitive type
+GLenum Primitive::type() const
+{
+	return type_;
+}
+
+// Return number of data points per vertex
+int Primitive::dataPerVertex() const
+{
+	return dataPerVertex_;
+}
+
+// Return vertex data array
+const Array<GLfloat>& Primitive::vertexData() const
+{
+	return vertexData_;
+}
+
+// Return index data array
+const Array<GLuint>& Primitive::indexData() const
+{
+	return indexData_;
+}
+
+// Return version of vertex and index data
+int Primitive::dataVersion() const
+{
+	return dataVersion_;
+}
+
 /*
  * Instances
  */
@@ -98,6 +135,73 @@ void Primitive::setNoInstances()
 	useInstances_ = false;
 }
 
+// Set owner of GL resources created for instances
+void Primitive::setOwner(const void* owner)
+{
+	owner_ = owner;
+}
+
+// Return checksum of current vertex and index data
+unsigned int Primitive::dataChecksum() const
+{
+	// FNV-1a hash, computed over 32-bit words of the vertex and index data
+	unsigned int checksum = 2166136261u;
+	const GLfloat* vertices = vertexData_.constArray();
+	unsigned int word;
+	for (int n=0; n<vertexData_.nItems(); ++n)
+	{
+		memcpy(&word, &vertices[n], sizeof(unsigned int));
+		checksum = (checksum ^ word) * 16777619u;
+	}
+	const GLuint* indices = indexData_.constArray();
+	for (int n=0; n<indexData_.nItems(); ++n) checksum = (checksum ^ indices[n]) * 16777619u;
+	checksum = (checksum ^ type_) * 16777619u;
+
+	return checksum;
+}
+
+// Upload data to specified buffer resource (creating it if necessary), reusing existing storage where possible
+bool Primitive::uploadBufferData(const QOpenGLContext* context, GLenum target, GLResource*& buffer, GLsizeiptr currentSize, GLsizeiptr newSize, const GLvoid* data)
+{
+	// Grab the QOpenGLFunctions object pointer
+	QOpenGLFunctions* glFunctions = context->functions();
+
+	// Create new buffer object if we don't already have one
+	bool newBuffer = (buffer == NULL);
+	if (newBuffer)
+	{
+		buffer = GLResourceManager::create(GLResource::BufferResource, context, owner_);
+		if (buffer == NULL) return false;
+	}
+
+	// Bind buffer object
+	glFunctions->glBindBuffer(target, buffer->object());
+
+	// For a new buffer we create its storage and data in one go.
+	// For an existing buffer of the same size we orphan the old storage (so we don't stall on any draw still using it) and stream the new data in.
+	// Otherwise, the storage must be recreated at the new size.
+	if (newBuffer) glFunctions->glBufferData(target, newSize, data, GL_STATIC_DRAW);
+	else if (currentSize == newSize)
+	{
+		glFunctions->glBufferData(target, newSize, NULL, GL_DYNAMIC_DRAW);
+		glFunctions->glBufferSubData(target, 0, newSize, data);
+	}
+	else glFunctions->glBufferData(target, newSize, data, GL_DYNAMIC_DRAW);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		glFunctions->glBindBuffer(target, 0);
+		GLResourceManager::release(buffer);
+		buffer = NULL;
+		return false;
+	}
+	glFunctions->glBindBuffer(target, 0);
+
+	GLResourceManager::setSize(buffer, newSize);
+	bytesUploaded_ += newSize;
+
+	return true;
+}
 
 // Push instance of primitive
 void Primitive::pushInstance(const QOpenGLContext* context)
@@ -105,12 +209,20 @@ void Primitive::pushInstance(const QOpenGLContext* context)
 	// Does this primitive use instances?
 	if (!useInstances_) return;
 
+	// If the topmost instance already holds the current data in resources which can be used in this context (e.g. it belongs to a context in the same share group), share them rather than uploading the data again
+	GLsizeiptr vboSize = nDefinedVertices_ * dataPerVertex_ * sizeof(GLfloat);
+	GLsizeiptr indexSize = indexData_.nItems() * sizeof(GLuint);
+	unsigned int checksum = dataChecksum();
+	PrimitiveInstance* topInstance = instances_.last();
+	if (topInstance && (topInstance->type() == PrimitiveInstance::globalInstanceType()) && topInstance->usableIn(context) && (topInstance->vertexDataSize() == vboSize) && (topInstance->indexDataSize() == indexSize) && (topInstance->dataChecksum() == checksum))
+	{
+		instances_.add()->share(context, topInstance);
+		return;
+	}
+
 	// Clear the error flag
 	glGetError();
 
-	// Grab the QOpenGLFunctions object pointer
-	QOpenGLFunctions* glFunctions = context->functions();
-
 	// Create new instance
 	PrimitiveInstance* pi = instances_.add();
 
@@ -118,81 +230,62 @@ void Primitive::pushInstance(const QOpenGLContext* context)
 	if (PrimitiveInstance::globalInstanceType() == PrimitiveInstance::VBOInstance)
 	{
 		// Prepare local array of data to pass to VBO
-		GLuint vertexVBO = 0, indexVBO = 0;
+		GLResource* vertexVBO = NULL, *indexVBO = NULL;
 		if (nDefinedVertices_ <= 0)
 		{
 			// Store instance data
-			pi->setVBO(context, 0, 0);
+			pi->setVBO(context, NULL, NULL);
 			return;
 		}
 
-		// Determine total size of array (in bytes) for VBO
-		int vboSize = nDefinedVertices_ * (colouredVertexData_ ? 10 : 6) * sizeof(GLfloat);
-		
 		// Generate vertex array object
-		glFunctions->glGenBuffers(1, &vertexVBO);
-
-		// Bind VBO
-		glFunctions->glBindBuffer(GL_ARRAY_BUFFER, vertexVBO);
-		
-		// Initialise vertex array data
-		glFunctions->glBufferData(GL_ARRAY_BUFFER, vboSize, vertexData_.array(), GL_STATIC_DRAW);
-		if (glGetError() != GL_NO_ERROR)
+		if (!uploadBufferData(context, GL_ARRAY_BUFFER, vertexVBO, 0, vboSize, vertexData_.constArray()))
 		{
-			glFunctions->glBindBuffer(GL_ARRAY_BUFFER, 0);
 			printf("Error occurred while generating vertex buffer object for Primitive.\n");
-			glFunctions->glDeleteBuffers(1, &vertexVBO);
-			vertexVBO = 0;
 			return;
 		}
-		glFunctions->glBindBuffer(GL_ARRAY_BUFFER, 0);
+		verticesUploaded_ += nDefinedVertices_;
 
 		// Generate index array object (if using indices)
 		if (indexData_.nItems() != 0)
 		{
-			// Generate index array object
-			glFunctions->glGenBuffers(1, &indexVBO);
-
-			// Bind VBO
-			glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexVBO);
-			
-			// Initialise index array data
-			glFunctions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData_.nItems()*sizeof(GLuint), indexData_.array(), GL_STATIC_DRAW);
-			if (glGetError() != GL_NO_ERROR)
+			if (!uploadBufferData(context, GL_ELEMENT_ARRAY_BUFFER, indexVBO, 0, indexSize, indexData_.constArray()))
 			{
-				glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 				printf("Error occurred while generating index buffer object for Primitive.\n");
-				glFunctions->glDeleteBuffers(1, &indexVBO);
-				indexVBO = 0;
+				GLResourceManager::release(vertexVBO);
 				return;
 			}
-			glFunctions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 		}
 
 		// Store instance data
-		pi->setVBO(context, vertexVBO, indexData_.nItems() != 0 ? indexVBO : 0);
+		pi->setVBO(context, vertexVBO, indexVBO);
+		pi->setData(vboSize, indexSize, checksum);
 	}
 	else
 	{
 		// Generate display list
-		int listId = glGenLists(1);
-		if (listId == 0) printf("Internal Error: Primitive::pushInstance - glGenLists(1) returned 0!\n!");
+		GLResource* list = GLResourceManager::create(GLResource::DisplayListResource, context, owner_);
+		if (list == NULL) printf("Internal Error: Primitive::pushInstance - failed to create display list!\n");
 		else
 		{
-			glNewList(listId, GL_COMPILE);
+			glNewList(list->object(), GL_COMPILE);
 			
 			// Does the vertex data contain colour-per-vertex information?
-			glInterleavedArrays(colouredVertexData_ ? GL_C4F_N3F_V3F : GL_N3F_V3F, 0, vertexData_.array());
+			glInterleavedArrays(colouredVertexData_ ? GL_C4F_N3F_V3F : GL_N3F_V3F, 0, vertexData_.constArray());
 
 			// Check if we are using indices
-			if (indexData_.nItems()) glDrawElements(type_, indexData_.nItems(), GL_UNSIGNED_INT, indexData_.array());
+			if (indexData_.nItems()) glDrawElements(type_, indexData_.nItems(), GL_UNSIGNED_INT, indexData_.constArray());
 			else glDrawArrays(type_, 0, nDefinedVertices_);
 			
 			glEndList();
+
+			// The list holds a compiled copy of the data, so its size is (roughly) that of the data
+			GLResourceManager::setSize(list, vboSize + indexSize);
 		}
 
 		// Store data
-		pi->setDisplayList(context, listId);
+		pi->setDisplayList(context, list);
+		pi->setData(vboSize, indexSize, checksum);
 	}
 }
 
@@ -202,31 +295,56 @@ void Primitive::popInstance(const QOpenGLContext* context)
 	// Does this primitive use instances?
 	if (!useInstances_) return;
 
-	// Grab the QOpenGLFunctions object pointer
-	QOpenGLFunctions* glFunctions = context->functions();
+	// Removing the instance releases its resources, which are deleted once they are no longer used by any other instance, and a context in their share group is current
+	if (instances_.last() != NULL) instances_.removeLast();
+}
+
+// Update topmost instance layer from current vertex data, reusing existing buffers where possible
+void Primitive::updateInstance(const QOpenGLContext* context)
+{
+	// Does this primitive use instances?
+	if (!useInstances_) return;
 
+	// If the topmost instance is not a VBO belonging to this context, or shares its buffers with another instance, we can't update it in place, so recreate it instead
 	PrimitiveInstance* pi = instances_.last();
-	if (pi != NULL)
+	if ((pi == NULL) || (pi->context() != context) || (pi->type() != PrimitiveInstance::VBOInstance) || (PrimitiveInstance::globalInstanceType() != PrimitiveInstance::VBOInstance) || pi->isShared())
 	{
-		if (pi->context() == context)
-		{
-			// Vertex buffer object or plain old display list?
-			if (pi->type() == PrimitiveInstance::VBOInstance)
-			{
-				GLuint bufid  = pi->vboVertexObject();
-				if (bufid != 0) glFunctions->glDeleteBuffers(1, &bufid);
-				if (indexData_.nItems() != 0)
-				{
-					bufid = pi->vboIndexObject();
-					if (bufid != 0) glFunctions->glDeleteBuffers(1, &bufid);
-				}
-			}
-			else if (pi->listObject() != 0) glDeleteLists(pi->listObject(),1);
-		}
-		instances_.removeLast();
+		if (pi != NULL) popInstance(context);
+		pushInstance(context);
+		return;
+	}
+
+	// If there are no vertices, sendToGL() will draw nothing, so leave the existing buffers alone
+	if (nDefinedVertices_ <= 0) return;
+
+	// Has the data actually changed since it was last uploaded?
+	GLsizeiptr vboSize = nDefinedVertices_ * dataPerVertex_ * sizeof(GLfloat);
+	GLsizeiptr indexSize = indexData_.nItems() * sizeof(GLuint);
+	unsigned int checksum = dataChecksum();
+	if ((pi->vboVertexObject() != 0) && (pi->vertexDataSize() == vboSize) && (pi->indexDataSize() == indexSize) && (pi->dataChecksum() == checksum)) return;
+
+	// Clear the error flag
+	glGetError();
+
+	// Update vertex and index data (if using indices)
+	GLResource* vertexVBO = pi->vboVertexResource(), *indexVBO = pi->vboIndexResource();
+	bool success = uploadBufferData(context, GL_ARRAY_BUFFER, vertexVBO, pi->vertexDataSize(), vboSize, vertexData_.constArray());
+	if (success && (indexData_.nItems() != 0)) success = uploadBufferData(context, GL_ELEMENT_ARRAY_BUFFER, indexVBO, pi->indexDataSize(), indexSize, indexData_.constArray());
+	pi->setVBO(context, vertexVBO, indexVBO);
+
+	// If the update failed, fall back to creating a fresh instance
+	if (!success)
+	{
+		printf("Error occurred while updating buffer objects for Primitive.\n");
+		popInstance(context);
+		pushInstance(context);
+		return;
 	}
-}
 
+	// Store new instance data
+	pi->setData(vboSize, indexSize, checksum);
+	verticesUploaded_ += nDefinedVertices_;
+}
 
 // Return number of instances available
 int Primitive::nInstances()
@@ -278,14 +396,33 @@ void Primitive::sendToGL()
 	else
 	{
 		// Does the vertex data contain colour-per-vertex information?
-		glInterleavedArrays(colouredVertexData_ ? GL_C4F_N3F_V3F : GL_N3F_V3F, 0, vertexData_.array());
+		glInterleavedArrays(colouredVertexData_ ? GL_C4F_N3F_V3F : GL_N3F_V3F, 0, vertexData_.constArray());
 
 		// Check if we are using indices
-		if (indexData_.nItems() != 0) glDrawElements(type_, indexData_.nItems(), GL_UNSIGNED_INT, indexData_.array());
+		if (indexData_.nItems() != 0) glDrawElements(type_, indexData_.nItems(), GL_UNSIGNED_INT, indexData_.constArray());
 		else glDrawArrays(type_, 0, nDefinedVertices_);
 	}
 }
 
+// Return total number of bytes uploaded to VBOs since last reset
+long int Primitive::bytesUploaded()
+{
+	return bytesUploaded_;
+}
+
+// Return total number of vertices uploaded to VBOs since last reset
+long int Primitive::verticesUploaded()
+{
+	return verticesUploaded_;
+}
+
+// Reset counts of bytes and vertices uploaded to VBOs
+void Primitive::resetUploadCounts()
+{
+	bytesUploaded_ = 0;
+	verticesUploaded_ = 0;
+}
+
 /*
  * Vertex / Index Generation
  */
@@ -63,6 +63,8 @@ class Primitive : public ListItem<Primitive>
 	int dataPerVertex_;
 	// Whether vertex data array also contains colour information
 	bool colouredVertexData_;
+	// Version of vertex and index data, incremented whenever the data is reset
+	int dataVersion_;
 
 	public:
 	// Initialise primitive storage
@@ -75,6 +77,16 @@ class Primitive : public ListItem<Primitive>
 	int nDefinedIndices() const;
 	// Return whether vertex data contains colour information
 	bool colouredVertexData() const;
+	// Return GL primitive type
+	GLenum type() const;
+	// Return number of data points per vertex
+	int dataPerVertex() const;
+	// Return vertex data array
+	const Array<GLfloat>& vertexData() const;
+	// Return index data array
+	const Array<GLuint>& indexData() const;
+	// Return version of vertex and index data
+	int dataVersion() const;
 
 
 	/*
@@ -85,18 +97,40 @@ class Primitive : public ListItem<Primitive>
 	List<PrimitiveInstance> instances_;
 	// Flag stating whether or not instances should be used for this primitive
 	bool useInstances_;
+	// Owner of GL resources created for instances (e.g. source collection)
+	const void* owner_;
+	// Total number of bytes uploaded to VBOs since last reset
+	static long int bytesUploaded_;
+	// Total number of vertices uploaded to VBOs since last reset
+	static long int verticesUploaded_;
+
+	private:
+	// Return checksum of current vertex and index data
+	unsigned int dataChecksum() const;
+	// Upload data to specified buffer resource (creating it if necessary), reusing existing storage where possible
+	bool uploadBufferData(const QOpenGLContext* context, GLenum target, GLResource*& buffer, GLsizeiptr currentSize, GLsizeiptr newSize, const GLvoid* data);
 
 	public:
 	// Flag that this primitive should not use instances (rendering will use vertex arrays)
 	void setNoInstances();
+	// Set owner of GL resources created for instances
+	void setOwner(const void* owner);
 	// Push instance layer from current vertex chunk list
 	void pushInstance(const QOpenGLContext* context);
 	// Pop topmost instance layer
 	void popInstance(const QOpenGLContext* context);
+	// Update topmost instance layer from current vertex data, reusing existing buffers where possible
+	void updateInstance(const QOpenGLContext* context);
 	// Return number of instances available
 	int nInstances();
 	// Send to OpenGL (i.e. render)
 	void sendToGL();
+	// Return total number of bytes uploaded to VBOs since last reset
+	static long int bytesUploaded();
+	// Return total number of vertices uploaded to VBOs since last reset
+	static long int verticesUploaded();
+	// Reset counts of bytes and vertices uploaded to VBOs
+	static void resetUploadCounts();
 
 
 	/*
@@ -31,9 +31,18 @@ PrimitiveInstance::PrimitiveInstance() : ListItem<PrimitiveInstance>()
 	// Private variables
 	context_ = NULL;
 	type_ = PrimitiveInstance::ListInstance;
-	listObject_ = 0;
-	vboVertexObject_ = 0;
-	vboIndexObject_ = 0;
+	listResource_ = NULL;
+	vboVertexResource_ = NULL;
+	vboIndexResource_ = NULL;
+	vertexDataSize_ = 0;
+	indexDataSize_ = 0;
+	dataChecksum_ = 0;
+}
+
+// Destructor
+PrimitiveInstance::~PrimitiveInstance()
+{
+	releaseResources();
 }
 
 // Return global instance type to use
@@ -61,36 +70,111 @@ PrimitiveInstance::InstanceType PrimitiveInstance::type() const
 }
 
 // Set display list data
-void PrimitiveInstance::setDisplayList(const QOpenGLContext* context, GLuint listObject)
+void PrimitiveInstance::setDisplayList(const QOpenGLContext* context, GLResource* listResource)
 {
 	context_ = context;
 	type_ = PrimitiveInstance::ListInstance;
-	listObject_ = listObject;
+	listResource_ = listResource;
 }
 
 // Set vbo object data
-void PrimitiveInstance::setVBO(const QOpenGLContext* context, GLuint vertexObject, GLuint indexObject)
+void PrimitiveInstance::setVBO(const QOpenGLContext* context, GLResource* vertexResource, GLResource* indexResource)
 {
 	context_ = context;
 	type_ = PrimitiveInstance::VBOInstance;
-	vboVertexObject_ = vertexObject;
-	vboIndexObject_ = indexObject;
+	vboVertexResource_ = vertexResource;
+	vboIndexResource_ = indexResource;
+}
+
+// Set size and checksum of data stored in instance
+void PrimitiveInstance::setData(long int vertexSize, long int indexSize, unsigned int checksum)
+{
+	vertexDataSize_ = vertexSize;
+	indexDataSize_ = indexSize;
+	dataChecksum_ = checksum;
+}
+
+// Share resources and data of specified instance (which must be usable in the supplied context)
+void PrimitiveInstance::share(const QOpenGLContext* context, const PrimitiveInstance* source)
+{
+	releaseResources();
+
+	context_ = context;
+	type_ = source->type_;
+	listResource_ = GLResourceManager::reference(source->listResource_);
+	vboVertexResource_ = GLResourceManager::reference(source->vboVertexResource_);
+	vboIndexResource_ = GLResourceManager::reference(source->vboIndexResource_);
+	setData(source->vertexDataSize_, source->indexDataSize_, source->dataChecksum_);
+}
+
+// Release resources used by instance
+void PrimitiveInstance::releaseResources()
+{
+	GLResourceManager::release(listResource_);
+	GLResourceManager::release(vboVertexResource_);
+	GLResourceManager::release(vboIndexResource_);
+	listResource_ = NULL;
+	vboVertexResource_ = NULL;
+	vboIndexResource_ = NULL;
+}
+
+// Return whether the instance's resources may be used in the specified context
+bool PrimitiveInstance::usableIn(const QOpenGLContext* context) const
+{
+	GLResource* resource = (type_ == PrimitiveInstance::VBOInstance ? vboVertexResource_ : listResource_);
+	return (resource && resource->usableIn(context));
+}
+
+// Return whether the instance's resources are shared with another instance
+bool PrimitiveInstance::isShared() const
+{
+	return ((listResource_ && listResource_->isShared()) || (vboVertexResource_ && vboVertexResource_->isShared()) || (vboIndexResource_ && vboIndexResource_->isShared()));
 }
 
 // Return display list object for instance
 GLuint PrimitiveInstance::listObject() const
 {
-	return listObject_;
+	return (listResource_ ? listResource_->object() : 0);
 }
 
 // Return VBO ID of vertex array for instance
 GLuint PrimitiveInstance::vboVertexObject() const
 {
-	return vboVertexObject_;
+	return (vboVertexResource_ ? vboVertexResource_->object() : 0);
 }
 
 // Return VBO ID of index array for instance
 GLuint PrimitiveInstance::vboIndexObject() const
 {
-	return vboIndexObject_;
+	return (vboIndexResource_ ? vboIndexResource_->object() : 0);
+}
+
+// Return VBO resource of vertex array for instance
+GLResource* PrimitiveInstance::vboVertexResource() const
+{
+	return vboVertexResource_;
+}
+
+// Return VBO resource of index array for instance
+GLResource* PrimitiveInstance::vboIndexResource() const
+{
+	return vboIndexResource_;
+}
+
+// Return size (in bytes) of vertex data currently stored in instance
+long int PrimitiveInstance::vertexDataSize() const
+{
+	return vertexDataSize_;
+}
+
+// Return size (in bytes) of index data currently stored in instance
+long int PrimitiveInstance::indexDataSize() const
+{
+	return indexDataSize_;
+}
+
+// Return checksum of primitive data currently stored in instance
+unsigned int PrimitiveInstance::dataChecksum() const
+{
+	return dataChecksum_;
 }
@@ -31,6 +31,7 @@
 #include <windows.h>
 #include "glext.h"
 #endif
+#include "render/glresourcemanager.h"
 #include "templates/list.h"
 
 // Forward Declarations
@@ -41,8 +42,9 @@ class GLExtensions;
 class PrimitiveInstance : public ListItem<PrimitiveInstance>
 {
 	public:
-	// Constructor
+	// Constructor / Destructor
 	PrimitiveInstance();
+	~PrimitiveInstance();
 	// Instance Type
 	enum InstanceType { NoInstances, ListInstance, VBOInstance };
 	
@@ -55,12 +57,18 @@ class PrimitiveInstance : public ListItem<PrimitiveInstance>
 	GLExtensions* extensions_;
 	// Type of instance
 	InstanceType type_;
-	// List ID of instance (if using display lists)
-	GLuint listObject_;
-	// VBO ID of vertex array (if using VBOs)
-	GLuint vboVertexObject_;
-	// VBO ID of index array (if using indexed VBOs)
-	GLuint vboIndexObject_;
+	// Display list resource of instance (if using display lists)
+	GLResource* listResource_;
+	// VBO resource of vertex array (if using VBOs)
+	GLResource* vboVertexResource_;
+	// VBO resource of index array (if using indexed VBOs)
+	GLResource* vboIndexResource_;
+	// Size (in bytes) of vertex data currently stored in instance
+	long int vertexDataSize_;
+	// Size (in bytes) of index data currently stored in instance
+	long int indexDataSize_;
+	// Checksum of primitive data currently stored in instance
+	unsigned int dataChecksum_;
 	
 	public:
 	// Return global instance type to use
@@ -72,9 +80,19 @@ class PrimitiveInstance : public ListItem<PrimitiveInstance>
 	// Return GL extensions
 	const GLExtensions* extensions() const;
 	// Set display list data
-	void setDisplayList(const QOpenGLContext* context, GLuint listObject);
+	void setDisplayList(const QOpenGLContext* context, GLResource* listResource);
 	// Set vbo object data
-	void setVBO(const QOpenGLContext* context, GLuint vertexObject, GLuint indexObject);
+	void setVBO(const QOpenGLContext* context, GLResource* vertexResource, GLResource* indexResource);
+	// Set size and checksum of data stored in instance
+	void setData(long int vertexSize, long int indexSize, unsigned int checksum);
+	// Share resources and data of specified instance (which must be usable in the supplied context)
+	void share(const QOpenGLContext* context, const PrimitiveInstance* source);
+	// Release resources used by instance
+	void releaseResources();
+	// Return whether the instance's resources may be used in the specified context
+	bool usableIn(const QOpenGLContext* context) const;
+	// Return whether the instance's resources are shared with another instance
+	bool isShared() const;
 	// Return type of instance
 	InstanceType type() const;
 	// Return display list object for instance
@@ -83,6 +101,16 @@ class PrimitiveInstance : public ListItem<PrimitiveInstance>
 	GLuint vboVertexObject() const;
 	// Return VBO ID of index array for instance
 	GLuint vboIndexObject() const;
+	// Return VBO resource of vertex array for instance
+	GLResource* vboVertexResource() const;
+	// Return VBO resource of index array for instance
+	GLResource* vboIndexResource() const;
+	// Return size (in bytes) of vertex data currently stored in instance
+	long int vertexDataSize() const;
+	// Return size (in bytes) of index data currently stored in instance
+	long int indexDataSize() const;
+	// Return checksum of primitive data currently stored in instance
+	unsigned int dataChecksum() const;
 };
 
 #endif
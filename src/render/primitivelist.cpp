@@ -24,6 +24,7 @@
 // Constructor
 PrimitiveList::PrimitiveList()
 {
+	owner_ = NULL;
 }
 
 // Destructor
@@ -47,7 +48,7 @@ void PrimitiveList::forgetAll()
 void PrimitiveList::reinitialise(int newSize, bool allowShrink, GLenum type, bool colourData)
 {
 	// Add enough primitives to match the new size
-	while (primitives_.nItems() < newSize) primitives_.add();
+	while (primitives_.nItems() < newSize) primitives_.add()->setOwner(owner_);
 
 	// Shrink list to new size (if allowed)
 	if (allowShrink)
@@ -63,15 +64,33 @@ void PrimitiveList::reinitialise(int newSize, bool allowShrink, GLenum type, boo
 	}
 }
 
+// Resize list to specified number of Primitives, reinitialising all but the first nKeep
+void PrimitiveList::resize(int newSize, int nKeep, GLenum type, bool colourData)
+{
+	while (primitives_.nItems() < newSize) primitives_.add()->setOwner(owner_);
+	while (primitives_.nItems() > newSize) primitives_.removeLast();
+
+	// Primitives we are keeping retain their data (and existing instances)
+	int index = 0;
+	for (Primitive* prim = primitives_.first(); prim != NULL; prim = prim->next, ++index) if (index >= nKeep) prim->initialise(type, colourData);
+}
+
 // Add a new primitive to the end of the list
 Primitive* PrimitiveList::addPrimitive(GLenum type, bool colourData)
 {
 	Primitive* newPrim = primitives_.add();
+	newPrim->setOwner(owner_);
 	newPrim->initialise(type, colourData);
 
 	return newPrim;
 }
 
+// Return first primitive in list
+Primitive* PrimitiveList::primitives()
+{
+	return primitives_.first();
+}
+
 // Return total number of defined vertices
 int PrimitiveList::nDefinedVertices()
 {
@@ -100,6 +119,12 @@ void PrimitiveList::popInstance(const QOpenGLContext* context)
 	for (Primitive* prim = primitives_.first(); prim != NULL; prim = prim->next) prim->popInstance(context);
 }
 
+// Update topmost instance layer, reusing existing buffers where possible
+void PrimitiveList::updateInstance(const QOpenGLContext* context)
+{
+	for (Primitive* prim = primitives_.first(); prim != NULL; prim = prim->next) prim->updateInstance(context);
+}
+
 // Return number of instances of topmost primitive
 int PrimitiveList::nInstances()
 {
@@ -107,6 +132,13 @@ int PrimitiveList::nInstances()
 	else return primitives_.first()->nInstances();
 }
 
+// Set owner of GL resources created for primitive instances
+void PrimitiveList::setOwner(const void* owner)
+{
+	owner_ = owner;
+	for (Primitive* prim = primitives_.first(); prim != NULL; prim = prim->next) prim->setOwner(owner_);
+}
+
 // Send to OpenGL (i.e. render)
 void PrimitiveList::sendToGL()
 {
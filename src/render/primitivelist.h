@@ -44,6 +44,8 @@ class PrimitiveList
 	private:
 	// List of Primitives owned and managed by this list
 	List<Primitive> primitives_;
+	// Owner of GL resources created for primitive instances (e.g. source collection)
+	const void* owner_;
 
 	public:
 	// Clear existing data
@@ -52,8 +54,12 @@ class PrimitiveList
 	void forgetAll();
 	// Reinitialise list so it is large enough to accomodate specified number of Primitives
 	void reinitialise(int newSize, bool allowShrink, GLenum type, bool colourData);
+	// Resize list to specified number of Primitives, reinitialising all but the first nKeep
+	void resize(int newSize, int nKeep, GLenum type, bool colourData);
 	// Add a new primitive to the end of the list
 	Primitive* addPrimitive(GLenum type, bool colourData);
+	// Return first primitive in list
+	Primitive* primitives();
 	// Return total number of defined vertices
 	int nDefinedVertices();
 	// Return total number of defined indices
@@ -62,8 +68,12 @@ class PrimitiveList
 	void pushInstance(const QOpenGLContext* context);
 	// Pop topmost instance layer
 	void popInstance(const QOpenGLContext* context);
+	// Update topmost instance layer, reusing existing buffers where possible
+	void updateInstance(const QOpenGLContext* context);
 	// Return number of instances of topmost primitive
 	int nInstances();
+	// Set owner of GL resources created for primitive instances
+	void setOwner(const void* owner);
 	// Send to OpenGL (i.e. render)
 	void sendToGL();
 
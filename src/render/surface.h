@@ -42,13 +42,14 @@ class Surface
 
 	public:
 	// Construct line surface representation of data in XY slices
-	static void constructLineXY(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale);
+	// If firstSlice is greater than zero, display data before that index is unchanged since the last construction, and existing primitives for it are kept
+	static void constructLineXY(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale, int firstSlice = 0);
 	// Construct line surface representation of data in ZY slices
 	static void constructLineZY(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale);
 	// Construct line surface representation of data
 	static void constructGrid(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale);
-	// Construct full surface representation of data
-	static void constructFull(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale);
+	// Construct full surface representation of data (with firstSlice as for constructLineXY())
+	static void constructFull(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale, int firstSlice = 0);
 };
 
 #endif
@@ -23,16 +23,28 @@
 #include "base/axes.h"
 
 // Construct full surface representation of data
-void Surface::constructFull(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale)
+void Surface::constructFull(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale, int firstSlice)
 {
-	// Forget all data in current primitives
-	primitiveList.forgetAll();
-
 	// Get extents of displayData to use based on current axes limits
 	Vec3<int> minIndex, maxIndex;
-	if (!calculateExtents(axes, displayAbscissa, displayData, minIndex, maxIndex)) return;
+	if (!calculateExtents(axes, displayAbscissa, displayData, minIndex, maxIndex))
+	{
+		primitiveList.forgetAll();
+		return;
+	}
 	int nZ = (maxIndex.z - minIndex.z) + 1;
 
+	// Determine how many existing primitives (one per strip between adjacent slices) can be kept
+	// The strip ending on the last old slice is always regenerated, since its normals depend on the slice following it.
+	// We require at least two old slices, since with fewer the primitives were not built as strips.
+	int nKeep = 0;
+	if (((firstSlice-2) >= minIndex.z) && (displayAbscissa.nItems() > 1))
+	{
+		if (maxIndex.z < firstSlice) return;
+		nKeep = (firstSlice-2) - minIndex.z;
+	}
+	else primitiveList.forgetAll();
+
 	// Copy and transform abscissa values (still in data space) into axes coordinates
 	Array<double> x(displayAbscissa, minIndex.x, maxIndex.x);
 	axes.transformX(x);
@@ -53,7 +65,8 @@ void Surface::constructFull(PrimitiveList& primitiveList, const Axes& axes, cons
 	}
 
 	// Resize primitive list so it's large enough for our needs
-	primitiveList.reinitialise(nZ-1, false, GL_TRIANGLES, true);
+	if (nKeep > 0) primitiveList.resize(nZ-1, nKeep, GL_TRIANGLES, true);
+	else primitiveList.reinitialise(nZ-1, false, GL_TRIANGLES, true);
 
 	// Temporary variables
 	Array< Vec3<double> > normA, normB;
@@ -64,25 +77,34 @@ void Surface::constructFull(PrimitiveList& primitiveList, const Axes& axes, cons
 	double zA, zB, zC;
 	Vec3<double> nrm(0.0, 1.0, 0.0);
 
-	// Construct first slice data and set initial min/max values
-	yA.copy(displayData[minIndex.z]->y(), minIndex.x, maxIndex.x);
-	typeA.copy(displayData[minIndex.z]->yType(), minIndex.x, maxIndex.x);
+	// Construct first slice data (along with that of the preceding slice, if we are keeping existing strips) and set initial min/max values
+	int startIndex = minIndex.z + nKeep;
+	zC = 0.0;
+	if (nKeep > 0)
+	{
+		yC.copy(displayData[startIndex-1]->y(), minIndex.x, maxIndex.x);
+		typeC.copy(displayData[startIndex-1]->yType(), minIndex.x, maxIndex.x);
+		axes.transformY(yC, typeC);
+		zC = axes.transformZ(displayData[startIndex-1]->z());
+	}
+	yA.copy(displayData[startIndex]->y(), minIndex.x, maxIndex.x);
+	typeA.copy(displayData[startIndex]->yType(), minIndex.x, maxIndex.x);
 	axes.transformY(yA, typeA);
-	zA = axes.transformZ(displayData[minIndex.z]->z());
-	if ((minIndex.z+1) <= maxIndex.z)	// Safety check - this should always be true because of the checks above
+	zA = axes.transformZ(displayData[startIndex]->z());
+	if ((startIndex+1) <= maxIndex.z)	// Safety check - this should always be true because of the checks above
 	{
-		yB.copy(displayData[minIndex.z+1]->y(), minIndex.x, maxIndex.x);
-		typeB.copy(displayData[minIndex.z+1]->yType(), minIndex.x, maxIndex.x);
+		yB.copy(displayData[startIndex+1]->y(), minIndex.x, maxIndex.x);
+		typeB.copy(displayData[startIndex+1]->yType(), minIndex.x, maxIndex.x);
 		axes.transformY(yB, typeB);
-		zB = axes.transformZ(displayData[minIndex.z+1]->z());
+		zB = axes.transformZ(displayData[startIndex+1]->z());
 	}
-	constructSurfaceStrip(x, yA, zA, axes, normA, colourA, colourScale, yC, 0.0, yB, zB);
+	constructSurfaceStrip(x, yA, zA, axes, normA, colourA, colourScale, yC, zC, yB, zB);
 
 	// Create triangles in strips between the previous and target Y/Z values
 	int nBit, nPlusOneBit, totalBit;
 	int vertexAn = -1, vertexBn = -1, vertexAnPlusOne = -1, vertexBnPlusOne = -1;
-	Primitive* currentPrimitive = primitiveList[0];
-	for (int index = minIndex.z+1; index <=maxIndex.z; ++index)
+	Primitive* currentPrimitive = primitiveList[nKeep];
+	for (int index = startIndex+1; index <=maxIndex.z; ++index)
 	{
 		// Grab next data (if we are not at the end of the index range)
 		if (index < maxIndex.z)
@@ -23,16 +23,27 @@
 #include "base/axes.h"
 
 // Construct line representation of data in XY slices
-void Surface::constructLineXY(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale)
+void Surface::constructLineXY(PrimitiveList& primitiveList, const Axes& axes, const Array<double>& displayAbscissa, List<DisplayDataSet>& displayData, ColourScale colourScale, int firstSlice)
 {
-	// Forget all data in current primitives
-	primitiveList.forgetAll();
-
 	// Get extents of displayData to use based on current axes limits
 	Vec3<int> minIndex, maxIndex;
-	if (!calculateExtents(axes, displayAbscissa, displayData, minIndex, maxIndex)) return;
+	if (!calculateExtents(axes, displayAbscissa, displayData, minIndex, maxIndex))
+	{
+		primitiveList.forgetAll();
+		return;
+	}
 	int nZ = (maxIndex.z - minIndex.z) + 1;
 
+	// Determine how many existing primitives (one per slice) can be kept
+	// If the first new slice lies beyond the z extent of the axes, then nothing new will be visible
+	int nKeep = 0;
+	if (firstSlice > minIndex.z)
+	{
+		if (maxIndex.z < firstSlice) return;
+		nKeep = firstSlice - minIndex.z;
+	}
+	else primitiveList.forgetAll();
+
 	// Copy and transform abscissa values (still in data space) into axes coordinates
 	Array<double> x(displayAbscissa, minIndex.x, maxIndex.x);
 	axes.transformX(x);
@@ -40,7 +51,7 @@ void Surface::constructLineXY(PrimitiveList& primitiveList, const Axes& axes, co
 	if (nX < 2) return;
 	
 	// Resize primitive list so it's large enough for our needs
-	primitiveList.reinitialise(nZ, true, GL_LINES, true);
+	primitiveList.resize(nZ, nKeep, GL_LINES, true);
 
 	// Get some values from axes so we can calculate colours properly
 	bool yLogarithmic = axes.logarithmic(1);
@@ -55,11 +66,11 @@ void Surface::constructLineXY(PrimitiveList& primitiveList, const Axes& axes, co
 	Array<DisplayDataSet::DataPointType> yType;
 
 	DisplayDataSet** slices = displayData.array();
-	Primitive* currentPrimitive = primitiveList[0];
+	Primitive* currentPrimitive = primitiveList[nKeep];
 
 	// Create lines for slices
 	int vertexA, vertexB;
-	for (int slice = minIndex.z; slice <= maxIndex.z; ++slice)
+	for (int slice = minIndex.z+nKeep; slice <= maxIndex.z; ++slice)
 	{
 		// Grab y and z values
 		y.copy(slices[slice]->y(), minIndex.x, maxIndex.x);
@@ -38,6 +38,7 @@ TextFragment::~TextFragment()
 void TextFragment::set(QString& text, double scale, Vec3<double> translation, bool italic, bool bold)
 {
 	text_ = text;
+	utf8Text_ = text.toUtf8();
 	scale_ = scale;
 	translation_ = translation;
 	italic_ = italic;
@@ -50,6 +51,12 @@ QString TextFragment::text()
 	return text_;
 }
 
+// Return text of fragment, encoded as UTF-8
+const QByteArray& TextFragment::utf8Text() const
+{
+	return utf8Text_;
+}
+
 // Return local scale for fragment
 double TextFragment::scale()
 {
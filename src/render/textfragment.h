@@ -25,6 +25,7 @@
 #include "templates/vector3.h"
 #include "templates/list.h"
 #include <QString>
+#include <QByteArray>
 
 // Forward Declarations
 /* none */
@@ -44,6 +45,8 @@ class TextFragment : public ListItem<TextFragment>
 	private:
 	// Fragment text
 	QString text_;
+	// Fragment text, encoded as UTF-8 (for passing to FTGL)
+	QByteArray utf8Text_;
 	// Local scale for fragment
 	double scale_;
 	// Local translation for fragment
@@ -58,6 +61,8 @@ class TextFragment : public ListItem<TextFragment>
 	void set(QString& text, double scale = 1.0, Vec3<double> translation = Vec3<double>(), bool italic = false, bool bold = false);
 	// Return fragment text
 	QString text();
+	// Return fragment text, encoded as UTF-8
+	const QByteArray& utf8Text() const;
 	// Return local scale for fragment
 	double scale();
 	// Return local translation for fragment
@@ -35,6 +35,7 @@ double TextPrimitive::textSizeScale_ = 1.0;
 // Constructor
 TextPrimitive::TextPrimitive() : ListItem<TextPrimitive>()
 {
+	invalidateLayout();
 }
 
 // Destructor
@@ -77,8 +78,16 @@ void TextPrimitive::setTextSizeScale(double textSizeScale)
 // Set data
 void TextPrimitive::set(QString text, Vec3<double> anchorPoint, TextPrimitive::TextAnchor anchorPosition, Vec3<double> adjustmentVector, Matrix& localRotation, double textSize, bool flat)
 {
-	// Call the parser
-	generateFragments(this, text);
+	// If the text is unchanged the existing fragments and bounding box are still valid, and only the transforms need recalculating
+	if (text == text_) fragmentTransformsFontVersion_ = -1;
+	else
+	{
+		// Clear old fragments and cached layout, and call the parser
+		text_ = text;
+		fragments_.clear();
+		invalidateLayout();
+		generateFragments(this, text);
+	}
 
 	anchorPoint_ = anchorPoint;
 	anchorPosition_ = anchorPosition;
@@ -88,6 +97,12 @@ void TextPrimitive::set(QString text, Vec3<double> anchorPoint, TextPrimitive::T
 	flat_ = flat;
 }
 
+// Return source text
+QString TextPrimitive::text() const
+{
+	return text_;
+}
+
 // Return transformation matrix to use when rendering the text
 Matrix TextPrimitive::transformationMatrix(const Matrix& viewMatrixInverse, double baseFontSize, TextFragment* fragment)
 {
@@ -162,6 +177,14 @@ Matrix TextPrimitive::transformationMatrix(const Matrix& viewMatrixInverse, doub
 // Calculate bounding box of primitive
 void TextPrimitive::boundingBox(Vec3<double>& lowerLeft, Vec3<double>& upperRight)
 {
+	// Return cached values if they are still valid for the current font
+	if (boundingBoxFontVersion_ == FontInstance::fontVersion())
+	{
+		lowerLeft = boundingBoxLowerLeft_;
+		upperRight = boundingBoxUpperRight_;
+		return;
+	}
+
 	// Set initial lowerLeft and upperRight from the first primitive in the list
 	if (fragments_.first()) FontInstance::boundingBox(fragments_.first()->text(), lowerLeft, upperRight);
 	else
@@ -193,6 +216,11 @@ void TextPrimitive::boundingBox(Vec3<double>& lowerLeft, Vec3<double>& upperRigh
 		if (ur.y > upperRight.y) upperRight.y = ur.y;
 		if (ur.x > upperRight.x) upperRight.x = ur.x;
 	}
+
+	// Store values in cache
+	boundingBoxLowerLeft_ = lowerLeft;
+	boundingBoxUpperRight_ = upperRight;
+	boundingBoxFontVersion_ = FontInstance::fontVersion();
 }
 
 // Render primitive
@@ -200,10 +228,14 @@ void TextPrimitive::render(const Matrix& viewMatrix, const Matrix& viewMatrixInv
 {
 	Matrix textMatrix;
 
+	// Make sure cached fragment transforms are up to date - only the view matrix should change from frame to frame
+	updateFragmentTransforms(viewMatrixInverse, baseFontSize);
+
 	// Loop over fragments
-	for (TextFragment* fragment = fragments_.first(); fragment != NULL; fragment = fragment->next)
+	int index = 0;
+	for (TextFragment* fragment = fragments_.first(); fragment != NULL; fragment = fragment->next, ++index)
 	{
-		textMatrix = transformationMatrix(viewMatrixInverse, baseFontSize, fragment) * viewMatrix;
+		textMatrix = fragmentTransforms_[index] * viewMatrix;
 		glLoadMatrixd(textMatrix.matrix());
 
 		// Draw bounding boxes around each fragment
@@ -225,14 +257,48 @@ void TextPrimitive::render(const Matrix& viewMatrix, const Matrix& viewMatrixInv
 		{
 			// Render the text twice - once with lines, and once with polygon fill
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			FontInstance::font()->Render(fragment->text().toUtf8());
+			FontInstance::font()->Render(fragment->utf8Text().constData());
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			FontInstance::font()->Render(fragment->text().toUtf8());
+			FontInstance::font()->Render(fragment->utf8Text().constData());
 		}
-		else FontInstance::font()->Render(fragment->text().toUtf8());
+		else FontInstance::font()->Render(fragment->utf8Text().constData());
 	}
 }
 
+/*
+ * Cached Layout
+ */
+
+// Invalidate cached layout data
+void TextPrimitive::invalidateLayout()
+{
+	boundingBoxFontVersion_ = -1;
+	fragmentTransformsFontVersion_ = -1;
+	fragmentTransforms_.clear();
+}
+
+// Update cached fragment transformation matrices, if necessary
+void TextPrimitive::updateFragmentTransforms(const Matrix& viewMatrixInverse, double baseFontSize)
+{
+	// Check cached data - flat text depends on the view, so must also check the view matrix inverse in that case
+	bool upToDate = true;
+	if (fragmentTransformsFontVersion_ != FontInstance::fontVersion()) upToDate = false;
+	else if (fragmentTransforms_.nItems() != fragments_.nItems()) upToDate = false;
+	else if (fragmentTransformsBaseFontSize_ != baseFontSize) upToDate = false;
+	else if (fragmentTransformsTextSizeScale_ != textSizeScale_) upToDate = false;
+	else if (flat_ && (fragmentTransformsViewMatrixInverse_ != viewMatrixInverse)) upToDate = false;
+	if (upToDate) return;
+
+	// Recalculate transforms
+	fragmentTransforms_.clear();
+	for (TextFragment* fragment = fragments_.first(); fragment != NULL; fragment = fragment->next) fragmentTransforms_.add(transformationMatrix(viewMatrixInverse, baseFontSize, fragment));
+
+	fragmentTransformsFontVersion_ = FontInstance::fontVersion();
+	fragmentTransformsBaseFontSize_ = baseFontSize;
+	fragmentTransformsTextSizeScale_ = textSizeScale_;
+	fragmentTransformsViewMatrixInverse_ = viewMatrixInverse;
+}
+
 /*
  * Generation
  */
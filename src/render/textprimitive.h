@@ -28,6 +28,7 @@
 #include "math/cuboid.h"
 #include "templates/vector3.h"
 #include "templates/list.h"
+#include "templates/array.h"
 #include <QString>
 
 // External Declarations
@@ -73,6 +74,8 @@ class TextPrimitive : public ListItem<TextPrimitive>
 	bool flat_;
 	// Text size
 	double textSize_;
+	// Source text from which fragments were generated
+	QString text_;
 	// Text fragments to render
 	List<TextFragment> fragments_;
 
@@ -81,6 +84,8 @@ class TextPrimitive : public ListItem<TextPrimitive>
 	static void setTextSizeScale(double textSizeScale);
 	// Set data
 	void set(QString text, Vec3<double> anchorPoint, TextAnchor anchorPosition, Vec3<double> adjustmentVector, Matrix& localRotation, double textSize, bool flat);
+	// Return source text
+	QString text() const;
 	// Return transformation matrix to use when rendering (including fragment scale/translation if one is specified)
 	Matrix transformationMatrix(const Matrix& viewMatrixInverse, double baseFontSize, TextFragment* fragment = NULL);
 	// Calculate bounding box of primitive
@@ -89,6 +94,30 @@ class TextPrimitive : public ListItem<TextPrimitive>
 	void render(const Matrix& viewMatrix, const Matrix& viewMatrixInverse, double baseFontSize);
 
 
+	/*
+	 * Cached Layout
+	 */
+	private:
+	// Font version at which cached bounding box was calculated
+	int boundingBoxFontVersion_;
+	// Cached bounding box of primitive
+	Vec3<double> boundingBoxLowerLeft_, boundingBoxUpperRight_;
+	// Cached transformation matrices for fragments
+	Array<Matrix> fragmentTransforms_;
+	// Font version at which cached fragment transformation matrices were calculated
+	int fragmentTransformsFontVersion_;
+	// Base font size and text scaling factor used for cached fragment transformation matrices
+	double fragmentTransformsBaseFontSize_, fragmentTransformsTextSizeScale_;
+	// View matrix inverse used for cached fragment transformation matrices (flat text only)
+	Matrix fragmentTransformsViewMatrixInverse_;
+
+	private:
+	// Invalidate cached layout data
+	void invalidateLayout();
+	// Update cached fragment transformation matrices, if necessary
+	void updateFragmentTransforms(const Matrix& viewMatrixInverse, double baseFontSize);
+
+
 	/*
 	 * Generation
 	 */
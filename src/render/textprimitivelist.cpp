@@ -31,12 +31,34 @@ TextPrimitiveList::TextPrimitiveList()
 void TextPrimitiveList::clear()
 {
 	textPrimitives_.clear();
+	recycledPrimitives_.clear();
+}
+
+// Move all primitives to the recycled list, so they may be reused by subsequent calls to add()
+void TextPrimitiveList::recycleAll()
+{
+	// Any primitives left over from the last recycle were not reused, so delete them now
+	recycledPrimitives_.clear();
+	while (textPrimitives_.first())
+	{
+		TextPrimitive* primitive = textPrimitives_.first();
+		textPrimitives_.disown(primitive);
+		recycledPrimitives_.own(primitive);
+	}
 }
 
 // Set data from literal coordinates and text
 void TextPrimitiveList::add(QString text, Vec3<double> anchorPoint, TextPrimitive::TextAnchor anchorPosition, Vec3<double> adjustmentVector, Matrix& localRotation, double textSize, bool flat)
 {
-	TextPrimitive* primitive = textPrimitives_.add();
+	// Reuse a recycled primitive with the same text if there is one, avoiding parsing the text and recalculating its bounding box
+	TextPrimitive* primitive;
+	for (primitive = recycledPrimitives_.first(); primitive != NULL; primitive = primitive->next) if (primitive->text() == text) break;
+	if (primitive)
+	{
+		recycledPrimitives_.disown(primitive);
+		textPrimitives_.own(primitive);
+	}
+	else primitive = textPrimitives_.add();
 	primitive->set(text, anchorPoint, anchorPosition, adjustmentVector, localRotation, textSize, flat);
 }
 
@@ -66,6 +88,23 @@ Cuboid TextPrimitiveList::boundingCuboid(const Matrix& viewMatrixInverse, double
 	return result;
 }
 
+// Append corners of the bounding box of each text primitive in the list (in local coordinates) to the supplied array
+void TextPrimitiveList::boundingQuads(const Matrix& viewMatrixInverse, double baseFontSize, Array< Vec3<double> >& corners)
+{
+	Matrix textMatrix;
+	Vec3<double> lowerLeft, upperRight;
+	for (TextPrimitive* primitive = textPrimitives_.first(); primitive != NULL; primitive = primitive->next)
+	{
+		// Get transformation matrix and bounding box for text, and transform the four corners (in order around the box)
+		textMatrix = primitive->transformationMatrix(viewMatrixInverse, baseFontSize);
+		primitive->boundingBox(lowerLeft, upperRight);
+		corners.add(textMatrix*lowerLeft);
+		corners.add(textMatrix*Vec3<double>(upperRight.x, lowerLeft.y, 0.0));
+		corners.add(textMatrix*upperRight);
+		corners.add(textMatrix*Vec3<double>(lowerLeft.x, upperRight.y, 0.0));
+	}
+}
+
 // Render all primitives in list
 void TextPrimitiveList::renderAll(const Matrix& viewMatrix, const Matrix& viewMatrixInverse, double baseFontSize)
 {
@@ -27,6 +27,7 @@
 #include "math/cuboid.h"
 #include "templates/vector3.h"
 #include "templates/list.h"
+#include "templates/array.h"
 #include <QString>
 
 // Forward Declarations
@@ -42,14 +43,20 @@ class TextPrimitiveList
 	private:
 	// List of text primitive chunks
 	List<TextPrimitive> textPrimitives_;
+	// Primitives available for reuse by add()
+	List<TextPrimitive> recycledPrimitives_;
 
 	public:
 	// Clear list
 	void clear();
+	// Move all primitives to the recycled list, so they may be reused by subsequent calls to add()
+	void recycleAll();
 	// Add primitive to list
 	void add(QString text, Vec3<double> anchorPoint, TextPrimitive::TextAnchor anchorPosition, Vec3<double> adjustmentVector, Matrix& rotation, double textSize, bool flat);
 	// Update global bounding cuboid for all text primitives in the list
 	Cuboid boundingCuboid(const Matrix& viewMatrixInverse, double baseFontSize, Cuboid startingCuboid = Cuboid());
+	// Append corners of the bounding box of each text primitive in the list (in local coordinates) to the supplied array
+	void boundingQuads(const Matrix& viewMatrixInverse, double baseFontSize, Array< Vec3<double> >& corners);
 	// Render all primitives in list
 	void renderAll(const Matrix& viewMatrix, const Matrix& viewMatrixInverse, double baseFontSize);
 };
@@ -74,6 +74,8 @@ void EditStateData::set(QString name, Data2D* value)
 {
 	name_ = name;
 	type_ = EditStateData::Data2DData;
+
+	// Array storage is shared with the source until either is modified, so this is a cheap snapshot
 	dataData2D_ = (*value);
 }
 
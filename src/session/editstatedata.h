@@ -56,11 +56,11 @@ class EditStateData : public ListItem<EditStateData>
 	double dataD_;
 	// Associated string data
 	QString dataS_;
-	// Associated Collection data
+	// Associated Collection data (whose dataset values share storage with the original)
 	Collection dataCollection_;
 	// Associated LineStyle data
 	LineStyle dataLineStyle_;
-	// Associated Data2D data
+	// Associated Data2D data (snapshot sharing storage with the original)
 	Data2D dataData2D_;
 
 	public:
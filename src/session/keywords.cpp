@@ -193,10 +193,10 @@ int UChromaSession::fitResultsKeywordNArguments(UChromaSession::FitResultsKeywor
  */
 
 // Settings Block Keywords
-const char* SettingsBlockKeywords[] = { "EndSettings", "ImageExport" };
+const char* SettingsBlockKeywords[] = { "BinaryDataFile", "EndSettings", "ImageExport" };
 
 // Settings Block NArguments
-int SettingsKeywordNArguments[] = { 0, 5 };
+int SettingsKeywordNArguments[] = { 1, 0, 5 };
 
 /*!
  * \brief Convert text string to SettingsKeyword
@@ -228,10 +228,10 @@ int UChromaSession::settingsKeywordNArguments(UChromaSession::SettingsKeyword kw
  */
 
 // DataSet Block Keywords
-const char* DataSetBlockKeywords[] = { "Data", "EndDataSet", "Source", "Z" };
+const char* DataSetBlockKeywords[] = { "BinaryData", "Data", "EndDataSet", "Source", "Z" };
 
 // DataSet Block NArguments
-int DataSetKeywordNArguments[] = { 0, 0, 1, 1 };
+int DataSetKeywordNArguments[] = { 1, 0, 0, 1, 1 };
 
 /*!
  * \brief Convert text string to DataSetKeyword
@@ -23,8 +23,10 @@
 #include "gui/uchroma.h"
 #include "kernels/fit.h"
 #include "base/lineparser.h"
+#include "base/datacache.h"
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QFileInfo>
 
 #define CHECKIOFAIL { if (hardIOFail_) { return false; } else { break; } }
 
@@ -301,6 +303,12 @@ bool UChromaSession::readCollectionBlock(LineParser& parser, Collection* collect
 				collection->setDataFileDirectory(QDir(parser.argString(1)));
 				if (!collection->dataFileDirectory().isReadable())
 				{
+					// If there is no main window, just warn about the problem
+					if (!uChroma_)
+					{
+						msg.print("Warning: The data directory specified (%s) does not exist or is unreadable.\n", qPrintable(collection->dataFileDirectory().absolutePath()));
+						break;
+					}
 					QMessageBox::StandardButton button = QMessageBox::warning(uChroma_, "Error", "The data directory specified (" + collection->dataFileDirectory().absolutePath() + ") does not exist or is unreadable.\nDo you want to reset the datafile location?", QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
 					if (button == QMessageBox::Yes)
 					{
@@ -405,7 +413,10 @@ bool UChromaSession::readCollectionBlock(LineParser& parser, Collection* collect
 // Read DataSetBlock keywords
 bool UChromaSession::readDataSetBlock(LineParser& parser, DataSet* dataSet, Collection* collection)
 {
-	bool foundEnd;
+	bool foundEnd, deferred = false;
+	qint64 deferredOffset = -1;
+	int deferredNPoints = 0;
+	double deferredExtents[4];
 	DataSet::DataSource source;
 	Data2D data;
 	while (!parser.atEnd())
@@ -422,6 +433,27 @@ bool UChromaSession::readDataSetBlock(LineParser& parser, DataSet* dataSet, Coll
 		}
 		switch (dataSetKwd)
 		{
+			case (UChromaSession::BinaryDataKeyword):
+				if (!binaryDataInput_.isReadable())
+				{
+					msg.print("Error : DataSet '%s' references binary data, but no binary data file has been opened.\n", qPrintable(dataSet->name()));
+					return false;
+				}
+				// If lazy loading, and the number of points and extents are given, just note the location of the data
+				deferredOffset = parser.argString(1).toLongLong();
+				if (lazyLoading_ && parser.hasArg(6))
+				{
+					deferred = true;
+					deferredNPoints = parser.argi(2);
+					for (int n=0; n<4; ++n) deferredExtents[n] = parser.argd(n+3);
+					break;
+				}
+				if (!binaryDataInput_.readData(deferredOffset, data))
+				{
+					msg.print("Error : Failed to read binary data for dataSet '%s'.\n", qPrintable(dataSet->name()));
+					return false;
+				}
+				break;
 			case (UChromaSession::DataKeyword):
 				data.reset();
 				foundEnd = false;
@@ -441,6 +473,7 @@ bool UChromaSession::readDataSetBlock(LineParser& parser, DataSet* dataSet, Coll
 			case (UChromaSession::EndDataSetKeyword):
 				// Store acquired data before we return
 				dataSet->setData(data);
+				if (deferred) dataSet->setDeferredData(&binaryDataInput_, deferredOffset, deferredNPoints, deferredExtents[0], deferredExtents[1], deferredExtents[2], deferredExtents[3]);
 				return true;
 				break;
 			case (UChromaSession::SourceKeyword):
@@ -483,6 +516,7 @@ bool UChromaSession::readFitParametersBlock(LineParser& parser, FitKernel* fitKe
 {
 	FitKernel::RangeType rangeType;
 	IndexData::IndexType indexType;
+	Statistics::Statistic statistic;
 	EquationVariable* eqVar;
 	ReferenceVariable* refVar;
 	DataSpaceRange* dataSpaceRange;
@@ -550,6 +584,16 @@ bool UChromaSession::readFitParametersBlock(LineParser& parser, FitKernel* fitKe
 				refVar->zIndex().setIndex(parser.argi(6));
 				refVar->zIndex().setOffset(parser.argi(7));
 				refVar->setZDataSetName(parser.argString(8));
+				if (parser.hasArg(9))
+				{
+					statistic = Statistics::statistic(parser.argString(9));
+					if (statistic == Statistics::nStatistics)
+					{
+						msg.print("Warning: Unrecognised statistic '%s' for reference '%s' - defaulting to 'None'.\n", parser.argChar(9), parser.argChar(1));
+						statistic = Statistics::NoStatistic;
+					}
+					refVar->setStatistic(statistic);
+				}
 				break;
 			case (UChromaSession::VariableKeyword):
 				// First, see if named variable exists
@@ -670,6 +714,12 @@ bool UChromaSession::readSettingsBlock(LineParser& parser)
 		}
 		switch (settingsKwd)
 		{
+			// Binary data file
+			case (UChromaSession::BinaryDataFileKeyword):
+				// File is specified relative to the session file
+				if (!binaryDataInput_.openForReading(QFileInfo(parser.fileName()).absoluteDir().absoluteFilePath(parser.argString(1)))) return false;
+				binaryData_ = true;
+				break;
 			// End input block
 			case (UChromaSession::EndSettingsKeyword):
 				return true;
@@ -891,6 +941,18 @@ void UChromaSession::setHardIOFail(bool hardFail)
 	hardIOFail_ = hardFail;
 }
 
+// Set whether to defer loading of binary dataset values until they are required
+void UChromaSession::setLazyLoading(bool b)
+{
+	lazyLoading_ = b;
+}
+
+// Return whether to defer loading of binary dataset values until they are required
+bool UChromaSession::lazyLoading()
+{
+	return lazyLoading_;
+}
+
 // Load session from file specified
 bool UChromaSession::loadSession(QString fileName)
 {
@@ -898,7 +960,8 @@ bool UChromaSession::loadSession(QString fileName)
 
 	if (!parser.ready())
 	{
-		QMessageBox::warning(uChroma_, "Error", "Can't open specified file for reading.");
+		if (uChroma_) QMessageBox::warning(uChroma_, "Error", "Can't open specified file for reading.");
+		else msg.print("Error: Can't open file '%s' for reading.\n", qPrintable(fileName));
 		return false;
 	}
 
@@ -964,10 +1027,15 @@ bool UChromaSession::loadSession(QString fileName)
 	}
 	parser.closeFiles();
 
+	// Keep the binary data file open if it is providing deferred data, otherwise enforce the resident data budget
+	if (!lazyLoading_) binaryDataInput_.close();
+	else DataCache::enforceBudget();
+
 	// Show a message if we encountered problems...
 	if (!success)
 	{
-		QMessageBox::warning(uChroma_, "Problems Loading File", "Errors were encountered while loading the file.\nCheck the Log window for possible error messages.");
+		if (uChroma_) QMessageBox::warning(uChroma_, "Problems Loading File", "Errors were encountered while loading the file.\nCheck the Log window for possible error messages.");
+		else msg.print("Errors were encountered while loading the file '%s'.\n", qPrintable(fileName));
 	}
 
 	// Set necessary variables
@@ -0,0 +1,426 @@
+/*
+	*** Processing Pipeline
+	*** src/session/pipeline.cpp
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "session/pipeline.h"
+#include "session/session.h"
+#include "base/collection.h"
+#include "base/lineparser.h"
+#include "base/messenger.h"
+#include "base/nxs.h"
+#include "kernels/fit.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+
+/*
+ * Pipeline Stage
+ */
+
+// Constructor
+PipelineStage::PipelineStage() : ListItem<PipelineStage>()
+{
+	lineNumber = 0;
+}
+
+// Static Members
+List<PipelineStage> Pipeline::stages_;
+double Pipeline::keywordTime_[Pipeline::nPipelineKeywords];
+int Pipeline::keywordCount_[Pipeline::nPipelineKeywords];
+
+/*
+ * Keywords
+ */
+
+// Pipeline Keywords
+const char* PipelineKeywords[] = { "Collection", "Data", "Export", "Fit", "Interpolate", "Load", "NewCollection", "Nexus", "Save", "Slice", "Transform" };
+
+// Pipeline Keyword NArguments (minimum)
+int PipelineKeywordNArguments[] = { 1, 1, 1, 0, 2, 1, 1, 4, 1, 2, 2 };
+
+// Pipeline Keyword Usage
+const char* PipelineKeywordUsage[] = {
+	"<locator>\t\tMake the specified collection current (use quotes for 'Parent//Child' locators)",
+	"<file> [file...]\tAppend datasets from the specified files to the current collection",
+	"<file>\t\tExport the data of the current collection",
+	"[name|*]\t\tRun the named fit of the current collection ('*' for all fits), or the current collection's own fit if no name is given",
+	"<x|y> <step|off> [constrained]\tSet interpolation for the current collection",
+	"<file.ucr>\t\tLoad the specified session, making its first collection current",
+	"<name>\t\tCreate a new, empty collection and make it current",
+	"<file> <root> <x> <y|-> [z|-] [dataspace] [slice]\tAppend datasets from a Nexus file to the current collection, from x/y axis datasets or rows of a 2D/3D dataspace",
+	"<file.ucr>\t\tSave the current session",
+	"<x|z> <value> [name]\tExtract a slice from the current collection at the specified axis value",
+	"<x|y|z> <equation|off>\tSet a transform equation for the current collection"
+};
+
+// Convert text string to PipelineKeyword
+Pipeline::PipelineKeyword Pipeline::pipelineKeyword(QString s)
+{
+	for (int n=0; n<Pipeline::nPipelineKeywords; ++n) if (s == PipelineKeywords[n]) return (Pipeline::PipelineKeyword) n;
+	return Pipeline::nPipelineKeywords;
+}
+
+// Convert PipelineKeyword to text string
+const char* Pipeline::pipelineKeyword(Pipeline::PipelineKeyword kwd)
+{
+	return PipelineKeywords[kwd];
+}
+
+// Return minimum number of expected arguments
+int Pipeline::pipelineKeywordNArguments(Pipeline::PipelineKeyword kwd)
+{
+	return PipelineKeywordNArguments[kwd];
+}
+
+// Print pipeline keywords and their arguments
+void Pipeline::printKeywords()
+{
+	printf("\nPipeline file keywords (one stage per line):\n\n");
+	for (int n=0; n<Pipeline::nPipelineKeywords; ++n) printf("\t%s %s\n", PipelineKeywords[n], PipelineKeywordUsage[n]);
+	printf("\nIn all arguments, %%input is replaced by the current input file, %%base by its name without path or suffix, and %%dir by its directory.\n");
+}
+
+/*
+ * Stages
+ */
+
+// Substitute input file placeholders in the argument supplied
+QString Pipeline::substitute(QString arg, QString inputFile)
+{
+	if (!arg.contains('%')) return arg;
+
+	QFileInfo fileInfo(inputFile);
+	arg.replace("%input", inputFile);
+	arg.replace("%base", fileInfo.completeBaseName());
+	arg.replace("%dir", inputFile.isEmpty() ? QString(".") : fileInfo.path());
+
+	return arg;
+}
+
+// Return target collection for stage, reporting an error if there is none
+Collection* Pipeline::targetCollection(Pipeline::PipelineKeyword kwd)
+{
+	Collection* collection = UChromaSession::currentCollection();
+	if (!collection) msg.print("Error: Pipeline stage '%s' requires a current collection, but there is none.\n", PipelineKeywords[kwd]);
+	return collection;
+}
+
+// Append datasets read from Nexus file (using stage arguments) to specified collection
+bool Pipeline::appendNexusData(Collection* collection, const QStringList& args)
+{
+	// Arguments are the file, root group, x, y, and z axis datasets, dataspace, and slice index - '-' stands for an unused dataset
+	QString names[4];
+	for (int n=0; n<4; ++n) if ((args.count() > n+2) && (args.at(n+2) != "-")) names[n] = args.at(n+2);
+	int zSlice = (args.count() > 6 ? args.at(6).toInt() : -1);
+
+	List<Data2D> slices;
+	if (!NexusHelper::loadSlice(args.at(0), args.at(1), names[0], names[1], names[2], names[3], zSlice, slices)) return false;
+
+	// Create new datasets from the slices, and append them in one go
+	QFileInfo fileInfo(args.at(0));
+	List<DataSet> newDataSets;
+	for (Data2D* slice = slices.first(); slice != NULL; slice = slice->next)
+	{
+		DataSet* dataSet = newDataSets.add();
+		dataSet->setName(fileInfo.fileName() + " Z = " + QString::number(slice->z()));
+		dataSet->setDataSource(DataSet::InternalSource);
+		dataSet->setData(*slice);
+	}
+	int nAppended = collection->appendDataSets(newDataSets);
+	msg.print(Messenger::Verbose, "Appended %i dataset(s) from Nexus file '%s' to collection '%s'.\n", nAppended, qPrintable(args.at(0)), qPrintable(collection->name()));
+
+	return true;
+}
+
+// Run a single stage
+bool Pipeline::runStage(PipelineStage* stage, QString inputFile)
+{
+	PipelineKeyword kwd = pipelineKeyword(stage->args.at(0));
+
+	// Substitute placeholders in stage arguments
+	QStringList args;
+	for (int n=1; n<stage->args.count(); ++n) args << substitute(stage->args.at(n), inputFile);
+
+	Collection* collection = NULL;
+	int axis;
+	switch (kwd)
+	{
+		// Make the specified collection current
+		case (Pipeline::CollectionKeyword):
+			collection = UChromaSession::locateCollection(args.at(0));
+			if (!collection)
+			{
+				msg.print("Error: No collection '%s' exists in the current session.\n", qPrintable(args.at(0)));
+				return false;
+			}
+			UChromaSession::setCurrentCollection(collection);
+			break;
+		// Append datasets to the current collection
+		case (Pipeline::DataKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			for (int n=0; n<args.count(); ++n) if (!collection->appendDataSet(args.at(n))) return false;
+			break;
+		// Export data of the current collection
+		case (Pipeline::ExportKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			if (!collection->exportData(args.at(0))) return false;
+			break;
+		// Run fit(s)
+		case (Pipeline::FitKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			if (args.count() == 0)
+			{
+				if (!collection->fitKernel())
+				{
+					msg.print("Error: Collection '%s' is not a fit collection.\n", qPrintable(collection->name()));
+					return false;
+				}
+				if (!collection->fitKernel()->fit()) return false;
+			}
+			else if (args.at(0) == "*")
+			{
+				for (Collection* fit = collection->fits(); fit != NULL; fit = fit->next) if (fit->fitKernel() && (!fit->fitKernel()->fit())) return false;
+			}
+			else
+			{
+				Collection* fit = collection->fit(args.at(0));
+				if ((!fit) || (!fit->fitKernel()))
+				{
+					msg.print("Error: Collection '%s' has no fit named '%s'.\n", qPrintable(collection->name()), qPrintable(args.at(0)));
+					return false;
+				}
+				if (!fit->fitKernel()->fit()) return false;
+			}
+			break;
+		// Set interpolation
+		case (Pipeline::InterpolateKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			axis = args.at(0).toLower() == "x" ? 0 : (args.at(0).toLower() == "y" ? 1 : -1);
+			if (axis == -1)
+			{
+				msg.print("Error: Invalid axis '%s' given to '%s' (expected 'x' or 'y').\n", qPrintable(args.at(0)), PipelineKeywords[kwd]);
+				return false;
+			}
+			if (args.at(1).toLower() == "off") collection->setInterpolate(axis, false);
+			else
+			{
+				collection->setInterpolationStep(axis, args.at(1).toDouble());
+				collection->setInterpolateConstrained(axis, (args.count() > 2) && (args.at(2).toLower() == "constrained"));
+				collection->setInterpolate(axis, true);
+			}
+			break;
+		// Load session
+		case (Pipeline::LoadKeyword):
+			if (!UChromaSession::loadSession(args.at(0))) return false;
+			UChromaSession::setCurrentCollection(UChromaSession::collections());
+			break;
+		// Create new collection
+		case (Pipeline::NewCollectionKeyword):
+			UChromaSession::setCurrentCollection(UChromaSession::addCollection(args.at(0)));
+			break;
+		// Append datasets from Nexus file
+		case (Pipeline::NexusKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			if (!appendNexusData(collection, args)) return false;
+			break;
+		// Save session
+		case (Pipeline::SaveKeyword):
+			if (!UChromaSession::saveSession(args.at(0))) return false;
+			break;
+		// Extract slice
+		case (Pipeline::SliceKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			axis = args.at(0).toLower() == "x" ? 0 : (args.at(0).toLower() == "z" ? 2 : -1);
+			if (axis == -1)
+			{
+				msg.print("Error: Invalid axis '%s' given to '%s' (expected 'x' or 'z').\n", qPrintable(args.at(0)), PipelineKeywords[kwd]);
+				return false;
+			}
+			collection->extractCurrentSlice(axis, args.at(1).toDouble());
+			if (args.count() > 2)
+			{
+				// New slice is the last in the list
+				Collection* slice = collection->slices();
+				while (slice && slice->next) slice = slice->next;
+				if (slice) slice->setName(args.at(2));
+			}
+			break;
+		// Set transform
+		case (Pipeline::TransformKeyword):
+			if (!(collection = targetCollection(kwd))) return false;
+			axis = QString("xyz").indexOf(args.at(0).toLower());
+			if ((axis == -1) || (args.at(0).length() != 1))
+			{
+				msg.print("Error: Invalid axis '%s' given to '%s' (expected 'x', 'y', or 'z').\n", qPrintable(args.at(0)), PipelineKeywords[kwd]);
+				return false;
+			}
+			if (args.at(1).toLower() == "off") collection->setTransformEnabled(axis, false);
+			else
+			{
+				if (!collection->setTransformEquation(axis, args.at(1)))
+				{
+					msg.print("Error: Invalid transform equation '%s' given to '%s'.\n", qPrintable(args.at(1)), PipelineKeywords[kwd]);
+					return false;
+				}
+				collection->setTransformEnabled(axis, true);
+			}
+			break;
+		default:
+			printf("Internal Error: Pipeline keyword %i not accounted for in Pipeline::runStage().\n", kwd);
+			return false;
+	}
+
+	return true;
+}
+
+// Read pipeline from file
+bool Pipeline::read(QString fileName)
+{
+	stages_.clear();
+	for (int n=0; n<nPipelineKeywords; ++n)
+	{
+		keywordTime_[n] = 0.0;
+		keywordCount_[n] = 0;
+	}
+
+	LineParser parser(fileName);
+	if (!parser.ready())
+	{
+		msg.print("Error: Can't open pipeline file '%s' for reading.\n", qPrintable(fileName));
+		return false;
+	}
+
+	// Read and check all stages before anything is run
+	int lineNumber = 0;
+	bool result = true;
+	while (!parser.atEnd())
+	{
+		if (!parser.getArgs(LineParser::UseQuotes + LineParser::SkipBlanks + LineParser::StripComments)) break;
+		++lineNumber;
+		if (parser.nArgs() == 0) continue;
+
+		PipelineKeyword kwd = pipelineKeyword(parser.argString(0));
+		if (kwd == nPipelineKeywords)
+		{
+			msg.print("Error: Unrecognised keyword '%s' in pipeline file (stage %i).\n", parser.argChar(0), lineNumber);
+			result = false;
+			continue;
+		}
+		if ((parser.nArgs()-1) < pipelineKeywordNArguments(kwd))
+		{
+			msg.print("Error: Keyword '%s' expects at least %i argument(s), but %i were given (stage %i).\n", PipelineKeywords[kwd], pipelineKeywordNArguments(kwd), parser.nArgs()-1, lineNumber);
+			result = false;
+			continue;
+		}
+
+		PipelineStage* stage = stages_.add();
+		stage->lineNumber = lineNumber;
+		for (int n=0; n<parser.nArgs(); ++n) stage->args << parser.argString(n);
+	}
+	parser.closeFiles();
+
+	if (result && (stages_.nItems() == 0))
+	{
+		msg.print("Error: Pipeline file '%s' contains no stages.\n", qPrintable(fileName));
+		result = false;
+	}
+
+	return result;
+}
+
+// Run pipeline for the specified input file (which may be empty)
+bool Pipeline::run(QString inputFile)
+{
+	QElapsedTimer timer, stageTimer;
+	timer.start();
+
+	// Start a fresh session (with a default view pane and collection) for each input
+	UChromaSession::startNewSession(true);
+	UChromaSession::setSessionFileDirectory(QDir::current());
+
+	// Load input - sessions are loaded as-is, while any other file is read as a dataset into the default collection, which is named after it
+	if (!inputFile.isEmpty())
+	{
+		QFileInfo fileInfo(inputFile);
+		msg.print("Processing '%s'...\n", qPrintable(inputFile));
+		if (fileInfo.suffix() == "ucr")
+		{
+			if (!UChromaSession::loadSession(inputFile)) return false;
+			UChromaSession::setCurrentCollection(UChromaSession::collections());
+		}
+		else
+		{
+			Collection* collection = UChromaSession::collections();
+			UChromaSession::setCurrentCollection(collection);
+			collection->setName(fileInfo.completeBaseName());
+			if (!collection->appendDataSet(inputFile)) return false;
+		}
+		msg.print(Messenger::Verbose, "  Input loaded in %.3f s.\n", timer.elapsed()*0.001);
+	}
+
+	// Run stages
+	for (PipelineStage* stage = stages_.first(); stage != NULL; stage = stage->next)
+	{
+		PipelineKeyword kwd = pipelineKeyword(stage->args.at(0));
+
+		stageTimer.start();
+		bool result = runStage(stage, inputFile);
+		double stageTime = stageTimer.nsecsElapsed() * 1.0e-6;
+		keywordTime_[kwd] += stageTime;
+		++keywordCount_[kwd];
+
+		if (!result)
+		{
+			msg.print("Error: Pipeline stage %i ('%s') failed.\n", stage->lineNumber, qPrintable(stage->args.join(" ")));
+			return false;
+		}
+		msg.print(Messenger::Verbose, "  Stage %i (%s) completed in %.3f ms.\n", stage->lineNumber, PipelineKeywords[kwd], stageTime);
+	}
+
+	msg.print("Pipeline completed in %.3f s.\n", timer.elapsed()*0.001);
+
+	return true;
+}
+
+// Run pipeline for all input files specified (or once, with no input, if there are none)
+int Pipeline::runAll(QStringList inputFiles)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	int nFailed = 0;
+	if (inputFiles.isEmpty())
+	{
+		if (!run(QString())) ++nFailed;
+	}
+	else for (int n=0; n<inputFiles.count(); ++n) if (!run(inputFiles.at(n))) ++nFailed;
+	int nRuns = inputFiles.isEmpty() ? 1 : inputFiles.count();
+
+	// Print summary, including per-stage timings
+	msg.print("Processing complete: %i of %i input(s) succeeded in %.3f s.\n", nRuns - nFailed, nRuns, timer.elapsed()*0.001);
+	msg.print("  Stage           Count   Total (ms)   Mean (ms)\n");
+	for (int n=0; n<nPipelineKeywords; ++n)
+	{
+		if (keywordCount_[n] == 0) continue;
+		msg.print("  %-14s  %5i   %10.3f   %9.3f\n", PipelineKeywords[n], keywordCount_[n], keywordTime_[n], keywordTime_[n] / keywordCount_[n]);
+	}
+
+	return (nFailed == 0 ? 0 : 1);
+}
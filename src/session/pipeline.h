@@ -0,0 +1,107 @@
+/*
+	*** Processing Pipeline
+	*** src/session/pipeline.h
+	Copyright T. Youngs 2013-2015
+
+	This file is part of uChroma.
+
+	uChroma is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uChroma is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uChroma.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UCHROMA_PIPELINE_H
+#define UCHROMA_PIPELINE_H
+
+#include "templates/list.h"
+#include <QString>
+#include <QStringList>
+
+// Forward Declarations
+class Collection;
+
+// Pipeline Stage
+class PipelineStage : public ListItem<PipelineStage>
+{
+	public:
+	// Constructor
+	PipelineStage();
+	// Arguments (the first of which is the keyword)
+	QStringList args;
+	// Line number in pipeline file
+	int lineNumber;
+};
+
+// Processing Pipeline
+class Pipeline
+{
+	/*
+	 * Keywords
+	 */
+	public:
+	// Pipeline keywords
+	enum PipelineKeyword
+	{
+		CollectionKeyword,
+		DataKeyword,
+		ExportKeyword,
+		FitKeyword,
+		InterpolateKeyword,
+		LoadKeyword,
+		NewCollectionKeyword,
+		NexusKeyword,
+		SaveKeyword,
+		SliceKeyword,
+		TransformKeyword,
+		nPipelineKeywords
+	};
+	// Convert text string to PipelineKeyword
+	static PipelineKeyword pipelineKeyword(QString s);
+	// Convert PipelineKeyword to text string
+	static const char* pipelineKeyword(PipelineKeyword kwd);
+	// Return minimum number of expected arguments
+	static int pipelineKeywordNArguments(PipelineKeyword kwd);
+	// Print pipeline keywords and their arguments
+	static void printKeywords();
+
+
+	/*
+	 * Stages
+	 */
+	private:
+	// Stages of current pipeline
+	static List<PipelineStage> stages_;
+	// Total time spent in stages of each type (in ms)
+	static double keywordTime_[nPipelineKeywords];
+	// Number of stages of each type run
+	static int keywordCount_[nPipelineKeywords];
+
+	private:
+	// Substitute input file placeholders in the argument supplied
+	static QString substitute(QString arg, QString inputFile);
+	// Return target collection for stage, reporting an error if there is none
+	static Collection* targetCollection(PipelineKeyword kwd);
+	// Append datasets read from Nexus file (using stage arguments) to specified collection
+	static bool appendNexusData(Collection* collection, const QStringList& args);
+	// Run a single stage
+	static bool runStage(PipelineStage* stage, QString inputFile);
+
+	public:
+	// Read pipeline from file
+	static bool read(QString fileName);
+	// Run pipeline for the specified input file (which may be empty)
+	static bool run(QString inputFile);
+	// Run pipeline for all input files specified (or once, with no input, if there are none)
+	static int runAll(QStringList inputFiles);
+};
+
+#endif
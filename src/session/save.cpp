@@ -23,7 +23,11 @@
 #include "gui/uchroma.h"
 #include "kernels/fit.h"
 #include "base/lineparser.h"
+#include "base/bufferedwriter.h"
+#include "base/datacache.h"
+#include "base/jobscheduler.h"
 #include <QMessageBox>
+#include <QFileInfo>
 
 // Return boolean string based on integer value
 const char* stringBool(int i)
@@ -37,13 +41,21 @@ const char* stringBool(bool b)
 	return (b ? "true" : "false");
 }
 
+// Return string for double value, using the shortest representation which reads back exactly
+QByteArray stringDouble(double d)
+{
+	QByteArray s;
+	BufferedWriter::appendValue(s, d);
+	return s;
+}
+
 // Write AxisBlock keywords
 bool UChromaSession::writeAxisBlock(LineParser& parser, Axes& axes, int axis)
 {
 	parser.writeLineF("    %s %i\n", UChromaSession::viewPaneKeyword(UChromaSession::AxisBlockKeyword), axis);
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::AutoScaleKeyword), Axes::autoScaleMethod(axes.autoScale(axis)));
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::AutoTicksKeyword), stringBool(axes.autoTicks(axis)));
-	parser.writeLineF("      %s %f\n", UChromaSession::axisKeyword(UChromaSession::FirstTickKeyword), axes.tickFirst(axis));
+	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::FirstTickKeyword), stringDouble(axes.tickFirst(axis)).constData());
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::FractionalPositioningKeyword), stringBool(axes.positionIsFractional(axis)));
 	parser.writeLineF("      %s %s %s %s\n", UChromaSession::axisKeyword(UChromaSession::GridLinesKeyword), stringBool(axes.gridLinesMajor(axis)), stringBool(axes.gridLinesMinor(axis)), stringBool(axes.gridLinesFull(axis)));
 	LineStyle style = axes.gridLineMajorStyle(axis);
@@ -53,15 +65,15 @@ bool UChromaSession::writeAxisBlock(LineParser& parser, Axes& axes, int axis)
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::InvertKeyword), stringBool(axes.inverted(axis)));
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::LabelAnchorKeyword), TextPrimitive::textAnchor(axes.labelAnchor(axis)));
 	parser.writeLineF("      %s %f %f %f\n", UChromaSession::axisKeyword(UChromaSession::LabelOrientationKeyword), axes.labelOrientation(axis).x, axes.labelOrientation(axis).y, axes.labelOrientation(axis).z);
-	parser.writeLineF("      %s %f %f\n", UChromaSession::axisKeyword(UChromaSession::LimitsKeyword), axes.min(axis), axes.max(axis));
+	parser.writeLineF("      %s %s %s\n", UChromaSession::axisKeyword(UChromaSession::LimitsKeyword), stringDouble(axes.min(axis)).constData(), stringDouble(axes.max(axis)).constData());
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::LogarithmicKeyword), stringBool(axes.logarithmic(axis)));
 	parser.writeLineF("      %s %i\n", UChromaSession::axisKeyword(UChromaSession::MinorTicksKeyword), axes.minorTicks(axis));
 	NumberFormat fmt = axes.numberFormat(axis);
 	parser.writeLineF("      %s '%s' %i %s %s\n", UChromaSession::axisKeyword(UChromaSession::NumberFormatKeyword), NumberFormat::formatType(fmt.type()), fmt.nDecimals(), stringBool(fmt.useUpperCaseExponent()), stringBool(fmt.forcePrecedingPlus()));
 	parser.writeLineF("      %s %f %f %f\n", UChromaSession::axisKeyword(UChromaSession::PositionFractionalKeyword), axes.positionFractional(axis).x, axes.positionFractional(axis).y, axes.positionFractional(axis).z);
-	parser.writeLineF("      %s %f %f %f\n", UChromaSession::axisKeyword(UChromaSession::PositionRealKeyword), axes.positionReal(axis).x, axes.positionReal(axis).y, axes.positionReal(axis).z);
-	parser.writeLineF("      %s %f\n", UChromaSession::axisKeyword(UChromaSession::StretchKeyword), axes.stretch(axis));
-	parser.writeLineF("      %s %f\n", UChromaSession::axisKeyword(UChromaSession::TickDeltaKeyword), axes.tickDelta(axis));
+	parser.writeLineF("      %s %s %s %s\n", UChromaSession::axisKeyword(UChromaSession::PositionRealKeyword), stringDouble(axes.positionReal(axis).x).constData(), stringDouble(axes.positionReal(axis).y).constData(), stringDouble(axes.positionReal(axis).z).constData());
+	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::StretchKeyword), stringDouble(axes.stretch(axis)).constData());
+	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::TickDeltaKeyword), stringDouble(axes.tickDelta(axis)).constData());
 	parser.writeLineF("      %s %f %f %f\n", UChromaSession::axisKeyword(UChromaSession::TickDirectionKeyword), axes.tickDirection(axis).x, axes.tickDirection(axis).y, axes.tickDirection(axis).z);
 	parser.writeLineF("      %s %s\n", UChromaSession::axisKeyword(UChromaSession::TitleAnchorKeyword), TextPrimitive::textAnchor(axes.titleAnchor(axis)));
 	parser.writeLine(QString("      ")+UChromaSession::axisKeyword(UChromaSession::TitleKeyword)+" '"+axes.title(axis)+"'\n");
@@ -93,7 +105,7 @@ bool UChromaSession::writeCollectionBlock(LineParser& parser, Collection* collec
 	// -- Interpolation
 	parser.writeLineF("%s  %s %s %s\n", indent, UChromaSession::collectionKeyword(UChromaSession::InterpolateKeyword), stringBool(collection->interpolate(0)), stringBool(collection->interpolate(2)));
 	parser.writeLineF("%s  %s %s %s\n", indent, UChromaSession::collectionKeyword(UChromaSession::InterpolateConstrainKeyword), stringBool(collection->interpolateConstrained(0)), stringBool(collection->interpolateConstrained(2)));
-	parser.writeLineF("%s  %s %f %f\n", indent, UChromaSession::collectionKeyword(UChromaSession::InterpolateStepKeyword), collection->interpolationStep(0), collection->interpolationStep(2));
+	parser.writeLineF("%s  %s %s %s\n", indent, UChromaSession::collectionKeyword(UChromaSession::InterpolateStepKeyword), stringDouble(collection->interpolationStep(0)).constData(), stringDouble(collection->interpolationStep(2)).constData());
 
 	// Colour Setup
 	parser.writeLineF("%s  %s '%s'\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourSourceKeyword), Collection::colourSource(collection->colourSource()));
@@ -106,21 +118,21 @@ bool UChromaSession::writeCollectionBlock(LineParser& parser, Collection* collec
 	// -- RGB Gradient
 	colour = collection->colourScalePointColour(Collection::RGBGradientSource, 0);
 	value = collection->colourScalePointValue(Collection::RGBGradientSource, 0);
-	parser.writeLineF("%s  %s %f %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourRGBGradientAKeyword), value, colour.red(), colour.green(), colour.blue(), colour.alpha());
+	parser.writeLineF("%s  %s %s %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourRGBGradientAKeyword), stringDouble(value).constData(), colour.red(), colour.green(), colour.blue(), colour.alpha());
 	colour = collection->colourScalePointColour(Collection::RGBGradientSource, 1);
 	value = collection->colourScalePointValue(Collection::RGBGradientSource, 1);
-	parser.writeLineF("%s  %s %f %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourRGBGradientBKeyword), value, colour.red(), colour.green(), colour.blue(), colour.alpha());
+	parser.writeLineF("%s  %s %s %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourRGBGradientBKeyword), stringDouble(value).constData(), colour.red(), colour.green(), colour.blue(), colour.alpha());
 	// -- HSV Gradient
 	colour = collection->colourScalePointColour(Collection::HSVGradientSource, 0);
 	value = collection->colourScalePointValue(Collection::HSVGradientSource, 0);
-	parser.writeLineF("%s  %s %f %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourHSVGradientAKeyword), value, colour.hue(), colour.saturation(), colour.value(), colour.alpha());
+	parser.writeLineF("%s  %s %s %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourHSVGradientAKeyword), stringDouble(value).constData(), colour.hue(), colour.saturation(), colour.value(), colour.alpha());
 	colour = collection->colourScalePointColour(Collection::HSVGradientSource, 1);
 	value = collection->colourScalePointValue(Collection::HSVGradientSource, 1);
-	parser.writeLineF("%s  %s %f %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourHSVGradientBKeyword), value, colour.hue(), colour.saturation(), colour.value(), colour.alpha());
+	parser.writeLineF("%s  %s %s %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourHSVGradientBKeyword), stringDouble(value).constData(), colour.hue(), colour.saturation(), colour.value(), colour.alpha());
 	// -- Custom Gradient
 	for (csp = collection->customColourScalePoints(); csp != NULL; csp = csp->next)
 	{
-		parser.writeLineF("%s  %s %f %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourCustomGradientKeyword), csp->value(), csp->colour().red(), csp->colour().green(), csp->colour().blue(), csp->colour().alpha());
+		parser.writeLineF("%s  %s %s %i %i %i %i\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourCustomGradientKeyword), stringDouble(csp->value()).constData(), csp->colour().red(), csp->colour().green(), csp->colour().blue(), csp->colour().alpha());
 	}
 	// -- Alpha control
 	parser.writeLineF("%s  %s '%s'\n", indent, UChromaSession::collectionKeyword(UChromaSession::ColourAlphaControlKeyword), Collection::alphaControl(collection->alphaControl()));
@@ -134,6 +146,7 @@ bool UChromaSession::writeCollectionBlock(LineParser& parser, Collection* collec
 
 	// Loop over datasets
 	for (DataSet* dataSet = collection->dataSets(); dataSet != NULL; dataSet = dataSet->next) writeDataSetBlock(parser, dataSet, indentLevel);
+	DataCache::enforceBudget(collection);
 
 	// Write FitKernel data if present
 	if (collection->fitKernel()) writeFitParametersBlock(parser, collection->fitKernel(), indentLevel);
@@ -160,10 +173,23 @@ bool UChromaSession::writeDataSetBlock(LineParser& parser, DataSet* dataSet, int
 	parser.writeLineF("%s  %s '%s'\n", indent, UChromaSession::collectionKeyword(UChromaSession::DataSetDefinitionKeyword), qPrintable(dataSet->name()));
 	if (dataSet->dataSource() == DataSet::FileSource) parser.writeLineF("%s    %s %s '%s'\n", indent, UChromaSession::dataSetKeyword(UChromaSession::SourceKeyword), DataSet::dataSource(dataSet->dataSource()), qPrintable(dataSet->sourceFileName()));
 	else parser.writeLineF("%s    %s %s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::SourceKeyword), DataSet::dataSource(dataSet->dataSource()));
-	parser.writeLineF("%s    %s %f\n", indent, UChromaSession::dataSetKeyword(UChromaSession::ZKeyword), dataSet->data().z());
-	parser.writeLineF("%s    %s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::DataKeyword));
-	for (int n=0; n< dataSet->data().nPoints(); ++n) parser.writeLineF("%s      %f  %f\n", indent, dataSet->data().x(n), dataSet->data().y(n));
-	parser.writeLineF("%s    End%s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::DataKeyword));
+	char value[32];
+	BufferedWriter::formatValue(dataSet->data().z(), value);
+	parser.writeLineF("%s    %s %s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::ZKeyword), value);
+
+	// Write values to the binary data file if one is open, falling back to inline data if this fails
+	// The number of points and data extents are also written, so that the values themselves can be loaded on demand
+	qint64 offset = (binaryDataOutput_.isWritable() ? binaryDataOutput_.writeData(dataSet->data()) : -1);
+	if (offset != -1) parser.writeLineF("%s    %s %lli %i %s %s %s %s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::BinaryDataKeyword), offset, dataSet->nPoints(), stringDouble(dataSet->xMin()).constData(), stringDouble(dataSet->xMax()).constData(), stringDouble(dataSet->yMin()).constData(), stringDouble(dataSet->yMax()).constData());
+	else
+	{
+		parser.writeLineF("%s    %s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::DataKeyword));
+		// Values are written with full precision, and formatted as a single block rather than line-by-line
+		QByteArray text;
+		BufferedWriter::appendData(text, dataSet->data(), qPrintable(QString(indent) + "      "));
+		parser.writeLine(QString::fromLatin1(text));
+		parser.writeLineF("%s    End%s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::DataKeyword));
+	}
 	parser.writeLineF("%s  %s\n", indent, UChromaSession::dataSetKeyword(UChromaSession::EndDataSetKeyword));
 
 	return true;
@@ -181,23 +207,23 @@ bool UChromaSession::writeFitParametersBlock(LineParser& parser, FitKernel* fitK
 	for (RefListItem<ReferenceVariable,bool>* ri = fitKernel->usedReferences(); ri != NULL; ri = ri->next)
 	{
 		ReferenceVariable* refVar = ri->item;
-		parser.writeLineF("%s    %s %s %s %i %i %s %i %i '%s'\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ReferenceKeyword), qPrintable(refVar->name()), IndexData::indexType(refVar->xIndex().type()), refVar->xIndex().index(), refVar->xIndex().offset(), IndexData::indexType(refVar->zIndex().type()), refVar->zIndex().index(), refVar->zIndex().offset(), qPrintable(refVar->zDataSetName()));
+		parser.writeLineF("%s    %s %s %s %i %i %s %i %i '%s' %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ReferenceKeyword), qPrintable(refVar->name()), IndexData::indexType(refVar->xIndex().type()), refVar->xIndex().index(), refVar->xIndex().offset(), IndexData::indexType(refVar->zIndex().type()), refVar->zIndex().index(), refVar->zIndex().offset(), qPrintable(refVar->zDataSetName()), Statistics::statistic(refVar->statistic()));
 	}
 	parser.writeLineF("%s    %s '%s'\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::EquationKeyword), qPrintable(fitKernel->equationText()));
 	parser.writeLineF("%s    %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::GlobalKeyword), stringBool(fitKernel->global()));
 	parser.writeLineF("%s    %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::OrthogonalKeyword), stringBool(fitKernel->orthogonal()));
-	parser.writeLineF("%s    %s %f\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::LimitStrengthKeyword), fitKernel->limitStrength());
+	parser.writeLineF("%s    %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::LimitStrengthKeyword), stringDouble(fitKernel->limitStrength()).constData());
 	for (RefListItem<EquationVariable,bool>* ri = fitKernel->usedVariables(); ri != NULL; ri = ri->next)
 	{
 		EquationVariable* eqVar = ri->item;
-		parser.writeLineF("%s    %s %s %s %f %s %f %s %f\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::VariableKeyword), qPrintable(eqVar->name()), stringBool(eqVar->fit()), eqVar->value(), stringBool(eqVar->maximumLimitEnabled()), eqVar->minimumLimit(), stringBool(eqVar->maximumLimitEnabled()), eqVar->maximumLimit());
+		parser.writeLineF("%s    %s %s %s %s %s %s %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::VariableKeyword), qPrintable(eqVar->name()), stringBool(eqVar->fit()), stringDouble(eqVar->value()).constData(), stringBool(eqVar->maximumLimitEnabled()), stringDouble(eqVar->minimumLimit()).constData(), stringBool(eqVar->maximumLimitEnabled()), stringDouble(eqVar->maximumLimit()).constData());
 	}
 	parser.writeLineF("%s    %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::XRangeTypeKeyword), FitKernel::rangeType(fitKernel->xRange()));
-	parser.writeLineF("%s    %s %f %f\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::XRangeAbsoluteKeyword), fitKernel->absoluteXMin(), fitKernel->absoluteXMax());
+	parser.writeLineF("%s    %s %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::XRangeAbsoluteKeyword), stringDouble(fitKernel->absoluteXMin()).constData(), stringDouble(fitKernel->absoluteXMax()).constData());
 	parser.writeLineF("%s    %s %i %i\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::XRangeIndexKeyword), fitKernel->indexXMin()+1, fitKernel->indexXMax()+1);
 	parser.writeLineF("%s    %s %i\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::XRangeIndexSingleKeyword), fitKernel->indexXSingle()+1);
 	parser.writeLineF("%s    %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ZRangeTypeKeyword), FitKernel::rangeType(fitKernel->zRange()));
-	parser.writeLineF("%s    %s %f %f\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ZRangeAbsoluteKeyword), fitKernel->absoluteZMin(), fitKernel->absoluteZMax());
+	parser.writeLineF("%s    %s %s %s\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ZRangeAbsoluteKeyword), stringDouble(fitKernel->absoluteZMin()).constData(), stringDouble(fitKernel->absoluteZMax()).constData());
 	parser.writeLineF("%s    %s %i %i\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ZRangeIndexKeyword), fitKernel->indexZMin()+1, fitKernel->indexZMax()+1);
 	parser.writeLineF("%s    %s %i\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::ZRangeIndexSingleKeyword), fitKernel->indexZSingle()+1);
 
@@ -219,7 +245,7 @@ bool UChromaSession::writeFitResultsBlock(LineParser& parser, DataSpaceRange* ra
 	indent[indentLevel*2] = '\0';
 
 	parser.writeLineF("%s  %s %i\n", indent, UChromaSession::fitParametersKeyword(UChromaSession::FitResultsBlockKeyword), rangeID);
-	for (NamedValue* value = range->fittedValues(); value != NULL; value = value->next) parser.writeLineF("%s    %s %s %e\n", indent, UChromaSession::fitResultsKeyword(UChromaSession::FittedValueKeyword), qPrintable(value->name()), value->value());
+	for (NamedValue* value = range->fittedValues(); value != NULL; value = value->next) parser.writeLineF("%s    %s %s %s\n", indent, UChromaSession::fitResultsKeyword(UChromaSession::FittedValueKeyword), qPrintable(value->name()), stringDouble(value->value()).constData());
 	parser.writeLineF("%s  %s\n", indent, UChromaSession::fitResultsKeyword(UChromaSession::EndFitResultsKeyword));
 
 	return true;
@@ -229,6 +255,7 @@ bool UChromaSession::writeFitResultsBlock(LineParser& parser, DataSpaceRange* ra
 bool UChromaSession::writeSettingsBlock(LineParser& parser)
 {
 	parser.writeLineF("%s\n", UChromaSession::inputBlock(UChromaSession::SettingsBlock));
+	if (binaryDataOutput_.isWritable()) parser.writeLineF("  %s \"%s\"\n", UChromaSession::settingsKeyword(UChromaSession::BinaryDataFileKeyword), qPrintable(QFileInfo(BinaryDataFile::sidecarFileName(parser.fileName())).fileName()));
 	parser.writeLineF("  %s \"%s\" %i %i %s %i\n", UChromaSession::settingsKeyword(UChromaSession::ImageExportKeyword), qPrintable(imageExportFileName_), imageExportWidth_, imageExportHeight_, UChromaSession::imageFormatExtension(imageExportFormat_), imageExportMaintainAspect_);
 	parser.writeLineF("%s\n", UChromaSession::settingsKeyword(UChromaSession::EndSettingsKeyword));
 
@@ -256,17 +283,17 @@ bool UChromaSession::writeViewPaneBlock(LineParser& parser, ViewPane* pane)
 	parser.writeLineF("    %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::AutoPositionTitlesKeyword), stringBool(pane->axes().autoPositionTitles()));
 	for (int axis=0; axis < 3; ++axis) writeAxisBlock(parser, pane->axes(), axis);
 	parser.writeLineF("    %s %i\n", UChromaSession::viewPaneKeyword(UChromaSession::BoundingBoxKeyword), pane->boundingBox());
-	parser.writeLineF("    %s %f\n", UChromaSession::viewPaneKeyword(UChromaSession::BoundingBoxPlaneYKeyword), pane->boundingBoxPlaneY());
+	parser.writeLineF("    %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::BoundingBoxPlaneYKeyword), stringDouble(pane->boundingBoxPlaneY()).constData());
 	parser.writeLineF("    %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::FlatLabelsKeyword), stringBool(pane->flatLabels()));
 	parser.writeLineF("    %s %i %i %i %i\n", UChromaSession::viewPaneKeyword(UChromaSession::GeometryKeyword), pane->bottomEdge(), pane->leftEdge(), pane->width(), pane->height()); 
 	parser.writeLineF("    %s %f\n", UChromaSession::viewPaneKeyword(UChromaSession::LabelPointSizeKeyword), pane->labelPointSize());
 	parser.writeLineF("    %s %f\n", UChromaSession::viewPaneKeyword(UChromaSession::TitlePointSizeKeyword), pane->titlePointSize());
 	Matrix mat = pane->viewRotation();
 	Vec3<double> trans = pane->viewTranslation();
-	parser.writeLineF("    %s %f %f %f\n", UChromaSession::viewPaneKeyword(UChromaSession::RotationXKeyword), mat[0], mat[1], mat[2]);
-	parser.writeLineF("    %s %f %f %f\n", UChromaSession::viewPaneKeyword(UChromaSession::RotationYKeyword), mat[4], mat[5], mat[6]);
-	parser.writeLineF("    %s %f %f %f\n", UChromaSession::viewPaneKeyword(UChromaSession::RotationZKeyword), mat[8], mat[9], mat[10]);
-	parser.writeLineF("    %s %f %f %f\n", UChromaSession::viewPaneKeyword(UChromaSession::TranslationKeyword), trans.x, trans.y, trans.z);
+	parser.writeLineF("    %s %s %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::RotationXKeyword), stringDouble(mat[0]).constData(), stringDouble(mat[1]).constData(), stringDouble(mat[2]).constData());
+	parser.writeLineF("    %s %s %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::RotationYKeyword), stringDouble(mat[4]).constData(), stringDouble(mat[5]).constData(), stringDouble(mat[6]).constData());
+	parser.writeLineF("    %s %s %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::RotationZKeyword), stringDouble(mat[8]).constData(), stringDouble(mat[9]).constData(), stringDouble(mat[10]).constData());
+	parser.writeLineF("    %s %s %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::TranslationKeyword), stringDouble(trans.x).constData(), stringDouble(trans.y).constData(), stringDouble(trans.z).constData());
 	parser.writeLineF("    %s %s\n", UChromaSession::viewPaneKeyword(UChromaSession::PerspectiveKeyword), stringBool(pane->hasPerspective()));
 	parser.writeLineF("    %s '%s'\n", UChromaSession::viewPaneKeyword(UChromaSession::RoleKeyword), ViewPane::paneRole(pane->role()));
 	for (TargetData* target = pane->collectionTargets(); target != NULL; target = target->next)
@@ -282,16 +309,50 @@ bool UChromaSession::writeViewPaneBlock(LineParser& parser, ViewPane* pane)
 	return true;
 }
 
+// Set whether dataset values are written to a binary sidecar file rather than inline
+void UChromaSession::setBinaryData(bool b)
+{
+	binaryData_ = b;
+}
+
+// Return whether dataset values are written to a binary sidecar file rather than inline
+bool UChromaSession::binaryData()
+{
+	return binaryData_;
+}
+
 // Save current data to file specified
 bool UChromaSession::saveSession(QString fileName)
 {
 	LineParser parser(fileName, true);
 	if (!parser.ready())
 	{
-		QMessageBox::warning(uChroma_, "Error", "Can't open specified file for writing.");
+		if (uChroma_) QMessageBox::warning(uChroma_, "Error", "Can't open specified file for writing.");
+		else msg.print("Error: Can't open file '%s' for writing.\n", qPrintable(fileName));
 		return false;
 	}
 
+	// Open binary data file if required
+	if (binaryData_)
+	{
+		QString sidecarFileName = BinaryDataFile::sidecarFileName(fileName);
+
+		// If we are about to replace the file providing deferred data, all of that data must be made resident first
+		if (binaryDataInput_.isReadable() && (QFileInfo(binaryDataInput_.fileName()) == QFileInfo(sidecarFileName)))
+		{
+			for (Collection* collection = collections_.first(); collection != NULL; collection = collection->next) collection->detachDeferredData();
+			JobScheduler::waitForDone();
+			binaryDataInput_.close();
+		}
+
+		if (!binaryDataOutput_.openForWriting(sidecarFileName))
+		{
+			if (uChroma_) QMessageBox::warning(uChroma_, "Error", "Can't open binary data file for writing.");
+			parser.closeFiles();
+			return false;
+		}
+	}
+
 	// Write Settings Data
 	writeSettingsBlock(parser);
 
@@ -302,5 +363,13 @@ bool UChromaSession::saveSession(QString fileName)
 	writeViewBlock(parser);
 
 	parser.closeFiles();
+
+	// Finalise binary data file
+	if (binaryDataOutput_.isWritable() && (!binaryDataOutput_.close()))
+	{
+		if (uChroma_) QMessageBox::warning(uChroma_, "Error", "Failed to write binary data file.");
+		return false;
+	}
+
 	return true;
 }
@@ -21,6 +21,7 @@
 
 #include "session/session.h"
 #include "gui/uchroma.h"
+#include "base/jobscheduler.h"
 #include "version.h"
 
 // Static variables
@@ -46,6 +47,10 @@ ViewPane* UChromaSession::currentViewPane_ = NULL;
 QDir UChromaSession::sessionFileDirectory_;
 QString UChromaSession::inputFile_;
 bool UChromaSession::hardIOFail_ = false;
+bool UChromaSession::binaryData_ = false;
+BinaryDataFile UChromaSession::binaryDataInput_;
+BinaryDataFile UChromaSession::binaryDataOutput_;
+bool UChromaSession::lazyLoading_ = false;
 // -- Edit states
 List<EditStateGroup> UChromaSession::editStateGroups_;
 // Current EditStateGroup (for undo)
@@ -257,8 +262,10 @@ QString UChromaSession::uniqueCollectionName(QString baseName)
 // Setup new, empty session
 void UChromaSession::startNewSession(bool createDefaults)
 {
-	// Clear collections
+	// Clear collections, and close any file providing their deferred data (once any jobs still reading from it have stopped)
 	collections_.clear();
+	JobScheduler::waitForDone();
+	binaryDataInput_.close();
 
 	// Clear layout
 	viewLayout_.clear();
@@ -278,6 +285,7 @@ void UChromaSession::startNewSession(bool createDefaults)
 	// Set current project data
 	setAsNotModified();
 	inputFile_ = QString();
+	binaryData_ = false;
 }
 
 // Add new collection
@@ -415,7 +423,7 @@ void UChromaSession::focusNextCollection()
 	// Safety check...
 	if (currentCollection_ == NULL) currentCollection_ = collections_.first();
 
-	uChroma_->updateGUI();
+	if (uChroma_) uChroma_->updateGUI();
 }
 
 // Move collection focus to previous in list
@@ -426,7 +434,7 @@ void UChromaSession::focusPreviousCollection()
 	// Safety check...
 	if (currentCollection_ == NULL) currentCollection_ = collections_.last()->previousCollection(true);
 
-	uChroma_->updateGUI();
+	if (uChroma_) uChroma_->updateGUI();
 }
 
 // Set current Collection
@@ -496,7 +504,7 @@ void UChromaSession::recalculateViewLayout(int contextWidth, int contextHeight)
 {
 	viewLayout_.recalculate(contextWidth, contextHeight);
 
-	uChroma_->updateDisplay();
+	if (uChroma_) uChroma_->updateDisplay();
 }
 
 // Set current view pane to the one under the specified screen coordinates
@@ -508,7 +516,7 @@ bool UChromaSession::setCurrentViewPane(int layoutX, int layoutY)
 	currentViewPane_ = newCurrentPane;
 
 	// Toolbars and subwindows now need updating
-	uChroma_->updateToolBars();
+	if (uChroma_) uChroma_->updateToolBars();
 
 	return true;
 }
@@ -677,7 +685,7 @@ void UChromaSession::endEditStateGroup()
 	currentEditStateGroup_ = NULL;
 
 	// Update Edit menu
-	uChroma_->updateUndoRedo();
+	if (uChroma_) uChroma_->updateUndoRedo();
 }
 
 // Return current EditStateGroup
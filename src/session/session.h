@@ -27,6 +27,7 @@
 #include "session/editstate.h"
 #include "session/editstatedata.h"
 #include "session/editstategroup.h"
+#include "base/binarydata.h"
 #include "base/collection.h"
 #include "base/viewlayout.h"
 
@@ -200,6 +201,14 @@ class UChromaSession
 	static QString inputFile_;
 	// Whether to enforce hard fail on input file error
 	static bool hardIOFail_;
+	// Whether dataset values are written to a binary sidecar file rather than inline
+	static bool binaryData_;
+	// Binary sidecar file being read (kept open while it provides deferred data)
+	static BinaryDataFile binaryDataInput_;
+	// Binary sidecar file being written
+	static BinaryDataFile binaryDataOutput_;
+	// Whether to defer loading of binary dataset values until they are required
+	static bool lazyLoading_;
 
 	public:
 	// Input File Block Keyword Enum
@@ -293,6 +302,7 @@ class UChromaSession
 	// DataSet Block Keyword Enum
 	enum DataSetKeyword
 	{
+		BinaryDataKeyword,
 		DataKeyword,
 		EndDataSetKeyword,
 		SourceKeyword,
@@ -351,6 +361,7 @@ class UChromaSession
 	// Settings Block Keyword Enum
 	enum SettingsKeyword
 	{
+		BinaryDataFileKeyword,
 		EndSettingsKeyword,
 		ImageExportKeyword,
 		nSettingsKeywords
@@ -453,6 +464,14 @@ class UChromaSession
 	static QString inputFile();
 	// Set whether to enforce hard fail on session file error
 	static void setHardIOFail(bool hardFail);
+	// Set whether dataset values are written to a binary sidecar file rather than inline
+	static void setBinaryData(bool b);
+	// Return whether dataset values are written to a binary sidecar file rather than inline
+	static bool binaryData();
+	// Set whether to defer loading of binary dataset values until they are required
+	static void setLazyLoading(bool b);
+	// Return whether to defer loading of binary dataset values until they are required
+	static bool lazyLoading();
 	// Load session from file specified
 	static bool loadSession(QString fileName);
 	// Save session input to file specified
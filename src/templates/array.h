@@ -27,10 +27,13 @@
 #include "base/messenger.h"
 #include "templates/list.h"
 #include "templates/vector3.h"
+#include <QAtomicInt>
 
 /*!
  * \short Array
  * \details A simple dynamic Array-style class.
+ * Storage is shared between copies of an Array, and is only duplicated when one of them is modified (copy-on-write), so
+ * snapshots of large arrays (e.g. for undo/redo, or for use in another thread) are cheap until they diverge.
  */
 template <class A> class Array : public ListItem< Array<A> >
 {
@@ -38,6 +41,7 @@ template <class A> class Array : public ListItem< Array<A> >
 	// Constructors
 	Array(int initialSize = 0) : ListItem< Array<A> >()
 	{
+		storage_ = NULL;
 		array_ = NULL;
 		size_ = 0;
 		nItems_ = 0;
@@ -45,6 +49,7 @@ template <class A> class Array : public ListItem< Array<A> >
 	}
 	Array(const Array<A>& source, int firstIndex, int lastIndex) : ListItem< Array<A> >()
 	{
+		storage_ = NULL;
 		array_ = NULL;
 		size_ = 0;
 		nItems_ = 0;
@@ -53,27 +58,30 @@ template <class A> class Array : public ListItem< Array<A> >
 	// Destructor
 	~Array()
 	{
-		if (array_ != NULL) delete[] array_;
+		release();
 	}
 	// Copy Constructor
 	Array(const Array<A>& source)
 	{
-		array_ = NULL;
-		size_ = 0;
-		resize(source.size_);
-		nItems_ = source.nItems_;
-		for (int n=0; n<nItems_; ++n) array_[n] = source.array_[n];
+		storage_ = NULL;
+		share(source);
 	}
 	// Assignment Operator
 	void operator=(const Array<A>& source)
 	{
-		clear();
-		resize(source.size_);
-		nItems_ = source.nItems_;
-		for (int n=0; n<nItems_; ++n) array_[n] = source.array_[n];
+		if (this == &source) return;
+		release();
+		share(source);
 	}
 	// Conversion operator (to standard array)
+	// -- Storage is detached from any other Arrays sharing it, so use constArray() (or a const Array) when only reading
 	operator A*()
+	{
+		detach();
+		return array_;
+	}
+	// Conversion operator (to const standard array)
+	operator const A*() const
 	{
 		return array_;
 	}
@@ -84,40 +92,76 @@ template <class A> class Array : public ListItem< Array<A> >
 	 */
 	///@{
 	private:
+	// Reference-counted array storage
+	class Storage
+	{
+		public:
+		Storage(int size)
+		{
+			refCount = 1;
+			data = new A[size];
+		}
+		~Storage()
+		{
+			delete[] data;
+		}
+		// Number of Arrays using this storage
+		QAtomicInt refCount;
+		// Data
+		A* data;
+	};
+	// Storage for data, possibly shared with other Arrays
+	Storage* storage_;
 	// Current size of Array
 	int size_;
-	// Array data
+	// Array data (in storage_)
 	A* array_;
 	// Number of data actually in Array
 	int nItems_;
 
 	private:
+	// Release reference to current storage
+	void release()
+	{
+		if (storage_ && (!storage_->refCount.deref())) delete storage_;
+		storage_ = NULL;
+		array_ = NULL;
+		size_ = 0;
+	}
+	// Share storage of source array
+	void share(const Array<A>& source)
+	{
+		storage_ = source.storage_;
+		if (storage_) storage_->refCount.ref();
+		array_ = source.array_;
+		size_ = source.size_;
+		nItems_ = source.nItems_;
+	}
+	// Replace storage with new storage of specified size, keeping existing data
+	void reallocate(int newSize)
+	{
+		Storage* newStorage = new Storage(newSize);
+		for (int n=0; n<nItems_; ++n) newStorage->data[n] = array_[n];
+
+		int nItems = nItems_;
+		release();
+		storage_ = newStorage;
+		array_ = storage_->data;
+		size_ = newSize;
+		nItems_ = nItems;
+	}
 	// Resize array 
 	void resize(int newSize)
 	{
 		// Array large enough already?
 		if ((newSize-size_) <= 0) return;
 
-		// Copy old data to temporary array
-		int oldSize = size_;
-		A* oldData = NULL;
-		if (oldSize > 0)
-		{
-			oldData = new A[oldSize];
-			for (int n=0; n<nItems_; ++n) oldData[n] = array_[n];
-		}
-
-		// Delete old, and create new array
-		if (array_ != NULL) delete[] array_;
-		size_ = newSize;
-		array_ = new A[size_];
-
-		// Copy old data into new array
-		if (oldSize > 0)
-		{
-			for (int n=0; n<nItems_; ++n) array_[n] = oldData[n];
-			delete[] oldData;
-		}
+		reallocate(newSize);
+	}
+	// Make sure storage is not shared with any other Array, prior to modification
+	void detach()
+	{
+		if (storage_ && (storage_->refCount.load() > 1)) reallocate(size_);
 	}
 
 	public:
@@ -131,8 +175,24 @@ template <class A> class Array : public ListItem< Array<A> >
 	{
 		return size_;
 	}
+	// Return whether storage is currently shared with another Array
+	bool isShared() const
+	{
+		return (storage_ && (storage_->refCount.load() > 1));
+	}
 	// Return data array
 	A* array()
+	{
+		detach();
+		return array_;
+	}
+	// Return data array (const)
+	const A* array() const
+	{
+		return array_;
+	}
+	// Return data array for reading, without detaching shared storage
+	const A* constArray() const
 	{
 		return array_;
 	}
@@ -141,11 +201,18 @@ template <class A> class Array : public ListItem< Array<A> >
 	{
 		nItems_ = 0;
 	}
+	// Clear array, releasing its storage
+	void releaseStorage()
+	{
+		release();
+		nItems_ = 0;
+	}
 	// Create empty array of specified size
 	void createEmpty(int size, A value = A())
 	{
-		// First, resize array...
+		// First, resize array (or take our own copy of it)...
 		resize(size);
+		detach();
 		
 		// ...then set number of items to specified size...
 		nItems_ = size;
@@ -171,6 +238,7 @@ template <class A> class Array : public ListItem< Array<A> >
 		if (nItemsToCopy > 0)
 		{
 			resize(nItemsToCopy);
+			detach();
 			nItems_ = nItemsToCopy;
 			for (int n=0; n<nItems_; ++n) array_[n] = source.array_[n+firstIndex];
 		}
@@ -188,12 +256,28 @@ template <class A> class Array : public ListItem< Array<A> >
 	{
 		// Is current array large enough?
 		if (nItems_ == size_) resize(size_+CHUNKSIZE);
+		else detach();
 
 		// Store new value
 		array_[nItems_++] = data;
 	}
 	// Return nth item in array
+	// -- Storage is detached from any other Arrays sharing it, so use value() (or a const Array) when only reading
 	A& operator[](int n)
+	{
+		detach();
+#ifdef CHECKS
+		if ((n < 0) || (n >= nItems_))
+		{
+			static A dummy;
+			msg.print("OUT_OF_RANGE - Array index %i is out of range in Array::operator[] (nItems = %i).\n", n, nItems_);
+			return dummy;
+		}
+#endif
+		return array_[n];
+	}
+	// Return nth item in array (const)
+	const A& operator[](int n) const
 	{
 #ifdef CHECKS
 		if ((n < 0) || (n >= nItems_))
@@ -218,21 +302,21 @@ template <class A> class Array : public ListItem< Array<A> >
 		return array_[n];
 	}
 	// Operator= (set all)
-	void operator=(const double value) { for (int n=0; n<nItems_; ++n) array_[n] = value; }
-	void operator=(const int value) { for (int n=0; n<nItems_; ++n) array_[n] = value; }
+	void operator=(const double value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] = value; }
+	void operator=(const int value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] = value; }
 	// Operator+= (add to all)
-	void operator+=(const double value) { for (int n=0; n<nItems_; ++n) array_[n] += value; }
-	void operator+=(const int value) { for (int n=0; n<nItems_; ++n) array_[n] += value; }
-	void operator+=(const Array<A> array) { for (int n=0; n<nItems_; ++n) array_[n] += array.value(n); }
+	void operator+=(const double value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] += value; }
+	void operator+=(const int value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] += value; }
+	void operator+=(const Array<A> array) { detach(); for (int n=0; n<nItems_; ++n) array_[n] += array.value(n); }
 	// Operator-= (subtract from all)
-	void operator-=(const double value) { for (int n=0; n<nItems_; ++n) array_[n] -= value; }
-	void operator-=(const int value) { for (int n=0; n<nItems_; ++n) array_[n] -= value; }
+	void operator-=(const double value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] -= value; }
+	void operator-=(const int value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] -= value; }
 	// Operator*= (multiply all)
-	void operator*=(const double value) { for (int n=0; n<nItems_; ++n) array_[n] *= value; }
-	void operator*=(const int value) { for (int n=0; n<nItems_; ++n) array_[n] *= value; }
+	void operator*=(const double value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] *= value; }
+	void operator*=(const int value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] *= value; }
 	// Operator/= (divide all)
-	void operator/=(const double value) { for (int n=0; n<nItems_; ++n) array_[n] /= value; }
-	void operator/=(const int value) { for (int n=0; n<nItems_; ++n) array_[n] /= value; }
+	void operator/=(const double value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] /= value; }
+	void operator/=(const int value) { detach(); for (int n=0; n<nItems_; ++n) array_[n] /= value; }
 	// Operator- (subtraction)
 	Array<A> operator-(const double value) { Array<A> result = *this; result -= value; return result; }
 	Array<A> operator-(const int value) { Array<A> result = *this; result -= value; return result; }
@@ -267,11 +351,13 @@ template <class A> class Array : public ListItem< Array<A> >
 	// Take log (base 10) of contained data
 	void takeLog()
 	{
+		detach();
 		 for (int n=0; n<nItems_; ++n) array_[n] = array_[n] < 1.0e-3 ? 0.0 : log10(array_[n]);
 	}
 	// Take natural log of contained data
 	void takeLn()
 	{
+		detach();
 		 for (int n=0; n<nItems_; ++n) array_[n] = array_[n] < 1.0e-3 ? 0.0 : log(array_[n]);
 	}
 	///@}